@@ -0,0 +1,570 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "batch.h"
+#include "blm.h"
+#include "lfg.h"
+#include "pm.h"
+#include "tsfunc.h"
+
+typedef struct {
+
+	const batch_t		*b;
+	batch_job_t		*job;
+}
+batch_arg_t;
+
+static const char	*batch_param_name[BATCH_PARAM_MAX] = {
+
+	"Rs", "Ld", "Lq", "Udc", "Rdc", "Zp", "Kv", "Jm"
+};
+
+static void
+batch_eabi_incremental() { ts_script_eabi(PM_EABI_INCREMENTAL); }
+
+static void
+batch_eabi_absolute() { ts_script_eabi(PM_EABI_ABSOLUTE); }
+
+static const struct {
+
+	const char	*name;
+	void		(* proc) ();
+}
+batch_script_list[] = {
+
+	{ "speed",	&ts_script_speed },
+	{ "hfi",	&ts_script_hfi },
+	{ "weakening",	&ts_script_weakening },
+	{ "hall",	&ts_script_hall },
+	{ "eabi_inc",	&batch_eabi_incremental },
+	{ "eabi_abs",	&batch_eabi_absolute },
+
+	{ NULL, NULL }
+};
+
+static int
+batch_parse(batch_t *b, const char *file)
+{
+	FILE		*fd;
+	char		line[400], *tok, *ep;
+	int		N, n, lN, rc = 0;
+
+	fd = fopen(file, "r");
+
+	if (fd == NULL) {
+
+		fprintf(stderr, "fopen: %s\n", strerror(errno));
+		return -1;
+	}
+
+	lN = 0;
+
+	while (fgets(line, sizeof(line), fd) != NULL) {
+
+		lN++;
+
+		tok = strtok(line, " \t\r\n");
+
+		if (tok == NULL || tok[0] == '#')
+			continue;
+
+		for (n = 0; n < BATCH_PARAM_MAX; ++n) {
+
+			if (strcmp(tok, batch_param_name[n]) == 0)
+				break;
+		}
+
+		if (n < BATCH_PARAM_MAX) {
+
+			b->length[n] = 0;
+
+			while ((tok = strtok(NULL, " \t\r\n")) != NULL) {
+
+				if (b->length[n] >= BATCH_VALUES_MAX) {
+
+					fprintf(stderr, "%s:%i: too many values\n", file, lN);
+					rc = -1;
+					break;
+				}
+
+				b->value[n][b->length[n]] = strtod(tok, &ep);
+
+				if (*ep != 0 || !(b->value[n][b->length[n]] > 0.)) {
+
+					fprintf(stderr, "%s:%i: bad value \"%s\"\n", file, lN, tok);
+					rc = -1;
+					break;
+				}
+
+				b->length[n]++;
+			}
+		}
+		else if (strcmp(tok, "script") == 0) {
+
+			while ((tok = strtok(NULL, " \t\r\n")) != NULL) {
+
+				for (n = 0; batch_script_list[n].name != NULL; ++n) {
+
+					if (strcmp(tok, batch_script_list[n].name) == 0)
+						break;
+				}
+
+				if (batch_script_list[n].name == NULL) {
+
+					fprintf(stderr, "%s:%i: unknown script \"%s\"\n", file, lN, tok);
+					rc = -1;
+					break;
+				}
+
+				if (b->script_N >= BATCH_SCRIPT_MAX) {
+
+					fprintf(stderr, "%s:%i: too many scripts\n", file, lN);
+					rc = -1;
+					break;
+				}
+
+				b->script[b->script_N++] = n;
+			}
+		}
+		else if (strcmp(tok, "seed") == 0) {
+
+			if ((tok = strtok(NULL, " \t\r\n")) != NULL)
+				b->seed = strtol(tok, NULL, 10);
+		}
+		else if (strcmp(tok, "solver") == 0) {
+
+			if ((tok = strtok(NULL, " \t\r\n")) != NULL) {
+
+				b->solver = sim_solver(tok);
+
+				if (b->solver < 0) {
+
+					fprintf(stderr, "%s:%i: unknown solver \"%s\"\n", file, lN, tok);
+					rc = -1;
+				}
+			}
+		}
+		else if (strcmp(tok, "telemetry") == 0) {
+
+			if ((tok = strtok(NULL, " \t\r\n")) != NULL)
+				b->telemetry = strtol(tok, NULL, 10);
+		}
+		else if (strcmp(tok, "decimate") == 0) {
+
+			if ((tok = strtok(NULL, " \t\r\n")) == NULL)
+				continue;
+
+			N = strtol(tok, &ep, 10);
+
+			if (*ep != 0 || N < 1) {
+
+				fprintf(stderr, "%s:%i: bad decimate \"%s\"\n", file, lN, tok);
+				rc = -1;
+			}
+
+			while (rc == 0 && (tok = strtok(NULL, " \t\r\n")) != NULL) {
+
+				n = strtol(tok, &ep, 10);
+
+				if (*ep != 0 || n < 1 || n >= TLM_SIZE) {
+
+					fprintf(stderr, "%s:%i: bad column \"%s\"\n", file, lN, tok);
+					rc = -1;
+					break;
+				}
+
+				if (b->decimate_N >= BATCH_DECIMATE_MAX) {
+
+					fprintf(stderr, "%s:%i: too many columns\n", file, lN);
+					rc = -1;
+					break;
+				}
+
+				b->decimate[b->decimate_N][0] = n;
+				b->decimate[b->decimate_N][1] = N;
+				b->decimate_N++;
+			}
+		}
+		else if (strcmp(tok, "threads") == 0) {
+
+			if ((tok = strtok(NULL, " \t\r\n")) != NULL)
+				b->threads = strtol(tok, NULL, 10);
+		}
+		else if (strcmp(tok, "output") == 0) {
+
+			if ((tok = strtok(NULL, " \t\r\n")) != NULL) {
+
+				strncpy(b->output, tok, sizeof(b->output) - 1);
+				b->output[sizeof(b->output) - 1] = 0;
+			}
+		}
+		else {
+			fprintf(stderr, "%s:%i: unknown keyword \"%s\"\n", file, lN, tok);
+			rc = -1;
+		}
+
+		if (rc != 0)
+			break;
+	}
+
+	fclose(fd);
+
+	return rc;
+}
+
+static int
+batch_expand(batch_t *b)
+{
+	batch_job_t	*job;
+	int		N, n, i, jN;
+
+	jN = 1;
+
+	for (n = 0; n < BATCH_PARAM_MAX; ++n) {
+
+		jN *= (b->length[n] > 0) ? b->length[n] : 1;
+	}
+
+	b->job = calloc(jN, sizeof(batch_job_t));
+
+	if (b->job == NULL) {
+
+		fprintf(stderr, "calloc: %s\n", strerror(errno));
+		return -1;
+	}
+
+	b->job_N = jN;
+
+	/* Make the cartesian product of all parameter lists. The missing
+	 * parameters are masked out to keep the model default.
+	 * */
+	for (N = 0; N < jN; ++N) {
+
+		job = &b->job[N];
+		i = N;
+
+		for (n = 0; n < BATCH_PARAM_MAX; ++n) {
+
+			if (b->length[n] > 0) {
+
+				job->param[n] = b->value[n][i % b->length[n]];
+				job->mask |= (1U << n);
+
+				i /= b->length[n];
+			}
+		}
+
+		job->seed = b->seed + N;
+	}
+
+	return 0;
+}
+
+static void
+batch_job_proc(void *arg)
+{
+	const batch_t	*b = ((batch_arg_t *) arg)->b;
+	batch_job_t	*job = ((batch_arg_t *) arg)->job;
+
+	const double	*param = job->param;
+	int		n;
+
+	memset(&m, 0, sizeof(m));
+	memset(&pm, 0, sizeof(pm));
+
+	blm_enable(&m);
+
+	m.sol_mode = b->solver;
+
+	lfg_start(&m.lfg, job->seed);
+
+#define batch_PARAM(n)		(job->mask & (1U << (n)))
+
+	if (batch_PARAM(BATCH_PARAM_RS))	{ m.Rs = param[BATCH_PARAM_RS]; }
+	if (batch_PARAM(BATCH_PARAM_LD))	{ m.Ld = param[BATCH_PARAM_LD]; }
+	if (batch_PARAM(BATCH_PARAM_LQ))	{ m.Lq = param[BATCH_PARAM_LQ]; }
+	if (batch_PARAM(BATCH_PARAM_UDC))	{ m.Udc = param[BATCH_PARAM_UDC]; }
+	if (batch_PARAM(BATCH_PARAM_RDC))	{ m.Rdc = param[BATCH_PARAM_RDC]; }
+	if (batch_PARAM(BATCH_PARAM_ZP))	{ m.Zp = (int) param[BATCH_PARAM_ZP]; }
+	if (batch_PARAM(BATCH_PARAM_JM))	{ m.Jm = param[BATCH_PARAM_JM]; }
+
+	if (batch_PARAM(BATCH_PARAM_KV)) {
+
+		m.lambda = blm_Kv_lambda(&m, param[BATCH_PARAM_KV]);
+	}
+
+	/* Store back the actual machine parameters.
+	 * */
+	job->param[BATCH_PARAM_RS] = m.Rs;
+	job->param[BATCH_PARAM_LD] = m.Ld;
+	job->param[BATCH_PARAM_LQ] = m.Lq;
+	job->param[BATCH_PARAM_UDC] = m.Udc;
+	job->param[BATCH_PARAM_RDC] = m.Rdc;
+	job->param[BATCH_PARAM_ZP] = m.Zp;
+	job->param[BATCH_PARAM_KV] = (60. / 2. / M_PI) / sqrt(3.) / (m.lambda * m.Zp);
+	job->param[BATCH_PARAM_JM] = m.Jm;
+
+	blm_restart(&m);
+
+	tlm_restart();
+
+	ts_script_default();
+	ts_script_base();
+	blm_restart(&m);
+
+	for (n = 0; n < b->script_N; ++n) {
+
+		batch_script_list[b->script[n]].proc();
+		blm_restart(&m);
+	}
+}
+
+static void
+batch_job_run(const batch_t *b, int N)
+{
+	batch_job_t	*job = &b->job[N];
+	batch_arg_t	arg = { b, job };
+
+	char		file_log[BATCH_PATH_MAX + 40];
+	char		file_tlm[BATCH_PATH_MAX + 40];
+	char		file_gp[BATCH_PATH_MAX + 40];
+
+	double		wall;
+	int		n;
+
+	sprintf(file_log, "%s/%i.log", b->output, N);
+
+	ts_log = fopen(file_log, "w");
+
+	if (ts_log == NULL) {
+
+		fprintf(stderr, "fopen: %s\n", strerror(errno));
+
+		job->status = -1;
+		job->fsm_errno = PM_OK;
+		return ;
+	}
+
+	if (b->telemetry != 0) {
+
+		sprintf(file_tlm, "%s/%i-TLM", b->output, N);
+		sprintf(file_gp, "%s/%i-auto.gp", b->output, N);
+
+		tlm_setup(file_tlm, file_gp);
+
+		for (n = 0; n < b->decimate_N; ++n) {
+
+			tlm_decimate(b->decimate[n][0], b->decimate[n][1]);
+		}
+	}
+	else {
+		tlm_setup(NULL, NULL);
+	}
+
+	wall = sim_clock();
+
+	job->status = sim_protect(&batch_job_proc, (void *) &arg);
+
+	job->wall = sim_clock() - wall;
+	job->fsm_errno = pm.fsm_errno;
+
+	job->const_Rs = pm.const_Rs;
+	job->const_L1 = pm.const_im_L1;
+	job->const_L2 = pm.const_im_L2;
+	job->const_lambda = pm.const_lambda;
+	job->const_Jm = pm.const_Ja * pm.const_Zp * pm.const_Zp;
+
+	tlm_close();
+
+	fclose(ts_log);
+	ts_log = NULL;
+}
+
+static void *
+batch_worker(void *arg)
+{
+	batch_t		*b = (batch_t *) arg;
+	int		N, done;
+
+	do {
+		/* Take the next job from the queue.
+		 * */
+		N = __atomic_fetch_add(&b->job_next, 1, __ATOMIC_RELAXED);
+
+		if (N >= b->job_N)
+			break;
+
+		batch_job_run(b, N);
+
+		done = __atomic_add_fetch(&b->job_done, 1, __ATOMIC_RELAXED);
+
+		fprintf(stderr, "  JOB	%i (%i/%i) %s %.1f (s)\n", N, done, b->job_N,
+				(b->job[N].status == 0) ? "OK" : "FAULT", b->job[N].wall);
+	}
+	while (1);
+
+	return NULL;
+}
+
+static void
+batch_report(const batch_t *b, FILE *fd)
+{
+	const batch_job_t	*job;
+	int			N, n;
+
+	fprintf(fd, "# N");
+
+	for (n = 0; n < BATCH_PARAM_MAX; ++n) {
+
+		fprintf(fd, " %s", batch_param_name[n]);
+	}
+
+	fprintf(fd, " status const_Rs const_L1 const_L2 const_lambda const_Jm wall\n");
+
+	for (N = 0; N < b->job_N; ++N) {
+
+		job = &b->job[N];
+
+		fprintf(fd, "%i", N);
+
+		for (n = 0; n < BATCH_PARAM_MAX; ++n) {
+
+			fprintf(fd, " %.4E", job->param[n]);
+		}
+
+		fprintf(fd, " %s %.4E %.4E %.4E %.4E %.4E %.2f\n",
+				(job->status == 0) ? "OK"
+				: (job->fsm_errno != PM_OK) ? pm_strerror(job->fsm_errno)
+				: "FAULT", job->const_Rs, job->const_L1, job->const_L2,
+				job->const_lambda, job->const_Jm, job->wall);
+	}
+}
+
+int batch_script(const char *file, int threads)
+{
+	batch_t		*b;
+	pthread_t	*pool;
+	FILE		*fd;
+
+	char		file_result[BATCH_PATH_MAX + 40];
+	double		wall, wall_sum;
+	int		N, rc = 0;
+
+	b = calloc(1, sizeof(batch_t));
+
+	if (b == NULL) {
+
+		fprintf(stderr, "calloc: %s\n", strerror(errno));
+		return -1;
+	}
+
+	b->seed = (int) time(NULL);
+	b->solver = BLM_SOLVER_FIXED;
+	b->telemetry = 0;
+	b->threads = 0;
+
+	strcpy(b->output, "/tmp/pm-batch");
+
+	do {
+		if ((rc = batch_parse(b, file)) != 0)
+			break;
+
+		if ((rc = batch_expand(b)) != 0)
+			break;
+
+		if (mkdir(b->output, 0755) != 0 && errno != EEXIST) {
+
+			fprintf(stderr, "mkdir: %s\n", strerror(errno));
+			rc = -1;
+			break;
+		}
+
+		b->threads = (threads > 0) ? threads : b->threads;
+
+		if (b->threads < 1) {
+
+			/* Use all online CPU cores.
+			 * */
+			b->threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+			b->threads = (b->threads < 1) ? 1 : b->threads;
+		}
+
+		b->threads = (b->threads > b->job_N) ? b->job_N : b->threads;
+
+		pool = calloc(b->threads, sizeof(pthread_t));
+
+		if (pool == NULL) {
+
+			fprintf(stderr, "calloc: %s\n", strerror(errno));
+			rc = -1;
+			break;
+		}
+
+		fprintf(stderr, "  BATCH	%i jobs on %i threads\n", b->job_N, b->threads);
+
+		wall = sim_clock();
+
+		for (N = 0; N < b->threads; ++N) {
+
+			if (pthread_create(&pool[N], NULL, &batch_worker, b) != 0) {
+
+				fprintf(stderr, "pthread_create: %s\n", strerror(errno));
+				break;
+			}
+		}
+
+		if (N == 0) {
+
+			/* Run in the main thread if we are unable to create
+			 * any worker.
+			 * */
+			batch_worker(b);
+		}
+
+		while (N > 0) {
+
+			pthread_join(pool[--N], NULL);
+		}
+
+		wall = sim_clock() - wall;
+		wall_sum = 0.;
+
+		for (N = 0; N < b->job_N; ++N) {
+
+			wall_sum += b->job[N].wall;
+			rc = (b->job[N].status != 0) ? -1 : rc;
+		}
+
+		free(pool);
+
+		batch_report(b, stdout);
+
+		sprintf(file_result, "%s/result.txt", b->output);
+
+		fd = fopen(file_result, "w");
+
+		if (fd != NULL) {
+
+			batch_report(b, fd);
+			fclose(fd);
+		}
+
+		fprintf(stderr, "  BATCH	%.1f (s) wall %.1f (s) serial %.1fx\n",
+				wall, wall_sum, wall_sum / wall);
+	}
+	while (0);
+
+	free(b->job);
+	free(b);
+
+	return rc;
+}
+
@@ -0,0 +1,68 @@
+#ifndef _H_BATCH_
+#define _H_BATCH_
+
+#define BATCH_VALUES_MAX	40
+#define BATCH_SCRIPT_MAX	10
+#define BATCH_PATH_MAX		200
+#define BATCH_DECIMATE_MAX	40
+
+enum {
+	BATCH_PARAM_RS		= 0,
+	BATCH_PARAM_LD,
+	BATCH_PARAM_LQ,
+	BATCH_PARAM_UDC,
+	BATCH_PARAM_RDC,
+	BATCH_PARAM_ZP,
+	BATCH_PARAM_KV,
+	BATCH_PARAM_JM,
+	BATCH_PARAM_MAX
+};
+
+typedef struct {
+
+	double		param[BATCH_PARAM_MAX];
+	int		mask;
+	int		seed;
+
+	int		status;
+	int		fsm_errno;
+	double		wall;
+
+	double		const_Rs;
+	double		const_L1;
+	double		const_L2;
+	double		const_lambda;
+	double		const_Jm;
+}
+batch_job_t;
+
+typedef struct {
+
+	double		value[BATCH_PARAM_MAX][BATCH_VALUES_MAX];
+	int		length[BATCH_PARAM_MAX];
+
+	int		script[BATCH_SCRIPT_MAX];
+	int		script_N;
+
+	int		seed;
+	int		solver;
+	int		telemetry;
+	int		threads;
+
+	int		decimate[BATCH_DECIMATE_MAX][2];
+	int		decimate_N;
+
+	char		output[BATCH_PATH_MAX];
+
+	batch_job_t	*job;
+	int		job_N;
+
+	int		job_next;
+	int		job_done;
+}
+batch_t;
+
+int batch_script(const char *file, int threads);
+
+#endif /* _H_BATCH_ */
+
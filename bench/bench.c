@@ -4,20 +4,30 @@
 #include <errno.h>
 #include <math.h>
 #include <time.h>
+#include <setjmp.h>
 
+#include "batch.h"
 #include "blm.h"
+#include "cost.h"
+#include "fast.h"
 #include "lfg.h"
+#include "mc.h"
+#include "perf.h"
 #include "pm.h"
+#include "tlz.h"
 #include "tsfunc.h"
 
 #define TLM_FILE	"/tmp/pm-TLM"
 #define PWM_FILE	"/tmp/pm-PWM"
 #define AGP_FILE	"/tmp/pm-auto.gp"
 
-#define TLM_SIZE	100
+/* Column where automatically named parameters begin, the machine columns
+ * below it are named in plot.gp.
+ * */
+#define TLM_NAMED_BEGIN	30
 
-blm_t			m;
-pmc_t			pm;
+__thread blm_t		m;
+__thread pmc_t		pm;
 
 typedef struct {
 
@@ -25,13 +35,23 @@ typedef struct {
 
 	float		y[TLM_SIZE];
 
-	FILE		*fd_tlm;
+	int		decimate[TLM_SIZE];
+	int		base_N;
+	int		named_N;
+
+	const char	*file_tlm;
+	const char	*file_gp;
+
+	tlz_t		*lz;
 	FILE		*fd_pwm;
 	FILE		*fd_gp;
 }
 tlm_t;
 
-static tlm_t		tlm;
+static __thread tlm_t		tlm;
+static __thread jmp_buf		*sim_fault;
+
+__thread sim_perf_t		*sim_perf;
 
 static void
 tlm_page_GP(int nGP, const char *figure, const char *label)
@@ -50,6 +70,7 @@ tlm_plot_grab()
 	double		A, B, C, D, Q, rel;
 	int		nGP;
 
+#define val_GP(x)		{ tlm.y[nGP++] = (float) (x); }
 #define sym_GP(x, s, l)		{ tlm.y[nGP] = (float) (x); if (tlm.fd_gp != NULL) \
 				{ tlm_page_GP(nGP, s, (const char *) l); } nGP++; }
 #define fmt_GP(x, l)		sym_GP(x, #x, l)
@@ -57,29 +78,31 @@ tlm_plot_grab()
 
 	/* Machine State Variables.
 	 * */
-	tlm.y[0] = m.time;
-	tlm.y[1] = m.state[0];
-	tlm.y[2] = m.state[1];
-	tlm.y[3] = m.state[2] * kRPM;
-	tlm.y[4] = m.state[3] * kDEG;
-	tlm.y[5] = m.state[4];
-	tlm.y[6] = m.state[6];
+	nGP = 0;
+
+	val_GP(m.time);
+	val_GP(m.state[0]);
+	val_GP(m.state[1]);
+	val_GP(m.state[2] * kRPM);
+	val_GP(m.state[3] * kDEG);
+	val_GP(m.state[4]);
+	val_GP(m.state[6]);
 
 	/* Duty Cycle.
 	 * */
-	tlm.y[7] = (double) m.pwm_A * 100. / (double) m.pwm_resolution;
-	tlm.y[8] = (double) m.pwm_B * 100. / (double) m.pwm_resolution;
-	tlm.y[9] = (double) m.pwm_C * 100. / (double) m.pwm_resolution;
+	val_GP((double) m.pwm_A * 100. / (double) m.pwm_resolution);
+	val_GP((double) m.pwm_B * 100. / (double) m.pwm_resolution);
+	val_GP((double) m.pwm_C * 100. / (double) m.pwm_resolution);
 
 	/* VSI Voltage.
 	 * */
-	tlm.y[10] = pm.vsi_X;
-	tlm.y[11] = pm.vsi_Y;
+	val_GP(pm.vsi_X);
+	val_GP(pm.vsi_Y);
 
 	/* Estimated Current.
 	 * */
-	tlm.y[12] = pm.lu_iD;
-	tlm.y[13] = pm.lu_iQ;
+	val_GP(pm.lu_iD);
+	val_GP(pm.lu_iQ);
 
 	D = cos(m.state[3]);
 	Q = sin(m.state[3]);
@@ -94,38 +117,40 @@ tlm_plot_grab()
 		pm.fsm_errno = PM_ERROR_NO_SYNC_FAULT;
 	}
 
-	tlm.y[14] = rel * kDEG;
+	val_GP(rel * kDEG);
 
 	/* Estimated Position.
 	 * */
-	tlm.y[15] = atan2(pm.lu_F[1], pm.lu_F[0]) * kDEG;
+	val_GP(atan2(pm.lu_F[1], pm.lu_F[0]) * kDEG);
 
 	/* Estimated Speed.
 	 * */
-	tlm.y[16] = pm.lu_wS * kRPM;
+	val_GP(pm.lu_wS * kRPM);
 
 	/* Power Consumption.
 	 * */
-	tlm.y[17] = m.drain_wP;
-	tlm.y[18] = pm.watt_drain_wP;
+	val_GP(m.drain_wP);
+	val_GP(pm.watt_drain_wP);
 
 	/* DC link Voltage.
 	 * */
-	tlm.y[19] = pm.const_fb_U;
+	val_GP(pm.const_fb_U);
 
 	blm_DQ_ABC(m.state[3], m.state[0], m.state[1], &A, &B, &C);
 
 	/* Absolute Current.
 	 * */
-	tlm.y[20] = fabsf(A);
-	tlm.y[21] = fabsf(B);
-	tlm.y[22] = fabsf(C);
+	val_GP(fabsf(A));
+	val_GP(fabsf(B));
+	val_GP(fabsf(C));
 
 	/* NOTE: Private parameters are managed with automatic generation of GP
 	 * configuration. So you only need to add a one line of code for each
 	 * parameter here.
 	 * */
-	nGP = 30;
+	tlm.base_N = nGP;
+
+	nGP = TLM_NAMED_BEGIN;
 
 	fmt_GP(pm.fb_uA, 0);
 	fmt_GP(pm.fb_uB, 0);
@@ -214,7 +239,31 @@ tlm_plot_grab()
 
 	if (tlm.fd_gp != NULL) { fclose(tlm.fd_gp); tlm.fd_gp = NULL; }
 
-	fwrite(tlm.y, sizeof(float), TLM_SIZE, tlm.fd_tlm);
+	if (tlm.lz->started == 0) {
+
+		tlm.named_N = nGP;
+
+		/* Drop the columns that are not named in GP configuration.
+		 * */
+		for (nGP = 0; nGP < TLM_SIZE; ++nGP) {
+
+			if (		nGP < tlm.base_N || (nGP >= TLM_NAMED_BEGIN
+						&& nGP < tlm.named_N)) {
+
+				tlz_column(tlm.lz, nGP, (nGP != 0 && tlm.decimate[nGP] > 1)
+						? tlm.decimate[nGP] : 1);
+			}
+			else {
+				tlz_column(tlm.lz, nGP, 0);
+			}
+		}
+	}
+
+	if (tlz_write(tlm.lz, tlm.y) != 0) {
+
+		fprintf(stderr, "tlz_write: failed\n");
+		sim_abort();
+	}
 }
 
 static void
@@ -268,19 +317,23 @@ static void
 tlm_PWM_grab()
 {
 	double		usual_dT;
+	int		usual_mode;
 
 	tlm.fd_pwm = fopen(PWM_FILE, "wb");
 
 	if (tlm.fd_pwm == NULL) {
 
 		fprintf(stderr, "fopen: %s", strerror(errno));
-		exit(-1);
+		sim_abort();
 	}
 
 	tlm.y[0] = 0.f;
 
 	usual_dT = m.sol_dT;
+	usual_mode = m.sol_mode;
+
 	m.sol_dT = 10.E-9;
+	m.sol_mode = BLM_SOLVER_FIXED;
 	m.proc_step = &tlm_proc_step;
 
 	/* Collect telemetry in one PWM cycle.
@@ -290,47 +343,121 @@ tlm_PWM_grab()
 	fclose(tlm.fd_pwm);
 
 	m.sol_dT = usual_dT;
+	m.sol_mode = usual_mode;
 	m.proc_step = NULL;
 }
 
-void tlm_restart()
+void tlm_setup(const char *file_tlm, const char *file_gp)
 {
-	if (tlm.fd_tlm == NULL) {
+	tlm.file_tlm = file_tlm;
+	tlm.file_gp = file_gp;
+}
 
-		tlm.fd_tlm = fopen(TLM_FILE, "wb");
+void tlm_restart()
+{
+	if (tlm.file_tlm == NULL) {
 
-		if (tlm.fd_tlm == NULL) {
+		/* Telemetry is disabled.
+		 * */
+		return ;
+	}
 
-			fprintf(stderr, "fopen: %s", strerror(errno));
-			exit(-1);
-		}
+	if (tlm.lz == NULL) {
 
-		tlm.fd_gp = fopen(AGP_FILE, "w");
+		tlm.fd_gp = fopen(tlm.file_gp, "w");
 
 		if (tlm.fd_gp == NULL) {
 
 			fprintf(stderr, "fopen: %s", strerror(errno));
-			exit(-1);
+			sim_abort();
 		}
 	}
 	else {
-		tlm.fd_tlm = freopen(NULL, "wb", tlm.fd_tlm);
+		tlz_close(tlm.lz);
+	}
+
+	tlm.lz = tlz_open(tlm.file_tlm, TLM_SIZE);
+
+	if (tlm.lz == NULL) {
+
+		sim_abort();
 	}
 }
 
+void tlm_decimate(int nGP, int N)
+{
+	if (nGP >= 0 && nGP < TLM_SIZE) {
+
+		tlm.decimate[nGP] = N;
+	}
+}
+
+void tlm_close()
+{
+	if (tlm.lz != NULL) {
+
+		tlz_close(tlm.lz);
+		tlm.lz = NULL;
+	}
+
+	if (tlm.fd_gp != NULL) {
+
+		fclose(tlm.fd_gp);
+		tlm.fd_gp = NULL;
+	}
+}
+
+void sim_abort()
+{
+	tlm_close();
+
+	if (sim_fault != NULL) {
+
+		/* Return back into the batch job.
+		 * */
+		longjmp(*sim_fault, 1);
+	}
+
+	exit(-1);
+}
+
+int sim_protect(void (* proc) (void *), void *arg)
+{
+	jmp_buf		fault;
+
+	if (setjmp(fault) != 0) {
+
+		sim_fault = NULL;
+		return -1;
+	}
+
+	sim_fault = &fault;
+
+	proc(arg);
+
+	sim_fault = NULL;
+
+	return 0;
+}
+
 void sim_runtime(double dT)
 {
+	sim_perf_t	*perf = sim_perf;
 	pmfb_t		fb;
-	double		stop;
+	double		stop, clock[3];
 
 	stop = m.time + dT;
 
 	while (m.time < stop) {
 
+		if (perf != NULL) { clock[0] = sim_clock(); }
+
 		/* Plant model update.
 		 * */
 		blm_update(&m);
 
+		if (perf != NULL) { clock[1] = sim_clock(); }
+
 		fb.current_A = m.analog_iA;
 		fb.current_B = m.analog_iB;
 		fb.current_C = m.analog_iC;
@@ -347,9 +474,24 @@ void sim_runtime(double dT)
 
 		/* PM update.
 		 * */
-		pm_feedback(&pm, &fb);
+		if (sim_cost != NULL) {
+
+			cost_feedback(&pm, &fb);
+		}
+		else {
+			pm_feedback(&pm, &fb);
+		}
+
+		if (perf != NULL) {
+
+			clock[2] = sim_clock();
+
+			perf->cycles += 1;
+			perf->blm += clock[1] - clock[0];
+			perf->pm += clock[2] - clock[1];
+		}
 
-		if (tlm.fd_tlm != NULL) {
+		if (tlm.lz != NULL) {
 
 			/* Collect telemetry.
 			 * */
@@ -360,12 +502,7 @@ void sim_runtime(double dT)
 
 			fprintf(stderr, "fsm_errno: %s\n", pm_strerror(pm.fsm_errno));
 
-			if (tlm.fd_tlm != NULL) {
-
-				fclose(tlm.fd_tlm);
-			}
-
-			exit(-1);
+			sim_abort();
 		}
 	}
 }
@@ -433,29 +570,137 @@ void bench_script()
 	tlm_PWM_grab();
 }
 
+int sim_solver(const char *name)
+{
+	int		mode = -1;
+
+	if (strcmp(name, "fixed") == 0) {
+
+		mode = BLM_SOLVER_FIXED;
+	}
+	else if (strcmp(name, "rk21") == 0) {
+
+		mode = BLM_SOLVER_RK21;
+	}
+	else if (strcmp(name, "rk54") == 0) {
+
+		mode = BLM_SOLVER_RK54;
+	}
+
+	return mode;
+}
+
+double sim_clock()
+{
+	struct timespec		ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (double) ts.tv_sec + (double) ts.tv_nsec * 1.E-9;
+}
+
+static void
+sim_solver_report(double wall)
+{
+	printf("\n---- Solver ----\n");
+
+	printf("sol_stat_time = %.3f (s)\n", m.sol_stat.time);
+	printf("sol_stat_steps = %li\n", m.sol_stat.steps);
+	printf("sol_stat_reject = %li\n", m.sol_stat.reject);
+	printf("sol_stat_eval = %li\n", m.sol_stat.eval);
+
+	printf("wall = %.3f (s) %.3f (sim/wall)\n", wall, m.sol_stat.time / wall);
+}
+
 int main(int argc, char *argv[])
 {
+	double		wall;
+	int		N, rc = 0;
+
 	if (argc < 2) {
 
 		exit(-1);
 	}
 
-	lfg_start((int) time(NULL));
+	lfg_start(&m.lfg, (int) time(NULL));
+
+	ts_log = stdout;
+
+	tlm_setup(TLM_FILE, AGP_FILE);
+
+	if (		argc > 2 && strcmp(argv[1], "batch") != 0
+			&& strcmp(argv[1], "cost") != 0
+			&& strcmp(argv[1], "mc") != 0
+			&& strcmp(argv[1], "fast") != 0) {
+
+		m.sol_mode = sim_solver(argv[2]);
+
+		if (m.sol_mode < 0) {
+
+			fprintf(stderr, "Unknown solver \"%s\" (fixed rk21 rk54)\n", argv[2]);
+			exit(-1);
+		}
+	}
+
+	if (		argc > 3 && (strcmp(argv[1], "test") == 0
+				|| strcmp(argv[1], "bench") == 0)) {
+
+		/* Decimate all telemetry columns except time.
+		 * */
+		for (N = 1; N < TLM_SIZE; ++N) {
+
+			tlm_decimate(N, strtol(argv[3], NULL, 10));
+		}
+	}
+
+	wall = sim_clock();
 
 	if (strcmp(argv[1], "test") == 0) {
 
 		ts_script_test();
+		sim_solver_report(sim_clock() - wall);
 	}
 	else if (strcmp(argv[1], "bench") == 0) {
 
 		bench_script();
+		sim_solver_report(sim_clock() - wall);
+	}
+	else if (strcmp(argv[1], "perf") == 0) {
+
+		rc = perf_script((argc > 3) ? argv[3] : PERF_FILE,
+				(argc > 4) ? argv[4] : NULL, m.sol_mode);
 	}
+	else if (strcmp(argv[1], "cost") == 0) {
 
-	if (tlm.fd_tlm != NULL) {
+		rc = cost_script((argc > 2) ? strtod(argv[2], NULL) : 0.,
+				(argc > 3) ? strtod(argv[3], NULL) : COST_CPU_HZ,
+				(argc > 4) ? strtod(argv[4], NULL) : 1.);
+	}
+	else if (strcmp(argv[1], "mc") == 0) {
 
-		fclose(tlm.fd_tlm);
+		rc = mc_script((argc > 2) ? strtol(argv[2], NULL, 10) : MC_LANES_DEFAULT,
+				(argc > 3) ? strtod(argv[3], NULL) : MC_TOL_DEFAULT,
+				(argc > 4) ? strtol(argv[4], NULL, 10) : 1);
 	}
+	else if (strcmp(argv[1], "fast") == 0) {
 
-	return 0;
+		rc = fast_script((argc > 2) ? strcmp(argv[2], "skip") == 0 : 0,
+				(argc > 3) ? strtod(argv[3], NULL) : FAST_SYNC_DEFAULT,
+				(argc > 4) ? strtol(argv[4], NULL, 10) : 1);
+	}
+	else if (strcmp(argv[1], "batch") == 0) {
+
+		if (argc < 3) {
+
+			fprintf(stderr, "Usage: %s batch <sweep> [threads]\n", argv[0]);
+			exit(-1);
+		}
+
+		rc = batch_script(argv[2], (argc > 3) ? strtol(argv[3], NULL, 10) : 0);
+	}
+
+	tlm_close();
+
+	return rc;
 }
 
@@ -49,6 +49,13 @@ void blm_enable(blm_t *m)
 
 	m->time = 0.;		/* Simulation TIME (Second) */
 	m->sol_dT = 5.E-6;	/* ODE solver step (Second) */
+	m->sol_tol = 1.E-2;	/* Adaptive solver tolerance */
+
+	m->sol_hnext = 0.;
+
+	/* NOTE: The solver mode and statistics are not touched here so you
+	 * can select the mode once from the outside.
+	 * */
 
 	m->pwm_dT = 35.E-6;		/* PWM cycle (Second)    */
 	m->pwm_deadtime = 170.E-9;	/* PWM deadtime (Second) */
@@ -68,14 +75,14 @@ void blm_enable(blm_t *m)
 	m->Ld = 11.E-6;
 	m->Lq = 16.E-6;
 
-	/* Flux linkage constant (Weber).
-         * */
-        m->lambda = blm_Kv_lambda(m, 270.);
-
 	/* Number of the rotor pole pairs.
 	 * */
 	m->Zp = 14;
 
+	/* Flux linkage constant (Weber).
+         * */
+        m->lambda = blm_Kv_lambda(m, 270.);
+
 	/* Ambient temperature (Celsius).
 	 * */
 	m->Ta = 25.;
@@ -241,11 +248,55 @@ blm_equation(const blm_t *m, const double state[7], double y[7])
 			+ (m->Ta - state[4]) / m->Rt) / m->Ct;
 }
 
+static void
+blm_sensor_step(blm_t *m, double dT)
+{
+	double		iA, iB, iC, uA, uB, uC, kA, kB, uMIN;
+
+	/* Sensor transient (FAST).
+	 * */
+	kA = 1.0 - exp(- dT / m->tau_A);
+	kB = 1.0 - exp(- dT / m->tau_B);
+
+	blm_DQ_ABC(m->state[3], m->state[0], m->state[1], &iA, &iB, &iC);
+
+	m->state[7] += (iA - m->state[7]) * kA;
+	m->state[8] += (iB - m->state[8]) * kA;
+	m->state[9] += (iC - m->state[9]) * kA;
+
+	if (m->pwm_Z != BLM_Z_DETACHED) {
+
+		uA = m->xfet[0] * m->state[6];
+		uB = m->xfet[1] * m->state[6];
+		uC = m->xfet[2] * m->state[6];
+	}
+	else {
+		blm_DQ_ABC(m->state[3], 0., m->lambda * m->state[2], &uA, &uB, &uC);
+
+		uMIN = (uA < uB) ? uA : uB;
+		uMIN = (uMIN < uC) ? uMIN : uC;
+
+		uA += - uMIN;
+		uB += - uMIN;
+		uC += - uMIN;
+	}
+
+	m->state[10] += (m->state[6]  - m->state[10]) * kA;
+	m->state[11] += (m->state[10] - m->state[11]) * kB;
+	m->state[12] += (uA - m->state[12]) * kB;
+	m->state[13] += (uB - m->state[13]) * kB;
+	m->state[14] += (uC - m->state[14]) * kB;
+
+	if (m->proc_step != NULL) {
+
+		m->proc_step(dT);
+	}
+}
+
 static void
 blm_ode_step(blm_t *m, double dT)
 {
 	double		x2[7], y1[7], y2[7];
-	double		iA, iB, iC, uA, uB, uC, kA, kB, uMIN;
 
 	/* Second-order ODE solver.
 	 * */
@@ -286,48 +337,276 @@ blm_ode_step(blm_t *m, double dT)
 	m->state[5] += (y1[5] + y2[5]) * dT / 2.;
 	m->state[6] += (y1[6] + y2[6]) * dT / 2.;
 
-	/* Sensor transient (FAST).
+	m->sol_stat.steps += 1;
+	m->sol_stat.eval += 2;
+
+	blm_sensor_step(m, dT);
+}
+
+typedef struct {
+
+	int		stages;
+	int		fsal;
+	int		order;
+
+	double		a[7][6];
+	double		b[7];
+	double		e[7];
+}
+blm_tableau_t;
+
+static const blm_tableau_t	blm_tableau_RK21 = {
+
+	/* Heun-Euler embedded pair 2(1).
 	 * */
-	kA = 1.0 - exp(- dT / m->tau_A);
-	kB = 1.0 - exp(- dT / m->tau_B);
+	2, 0, 1,
 
-	blm_DQ_ABC(m->state[3], m->state[0], m->state[1], &iA, &iB, &iC);
+	{	{ 0. },
+		{ 1. } },
 
-	m->state[7] += (iA - m->state[7]) * kA;
-	m->state[8] += (iB - m->state[8]) * kA;
-	m->state[9] += (iC - m->state[9]) * kA;
+	{ 1. / 2., 1. / 2. },
+	{ - 1. / 2., 1. / 2. }
+};
 
-	if (m->pwm_Z != BLM_Z_DETACHED) {
+static const blm_tableau_t	blm_tableau_RK54 = {
 
-		uA = m->xfet[0] * m->state[6];
-		uB = m->xfet[1] * m->state[6];
-		uC = m->xfet[2] * m->state[6];
+	/* Dormand-Prince embedded pair 5(4).
+	 * */
+	7, 1, 4,
+
+	{	{ 0. },
+		{ 1. / 5. },
+		{ 3. / 40., 9. / 40. },
+		{ 44. / 45., - 56. / 15., 32. / 9. },
+		{ 19372. / 6561., - 25360. / 2187., 64448. / 6561., - 212. / 729. },
+		{ 9017. / 3168., - 355. / 33., 46732. / 5247., 49. / 176.,
+			- 5103. / 18656. },
+		{ 35. / 384., 0., 500. / 1113., 125. / 192., - 2187. / 6784.,
+			11. / 84. } },
+
+	{ 35. / 384., 0., 500. / 1113., 125. / 192., - 2187. / 6784., 11. / 84., 0. },
+	{ 71. / 57600., 0., - 71. / 16695., 71. / 1920., - 17253. / 339200.,
+		22. / 525., - 1. / 40. }
+};
+
+static void
+blm_sol_equation(blm_t *m, const double state[7], double y[7])
+{
+	blm_equation(m, state, y);
+
+	if (m->pwm_Z == BLM_Z_DETACHED) {
+
+		y[0] = 0.;
+		y[1] = 0.;
+	}
+
+	m->sol_stat.eval += 1;
+}
+
+static void
+blm_sol_start(blm_t *m, double dT)
+{
+	const blm_tableau_t	*tb;
+
+	/* Absolute tolerance scale of each state variable.
+	 * */
+	const double		scale[7] = { 1., 1., 10., 1.E-2, 1., 1., 1. };
+
+	double		k[7][7], x[7], h, ex, err, fac;
+	int		i, j, n;
+
+	tb = (m->sol_mode == BLM_SOLVER_RK54) ? &blm_tableau_RK54 : &blm_tableau_RK21;
+
+	for (i = 0; i < 7; ++i) {
+
+		m->sol_y0[i] = m->state[i];
+	}
+
+	if (m->pwm_Z == BLM_Z_DETACHED) {
+
+		m->sol_y0[0] = 0.;
+		m->sol_y0[1] = 0.;
+	}
+
+	if (m->sol_fsal != 0) {
+
+		/* First same as last.
+		 * */
+		for (i = 0; i < 7; ++i) {
+
+			m->sol_k0[i] = m->sol_k1[i];
+		}
 	}
 	else {
-		blm_DQ_ABC(m->state[3], 0., m->lambda * m->state[2], &uA, &uB, &uC);
+		blm_sol_equation(m, m->sol_y0, m->sol_k0);
+	}
 
-		uMIN = (uA < uB) ? uA : uB;
-		uMIN = (uMIN < uC) ? uMIN : uC;
+	for (i = 0; i < 7; ++i) {
 
-		uA += - uMIN;
-		uB += - uMIN;
-		uC += - uMIN;
+		k[0][i] = m->sol_k0[i];
 	}
 
-	m->state[10] += (m->state[6]  - m->state[10]) * kA;
-	m->state[11] += (m->state[10] - m->state[11]) * kB;
-	m->state[12] += (uA - m->state[12]) * kB;
-	m->state[13] += (uB - m->state[13]) * kB;
-	m->state[14] += (uC - m->state[14]) * kB;
+	/* Do not step over the end of PWM cycle.
+	 * */
+	fac = (m->sol_left > dT) ? m->sol_left : dT;
 
-	if (m->proc_step != NULL) {
+	h = (m->sol_hnext > 0.) ? m->sol_hnext : m->sol_dT;
+	h = (h < fac) ? h : fac;
 
-		m->proc_step(dT);
+	do {
+		for (n = 1; n < tb->stages; ++n) {
+
+			for (i = 0; i < 7; ++i) {
+
+				x[i] = 0.;
+
+				for (j = 0; j < n; ++j) {
+
+					x[i] += tb->a[n][j] * k[j][i];
+				}
+
+				x[i] = m->sol_y0[i] + x[i] * h;
+			}
+
+			blm_sol_equation(m, x, k[n]);
+		}
+
+		err = 0.;
+
+		for (i = 0; i < 7; ++i) {
+
+			x[i] = 0.;
+			ex = 0.;
+
+			for (n = 0; n < tb->stages; ++n) {
+
+				x[i] += tb->b[n] * k[n][i];
+				ex += tb->e[n] * k[n][i];
+			}
+
+			m->sol_y1[i] = m->sol_y0[i] + x[i] * h;
+
+			/* Mixed absolute and relative error.
+			 * */
+			ex = fabs(ex * h) / (m->sol_tol * (scale[i] + fabs(m->sol_y1[i])));
+			err = (ex > err) ? ex : err;
+		}
+
+		if (err > 1.E-12) {
+
+			fac = (tb->order == 1) ? 1. / sqrt(err)
+				: pow(err, - 1. / (tb->order + 1));
+
+			fac *= 0.9;
+		}
+		else {
+			fac = 2.;
+		}
+
+		if (err < 1. || h < 1.E-9) {
+
+			/* Accept the step.
+			 * */
+			m->sol_stat.steps += 1;
+
+			fac = (fac < 2.) ? fac : 2.;
+			m->sol_hnext = h * fac;
+			break;
+		}
+
+		m->sol_stat.reject += 1;
+
+		fac = (fac > .2) ? fac : .2;
+		h *= fac;
+	}
+	while (1);
+
+	if (tb->fsal != 0) {
+
+		for (i = 0; i < 7; ++i) {
+
+			m->sol_k1[i] = k[tb->stages - 1][i];
+		}
 	}
+
+	m->sol_h = h;
+	m->sol_tau = 0.;
+
+	m->sol_pending = 1;
+	m->sol_fsal = 0;
+
+	m->sol_xfet[0] = m->xfet[0];
+	m->sol_xfet[1] = m->xfet[1];
+	m->sol_xfet[2] = m->xfet[2];
+	m->sol_xfet[3] = m->pwm_Z;
 }
 
 static void
-blm_solve(blm_t *m, double dT)
+blm_sol_interp(const blm_t *m, double tau, double y[7])
+{
+	double		th, h00, h10, h01, h11;
+	int		i;
+
+	th = tau / m->sol_h;
+
+	if (m->sol_mode == BLM_SOLVER_RK54) {
+
+		/* Cubic Hermite interpolation.
+		 * */
+		h00 = (2. * th - 3.) * th * th + 1.;
+		h10 = ((th - 2.) * th + 1.) * th * m->sol_h;
+		h01 = (3. - 2. * th) * th * th;
+		h11 = (th - 1.) * th * th * m->sol_h;
+
+		for (i = 0; i < 7; ++i) {
+
+			y[i] =    h00 * m->sol_y0[i] + h10 * m->sol_k0[i]
+				+ h01 * m->sol_y1[i] + h11 * m->sol_k1[i];
+		}
+	}
+	else {
+		/* Quadratic interpolation.
+		 * */
+		for (i = 0; i < 7; ++i) {
+
+			y[i] = m->sol_y0[i] + th * m->sol_h * m->sol_k0[i]
+				+ th * th * (m->sol_y1[i] - m->sol_y0[i]
+						- m->sol_h * m->sol_k0[i]);
+		}
+	}
+}
+
+static int
+blm_sol_deadtime(const blm_t *m, const double y[7])
+{
+	double		iABC[3];
+	int		n, ev = 0;
+
+	if ((m->xdtu[0] | m->xdtu[1] | m->xdtu[2]) == 0) {
+
+		/* No Dead-Time in progress.
+		 * */
+		return 0;
+	}
+
+	blm_DQ_ABC(y[3], y[0], y[1], &iABC[0], &iABC[1], &iABC[2]);
+
+	for (n = 0; n < 3; ++n) {
+
+		if (m->xdtu[n] != 0) {
+
+			/* Current crossed the threshold on Dead-Time.
+			 * */
+			ev |= (m->xfet[n] != 0 && iABC[n] > m->Dtol) ? (1 << n) : 0;
+			ev |= (m->xfet[n] == 0 && iABC[n] < - m->Dtol) ? (1 << n) : 0;
+		}
+	}
+
+	return ev;
+}
+
+static void
+blm_vsi_deadtime(blm_t *m)
 {
 	double		iA, iB, iC;
 
@@ -353,68 +632,170 @@ blm_solve(blm_t *m, double dT)
 		 * */
 		m->xfet[2] = (iC > m->Dtol) ? 0 : (iC < - m->Dtol) ? 1 : m->xfet[2];
 	}
+}
 
+static void
+blm_vsi_surge(blm_t *m)
+{
 	if (m->xfet[0] != m->xfet[3]) {
 
 		/* ADC surge on A.
 		 * */
-		m->state[7]  += lfg_gauss() * 5.;
-		m->state[10] += lfg_gauss() * 2.;
+		m->state[7]  += lfg_gauss(&m->lfg) * 5.;
+		m->state[10] += lfg_gauss(&m->lfg) * 2.;
 	}
 
 	if (m->xfet[1] != m->xfet[4]) {
 
 		/* ADC surge on B.
 		 * */
-		m->state[8]  += lfg_gauss() * 5.;
-		m->state[10] += lfg_gauss() * 2.;
+		m->state[8]  += lfg_gauss(&m->lfg) * 5.;
+		m->state[10] += lfg_gauss(&m->lfg) * 2.;
 	}
 
 	if (m->xfet[2] != m->xfet[5]) {
 
 		/* ADC surge on C.
 		 * */
-		m->state[9]  += lfg_gauss() * 5.;
-		m->state[10] += lfg_gauss() * 2.;
+		m->state[9]  += lfg_gauss(&m->lfg) * 5.;
+		m->state[10] += lfg_gauss(&m->lfg) * 2.;
 	}
 
-	/* Divide the long interval.
+	/* Keep the previous VSI state.
 	 * */
-	while (dT > m->sol_dT) {
+	m->xfet[3] = m->xfet[0];
+	m->xfet[4] = m->xfet[1];
+	m->xfet[5] = m->xfet[2];
+}
+
+static void
+blm_sol_adaptive(blm_t *m, double dT)
+{
+	double		y[7], dt, t0, t1, tm;
+	int		i, ev;
 
-		blm_ode_step(m, m->sol_dT);
-		dT -= m->sol_dT;
+	if (		m->sol_pending != 0
+			&& (	   m->sol_xfet[0] != m->xfet[0]
+				|| m->sol_xfet[1] != m->xfet[1]
+				|| m->sol_xfet[2] != m->xfet[2]
+				|| m->sol_xfet[3] != m->pwm_Z)) {
+
+		/* VSI switching instant. Drop the rest of step.
+		 * */
+		m->sol_pending = 0;
+		m->sol_fsal = 0;
 	}
 
-	blm_ode_step(m, dT);
+	while (dT > 1.E-15) {
+
+		if (m->sol_pending == 0) {
+
+			blm_sol_start(m, dT);
+		}
+
+		dt = m->sol_h - m->sol_tau;
+		dt = (dt < dT) ? dt : dT;
+
+		blm_sol_interp(m, m->sol_tau + dt, y);
+
+		ev = blm_sol_deadtime(m, y);
+
+		if (ev != 0) {
+
+			/* Locate the Dead-Time event by bisection.
+			 * */
+			t0 = m->sol_tau;
+			t1 = m->sol_tau + dt;
+
+			while (t1 - t0 > 1.E-9) {
+
+				tm = (t0 + t1) / 2.;
+
+				blm_sol_interp(m, tm, y);
+
+				if (blm_sol_deadtime(m, y) != 0) { t1 = tm; } else { t0 = tm; }
+			}
+
+			dt = t1 - m->sol_tau;
+
+			blm_sol_interp(m, t1, y);
+		}
+
+		for (i = 0; i < 7; ++i) {
+
+			m->state[i] = y[i];
+		}
+
+		m->sol_tau += dt;
+		m->sol_left -= dt;
+
+		dT -= dt;
+
+		blm_sensor_step(m, dt);
+
+		if (ev != 0) {
+
+			blm_vsi_deadtime(m);
+			blm_vsi_surge(m);
+
+			m->sol_pending = 0;
+			m->sol_fsal = 0;
+		}
+		else if (m->sol_h - m->sol_tau < 1.E-15) {
+
+			m->sol_pending = 0;
+			m->sol_fsal = (m->sol_mode == BLM_SOLVER_RK54) ? 1 : 0;
+		}
+	}
+}
+
+static void
+blm_solve(blm_t *m, double dT)
+{
+	blm_vsi_deadtime(m);
+	blm_vsi_surge(m);
+
+	if (m->sol_mode == BLM_SOLVER_FIXED) {
+
+		/* Divide the long interval.
+		 * */
+		while (dT > m->sol_dT) {
+
+			blm_ode_step(m, m->sol_dT);
+			dT -= m->sol_dT;
+		}
+
+		blm_ode_step(m, dT);
+	}
+	else {
+		blm_sol_adaptive(m, dT);
+	}
 
 	if (m->state[3] < - M_PI) {
 
 		m->state[3] += 2. * M_PI;
+		m->sol_y0[3] += 2. * M_PI;
+		m->sol_y1[3] += 2. * M_PI;
 		m->revol -= 1;
 	}
 	else if (m->state[3] > M_PI) {
 
 		m->state[3] -= 2. * M_PI;
+		m->sol_y0[3] -= 2. * M_PI;
+		m->sol_y1[3] -= 2. * M_PI;
 		m->revol += 1;
 	}
-
-	/* Keep the previous VSI state.
-	 * */
-	m->xfet[3] = m->xfet[0];
-	m->xfet[4] = m->xfet[1];
-	m->xfet[5] = m->xfet[2];
 }
 
 static double
-blm_ADC(double vconv, double vmin, double vmax)
+blm_ADC(blm_t *m, double vconv, double vmin, double vmax)
 {
 	double		rel;
 	int		ADC;
 
 	rel = (vconv - vmin) / (vmax - vmin);
 
-	ADC = (int) (rel * 4096. + lfg_gauss() * 2.);
+	ADC = (int) (rel * 4096. + lfg_gauss(&m->lfg) * 2.);
 	ADC = ADC < 0 ? 0 : ADC > 4095 ? 4095 : ADC;
 
 	return (double) ADC / 4096. * (vmax - vmin) + vmin;
@@ -472,8 +853,8 @@ blm_sample_analog(blm_t *m)
 	location = m->state[3] + (2. * M_PI) * (double) m->revol;
 	angle = location * m->analog_Zq / m->Zp;
 
-	m->analog_SIN = (float) blm_ADC(sin(angle), - 3., 3.);
-	m->analog_COS = (float) blm_ADC(cos(angle), - 3., 3.);
+	m->analog_SIN = (float) blm_ADC(m, sin(angle), - 3., 3.);
+	m->analog_COS = (float) blm_ADC(m, cos(angle), - 3., 3.);
 }
 
 static void
@@ -509,19 +890,19 @@ blm_pwm_up_event(blm_t *m, int ev)
 	switch (ev) {
 
 		case 0:
-			m->analog_iA = (float) blm_ADC(m->state[7], - m->range_A, m->range_A);
-			m->analog_iB = (float) blm_ADC(m->state[8], - m->range_A, m->range_A);
-			m->analog_iC = (float) blm_ADC(m->state[9], - m->range_A, m->range_A);
+			m->analog_iA = (float) blm_ADC(m, m->state[7], - m->range_A, m->range_A);
+			m->analog_iB = (float) blm_ADC(m, m->state[8], - m->range_A, m->range_A);
+			m->analog_iC = (float) blm_ADC(m, m->state[9], - m->range_A, m->range_A);
 			break;
 
 		case 1:
-			m->analog_uS = (float) blm_ADC(m->state[11], 0., m->range_B);
-			m->analog_uA = (float) blm_ADC(m->state[12], 0., m->range_B);
-			m->analog_uB = (float) blm_ADC(m->state[13], 0., m->range_B);
+			m->analog_uS = (float) blm_ADC(m, m->state[11], 0., m->range_B);
+			m->analog_uA = (float) blm_ADC(m, m->state[12], 0., m->range_B);
+			m->analog_uB = (float) blm_ADC(m, m->state[13], 0., m->range_B);
 			break;
 
 		case 2:
-			m->analog_uC = (float) blm_ADC(m->state[14], 0., m->range_B);
+			m->analog_uC = (float) blm_ADC(m, m->state[14], 0., m->range_B);
 
 			blm_sample_analog(m);
 			blm_sample_hall(m);
@@ -649,6 +1030,12 @@ blm_pwm_solve(blm_t *m)
 	 * */
 	blm_pwm_bsort(m);
 
+	/* Start the adaptive solver from scratch.
+	 * */
+	m->sol_pending = 0;
+	m->sol_fsal = 0;
+	m->sol_left = m->pwm_dT;
+
 	/* PWM count up.
 	 * */
 	blm_pwm_up_event(m, 0);
@@ -704,5 +1091,6 @@ void blm_update(blm_t *m)
 	blm_pwm_solve(m);
 
 	m->time += m->pwm_dT;
+	m->sol_stat.time += m->pwm_dT;
 }
 
@@ -1,16 +1,50 @@
 #ifndef _H_BLM_
 #define _H_BLM_
 
+#include "lfg.h"
+
 enum {
 	BLM_Z_NONE		= 0,
 	BLM_Z_DETACHED
 };
 
+enum {
+	BLM_SOLVER_FIXED	= 0,
+	BLM_SOLVER_RK21,
+	BLM_SOLVER_RK54
+};
+
 typedef struct {
 
 	double		time;
 	double		sol_dT;
 
+	int		sol_mode;
+	double		sol_tol;
+
+	double		sol_y0[7];
+	double		sol_y1[7];
+	double		sol_k0[7];
+	double		sol_k1[7];
+
+	double		sol_h;
+	double		sol_tau;
+	double		sol_hnext;
+	double		sol_left;
+
+	int		sol_pending;
+	int		sol_fsal;
+	int		sol_xfet[4];
+
+	struct {
+
+		double	time;
+		long	steps;
+		long	reject;
+		long	eval;
+	}
+	sol_stat;
+
 	int		unsync_flag;
 
 	double		pwm_dT;
@@ -84,6 +118,8 @@ typedef struct {
 	float		analog_SIN;
 	float		analog_COS;
 
+	lfg_t		lfg;
+
 	void 		(* proc_step) (double);
 }
 blm_t;
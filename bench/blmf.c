@@ -0,0 +1,737 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "blm.h"
+#include "blmf.h"
+#include "lfg.h"
+
+typedef struct {
+
+	int		comp;
+	int		ev;
+}
+blmf_event_t;
+
+void blmf_enable(blmf_t *mf, const blm_t *m)
+{
+	mf->time = 0.;
+	mf->sol_dT = m->sol_dT;
+
+	/* NOTE: The dead-time mode is not touched here so you can select
+	 * the mode once from the outside.
+	 * */
+
+	mf->pwm_dT = m->pwm_dT;
+	mf->pwm_deadtime = m->pwm_deadtime;
+	mf->pwm_minimal = m->pwm_minimal;
+	mf->pwm_resolution = m->pwm_resolution;
+
+	mf->Dtol = (float) m->Dtol;
+
+	mf->Rs = (float) m->Rs;
+	mf->Ld = (float) m->Ld;
+	mf->Lq = (float) m->Lq;
+	mf->lambda = (float) m->lambda;
+	mf->Zp = (float) m->Zp;
+
+	mf->Ta = (float) m->Ta;
+	mf->Ct = (float) m->Ct;
+	mf->Rt = (float) m->Rt;
+
+	mf->Udc = (float) m->Udc;
+	mf->Rdc = (float) m->Rdc;
+	mf->Cdc = (float) m->Cdc;
+
+	mf->Jm = (float) m->Jm;
+
+	mf->Mq[0] = (float) m->Mq[0];
+	mf->Mq[1] = (float) m->Mq[1];
+	mf->Mq[2] = (float) m->Mq[2];
+	mf->Mq[3] = (float) m->Mq[3];
+
+	mf->adc_Tconv = m->adc_Tconv;
+	mf->tau_A = m->tau_A;
+	mf->tau_B = m->tau_B;
+	mf->range_A = (float) m->range_A;
+	mf->range_B = (float) m->range_B;
+
+	mf->hall[0] = (float) m->hall[0];
+	mf->hall[1] = (float) m->hall[1];
+	mf->hall[2] = (float) m->hall[2];
+
+	mf->eabi_ERES = m->eabi_ERES;
+	mf->eabi_WRAP = m->eabi_WRAP;
+	mf->eabi_Zq = (float) m->eabi_Zq;
+
+	mf->analog_Zq = (float) m->analog_Zq;
+
+	/* Force the table to be built on the next cycle.
+	 * */
+	mf->tab_resolution = 0;
+
+	mf->sol_stat.steps = 0;
+}
+
+void blmf_seed(blmf_t *mf, int seed)
+{
+	lfg_t		lfg;
+	int		i;
+
+	/* We take the same distribution as BLM model does.
+	 * */
+	lfg_start(&lfg, seed);
+
+	for (i = 0; i < (1 << BLMF_GAUSS_BITS); ++i) {
+
+		mf->gauss[i] = (float) lfg_gauss(&lfg);
+	}
+
+	mf->gauss_lcgu = (uint32_t) seed;
+}
+
+void blmf_restart(blmf_t *mf)
+{
+	int		i;
+
+	for (i = 0; i < 15; ++i) {
+
+		mf->state[i] = 0.f;
+	}
+
+	mf->state[4] = mf->Ta;
+	mf->state[6] = mf->Udc;
+	mf->state[10] = mf->Udc;
+	mf->state[11] = mf->Udc;
+
+	mf->acc[0] = 0.;
+	mf->acc[1] = 0.;
+	mf->acc[2] = mf->Ta;
+
+	mf->inc[0] = 0.f;
+	mf->inc[1] = 0.f;
+	mf->inc[2] = 0.f;
+
+	for (i = 0; i < 6; ++i) {
+
+		mf->xfet[i] = 0;
+	}
+
+	mf->xdtu[0] = 0;
+	mf->xdtu[1] = 0;
+	mf->xdtu[2] = 0;
+
+	mf->drain_wP = 0.f;
+	mf->revol = 0;
+}
+
+static inline float
+blmf_gauss(blmf_t *mf)
+{
+	/* Linear Congruential generator picks the table entry.
+	 * */
+	mf->gauss_lcgu = mf->gauss_lcgu * 1664525U + 1013904223U;
+
+	return mf->gauss[mf->gauss_lcgu >> (32 - BLMF_GAUSS_BITS)];
+}
+
+static inline float
+blmf_ADC(blmf_t *mf, float vconv, float vmin, float vmax)
+{
+	float		rel;
+	int		ADC;
+
+	rel = (vconv - vmin) / (vmax - vmin);
+
+	ADC = (int) (rel * 4096.f + blmf_gauss(mf) * 2.f);
+	ADC = ADC < 0 ? 0 : ADC > 4095 ? 4095 : ADC;
+
+	return (float) ADC * (1.f / 4096.f) * (vmax - vmin) + vmin;
+}
+
+static inline void
+blmf_DQ_ABC(float tS, float tC, float D, float Q, float ABC[3])
+{
+	float		X, Y;
+
+	X = tC * D - tS * Q;
+	Y = tS * D + tC * Q;
+
+	ABC[0] = X;
+	ABC[1] = - 0.5f * X + 0.866025404f * Y;
+	ABC[2] = - 0.5f * X - 0.866025404f * Y;
+}
+
+static inline void
+blmf_rotate(float S, float C, float d, float *rS, float *rC)
+{
+	float		d2, kS, kC;
+
+	/* Rotation by small angle from Taylor series. We take SIN/COS of
+	 * the position once in PWM cycle and only rotate it in the steps.
+	 * */
+	d2 = d * d;
+
+	kS = d * (1.f - d2 * (1.f / 6.f));
+	kC = 1.f - d2 * (0.5f - d2 * (1.f / 24.f));
+
+	*rS = S * kC + C * kS;
+	*rC = C * kC - S * kS;
+}
+
+static void
+blmf_equation(const blmf_t *mf, const float x[7], float tS, float tC, float y[7])
+{
+	float		uA, uB, uX, uY, uD, uQ, Rs, lambda, mP, mQ, mS;
+
+	/* Thermal drift.
+	 * */
+	Rs = mf->Rs * (1.f + 4.E-3f * (x[4] - mf->Ta));
+	lambda = mf->lambda * (1.f - 1.E-3f * (x[4] - mf->Ta));
+
+	/* Voltage from VSI.
+	 * */
+	uQ = (float) (mf->xfet[0] + mf->xfet[1] + mf->xfet[2]) * (1.f / 3.f);
+	uA = ((float) mf->xfet[0] - uQ) * x[6];
+	uB = ((float) mf->xfet[1] - uQ) * x[6];
+
+	uX = uA;
+	uY = 0.577350269f * uA + 1.154700538f * uB;
+
+	uD = tC * uX + tS * uY;
+	uQ = tC * uY - tS * uX;
+
+	/* Energy consumption equation.
+	 * */
+	y[5] = 1.5f * (x[0] * uD + x[1] * uQ);
+
+	/* DC link voltage equation.
+	 * */
+	y[6] = ((mf->Udc - x[6]) * mf->inv_Rdc - y[5] / x[6]) * mf->inv_Cdc;
+
+	/* Electrical equations of PMSM.
+	 * */
+	uD += - Rs * x[0] + mf->Lq * x[2] * x[1];
+	uQ += - Rs * x[1] - mf->Ld * x[2] * x[0] - lambda * x[2];
+
+	y[0] = uD * mf->inv_Ld;
+	y[1] = uQ * mf->inv_Lq;
+
+	/* Torque production.
+	 * */
+	mP = 1.5f * mf->Zp * (lambda + (mf->Ld - mf->Lq) * x[0]) * x[1];
+
+	/* Mechanical load torque.
+	 * */
+	mS = x[2] * mf->inv_Zp;
+	mQ = mf->Mq[0] - mS * (mf->Mq[1] + fabsf(mS) * mf->Mq[2]);
+	mQ += (mS < 0.f) ? mf->Mq[3] : - mf->Mq[3];
+
+	/* Mechanical equations.
+	 * */
+	y[2] = mf->Zp * (mP + mQ) * mf->inv_Jm;
+	y[3] = x[2];
+
+	/* Thermal equation.
+	 * */
+	y[4] = (1.5f * Rs * (x[0] * x[0] + x[1] * x[1])
+			+ (mf->Ta - x[4]) * mf->inv_Rt) * mf->inv_Ct;
+}
+
+static void
+blmf_sensor_step(blmf_t *mf, int k)
+{
+	float		iABC[3], uABC[3], kA, kB, uMIN;
+
+	/* Sensor transient (FAST).
+	 * */
+	kA = mf->kA[k];
+	kB = mf->kB[k];
+
+	blmf_DQ_ABC(mf->pos_S, mf->pos_C, mf->state[0], mf->state[1], iABC);
+
+	mf->state[7] += (iABC[0] - mf->state[7]) * kA;
+	mf->state[8] += (iABC[1] - mf->state[8]) * kA;
+	mf->state[9] += (iABC[2] - mf->state[9]) * kA;
+
+	if (mf->pwm_Z != BLM_Z_DETACHED) {
+
+		uABC[0] = (float) mf->xfet[0] * mf->state[6];
+		uABC[1] = (float) mf->xfet[1] * mf->state[6];
+		uABC[2] = (float) mf->xfet[2] * mf->state[6];
+	}
+	else {
+		blmf_DQ_ABC(mf->pos_S, mf->pos_C, 0.f, mf->lambda * mf->state[2], uABC);
+
+		uMIN = (uABC[0] < uABC[1]) ? uABC[0] : uABC[1];
+		uMIN = (uMIN < uABC[2]) ? uMIN : uABC[2];
+
+		uABC[0] += - uMIN;
+		uABC[1] += - uMIN;
+		uABC[2] += - uMIN;
+	}
+
+	mf->state[10] += (mf->state[6]  - mf->state[10]) * kA;
+	mf->state[11] += (mf->state[10] - mf->state[11]) * kB;
+	mf->state[12] += (uABC[0] - mf->state[12]) * kB;
+	mf->state[13] += (uABC[1] - mf->state[13]) * kB;
+	mf->state[14] += (uABC[2] - mf->state[14]) * kB;
+}
+
+static void
+blmf_ode_step(blmf_t *mf, int k)
+{
+	float		x2[7], y1[7], y2[7], dT, hT, tS, tC;
+	int		i;
+
+	/* Second-order ODE solver.
+	 * */
+	dT = (float) k * mf->tick_dT;
+	hT = dT * 0.5f;
+
+	blmf_equation(mf, mf->state, mf->pos_S, mf->pos_C, y1);
+
+	if (mf->pwm_Z != BLM_Z_DETACHED) {
+
+		x2[0] = mf->state[0] + y1[0] * dT;
+		x2[1] = mf->state[1] + y1[1] * dT;
+	}
+	else {
+		x2[0] = 0.f;
+		x2[1] = 0.f;
+	}
+
+	for (i = 2; i < 7; ++i) {
+
+		x2[i] = mf->state[i] + y1[i] * dT;
+	}
+
+	blmf_rotate(mf->pos_S, mf->pos_C, y1[3] * dT, &tS, &tC);
+	blmf_equation(mf, x2, tS, tC, y2);
+
+	if (mf->pwm_Z != BLM_Z_DETACHED) {
+
+		mf->state[0] += (y1[0] + y2[0]) * hT;
+		mf->state[1] += (y1[1] + y2[1]) * hT;
+	}
+	else {
+		mf->state[0] = 0.f;
+		mf->state[1] = 0.f;
+	}
+
+	for (i = 0; i < 3; ++i) {
+
+		mf->inc[i] += (y1[i + 2] + y2[i + 2]) * hT;
+		mf->state[i + 2] = (float) (mf->acc[i] + (double) mf->inc[i]);
+	}
+
+	mf->state[5] += (y1[5] + y2[5]) * hT;
+	mf->state[6] += (y1[6] + y2[6]) * hT;
+
+	blmf_rotate(mf->pos_S, mf->pos_C, (y1[3] + y2[3]) * hT, &tS, &tC);
+
+	mf->pos_S = tS;
+	mf->pos_C = tC;
+
+	mf->sol_stat.steps += 1;
+
+	blmf_sensor_step(mf, k);
+}
+
+static void
+blmf_vsi_deadtime(blmf_t *mf)
+{
+	float		iABC[3];
+	int		n;
+
+	if ((mf->xdtu[0] | mf->xdtu[1] | mf->xdtu[2]) == 0) {
+
+		/* No Dead-Time in progress.
+		 * */
+		return ;
+	}
+
+	blmf_DQ_ABC(mf->pos_S, mf->pos_C, mf->state[0], mf->state[1], iABC);
+
+	for (n = 0; n < 3; ++n) {
+
+		if (mf->xdtu[n] != 0) {
+
+			mf->xfet[n] = (iABC[n] > mf->Dtol) ? 0
+				: (iABC[n] < - mf->Dtol) ? 1 : mf->xfet[n];
+		}
+	}
+}
+
+static void
+blmf_vsi_surge(blmf_t *mf)
+{
+	int		n;
+
+	for (n = 0; n < 3; ++n) {
+
+		if (mf->xfet[n] != mf->xfet[n + 3]) {
+
+			/* ADC surge on phase.
+			 * */
+			mf->state[7 + n] += blmf_gauss(mf) * 5.f;
+			mf->state[10]    += blmf_gauss(mf) * 2.f;
+		}
+
+		/* Keep the previous VSI state.
+		 * */
+		mf->xfet[n + 3] = mf->xfet[n];
+	}
+}
+
+static void
+blmf_solve(blmf_t *mf, int k)
+{
+	blmf_vsi_deadtime(mf);
+	blmf_vsi_surge(mf);
+
+	/* Divide the long interval.
+	 * */
+	while (k > mf->tick_step) {
+
+		blmf_ode_step(mf, mf->tick_step);
+		k -= mf->tick_step;
+	}
+
+	blmf_ode_step(mf, k);
+
+	if (mf->state[3] < (float) - M_PI) {
+
+		mf->acc[1] += 2. * M_PI;
+		mf->state[3] = (float) (mf->acc[1] + (double) mf->inc[1]);
+		mf->revol -= 1;
+	}
+	else if (mf->state[3] > (float) M_PI) {
+
+		mf->acc[1] -= 2. * M_PI;
+		mf->state[3] = (float) (mf->acc[1] + (double) mf->inc[1]);
+		mf->revol += 1;
+	}
+}
+
+static void
+blmf_sample_position(blmf_t *mf)
+{
+	double		location, angle;
+	int		HS = 0, EP;
+
+	HS |= (mf->pos_C * mf->hall_X[0] + mf->pos_S * mf->hall_Y[0] < 0.f) ? 1 : 0;
+	HS |= (mf->pos_C * mf->hall_X[1] + mf->pos_S * mf->hall_Y[1] < 0.f) ? 2 : 0;
+	HS |= (mf->pos_C * mf->hall_X[2] + mf->pos_S * mf->hall_Y[2] < 0.f) ? 4 : 0;
+
+	mf->pulse_HS = HS;
+
+	/* Total location needs double precision after a few revolutions.
+	 * */
+	location = mf->acc[1] + (double) mf->inc[1] + (2. * M_PI) * (double) mf->revol;
+	angle = location * mf->eabi_Zq / mf->Zp;
+
+	EP = (int) (angle / (2. * M_PI) * (double) mf->eabi_ERES);
+
+	EP = EP - (EP / mf->eabi_WRAP) * mf->eabi_WRAP;
+	EP += (EP < 0) ? mf->eabi_WRAP : 0;
+
+	mf->pulse_EP = EP;
+
+	angle = location * mf->analog_Zq / mf->Zp;
+	angle = remainder(angle, 2. * M_PI);
+
+	mf->analog_SIN = blmf_ADC(mf, sinf((float) angle), - 3.f, 3.f);
+	mf->analog_COS = blmf_ADC(mf, cosf((float) angle), - 3.f, 3.f);
+}
+
+static void
+blmf_pwm_up_event(blmf_t *mf, int ev)
+{
+	switch (ev) {
+
+		case 0:
+			mf->analog_iA = blmf_ADC(mf, mf->state[7], - mf->range_A, mf->range_A);
+			mf->analog_iB = blmf_ADC(mf, mf->state[8], - mf->range_A, mf->range_A);
+			mf->analog_iC = blmf_ADC(mf, mf->state[9], - mf->range_A, mf->range_A);
+			break;
+
+		case 1:
+			mf->analog_uS = blmf_ADC(mf, mf->state[11], 0.f, mf->range_B);
+			mf->analog_uA = blmf_ADC(mf, mf->state[12], 0.f, mf->range_B);
+			mf->analog_uB = blmf_ADC(mf, mf->state[13], 0.f, mf->range_B);
+			break;
+
+		case 2:
+			mf->analog_uC = blmf_ADC(mf, mf->state[14], 0.f, mf->range_B);
+
+			blmf_sample_position(mf);
+			break;
+
+		case 3: case 4: case 5:
+			mf->xfet[ev - 3] = 1;
+			mf->xdtu[ev - 3] = 1;
+			break;
+
+		case 6: case 7: case 8:
+			mf->xfet[ev - 6] = 1;
+			mf->xdtu[ev - 6] = 0;
+			break;
+
+		default:
+			break;
+	}
+}
+
+static void
+blmf_pwm_down_event(blmf_t *mf, int ev)
+{
+	switch (ev) {
+
+		case 3: case 4: case 5:
+			mf->xfet[ev - 3] = 0;
+			mf->xdtu[ev - 3] = 0;
+			break;
+
+		case 6: case 7: case 8:
+			mf->xfet[ev - 6] = 0;
+			mf->xdtu[ev - 6] = (mf->dt_skip != 0) ? 0 : 1;
+			break;
+
+		default:
+			break;
+	}
+}
+
+static void
+blmf_tab_prepare(blmf_t *mf)
+{
+	double		dTu;
+	int		n, step;
+
+	if (		mf->tab_pwm_dT == mf->pwm_dT
+			&& mf->tab_resolution == mf->pwm_resolution
+			&& mf->tab_sol_dT == mf->sol_dT
+			&& mf->tab_tau_A == mf->tau_A
+			&& mf->tab_tau_B == mf->tau_B) {
+
+		/* The table is still valid.
+		 * */
+		return ;
+	}
+
+	dTu = mf->pwm_dT / (double) (mf->pwm_resolution * 2);
+
+	step = (int) (mf->sol_dT / dTu);
+	step = (step < 1) ? 1 : (step > BLMF_STEP_MAX) ? BLMF_STEP_MAX : step;
+
+	for (n = 0; n <= step; ++n) {
+
+		mf->kA[n] = (float) (1. - exp(- (double) n * dTu / mf->tau_A));
+		mf->kB[n] = (float) (1. - exp(- (double) n * dTu / mf->tau_B));
+	}
+
+	mf->tick_dT = (float) dTu;
+	mf->tick_step = step;
+
+	mf->tab_pwm_dT = mf->pwm_dT;
+	mf->tab_resolution = mf->pwm_resolution;
+	mf->tab_sol_dT = mf->sol_dT;
+	mf->tab_tau_A = mf->tau_A;
+	mf->tab_tau_B = mf->tau_B;
+}
+
+static void
+blmf_pwm_prepare(blmf_t *mf)
+{
+	int		n;
+
+	blmf_tab_prepare(mf);
+
+	/* We replace the divisions in ODE.
+	 * */
+	mf->inv_Ld = 1.f / mf->Ld;
+	mf->inv_Lq = 1.f / mf->Lq;
+	mf->inv_Zp = 1.f / mf->Zp;
+	mf->inv_Rdc = 1.f / mf->Rdc;
+	mf->inv_Cdc = 1.f / mf->Cdc;
+	mf->inv_Jm = 1.f / mf->Jm;
+	mf->inv_Rt = 1.f / mf->Rt;
+	mf->inv_Ct = 1.f / mf->Ct;
+
+	for (n = 0; n < 3; ++n) {
+
+		mf->hall_X[n] = cosf(mf->hall[n] * (float) (M_PI / 180.));
+		mf->hall_Y[n] = sinf(mf->hall[n] * (float) (M_PI / 180.));
+
+		/* The slow states could be changed from the outside.
+		 * */
+		if (mf->state[n + 2] != (float) mf->acc[n]) {
+
+			mf->acc[n] = (double) mf->state[n + 2];
+		}
+
+		mf->inc[n] = 0.f;
+	}
+
+	mf->pos_S = sinf(mf->state[3]);
+	mf->pos_C = cosf(mf->state[3]);
+}
+
+static int
+blmf_pwm_events(blmf_t *mf, blmf_event_t *list, int up)
+{
+	blmf_event_t	ebuf;
+
+	float		iABC[3];
+	double		dTu;
+	int		pwm[3], xA, xMIN, xMAX, xDT, xHS, xLS, k, i, N = 0;
+
+	dTu = mf->pwm_dT / (double) (mf->pwm_resolution * 2);
+
+	xMIN = (int) (mf->pwm_minimal * (double) mf->pwm_resolution / mf->pwm_dT);
+	xMAX = mf->pwm_resolution;
+	xDT = (int) (mf->pwm_deadtime / dTu);
+
+	if (up != 0) {
+
+		/* ADC sampling.
+		 * */
+		list[N].comp = xMAX - (int) (mf->adc_Tconv / dTu);
+		list[N++].ev = 1;
+
+		list[N].comp = xMAX - (int) (2. * mf->adc_Tconv / dTu);
+		list[N++].ev = 2;
+	}
+
+	pwm[0] = mf->pwm_A;
+	pwm[1] = mf->pwm_B;
+	pwm[2] = mf->pwm_C;
+
+	blmf_DQ_ABC(mf->pos_S, mf->pos_C, mf->state[0], mf->state[1], iABC);
+
+	for (k = 0; k < 3; ++k) {
+
+		/* FET low side.
+		 * */
+		xA = (pwm[k] < xMIN) ? 0 : pwm[k] + xDT;
+		xLS = (xA < xMIN) ? 0 : (xA > xMAX - xMIN) ? xMAX : xA;
+
+		/* FET high side.
+		 * */
+		xA = pwm[k];
+		xHS = (xA < xMIN) ? 0 : (xA > xMAX - xMIN) ? xMAX : xA;
+
+		if (mf->dt_skip != 0) {
+
+			/* Dead-Time is resolved by the current direction.
+			 * */
+			if (up != 0) {
+
+				list[N].comp = (iABC[k] > mf->Dtol) ? xHS : xLS;
+			}
+			else {
+				list[N].comp = (iABC[k] < - mf->Dtol) ? xLS : xHS;
+			}
+
+			list[N++].ev = 6 + k;
+		}
+		else {
+			list[N].comp = xLS;
+			list[N++].ev = 3 + k;
+
+			list[N].comp = xHS;
+			list[N++].ev = 6 + k;
+		}
+	}
+
+	/* Get SORTED events.
+	 * */
+	for (i = 1; i < N; ++i) {
+
+		ebuf = list[i];
+
+		for (k = i; k > 0 && list[k - 1].comp < ebuf.comp; --k) {
+
+			list[k] = list[k - 1];
+		}
+
+		list[k] = ebuf;
+	}
+
+	return N;
+}
+
+void blmf_update(blmf_t *mf)
+{
+	blmf_event_t	list[8];
+	int		level, xMAX, i, N;
+
+	blmf_pwm_prepare(mf);
+
+	xMAX = mf->pwm_resolution;
+
+	/* PWM count up.
+	 * */
+	N = blmf_pwm_events(mf, list, 1);
+
+	blmf_pwm_up_event(mf, 0);
+
+	level = xMAX;
+
+	for (i = 0; i < N; ++i) {
+
+		if (level != list[i].comp) {
+
+			blmf_solve(mf, level - list[i].comp);
+
+			level = list[i].comp;
+		}
+
+		blmf_pwm_up_event(mf, list[i].ev);
+	}
+
+	if (level != 0) {
+
+		blmf_solve(mf, level);
+	}
+
+	/* PWM count down.
+	 * */
+	N = blmf_pwm_events(mf, list, 0);
+
+	level = 0;
+
+	for (i = N - 1; i >= 0; --i) {
+
+		if (level != list[i].comp) {
+
+			blmf_solve(mf, list[i].comp - level);
+
+			level = list[i].comp;
+		}
+
+		blmf_pwm_down_event(mf, list[i].ev);
+	}
+
+	if (level != xMAX) {
+
+		blmf_solve(mf, xMAX - level);
+	}
+
+	/* Get average POWER on PWM cycle.
+	 * */
+	mf->drain_wP = mf->state[5] / (float) mf->pwm_dT;
+	mf->state[5] = 0.f;
+
+	for (i = 0; i < 3; ++i) {
+
+		mf->acc[i] += (double) mf->inc[i];
+		mf->inc[i] = 0.f;
+
+		mf->state[i + 2] = (float) mf->acc[i];
+	}
+
+	mf->time += mf->pwm_dT;
+}
+
@@ -0,0 +1,157 @@
+#ifndef _H_BLMF_
+#define _H_BLMF_
+
+#include <stdint.h>
+
+#include "blm.h"
+
+/* Maximal number of PWM ticks in one solver step.
+ * */
+#define BLMF_STEP_MAX		1024
+
+/* Size of Gaussian noise table is (1 << BLMF_GAUSS_BITS).
+ * */
+#define BLMF_GAUSS_BITS		12
+
+/* This is the reduced precision version of BLM model to run the firmware
+ * in real time. The ODE is integrated in single precision on the grid of
+ * PWM ticks so the sensor transient factors are taken from the table that
+ * is built once. The ADC noise is drawn from the table of normal samples
+ * instead of summation of uniform numbers on each conversion.
+ *
+ * NOTE: Speed, position and temperature increments within the step are
+ * below the float resolution. They are accumulated over PWM cycle and
+ * added to the double precision value at the end of cycle.
+ *
+ * NOTE: With dead-time skipped each phase is switched once in half of PWM
+ * cycle at the instant that dead-time would give for the phase current at
+ * the beginning of cycle. So there are no short steps within dead-time but
+ * the current crossing zero in the middle of cycle is not seen.
+ * */
+typedef struct {
+
+	double		time;
+	double		sol_dT;
+
+	int		dt_skip;
+
+	double		pwm_dT;
+	double		pwm_deadtime;
+	double		pwm_minimal;
+	int		pwm_resolution;
+
+	float		Dtol;
+
+	int		pwm_A;
+	int		pwm_B;
+	int		pwm_C;
+	int		pwm_Z;
+
+	float		state[15];
+	float		drain_wP;
+
+	int		xfet[6];
+	int		xdtu[3];
+	int		revol;
+
+	float		Rs;
+	float		Ld;
+	float		Lq;
+	float		lambda;
+	float		Zp;
+
+	float		Ta;
+	float		Ct;
+	float		Rt;
+
+	float		Udc;
+	float		Rdc;
+	float		Cdc;
+
+	float		Jm;
+	float		Mq[4];
+
+	double		adc_Tconv;
+	double		tau_A;
+	double		tau_B;
+	float		range_A;
+	float		range_B;
+
+	float		hall[3];
+
+	int		eabi_ERES;
+	int		eabi_WRAP;
+	float		eabi_Zq;
+
+	float		analog_Zq;
+
+	float		analog_iA;
+	float		analog_iB;
+	float		analog_iC;
+	float		analog_uS;
+	float		analog_uA;
+	float		analog_uB;
+	float		analog_uC;
+
+	int		pulse_HS;
+	int		pulse_EP;
+
+	float		analog_SIN;
+	float		analog_COS;
+
+	/* Inverse constants of the current PWM cycle.
+	 * */
+	float		inv_Ld;
+	float		inv_Lq;
+	float		inv_Zp;
+	float		inv_Rdc;
+	float		inv_Cdc;
+	float		inv_Jm;
+	float		inv_Rt;
+	float		inv_Ct;
+
+	float		hall_X[3];
+	float		hall_Y[3];
+
+	/* SIN/COS of the position carried between the steps.
+	 * */
+	float		pos_S;
+	float		pos_C;
+
+	/* Slow states (speed, position, temperature).
+	 * */
+	double		acc[3];
+	float		inc[3];
+
+	/* Sensor transient factors on the tick grid.
+	 * */
+	float		tick_dT;
+	int		tick_step;
+
+	double		tab_pwm_dT;
+	int		tab_resolution;
+	double		tab_sol_dT;
+	double		tab_tau_A;
+	double		tab_tau_B;
+
+	float		kA[BLMF_STEP_MAX + 1];
+	float		kB[BLMF_STEP_MAX + 1];
+
+	float		gauss[1U << BLMF_GAUSS_BITS];
+	uint32_t	gauss_lcgu;
+
+	struct {
+
+		long	steps;
+	}
+	sol_stat;
+}
+blmf_t;
+
+void blmf_enable(blmf_t *mf, const blm_t *m);
+void blmf_seed(blmf_t *mf, int seed);
+void blmf_restart(blmf_t *mf);
+void blmf_update(blmf_t *mf);
+
+#endif /* _H_BLMF_ */
+
@@ -0,0 +1,698 @@
+#include <stddef.h>
+#include <math.h>
+
+#include "blm.h"
+#include "blms.h"
+#include "lfg.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define _BLMS_SIMD_X86
+#endif
+
+void blms_enable(blms_t *mc, const blm_t *m, int N)
+{
+	int		n;
+
+	mc->N = (N < BLMS_MAX) ? N : BLMS_MAX;
+
+	mc->time = 0.;
+	mc->sol_dT = m->sol_dT;
+
+	mc->pwm_dT = m->pwm_dT;
+	mc->pwm_deadtime = m->pwm_deadtime;
+	mc->pwm_minimal = m->pwm_minimal;
+	mc->pwm_resolution = m->pwm_resolution;
+
+	mc->Dtol = m->Dtol;
+	mc->Ta = m->Ta;
+
+	mc->adc_Tconv = m->adc_Tconv;
+	mc->tau_A = m->tau_A;
+	mc->tau_B = m->tau_B;
+	mc->range_A = m->range_A;
+	mc->range_B = m->range_B;
+
+	mc->hall[0] = m->hall[0];
+	mc->hall[1] = m->hall[1];
+	mc->hall[2] = m->hall[2];
+
+	mc->eabi_ERES = m->eabi_ERES;
+	mc->eabi_WRAP = m->eabi_WRAP;
+	mc->eabi_Zq = m->eabi_Zq;
+
+	mc->analog_Zq = m->analog_Zq;
+
+	for (n = 0; n < mc->N; ++n) {
+
+		blms_load(mc, n, m);
+	}
+
+	mc->sol_stat.steps = 0;
+}
+
+void blms_load(blms_t *mc, int n, const blm_t *m)
+{
+	mc->Rs[n] = m->Rs;
+	mc->Ld[n] = m->Ld;
+	mc->Lq[n] = m->Lq;
+	mc->lambda[n] = m->lambda;
+	mc->Zp[n] = (double) m->Zp;
+
+	mc->Ct[n] = m->Ct;
+	mc->Rt[n] = m->Rt;
+
+	mc->Udc[n] = m->Udc;
+	mc->Rdc[n] = m->Rdc;
+	mc->Cdc[n] = m->Cdc;
+
+	mc->Jm[n] = m->Jm;
+
+	mc->Mq[0][n] = m->Mq[0];
+	mc->Mq[1][n] = m->Mq[1];
+	mc->Mq[2][n] = m->Mq[2];
+	mc->Mq[3][n] = m->Mq[3];
+}
+
+void blms_seed(blms_t *mc, int seed)
+{
+	lfg_t		lfg;
+	int		i, n;
+
+	for (n = 0; n < mc->N; ++n) {
+
+		/* Each instance gets its own sequence.
+		 * */
+		lfg_start(&lfg, seed + n * 7919);
+
+		for (i = 0; i < 55; ++i) {
+
+			mc->lfg_seed[i][n] = lfg.seed[i];
+		}
+	}
+
+	mc->lfg_ra = 0;
+	mc->lfg_rb = 31;
+}
+
+void blms_restart(blms_t *mc)
+{
+	int		i, n;
+
+	for (n = 0; n < mc->N; ++n) {
+
+		for (i = 0; i < 15; ++i) {
+
+			mc->state[i][n] = 0.;
+		}
+
+		mc->state[4][n] = mc->Ta;
+		mc->state[6][n] = mc->Udc[n];
+		mc->state[10][n] = mc->Udc[n];
+		mc->state[11][n] = mc->Udc[n];
+
+		mc->pwm_A[n] = 0;
+		mc->pwm_B[n] = 0;
+		mc->pwm_C[n] = 0;
+		mc->pwm_Z[n] = BLM_Z_NONE;
+
+		mc->drain_wP[n] = 0.;
+		mc->revol[n] = 0;
+	}
+}
+
+static inline void
+blms_sincos(double x, double *s, double *c)
+{
+	double		k, r, z, ps, pc;
+	int		q;
+
+	/* Branch-free SIN/COS kernel that can be vectorized. We reduce
+	 * the argument to [-pi/4, pi/4] in three parts and use the minimax
+	 * polynomials from Cephes.
+	 * */
+	k = x * 0.636619772367581343076 + 6755399441055744.;
+	k = k - 6755399441055744.;
+
+	r = x - k * 1.57079632673412561417;
+	r = r - k * 6.07710050630396597660E-11;
+	r = r - k * 2.02226624879595063154E-21;
+
+	q = (int) k;
+	z = r * r;
+
+	ps = 1.58962301576546568060E-10;
+	ps = ps * z - 2.50507477628578072866E-8;
+	ps = ps * z + 2.75573136213857245213E-6;
+	ps = ps * z - 1.98412698295895385996E-4;
+	ps = ps * z + 8.33333333332211858878E-3;
+	ps = ps * z - 1.66666666666666307295E-1;
+	ps = r + r * z * ps;
+
+	pc = - 1.13585365213876817300E-11;
+	pc = pc * z + 2.08757008419747316778E-9;
+	pc = pc * z - 2.75573141792967388112E-7;
+	pc = pc * z + 2.48015872888517045348E-5;
+	pc = pc * z - 1.38888888888730564116E-3;
+	pc = pc * z + 4.16666666666665929218E-2;
+	pc = 1. - 0.5 * z + z * z * pc;
+
+	*s = (q & 1) ? pc : ps;
+	*c = (q & 1) ? ps : pc;
+
+	*s = (q & 2) ? - *s : *s;
+	*c = ((q + 1) & 2) ? - *c : *c;
+}
+
+static void
+blms_gauss(blms_t *mc, double *g)
+{
+	double		*a, *b, x;
+	int		i, n;
+
+	for (n = 0; n < mc->N; ++n) {
+
+		g[n] = 0.;
+	}
+
+	for (i = 0; i < 3; ++i) {
+
+		a = mc->lfg_seed[mc->lfg_ra];
+		b = mc->lfg_seed[mc->lfg_rb];
+
+		/* Lagged Fibonacci generator of all instances.
+		 * */
+		for (n = 0; n < mc->N; ++n) {
+
+			x = (a[n] < b[n]) ? a[n] - b[n] + 1. : a[n] - b[n] - 1.;
+
+			a[n] = x;
+			g[n] += x;
+		}
+
+		mc->lfg_ra = (mc->lfg_ra < 54) ? mc->lfg_ra + 1 : 0;
+		mc->lfg_rb = (mc->lfg_rb < 54) ? mc->lfg_rb + 1 : 0;
+	}
+}
+
+static inline double
+blms_ADC(double vconv, double g, double vmin, double vmax)
+{
+	double		rel;
+	int		ADC;
+
+	rel = (vconv - vmin) / (vmax - vmin);
+
+	ADC = (int) (rel * 4096. + g * 2.);
+	ADC = ADC < 0 ? 0 : ADC > 4095 ? 4095 : ADC;
+
+	return (double) ADC / 4096. * (vmax - vmin) + vmin;
+}
+
+static inline void
+blms_equation(const blms_t *mc, int n, const double x[7], double tS, double tC,
+		const double f[3], double y[7])
+{
+	double		uA, uB, uX, uY, uD, uQ, Rs, lambda, mP, mQ, mS;
+
+	/* Thermal drift.
+	 * */
+	Rs = mc->Rs[n] * (1. + 4.E-3 * (x[4] - mc->Ta));
+	lambda = mc->lambda[n] * (1. - 1.E-3 * (x[4] - mc->Ta));
+
+	/* Voltage from VSI averaged over the step.
+	 * */
+	uQ = (f[0] + f[1] + f[2]) / 3.;
+	uA = (f[0] - uQ) * x[6];
+	uB = (f[1] - uQ) * x[6];
+
+	uX = uA;
+	uY = 0.577350269189626 * uA + 1.15470053837925 * uB;
+
+	uD = tC * uX + tS * uY;
+	uQ = tC * uY - tS * uX;
+
+	/* Energy consumption equation.
+	 * */
+	y[5] = 1.5 * (x[0] * uD + x[1] * uQ);
+
+	/* DC link voltage equation.
+	 * */
+	y[6] = ((mc->Udc[n] - x[6]) * mc->inv_Rdc[n] - y[5] / x[6]) * mc->inv_Cdc[n];
+
+	/* Electrical equations of PMSM.
+	 * */
+	uD += - Rs * x[0] + mc->Lq[n] * x[2] * x[1];
+	uQ += - Rs * x[1] - mc->Ld[n] * x[2] * x[0] - lambda * x[2];
+
+	y[0] = uD * mc->inv_Ld[n];
+	y[1] = uQ * mc->inv_Lq[n];
+
+	/* Torque production.
+	 * */
+	mP = 1.5 * mc->Zp[n] * (lambda + (mc->Ld[n] - mc->Lq[n]) * x[0]) * x[1];
+
+	/* Mechanical load torque.
+	 * */
+	mS = x[2] * mc->inv_Zp[n];
+	mQ = mc->Mq[0][n] - mS * (mc->Mq[1][n] + fabs(mS) * mc->Mq[2][n]);
+	mQ += (mS < 0.) ? mc->Mq[3][n] : - mc->Mq[3][n];
+
+	/* Mechanical equations.
+	 * */
+	y[2] = mc->Zp[n] * (mP + mQ) * mc->inv_Jm[n];
+	y[3] = x[2];
+
+	/* Thermal equation.
+	 * */
+	y[4] = (1.5f * Rs * (x[0] * x[0] + x[1] * x[1])
+			+ (mc->Ta - x[4]) * mc->inv_Rt[n]) * mc->inv_Ct[n];
+}
+
+static inline double
+blms_decay(double d)
+{
+	double		y;
+
+	/* Fast approximation of exp(-d) that is good enough for the noise
+	 * amplitude and can be vectorized.
+	 * */
+	y = 1. - d * (1. / 256.);
+	y = (y > 0.) ? y : 0.;
+
+	y *= y; y *= y; y *= y; y *= y;
+	y *= y; y *= y; y *= y; y *= y;
+
+	return y;
+}
+
+static inline double
+blms_overlap(double ua, double ub, double wa, double wb)
+{
+	double		lo, hi;
+
+	lo = (ua > wa) ? ua : wa;
+	hi = (ub < wb) ? ub : wb;
+
+	return (hi > lo) ? hi - lo : 0.;
+}
+
+static void
+blms_step(blms_t *mc, double ua, double ub, int last)
+{
+	double		gA[BLMS_MAX], gB[BLMS_MAX], gC[BLMS_MAX], gS[BLMS_MAX];
+
+	double		dTu, dT, kA, kB, kS, Dtol, xMAX;
+	int		n, N = mc->N;
+
+	dTu = mc->pwm_dT / (double) (mc->pwm_resolution * 2);
+	dT = (ub - ua) * dTu;
+
+	/* Sensor transient (FAST).
+	 * */
+	kA = 1.0 - exp(- dT / mc->tau_A);
+	kB = 1.0 - exp(- dT / mc->tau_B);
+
+	kS = dTu / mc->tau_A;
+
+	Dtol = mc->Dtol;
+	xMAX = (double) mc->pwm_resolution;
+
+	if (last != 0) {
+
+		/* ADC surge is only visible to the sample at the end of
+		 * PWM cycle as it is decayed in a few microseconds.
+		 * */
+		blms_gauss(mc, gA);
+		blms_gauss(mc, gB);
+		blms_gauss(mc, gC);
+		blms_gauss(mc, gS);
+	}
+
+	for (n = 0; n < N; ++n) {
+
+		double		x[7], x2[7], y1[7], y2[7], iABC[3], f[3], w[3];
+		double		tS, tC, iX, iY, uA, uB, uC, uMIN, xh, xl, edge;
+		int		k, detached;
+
+		detached = (mc->pwm_Z[n] == BLM_Z_DETACHED);
+
+		for (k = 0; k < 7; ++k) {
+
+			x[k] = mc->state[k][n];
+		}
+
+		tS = mc->pos_S[n];
+		tC = mc->pos_C[n];
+
+		iX = tC * x[0] - tS * x[1];
+		iY = tS * x[0] + tC * x[1];
+
+		iABC[0] = iX;
+		iABC[1] = - 0.5 * iX + 0.866025403784439 * iY;
+		iABC[2] = - 0.5 * iX - 0.866025403784439 * iY;
+
+		for (k = 0; k < 3; ++k) {
+
+			xh = mc->x_hs[k][n];
+			xl = mc->x_ls[k][n];
+
+			/* The phase is ON in the middle of PWM cycle and
+			 * follows the current sign on Dead-Time. The rising
+			 * Dead-Time starts with high side and the falling one
+			 * with low side.
+			 * */
+			f[k] = blms_overlap(ua, ub, - xh, xh);
+			f[k] += (iABC[k] > Dtol) ? 0. : blms_overlap(ua, ub, - xl, - xh);
+			f[k] += (iABC[k] < - Dtol) ? blms_overlap(ua, ub, xh, xl) : 0.;
+			f[k] /= (ub - ua);
+
+			/* The last switching of the cycle.
+			 * */
+			edge = (iABC[k] < - Dtol && xl > xh) ? xl : xh;
+
+			w[k] = (edge > 0. && edge < xMAX && edge > ua)
+				? blms_decay((ub - edge) * kS) : 0.;
+		}
+
+		/* Second-order ODE solver.
+		 * */
+		blms_equation(mc, n, x, tS, tC, f, y1);
+
+		for (k = 0; k < 7; ++k) {
+
+			x2[k] = x[k] + y1[k] * dT;
+		}
+
+		x2[0] = (detached) ? 0. : x2[0];
+		x2[1] = (detached) ? 0. : x2[1];
+
+		blms_sincos(x2[3], &tS, &tC);
+		blms_equation(mc, n, x2, tS, tC, f, y2);
+
+		for (k = 0; k < 7; ++k) {
+
+			x[k] += (y1[k] + y2[k]) * dT / 2.;
+		}
+
+		x[0] = (detached) ? 0. : x[0];
+		x[1] = (detached) ? 0. : x[1];
+
+		/* Sensor transient.
+		 * */
+		blms_sincos(x[3], &tS, &tC);
+
+		mc->pos_S[n] = tS;
+		mc->pos_C[n] = tC;
+
+		iX = tC * x[0] - tS * x[1];
+		iY = tS * x[0] + tC * x[1];
+
+		iABC[0] = iX;
+		iABC[1] = - 0.5 * iX + 0.866025403784439 * iY;
+		iABC[2] = - 0.5 * iX - 0.866025403784439 * iY;
+
+		mc->state[7][n] += (iABC[0] - mc->state[7][n]) * kA;
+		mc->state[8][n] += (iABC[1] - mc->state[8][n]) * kA;
+		mc->state[9][n] += (iABC[2] - mc->state[9][n]) * kA;
+		mc->state[10][n] += (x[6] - mc->state[10][n]) * kA;
+
+		if (last != 0) {
+
+			/* ADC surge decayed from the switching instant.
+			 * */
+			mc->state[7][n] += gA[n] * 5. * w[0];
+			mc->state[8][n] += gB[n] * 5. * w[1];
+			mc->state[9][n] += gC[n] * 5. * w[2];
+			mc->state[10][n] += gS[n] * 2. * (w[0] + w[1] + w[2]);
+		}
+
+		/* Back EMF when detached.
+		 * */
+		iX = - tS * mc->lambda[n] * x[2];
+		iY = tC * mc->lambda[n] * x[2];
+
+		uA = iX;
+		uB = - 0.5 * iX + 0.866025403784439 * iY;
+		uC = - 0.5 * iX - 0.866025403784439 * iY;
+
+		uMIN = (uA < uB) ? uA : uB;
+		uMIN = (uMIN < uC) ? uMIN : uC;
+
+		uA = (detached) ? uA - uMIN : f[0] * x[6];
+		uB = (detached) ? uB - uMIN : f[1] * x[6];
+		uC = (detached) ? uC - uMIN : f[2] * x[6];
+
+		mc->state[11][n] += (mc->state[10][n] - mc->state[11][n]) * kB;
+		mc->state[12][n] += (uA - mc->state[12][n]) * kB;
+		mc->state[13][n] += (uB - mc->state[13][n]) * kB;
+		mc->state[14][n] += (uC - mc->state[14][n]) * kB;
+
+		/* Keep the position in range.
+		 * */
+		mc->revol[n] += (x[3] < - M_PI) ? - 1 : (x[3] > M_PI) ? 1 : 0;
+
+		x[3] += (x[3] < - M_PI) ? 2. * M_PI : (x[3] > M_PI) ? - 2. * M_PI : 0.;
+
+		for (k = 0; k < 7; ++k) {
+
+			mc->state[k][n] = x[k];
+		}
+	}
+
+	mc->sol_stat.steps += 1;
+}
+
+static void
+blms_sample_current(blms_t *mc)
+{
+	double		gA[BLMS_MAX], gB[BLMS_MAX], gC[BLMS_MAX];
+	double		range_A = mc->range_A;
+	int		n;
+
+	blms_gauss(mc, gA);
+	blms_gauss(mc, gB);
+	blms_gauss(mc, gC);
+
+	for (n = 0; n < mc->N; ++n) {
+
+		mc->analog_iA[n] = (float) blms_ADC(mc->state[7][n], gA[n], - range_A, range_A);
+		mc->analog_iB[n] = (float) blms_ADC(mc->state[8][n], gB[n], - range_A, range_A);
+		mc->analog_iC[n] = (float) blms_ADC(mc->state[9][n], gC[n], - range_A, range_A);
+	}
+}
+
+static void
+blms_sample_voltage(blms_t *mc)
+{
+	double		gS[BLMS_MAX], gA[BLMS_MAX], gB[BLMS_MAX];
+	double		range_B = mc->range_B;
+	int		n;
+
+	blms_gauss(mc, gS);
+	blms_gauss(mc, gA);
+	blms_gauss(mc, gB);
+
+	for (n = 0; n < mc->N; ++n) {
+
+		mc->analog_uS[n] = (float) blms_ADC(mc->state[11][n], gS[n], 0., range_B);
+		mc->analog_uA[n] = (float) blms_ADC(mc->state[12][n], gA[n], 0., range_B);
+		mc->analog_uB[n] = (float) blms_ADC(mc->state[13][n], gB[n], 0., range_B);
+	}
+}
+
+static void
+blms_sample_position(blms_t *mc)
+{
+	double		gC[BLMS_MAX], gS[BLMS_MAX], gK[BLMS_MAX];
+	double		hX[3], hY[3], range_B = mc->range_B;
+	int		n, EP, WRAP = mc->eabi_WRAP;
+
+	blms_gauss(mc, gC);
+	blms_gauss(mc, gS);
+	blms_gauss(mc, gK);
+
+	for (n = 0; n < 3; ++n) {
+
+		hX[n] = cos(mc->hall[n] * (M_PI / 180.));
+		hY[n] = sin(mc->hall[n] * (M_PI / 180.));
+	}
+
+	for (n = 0; n < mc->N; ++n) {
+
+		double		mX, mY, location, angle, aS, aC;
+		int		HS = 0;
+
+		mc->analog_uC[n] = (float) blms_ADC(mc->state[14][n], gC[n], 0., range_B);
+
+		mX = mc->pos_C[n];
+		mY = mc->pos_S[n];
+
+		HS |= (mX * hX[0] + mY * hY[0] < 0.) ? 1 : 0;
+		HS |= (mX * hX[1] + mY * hY[1] < 0.) ? 2 : 0;
+		HS |= (mX * hX[2] + mY * hY[2] < 0.) ? 4 : 0;
+
+		mc->pulse_HS[n] = HS;
+
+		location = mc->state[3][n] + (2. * M_PI) * (double) mc->revol[n];
+		angle = location * mc->analog_Zq / mc->Zp[n];
+
+		blms_sincos(angle, &aS, &aC);
+
+		mc->analog_SIN[n] = (float) blms_ADC(aS, gS[n], - 3., 3.);
+		mc->analog_COS[n] = (float) blms_ADC(aC, gK[n], - 3., 3.);
+	}
+
+	for (n = 0; n < mc->N; ++n) {
+
+		double		location, angle;
+
+		location = mc->state[3][n] + (2. * M_PI) * (double) mc->revol[n];
+		angle = location * mc->eabi_Zq / mc->Zp[n];
+
+		EP = (int) (angle / (2. * M_PI) * (double) mc->eabi_ERES);
+
+		EP = EP - (EP / WRAP) * WRAP;
+		EP += (EP < 0) ? WRAP : 0;
+
+		mc->pulse_EP[n] = EP;
+	}
+}
+
+static void
+blms_pwm_prepare(blms_t *mc)
+{
+	double		dTu;
+	int		n, k, xA, xMIN, xMAX, xDT, pwm[3];
+
+	dTu = mc->pwm_dT / (double) (mc->pwm_resolution * 2);
+
+	xMIN = (int) (mc->pwm_minimal * (double) mc->pwm_resolution / mc->pwm_dT);
+	xMAX = mc->pwm_resolution;
+	xDT = (int) (mc->pwm_deadtime / dTu);
+
+	for (n = 0; n < mc->N; ++n) {
+
+		/* We replace the divisions in ODE kernel.
+		 * */
+		mc->inv_Ld[n] = 1. / mc->Ld[n];
+		mc->inv_Lq[n] = 1. / mc->Lq[n];
+		mc->inv_Zp[n] = 1. / mc->Zp[n];
+		mc->inv_Rdc[n] = 1. / mc->Rdc[n];
+		mc->inv_Cdc[n] = 1. / mc->Cdc[n];
+		mc->inv_Jm[n] = 1. / mc->Jm[n];
+		mc->inv_Rt[n] = 1. / mc->Rt[n];
+		mc->inv_Ct[n] = 1. / mc->Ct[n];
+
+		/* The position could be changed from the outside.
+		 * */
+		blms_sincos(mc->state[3][n], &mc->pos_S[n], &mc->pos_C[n]);
+	}
+
+	for (n = 0; n < mc->N; ++n) {
+
+		pwm[0] = mc->pwm_A[n];
+		pwm[1] = mc->pwm_B[n];
+		pwm[2] = mc->pwm_C[n];
+
+		for (k = 0; k < 3; ++k) {
+
+			/* FET low side.
+			 * */
+			xA = (pwm[k] < xMIN) ? 0 : pwm[k] + xDT;
+			xA = (xA < xMIN) ? 0 : (xA > xMAX - xMIN) ? xMAX : xA;
+
+			mc->x_ls[k][n] = (double) xA;
+
+			/* FET high side.
+			 * */
+			xA = pwm[k];
+			xA = (xA < xMIN) ? 0 : (xA > xMAX - xMIN) ? xMAX : xA;
+
+			mc->x_hs[k][n] = (double) xA;
+		}
+	}
+}
+
+static inline void __attribute__ ((always_inline))
+blms_update_body(blms_t *mc)
+{
+	double		dTu, xMAX, u1, u2, ua, ub, h;
+	int		n, i, M;
+
+	dTu = mc->pwm_dT / (double) (mc->pwm_resolution * 2);
+	xMAX = (double) mc->pwm_resolution;
+
+	/* ADC sampling instants (tick) from the middle of PWM cycle.
+	 * */
+	u1 = - xMAX + (double) (int) (mc->adc_Tconv / dTu);
+	u2 = - xMAX + (double) (int) (2. * mc->adc_Tconv / dTu);
+
+	blms_pwm_prepare(mc);
+
+	/* PWM count up.
+	 * */
+	blms_sample_current(mc);
+
+	blms_step(mc, - xMAX, u1, 0);
+	blms_sample_voltage(mc);
+
+	blms_step(mc, u1, u2, 0);
+	blms_sample_position(mc);
+
+	/* Common grid of the rest of PWM cycle.
+	 * */
+	M = (int) ceil((xMAX - u2) * dTu / mc->sol_dT);
+	M = (M < 1) ? 1 : M;
+
+	h = (xMAX - u2) / (double) M;
+
+	for (i = 0; i < M; ++i) {
+
+		ua = u2 + h * (double) i;
+		ub = (i < M - 1) ? ua + h : xMAX;
+
+		blms_step(mc, ua, ub, (i == M - 1));
+	}
+
+	/* Get average POWER on PWM cycle.
+	 * */
+	for (n = 0; n < mc->N; ++n) {
+
+		mc->drain_wP[n] = mc->state[5][n] / mc->pwm_dT;
+		mc->state[5][n] = 0.;
+	}
+
+	mc->time += mc->pwm_dT;
+}
+
+/* The whole cycle is flattened into each variant so that all kernels are
+ * vectorised for the instruction set selected at runtime.
+ * */
+static void __attribute__ ((flatten))
+blms_update_generic(blms_t *mc)
+{
+	blms_update_body(mc);
+}
+
+#ifdef _BLMS_SIMD_X86
+static void __attribute__ ((target("avx2,fma"), flatten))
+blms_update_AVX2(blms_t *mc)
+{
+	blms_update_body(mc);
+}
+#endif /* _BLMS_SIMD_X86 */
+
+void blms_update(blms_t *mc)
+{
+#ifdef _BLMS_SIMD_X86
+	if (		__builtin_cpu_supports("avx2")
+			&& __builtin_cpu_supports("fma")) {
+
+		blms_update_AVX2(mc);
+		return ;
+	}
+#endif /* _BLMS_SIMD_X86 */
+
+	blms_update_generic(mc);
+}
+
@@ -0,0 +1,130 @@
+#ifndef _H_BLMS_
+#define _H_BLMS_
+
+#include "blm.h"
+
+/* Maximal number of machine instances stepped together.
+ * */
+#define BLMS_MAX		256
+
+/* This is the structure-of-arrays version of BLM model. All instances
+ * share the PWM timing and sensor configuration but have their own
+ * machine constants, PWM duty cycles and noise sources. The instances
+ * are stepped in lock-step on the common time grid so each kernel is a
+ * plain loop over instances that the compiler turns into SIMD code.
+ *
+ * NOTE: Within the solver step the VSI voltage is averaged over the
+ * switching instants of each instance. Thus the ripple inside the step
+ * is not reproduced but the mean voltage and sampling instants are.
+ * */
+typedef struct {
+
+	int		N;
+
+	double		time;
+	double		sol_dT;
+
+	double		pwm_dT;
+	double		pwm_deadtime;
+	double		pwm_minimal;
+	int		pwm_resolution;
+
+	double		Dtol;
+	double		Ta;
+
+	double		adc_Tconv;
+	double		tau_A;
+	double		tau_B;
+	double		range_A;
+	double		range_B;
+
+	double		hall[3];
+
+	int		eabi_ERES;
+	int		eabi_WRAP;
+	double		eabi_Zq;
+
+	double		analog_Zq;
+
+	double		Rs[BLMS_MAX];
+	double		Ld[BLMS_MAX];
+	double		Lq[BLMS_MAX];
+	double		lambda[BLMS_MAX];
+	double		Zp[BLMS_MAX];
+
+	double		Ct[BLMS_MAX];
+	double		Rt[BLMS_MAX];
+
+	double		Udc[BLMS_MAX];
+	double		Rdc[BLMS_MAX];
+	double		Cdc[BLMS_MAX];
+
+	double		Jm[BLMS_MAX];
+	double		Mq[4][BLMS_MAX];
+
+	int		pwm_A[BLMS_MAX];
+	int		pwm_B[BLMS_MAX];
+	int		pwm_C[BLMS_MAX];
+	int		pwm_Z[BLMS_MAX];
+
+	double		state[15][BLMS_MAX];
+	double		drain_wP[BLMS_MAX];
+	int		revol[BLMS_MAX];
+
+	/* Inverse constants of the current PWM cycle.
+	 * */
+	double		inv_Ld[BLMS_MAX];
+	double		inv_Lq[BLMS_MAX];
+	double		inv_Zp[BLMS_MAX];
+	double		inv_Rdc[BLMS_MAX];
+	double		inv_Cdc[BLMS_MAX];
+	double		inv_Jm[BLMS_MAX];
+	double		inv_Rt[BLMS_MAX];
+	double		inv_Ct[BLMS_MAX];
+
+	/* SIN/COS of the position carried between the steps.
+	 * */
+	double		pos_S[BLMS_MAX];
+	double		pos_C[BLMS_MAX];
+
+	/* Switching instants of the current PWM cycle (tick).
+	 * */
+	double		x_hs[3][BLMS_MAX];
+	double		x_ls[3][BLMS_MAX];
+
+	float		analog_iA[BLMS_MAX];
+	float		analog_iB[BLMS_MAX];
+	float		analog_iC[BLMS_MAX];
+	float		analog_uS[BLMS_MAX];
+	float		analog_uA[BLMS_MAX];
+	float		analog_uB[BLMS_MAX];
+	float		analog_uC[BLMS_MAX];
+
+	int		pulse_HS[BLMS_MAX];
+	int		pulse_EP[BLMS_MAX];
+
+	float		analog_SIN[BLMS_MAX];
+	float		analog_COS[BLMS_MAX];
+
+	/* Lagged Fibonacci generator of each instance. All of them are
+	 * advanced together so the lags are common.
+	 * */
+	double		lfg_seed[55][BLMS_MAX];
+	int		lfg_ra, lfg_rb;
+
+	struct {
+
+		long	steps;
+	}
+	sol_stat;
+}
+blms_t;
+
+void blms_enable(blms_t *mc, const blm_t *m, int N);
+void blms_load(blms_t *mc, int n, const blm_t *m);
+void blms_seed(blms_t *mc, int seed);
+void blms_restart(blms_t *mc);
+void blms_update(blms_t *mc);
+
+#endif /* _H_BLMS_ */
+
@@ -0,0 +1,540 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif /* __x86_64__ */
+
+#include "blm.h"
+#include "cost.h"
+#include "lfg.h"
+#include "pm.h"
+#include "tsfunc.h"
+
+typedef struct {
+
+	int		config;
+	double		m_freq;
+}
+cost_arg_t;
+
+__thread cost_t		*sim_cost;
+
+static const char	*cost_name[COST_MAX] = {
+
+	"pm_feedback",
+	"pm_lu_FSM",
+	"pm_flux_ortega",
+	"pm_flux_kalman",
+	"pm_kalman_forecast",
+	"pm_kalman_update",
+	"pm_sensor_hall",
+	"pm_sensor_eabi",
+	"pm_hfi_wave",
+	"pm_loop_speed",
+	"pm_loop_current",
+	"pm_voltage",
+	"pm_FSM"
+};
+
+static const char	*cost_state_name[] = {
+
+	"IDLE",
+	"ZERO_DRIFT",
+	"SELF_TEST_BOOTSTRAP",
+	"SELF_TEST_POWER_STAGE",
+	"SELF_TEST_CLEARANCE",
+	"ADJUST_VOLTAGE",
+	"ADJUST_CURRENT",
+	"PROBE_CONST_RESISTANCE",
+	"PROBE_CONST_INDUCTANCE",
+	"LU_DETACHED",
+	"LU_STARTUP",
+	"LU_SHUTDOWN",
+	"PROBE_CONST_FLUX_LINKAGE",
+	"PROBE_CONST_INERTIA",
+	"PROBE_NOISE_THRESHOLD",
+	"ADJUST_SENSOR_HALL",
+	"ADJUST_SENSOR_EABI",
+	"ADJUST_SENSOR_SINCOS",
+	"LOOP_BOOST",
+	"HALT"
+};
+
+static const char	*cost_lu_name[] = {
+
+	"DISABLED",
+	"DETACHED",
+	"FORCED",
+	"ESTIMATE",
+	"ON_HFI",
+	"SENSOR_HALL",
+	"SENSOR_EABI",
+	"SENSOR_SINCOS"
+};
+
+static void
+cost_speed_kalman()
+{
+	pm.config_LU_ESTIMATE = PM_FLUX_KALMAN;
+
+	ts_script_speed();
+}
+
+static void
+cost_eabi_incremental() { ts_script_eabi(PM_EABI_INCREMENTAL); }
+
+/* Each configuration is run on the machine from ts_script_test() that it
+ * is known to pass on. The base identification is collected as separate
+ * configuration.
+ * */
+static const struct {
+
+	const char	*name;
+	void		(* proc) ();
+
+	double		Rs, Ld, Lq, Udc, Rdc;
+	int		Zp;
+	double		Kv, Jm;
+}
+cost_config_list[] = {
+
+	{ "base", NULL },
+	{ "ortega",	&ts_script_speed,	14.E-3, 10.E-6, 15.E-6, 22., 0.1, 14, 270., 3.E-4 },
+	{ "kalman",	&cost_speed_kalman,	14.E-3, 10.E-6, 15.E-6, 22., 0.1, 14, 270., 3.E-4 },
+	{ "hfi",	&ts_script_hfi,		14.E-3, 10.E-6, 15.E-6, 22., 0.1, 14, 270., 3.E-4 },
+	{ "hall",	&ts_script_hall,	0.24, 520.E-6, 650.E-6, 48., 0.5, 15, 15., 6.E-3 },
+	{ "eabi",	&cost_eabi_incremental,	14.E-3, 10.E-6, 15.E-6, 22., 0.1, 14, 270., 3.E-4 },
+
+	{ NULL }
+};
+
+static long long
+cost_counter()
+{
+	long long		val;
+
+	if (sim_cost->fd >= 0) {
+
+		/* Retired instructions in user space.
+		 * */
+		if (read(sim_cost->fd, &val, sizeof(val)) == sizeof(val))
+			return val;
+	}
+
+#if defined(__x86_64__) || defined(__i386__)
+	return (long long) __rdtsc();
+#else /* __x86_64__ */
+	{
+		struct timespec		ts;
+
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+
+		return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+	}
+#endif /* __x86_64__ */
+}
+
+static const char *
+cost_counter_name()
+{
+	if (sim_cost->fd >= 0)
+		return "insn";
+
+#if defined(__x86_64__) || defined(__i386__)
+	return "tsc";
+#else /* __x86_64__ */
+	return "ns";
+#endif /* __x86_64__ */
+}
+
+static void
+cost_counter_open()
+{
+	struct perf_event_attr		attr;
+
+	memset(&attr, 0, sizeof(attr));
+
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+
+	sim_cost->fd = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+
+	if (sim_cost->fd < 0) {
+
+		fprintf(stderr, "perf_event_open: %s (fallback to %s)\n",
+				strerror(errno), cost_counter_name());
+	}
+}
+
+static void
+cost_counter_calibrate()
+{
+	long long	last, now, min;
+	int		N;
+
+	/* Take the minimal cost of the counter itself.
+	 * */
+	min = 1LL << 60;
+	last = cost_counter();
+
+	for (N = 0; N < 10000; ++N) {
+
+		now = cost_counter();
+		min = (now - last < min) ? now - last : min;
+		last = now;
+	}
+
+	sim_cost->overhead = (double) min;
+}
+
+void cost_enter(int id)
+{
+	cost_t		*cost = sim_cost;
+
+	if (cost == NULL)
+		return ;
+
+	if (cost->depth >= COST_DEPTH_MAX) {
+
+		/* Frames above the stack are not measured but we count them
+		 * so that leave does not pop the parent.
+		 * */
+		cost->overflow++;
+		return ;
+	}
+
+	cost->stack[cost->depth].id = id;
+	cost->stack[cost->depth].child = 0;
+
+	cost->depth++;
+
+	cost->stack[cost->depth - 1].start = cost_counter();
+}
+
+void cost_leave(int id)
+{
+	cost_t		*cost = sim_cost;
+	long long	now;
+	double		val;
+
+	if (cost == NULL)
+		return ;
+
+	if (cost->overflow > 0) {
+
+		cost->overflow--;
+		return ;
+	}
+
+	if (cost->depth < 1)
+		return ;
+
+	now = cost_counter();
+
+	cost->depth--;
+
+	if (cost->stack[cost->depth].id != id)
+		return ;
+
+	val = (double) (now - cost->stack[cost->depth].start
+			- cost->stack[cost->depth].child) - cost->overhead;
+
+	cost->cycle[id] += (val > 0.) ? val : 0.;
+
+	if (cost->depth > 0) {
+
+		/* Parent also counts our two counter reads.
+		 * */
+		cost->stack[cost->depth - 1].child += (long long) (2. * cost->overhead);
+	}
+}
+
+static cost_bin_t *
+cost_bin(int config, int fsm_state, int lu_MODE)
+{
+	cost_t		*cost = sim_cost;
+	cost_bin_t	*bin;
+	int		N;
+
+	for (N = 0; N < cost->bin_N; ++N) {
+
+		bin = &cost->bin[N];
+
+		if (		bin->config == config
+				&& bin->fsm_state == fsm_state
+				&& bin->lu_MODE == lu_MODE)
+			return bin;
+	}
+
+	if (cost->bin_N >= COST_BIN_MAX)
+		return NULL;
+
+	bin = &cost->bin[cost->bin_N++];
+
+	bin->config = config;
+	bin->fsm_state = fsm_state;
+	bin->lu_MODE = lu_MODE;
+
+	return bin;
+}
+
+static int
+cost_hist_index(double val)
+{
+	int		N;
+
+	/* We use eight buckets per octave.
+	 * */
+	N = (val > 1.) ? (int) (log2(val) * 8.) : 0;
+
+	return (N < COST_HIST_MAX) ? N : COST_HIST_MAX - 1;
+}
+
+static double
+cost_hist_percentile(const cost_stat_t *stat, double pc)
+{
+	long		sum = 0, level;
+	int		N;
+
+	level = (long) ceil(stat->calls * pc);
+
+	for (N = 0; N < COST_HIST_MAX; ++N) {
+
+		sum += stat->hist[N];
+
+		if (sum >= level)
+			break;
+	}
+
+	/* Upper bound of the bucket.
+	 * */
+	return pow(2., (N + 1) / 8.);
+}
+
+void cost_feedback(pmc_t *pm, pmfb_t *fb)
+{
+	cost_t		*cost = sim_cost;
+	cost_bin_t	*bin;
+	cost_stat_t	*stat;
+	int		fsm_state, lu_MODE, N;
+
+	/* Bin is selected by the state at the cycle start.
+	 * */
+	fsm_state = pm->fsm_state;
+	lu_MODE = pm->lu_MODE;
+
+	memset(cost->cycle, 0, sizeof(cost->cycle));
+
+	cost->depth = 0;
+	cost->overflow = 0;
+
+	cost_enter(COST_FEEDBACK);
+
+	pm_feedback(pm, fb);
+
+	cost_leave(COST_FEEDBACK);
+
+	bin = cost_bin(cost->config, fsm_state, lu_MODE);
+
+	if (bin == NULL)
+		return ;
+
+	bin->cycles += 1;
+
+	for (N = 0; N < COST_MAX; ++N) {
+
+		if (cost->cycle[N] > 0.) {
+
+			stat = &bin->stat[N];
+
+			stat->calls += 1;
+			stat->sum += cost->cycle[N];
+			stat->max = (cost->cycle[N] > stat->max) ? cost->cycle[N] : stat->max;
+			stat->hist[cost_hist_index(cost->cycle[N])] += 1;
+		}
+	}
+}
+
+static void
+cost_run_proc(void *arg)
+{
+	const cost_arg_t	*ca = (const cost_arg_t *) arg;
+	int			config = ca->config;
+
+	memset(&m, 0, sizeof(m));
+	memset(&pm, 0, sizeof(pm));
+
+	blm_enable(&m);
+
+	lfg_start(&m.lfg, 1);
+
+	m.Rs = cost_config_list[config].Rs;
+	m.Ld = cost_config_list[config].Ld;
+	m.Lq = cost_config_list[config].Lq;
+	m.Udc = cost_config_list[config].Udc;
+	m.Rdc = cost_config_list[config].Rdc;
+	m.Zp = cost_config_list[config].Zp;
+	m.lambda = blm_Kv_lambda(&m, cost_config_list[config].Kv);
+	m.Jm = cost_config_list[config].Jm;
+
+	/* PWM frequency of the target we estimate the budget for.
+	 * */
+	m.pwm_dT = 1. / ca->m_freq;
+
+	blm_restart(&m);
+
+	sim_cost->config = 0;
+
+	ts_script_default();
+	ts_script_base();
+	blm_restart(&m);
+
+	sim_cost->config = config;
+
+	cost_config_list[config].proc();
+}
+
+static int
+cost_report(double m_freq, double budget, double scale, FILE *fd)
+{
+	const cost_t		*cost = sim_cost;
+	const cost_bin_t	*bin;
+	const cost_stat_t	*stat;
+
+	double			p999, worst;
+	int			N, n, rc = 0;
+
+	fprintf(fd, "# counter %s overhead %.1f\n", cost_counter_name(), cost->overhead);
+	fprintf(fd, "# m_freq %.1f budget %.1f scale %.4f\n", m_freq, budget, scale);
+	fprintf(fd, "# config state lu_MODE cycles func calls mean p999 max load flag\n");
+
+	for (N = 0; N < cost->bin_N; ++N) {
+
+		bin = &cost->bin[N];
+
+		for (n = 0; n < COST_MAX; ++n) {
+
+			stat = &bin->stat[n];
+
+			if (stat->calls == 0)
+				continue;
+
+			p999 = cost_hist_percentile(stat, .999);
+			p999 = (p999 < stat->max) ? p999 : stat->max;
+
+			/* Time counters see the host preemption, so we take
+			 * the worst case from the 99.9 percentile.
+			 * */
+			worst = (cost->fd >= 0) ? stat->max : p999;
+			worst *= scale;
+
+			fprintf(fd, "%s %s %s %li %s %li %.1f %.1f %.1f %.1f%% %s\n",
+					cost_config_list[bin->config].name,
+					cost_state_name[bin->fsm_state],
+					cost_lu_name[bin->lu_MODE], bin->cycles,
+					cost_name[n], stat->calls, stat->sum / stat->calls,
+					p999, stat->max, worst * 100. / budget,
+					(worst > budget) ? "OVER" : "OK");
+
+			rc = (worst > budget) ? 1 : rc;
+		}
+	}
+
+	return rc;
+}
+
+int cost_script(double m_freq, double cpu_hz, double scale)
+{
+	cost_arg_t		ca;
+
+	FILE			*fd;
+	double			budget;
+	int			N, status, rc = 0;
+
+	sim_cost = calloc(1, sizeof(cost_t));
+
+	if (sim_cost == NULL) {
+
+		fprintf(stderr, "calloc: %s\n", strerror(errno));
+		return -1;
+	}
+
+	if (m_freq < 1.) {
+
+		/* Take the default PWM frequency of the plant.
+		 * */
+		blm_enable(&m);
+
+		m_freq = 1. / m.pwm_dT;
+	}
+
+	cost_counter_open();
+	cost_counter_calibrate();
+
+	budget = cpu_hz / m_freq;
+
+	tlm_setup(NULL, NULL);
+
+	ts_log = fopen("/dev/null", "w");
+
+	if (ts_log == NULL) {
+
+		fprintf(stderr, "fopen: %s\n", strerror(errno));
+
+		free(sim_cost);
+		sim_cost = NULL;
+
+		return -1;
+	}
+
+	for (N = 1; cost_config_list[N].name != NULL; ++N) {
+
+		ca.config = N;
+		ca.m_freq = m_freq;
+
+		status = sim_protect(&cost_run_proc, (void *) &ca);
+
+		fprintf(stderr, "  COST	%s %s\n", cost_config_list[N].name,
+				(status == 0) ? "OK" : "FAULT");
+
+		rc = (status != 0) ? -1 : rc;
+	}
+
+	fclose(ts_log);
+	ts_log = stdout;
+
+	N = cost_report(m_freq, budget, scale, stdout);
+
+	fd = fopen(COST_FILE, "w");
+
+	if (fd != NULL) {
+
+		cost_report(m_freq, budget, scale, fd);
+		fclose(fd);
+	}
+	else {
+		fprintf(stderr, "fopen: %s\n", strerror(errno));
+	}
+
+	if (sim_cost->fd >= 0) {
+
+		close(sim_cost->fd);
+	}
+
+	free(sim_cost);
+	sim_cost = NULL;
+
+	return (rc == 0) ? N : rc;
+}
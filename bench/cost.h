@@ -0,0 +1,92 @@
+#ifndef _H_COST_
+#define _H_COST_
+
+#include "pm.h"
+
+#define COST_FILE		"/tmp/pm-cost.txt"
+
+#define COST_BIN_MAX		80
+#define COST_HIST_MAX		256
+#define COST_DEPTH_MAX		8
+
+/* Default target is STM32F405 at full clock.
+ * */
+#define COST_CPU_HZ		168000000.
+
+enum {
+	COST_FEEDBACK		= 0,
+	COST_LU_FSM,
+	COST_FLUX_ORTEGA,
+	COST_FLUX_KALMAN,
+	COST_KALMAN_FORECAST,
+	COST_KALMAN_UPDATE,
+	COST_SENSOR_HALL,
+	COST_SENSOR_EABI,
+	COST_HFI_WAVE,
+	COST_LOOP_SPEED,
+	COST_LOOP_CURRENT,
+	COST_VOLTAGE,
+	COST_FSM,
+	COST_MAX
+};
+
+typedef struct {
+
+	long		calls;
+
+	double		sum;
+	double		max;
+
+	long		hist[COST_HIST_MAX];
+}
+cost_stat_t;
+
+typedef struct {
+
+	int		config;
+	int		fsm_state;
+	int		lu_MODE;
+
+	long		cycles;
+
+	cost_stat_t	stat[COST_MAX];
+}
+cost_bin_t;
+
+typedef struct {
+
+	int		fd;
+	double		overhead;
+
+	int		config;
+
+	struct {
+
+		int		id;
+
+		long long	start;
+		long long	child;
+	}
+	stack[COST_DEPTH_MAX];
+
+	int		depth;
+	int		overflow;
+
+	double		cycle[COST_MAX];
+
+	cost_bin_t	bin[COST_BIN_MAX];
+	int		bin_N;
+}
+cost_t;
+
+extern __thread cost_t		*sim_cost;
+
+void cost_enter(int id);
+void cost_leave(int id);
+
+void cost_feedback(pmc_t *pm, pmfb_t *fb);
+
+int cost_script(double m_freq, double cpu_hz, double scale);
+
+#endif /* _H_COST_ */
+
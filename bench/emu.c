@@ -0,0 +1,875 @@
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "blm.h"
+#include "blmf.h"
+#include "emu.h"
+#include "lfg.h"
+
+/* Emulator runs the firmware modules against the plant model and exposes
+ * the shell on a pseudo-terminal. Each firmware task is a host thread and
+ * ADC IRQ is called from the plant thread once per PWM cycle.
+ * */
+
+#define EMU_FLASH_BEGIN		0x08000000UL
+#define EMU_FLASH_SIZE		0x00100000UL
+
+#define EMU_TASK_MAX		32
+#define EMU_RING_SIZE		4096
+
+#define EMU_ENV_PTY		"EMU_PTY_FD"
+#define EMU_ENV_FLASH		"EMU_FLASH_FD"
+
+enum {
+	EMU_PLANT_BLM		= 0,
+	EMU_PLANT_FAST,
+	EMU_PLANT_SKIP
+};
+
+typedef struct {
+
+	char		buf[EMU_RING_SIZE];
+
+	int		rp;
+	int		wp;
+
+	pthread_mutex_t	mutex;
+	pthread_cond_t	cond;
+}
+emu_ring_t;
+
+typedef struct {
+
+	char		name[16];
+
+	void		(* proc) (void *);
+	void		*arg;
+
+	int		busy;
+}
+emu_task_t;
+
+typedef struct {
+
+	double		speed;
+	const char	*flash;
+	const char	*link;
+	int		seed;
+	int		plant;
+	int		test;
+
+	char		**argv;
+}
+emu_opt_t;
+
+emu_port_t			emu;
+
+static blm_t			m;
+static blmf_t			mf;
+static emu_opt_t		opt;
+
+static int			pty_master;
+static int			pty_slave;
+
+static emu_ring_t		rx;
+static emu_ring_t		tx;
+
+static emu_task_t		task[EMU_TASK_MAX];
+static pthread_mutex_t		task_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static unsigned int		tick;
+static pthread_mutex_t		tick_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t		tick_cond = PTHREAD_COND_INITIALIZER;
+
+static pthread_mutex_t		irq_mutex;
+
+static void
+emu_ring_init(emu_ring_t *ring)
+{
+	ring->rp = 0;
+	ring->wp = 0;
+
+	pthread_mutex_init(&ring->mutex, NULL);
+	pthread_cond_init(&ring->cond, NULL);
+}
+
+static int
+emu_ring_count(const emu_ring_t *ring)
+{
+	return (ring->wp - ring->rp + EMU_RING_SIZE) % EMU_RING_SIZE;
+}
+
+static void *
+emu_pty_reader(void *unused)
+{
+	char		buf[EMU_RING_SIZE];
+	int		len, n;
+
+	for (;;) {
+
+		len = read(pty_master, buf, sizeof(buf));
+
+		if (len < 0 && errno == EINTR)
+			continue;
+
+		if (len <= 0) {
+
+			fprintf(stderr, "read: %s\n", strerror(errno));
+			exit(-1);
+		}
+
+		pthread_mutex_lock(&rx.mutex);
+
+		for (n = 0; n < len; ++n) {
+
+			/* Wait for the shell to take something if ring
+			 * is full as USART does with RX queue.
+			 * */
+			while (emu_ring_count(&rx) == EMU_RING_SIZE - 1) {
+
+				pthread_cond_wait(&rx.cond, &rx.mutex);
+			}
+
+			rx.buf[rx.wp] = buf[n];
+			rx.wp = (rx.wp + 1) % EMU_RING_SIZE;
+		}
+
+		pthread_cond_broadcast(&rx.cond);
+		pthread_mutex_unlock(&rx.mutex);
+	}
+
+	return NULL;
+}
+
+static void *
+emu_pty_writer(void *unused)
+{
+	char		buf[EMU_RING_SIZE];
+	int		len, n, rc;
+
+	for (;;) {
+
+		pthread_mutex_lock(&tx.mutex);
+
+		while (tx.rp == tx.wp) {
+
+			pthread_cond_wait(&tx.cond, &tx.mutex);
+		}
+
+		len = emu_ring_count(&tx);
+
+		for (n = 0; n < len; ++n) {
+
+			buf[n] = tx.buf[tx.rp];
+			tx.rp = (tx.rp + 1) % EMU_RING_SIZE;
+		}
+
+		pthread_cond_broadcast(&tx.cond);
+		pthread_mutex_unlock(&tx.mutex);
+
+		for (n = 0; n < len; n += rc) {
+
+			rc = write(pty_master, buf + n, len - n);
+
+			if (rc < 0) {
+
+				if (errno == EINTR)
+					rc = 0;
+				else
+					break;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+int emu_getc()
+{
+	int		c;
+
+	pthread_mutex_lock(&rx.mutex);
+
+	while (rx.rp == rx.wp) {
+
+		pthread_cond_wait(&rx.cond, &rx.mutex);
+	}
+
+	c = (unsigned char) rx.buf[rx.rp];
+	rx.rp = (rx.rp + 1) % EMU_RING_SIZE;
+
+	pthread_cond_broadcast(&rx.cond);
+	pthread_mutex_unlock(&rx.mutex);
+
+	return c;
+}
+
+int emu_poll()
+{
+	int		len;
+
+	pthread_mutex_lock(&rx.mutex);
+
+	len = emu_ring_count(&rx);
+
+	pthread_mutex_unlock(&rx.mutex);
+
+	return len;
+}
+
+void emu_putc(int c)
+{
+	pthread_mutex_lock(&tx.mutex);
+
+	while (emu_ring_count(&tx) == EMU_RING_SIZE - 1) {
+
+		pthread_cond_wait(&tx.cond, &tx.mutex);
+	}
+
+	if (tx.rp == tx.wp) {
+
+		/* Wake up the writer as ring was empty.
+		 * */
+		pthread_cond_broadcast(&tx.cond);
+	}
+
+	tx.buf[tx.wp] = (char) c;
+	tx.wp = (tx.wp + 1) % EMU_RING_SIZE;
+
+	pthread_mutex_unlock(&tx.mutex);
+}
+
+static void
+emu_pty_flush()
+{
+	struct timespec		ts = { 0, 1000000L };
+	int			n;
+
+	/* Give the writer a little time to drain the ring.
+	 * */
+	for (n = 0; n < 100; ++n) {
+
+		if (emu_ring_count(&tx) == 0)
+			break;
+
+		nanosleep(&ts, NULL);
+	}
+
+	tcdrain(pty_master);
+}
+
+static int
+emu_pty_open()
+{
+	struct termios		tio;
+	const char		*env, *name;
+	int			flags;
+
+	env = getenv(EMU_ENV_PTY);
+
+	if (env != NULL) {
+
+		/* We keep the same master across reset so the client does not
+		 * see the link is gone.
+		 * */
+		pty_master = strtol(env, NULL, 10);
+	}
+	else {
+		pty_master = posix_openpt(O_RDWR | O_NOCTTY);
+
+		if (pty_master < 0) {
+
+			fprintf(stderr, "posix_openpt: %s\n", strerror(errno));
+			return -1;
+		}
+
+		if (grantpt(pty_master) != 0 || unlockpt(pty_master) != 0) {
+
+			fprintf(stderr, "unlockpt: %s\n", strerror(errno));
+			return -1;
+		}
+	}
+
+	flags = fcntl(pty_master, F_GETFD);
+	fcntl(pty_master, F_SETFD, flags & ~FD_CLOEXEC);
+
+	name = ptsname(pty_master);
+
+	if (name == NULL) {
+
+		fprintf(stderr, "ptsname: %s\n", strerror(errno));
+		return -1;
+	}
+
+	/* We hold the slave open to not get EIO on master when the
+	 * client disconnects.
+	 * */
+	pty_slave = open(name, O_RDWR | O_NOCTTY | O_CLOEXEC);
+
+	if (pty_slave < 0) {
+
+		fprintf(stderr, "open: %s\n", strerror(errno));
+		return -1;
+	}
+
+	if (env == NULL) {
+
+		tcgetattr(pty_slave, &tio);
+		cfmakeraw(&tio);
+		tcsetattr(pty_slave, TCSANOW, &tio);
+
+		printf("emu: shell on %s\n", name);
+
+		if (opt.link != NULL) {
+
+			unlink(opt.link);
+
+			if (symlink(name, opt.link) != 0) {
+
+				fprintf(stderr, "symlink: %s\n", strerror(errno));
+			}
+		}
+
+		fflush(stdout);
+	}
+
+	return 0;
+}
+
+static int
+emu_flash_open()
+{
+	struct stat		sb;
+	const char		*env;
+	unsigned char		*flash;
+	int			fd, flags, mflags;
+	off_t			size = 0;
+
+	env = getenv(EMU_ENV_FLASH);
+
+	if (env != NULL) {
+
+		fd = strtol(env, NULL, 10);
+		size = EMU_FLASH_SIZE;
+	}
+	else if (opt.flash != NULL) {
+
+		fd = open(opt.flash, O_RDWR | O_CREAT, 0644);
+
+		if (fd < 0) {
+
+			fprintf(stderr, "open: %s\n", strerror(errno));
+			return -1;
+		}
+
+		if (fstat(fd, &sb) == 0) {
+
+			size = (sb.st_size < EMU_FLASH_SIZE) ? sb.st_size : EMU_FLASH_SIZE;
+		}
+	}
+	else {
+		/* Anonymous flash still survives the reset.
+		 * */
+		fd = memfd_create("flash", 0);
+
+		if (fd < 0) {
+
+			fprintf(stderr, "memfd_create: %s\n", strerror(errno));
+			return -1;
+		}
+	}
+
+	if (ftruncate(fd, EMU_FLASH_SIZE) != 0) {
+
+		fprintf(stderr, "ftruncate: %s\n", strerror(errno));
+		return -1;
+	}
+
+	flags = fcntl(fd, F_GETFD);
+	fcntl(fd, F_SETFD, flags & ~FD_CLOEXEC);
+
+	mflags = MAP_SHARED | MAP_FIXED_NOREPLACE;
+
+	/* We map flash at the same address as MCU has because firmware keeps
+	 * the flash addresses in 32-bit integers.
+	 * */
+	flash = mmap((void *) EMU_FLASH_BEGIN, EMU_FLASH_SIZE,
+			PROT_READ | PROT_WRITE, mflags, fd, 0);
+
+	if (flash != (void *) EMU_FLASH_BEGIN) {
+
+		fprintf(stderr, "mmap: %s\n", strerror(errno));
+		return -1;
+	}
+
+	if (size < EMU_FLASH_SIZE) {
+
+		/* Newly allocated flash is erased.
+		 * */
+		memset(flash + size, 0xFF, EMU_FLASH_SIZE - size);
+	}
+
+	if (env == NULL) {
+
+		char		ebuf[20];
+
+		sprintf(ebuf, "%i", fd);
+		setenv(EMU_ENV_FLASH, ebuf, 1);
+	}
+
+	return 0;
+}
+
+static __thread int		task_self = -1;
+
+static void *
+emu_task_entry(void *arg)
+{
+	emu_task_t		*ts = (emu_task_t *) arg;
+
+	task_self = (int) (ts - task);
+
+	ts->proc(ts->arg);
+
+	emu_task_exit();
+
+	return NULL;
+}
+
+int emu_task_create(void (* proc) (void *), const char *name, void *arg)
+{
+	pthread_attr_t		attr;
+	pthread_t		thread;
+	int			N, id = -1;
+
+	pthread_mutex_lock(&task_mutex);
+
+	for (N = 0; N < EMU_TASK_MAX; ++N) {
+
+		if (task[N].busy == 0) {
+
+			strncpy(task[N].name, name, sizeof(task[0].name) - 1);
+
+			task[N].proc = proc;
+			task[N].arg = arg;
+			task[N].busy = 1;
+
+			id = N;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&task_mutex);
+
+	if (id >= 0) {
+
+		pthread_attr_init(&attr);
+		pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+		if (pthread_create(&thread, &attr, &emu_task_entry, &task[id]) != 0) {
+
+			fprintf(stderr, "pthread_create: %s\n", strerror(errno));
+
+			pthread_mutex_lock(&task_mutex);
+
+			task[id].busy = 0;
+
+			pthread_mutex_unlock(&task_mutex);
+
+			id = -1;
+		}
+
+		pthread_attr_destroy(&attr);
+	}
+
+	return id;
+}
+
+void emu_task_exit()
+{
+	if (task_self >= 0) {
+
+		pthread_mutex_lock(&task_mutex);
+
+		task[task_self].busy = 0;
+
+		pthread_mutex_unlock(&task_mutex);
+	}
+
+	pthread_exit(NULL);
+}
+
+int emu_task_lookup(const char *name)
+{
+	int		N, id = -1;
+
+	pthread_mutex_lock(&task_mutex);
+
+	for (N = 0; N < EMU_TASK_MAX; ++N) {
+
+		if (task[N].busy != 0 && strcmp(task[N].name, name) == 0) {
+
+			id = N;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&task_mutex);
+
+	return id;
+}
+
+const char *emu_task_name(int id)
+{
+	if (id < 0 || id >= EMU_TASK_MAX)
+		return NULL;
+
+	return (task[id].busy != 0) ? task[id].name : "";
+}
+
+unsigned int emu_tick()
+{
+	return __atomic_load_n(&tick, __ATOMIC_RELAXED);
+}
+
+void emu_tick_wait(unsigned int xtick)
+{
+	pthread_mutex_lock(&tick_mutex);
+
+	while ((int) (xtick - tick) > 0) {
+
+		pthread_cond_wait(&tick_cond, &tick_mutex);
+	}
+
+	pthread_mutex_unlock(&tick_mutex);
+}
+
+void emu_irq_lock()
+{
+	pthread_mutex_lock(&irq_mutex);
+}
+
+void emu_irq_unlock()
+{
+	pthread_mutex_unlock(&irq_mutex);
+}
+
+void *emu_malloc(int size)
+{
+	return malloc(size);
+}
+
+void emu_free(void *p)
+{
+	free(p);
+}
+
+void emu_reset()
+{
+	emu_pty_flush();
+
+	/* We restart the whole process and keep the pty and flash open.
+	 * */
+	if (getenv(EMU_ENV_PTY) == NULL) {
+
+		char		ebuf[20];
+
+		sprintf(ebuf, "%i", pty_master);
+		setenv(EMU_ENV_PTY, ebuf, 1);
+	}
+
+	execv("/proc/self/exe", opt.argv);
+
+	fprintf(stderr, "execv: %s\n", strerror(errno));
+	exit(-1);
+}
+
+static double
+emu_clock()
+{
+	struct timespec		ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (double) ts.tv_sec + (double) ts.tv_nsec * 1.E-9;
+}
+
+static void
+emu_plant_config()
+{
+	m.pwm_dT = 1. / (double) emu.pwm_freq;
+	m.pwm_deadtime = (double) emu.pwm_deadtime * 1.E-9;
+	m.pwm_resolution = emu.pwm_resolution;
+
+	m.range_A = (double) emu.range_A;
+	m.range_B = (double) emu.range_B;
+
+	mf.pwm_dT = m.pwm_dT;
+	mf.pwm_deadtime = m.pwm_deadtime;
+	mf.pwm_resolution = m.pwm_resolution;
+
+	mf.range_A = (float) m.range_A;
+	mf.range_B = (float) m.range_B;
+}
+
+static double
+emu_plant_update()
+{
+	if (opt.plant == EMU_PLANT_BLM) {
+
+		blm_update(&m);
+
+		emu.analog_iA = m.analog_iA;
+		emu.analog_iB = m.analog_iB;
+		emu.analog_iC = m.analog_iC;
+		emu.analog_uS = m.analog_uS;
+		emu.analog_uA = m.analog_uA;
+		emu.analog_uB = m.analog_uB;
+		emu.analog_uC = m.analog_uC;
+
+		emu.pulse_HS = m.pulse_HS;
+		emu.pulse_EP = m.pulse_EP;
+
+		return m.time;
+	}
+	else {
+		mf.pwm_A = m.pwm_A;
+		mf.pwm_B = m.pwm_B;
+		mf.pwm_C = m.pwm_C;
+		mf.pwm_Z = m.pwm_Z;
+
+		blmf_update(&mf);
+
+		emu.analog_iA = mf.analog_iA;
+		emu.analog_iB = mf.analog_iB;
+		emu.analog_iC = mf.analog_iC;
+		emu.analog_uS = mf.analog_uS;
+		emu.analog_uA = mf.analog_uA;
+		emu.analog_uB = mf.analog_uB;
+		emu.analog_uC = mf.analog_uC;
+
+		emu.pulse_HS = mf.pulse_HS;
+		emu.pulse_EP = mf.pulse_EP;
+
+		return mf.time;
+	}
+}
+
+static void
+emu_plant()
+{
+	double		wall, clock, sleep, time = 0.;
+	unsigned int	xtick;
+
+	blm_enable(&m);
+
+	m.Rs = 28.E-3;
+	m.Ld = 14.E-6;
+	m.Lq = 22.E-6;
+	m.Udc = 48.;
+	m.Rdc = 0.1;
+	m.Zp = 14;
+	m.lambda = blm_Kv_lambda(&m, 87.);
+	m.Jm = 0.82E-3;
+
+	blm_restart(&m);
+
+	/* Fast plant takes the same machine.
+	 * */
+	mf.dt_skip = (opt.plant == EMU_PLANT_SKIP) ? 1 : 0;
+
+	blmf_enable(&mf, &m);
+	blmf_seed(&mf, opt.seed);
+	blmf_restart(&mf);
+
+	wall = emu_clock();
+
+	for (;;) {
+
+		emu_irq_lock();
+
+		if (emu.pwm_enabled != 0) {
+
+			if (		m.pwm_resolution != emu.pwm_resolution
+					|| m.range_A != (double) emu.range_A) {
+
+				emu_plant_config();
+			}
+
+			m.pwm_A = emu.pwm_A;
+			m.pwm_B = emu.pwm_B;
+			m.pwm_C = emu.pwm_C;
+			m.pwm_Z = (emu.pwm_Z != 0) ? BLM_Z_DETACHED : BLM_Z_NONE;
+		}
+
+		time = emu_plant_update();
+
+		if (emu.pwm_enabled != 0) {
+
+			emu_irq();
+		}
+
+		emu_irq_unlock();
+
+		xtick = (unsigned int) (time * 1000.);
+
+		if (xtick != tick) {
+
+			pthread_mutex_lock(&tick_mutex);
+
+			tick = xtick;
+
+			pthread_cond_broadcast(&tick_cond);
+			pthread_mutex_unlock(&tick_mutex);
+
+			if (opt.speed > 0.) {
+
+				/* Keep pace with the wall clock.
+				 * */
+				clock = emu_clock() - wall;
+				sleep = time / opt.speed - clock;
+
+				if (sleep > 0.) {
+
+					struct timespec		ts;
+
+					ts.tv_sec = (time_t) sleep;
+					ts.tv_nsec = (long) ((sleep - (double) ts.tv_sec) * 1.E+9);
+
+					nanosleep(&ts, NULL);
+				}
+			}
+		}
+	}
+}
+
+static void *
+emu_test_thread(void *unused)
+{
+	/* Test holds the other side of pty as the host does.
+	 * */
+	exit((emu_test(pty_slave) == 0) ? 0 : -1);
+
+	return NULL;
+}
+
+static void
+emu_usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-s speed] [-f flash] [-l link] [-r seed]"
+			" [-p plant] [-t]\n", name);
+	fprintf(stderr, "  -s speed    Relative to real time, 0 is as fast as possible\n");
+	fprintf(stderr, "  -f flash    File to keep the flash content in\n");
+	fprintf(stderr, "  -l link     Symlink to pty device\n");
+	fprintf(stderr, "  -r seed     Seed of plant noise generator\n");
+	fprintf(stderr, "  -p plant    Plant model (blm fast skip), fast is in float and\n"
+			"              skip also skips dead-time steps\n");
+	fprintf(stderr, "  -t          Run loopback test of telemetry flush and exit\n");
+}
+
+int main(int argc, char *argv[])
+{
+	pthread_mutexattr_t	attr;
+	pthread_t		thread;
+	int			c;
+
+	opt.speed = 1.;
+	opt.seed = 1;
+	opt.argv = argv;
+
+	while ((c = getopt(argc, argv, "s:f:l:r:p:th")) != -1) {
+
+		switch (c) {
+
+			case 's':
+				opt.speed = strtod(optarg, NULL);
+				break;
+
+			case 'f':
+				opt.flash = optarg;
+				break;
+
+			case 'l':
+				opt.link = optarg;
+				break;
+
+			case 'r':
+				opt.seed = strtol(optarg, NULL, 10);
+				break;
+
+			case 'p':
+				if (strcmp(optarg, "blm") == 0) {
+
+					opt.plant = EMU_PLANT_BLM;
+				}
+				else if (strcmp(optarg, "fast") == 0) {
+
+					opt.plant = EMU_PLANT_FAST;
+				}
+				else if (strcmp(optarg, "skip") == 0) {
+
+					opt.plant = EMU_PLANT_SKIP;
+				}
+				else {
+					emu_usage(argv[0]);
+					exit(-1);
+				}
+				break;
+
+			case 't':
+				opt.test = 1;
+				break;
+
+			default:
+				emu_usage(argv[0]);
+				exit(-1);
+		}
+	}
+
+	lfg_start(&m.lfg, opt.seed);
+
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&irq_mutex, &attr);
+	pthread_mutexattr_destroy(&attr);
+
+	emu_ring_init(&rx);
+	emu_ring_init(&tx);
+
+	if (emu_flash_open() != 0)
+		exit(-1);
+
+	if (emu_pty_open() != 0)
+		exit(-1);
+
+	pthread_create(&thread, NULL, &emu_pty_reader, NULL);
+	pthread_detach(thread);
+
+	pthread_create(&thread, NULL, &emu_pty_writer, NULL);
+	pthread_detach(thread);
+
+	if (opt.test != 0) {
+
+		pthread_create(&thread, NULL, &emu_test_thread, NULL);
+		pthread_detach(thread);
+	}
+
+	emu_main();
+	emu_plant();
+
+	return 0;
+}
+
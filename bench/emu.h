@@ -0,0 +1,77 @@
+#ifndef _H_EMU_
+#define _H_EMU_
+
+/* This is the boundary between the firmware modules built against the
+ * emulated HAL and the host side of emulator. Only plain C types are used
+ * here as both sides are built with different headers.
+ * */
+
+typedef struct {
+
+	/* PWM state given by the firmware.
+	 * */
+	int		pwm_enabled;
+	float		pwm_freq;
+	float		pwm_deadtime;
+	int		pwm_resolution;
+
+	int		pwm_A;
+	int		pwm_B;
+	int		pwm_C;
+	int		pwm_Z;
+
+	/* Measurement range of ADC channels.
+	 * */
+	float		range_A;
+	float		range_B;
+
+	/* Feedback given by the plant.
+	 * */
+	float		analog_iA;
+	float		analog_iB;
+	float		analog_iC;
+	float		analog_uS;
+	float		analog_uA;
+	float		analog_uB;
+	float		analog_uC;
+
+	int		pulse_HS;
+	int		pulse_EP;
+}
+emu_port_t;
+
+extern emu_port_t	emu;
+
+/* Firmware side.
+ * */
+void emu_irq();
+void emu_main();
+
+/* Host side.
+ * */
+int emu_task_create(void (* proc) (void *), const char *name, void *arg);
+void emu_task_exit();
+int emu_task_lookup(const char *name);
+const char *emu_task_name(int id);
+
+unsigned int emu_tick();
+void emu_tick_wait(unsigned int tick);
+
+void emu_irq_lock();
+void emu_irq_unlock();
+
+void *emu_malloc(int size);
+void emu_free(void *p);
+
+int emu_getc();
+int emu_poll();
+void emu_putc(int c);
+
+void emu_reset();
+
+/* Loopback test.
+ * */
+int emu_test(int fd);
+
+#endif /* _H_EMU_ */
+
@@ -0,0 +1,111 @@
+#ifndef _H_EMU_FW_
+#define _H_EMU_FW_
+
+/* This header is forced into each firmware module built for emulator.
+ * */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* We rename the firmware libc functions that clash with the host libc.
+ * */
+#define memset			fw_memset
+#define memcpy			fw_memcpy
+#define strcmp			fw_strcmp
+#define strstr			fw_strstr
+#define strcpy			fw_strcpy
+#define strlen			fw_strlen
+#define strchr			fw_strchr
+#define getc			fw_getc
+#define poll			fw_poll
+#define putc			fw_putc
+#define puts			fw_puts
+#define printf			fw_printf
+#define log			fw_log
+
+/* We define FreeRTOS include guards to get the subset of API that emulator
+ * provides instead of the kernel.
+ * */
+#define INC_FREERTOS_H
+#define INC_TASK_H
+#define QUEUE_H
+#define SEMAPHORE_H
+
+#define configTICK_RATE_HZ		1000
+#define configMINIMAL_STACK_SIZE	120
+#define configTOTAL_HEAP_SIZE		20000
+
+#define pdFALSE				((BaseType_t) 0)
+#define pdTRUE				((BaseType_t) 1)
+#define pdPASS				pdTRUE
+#define pdFAIL				pdFALSE
+
+#define portMAX_DELAY			((TickType_t) 0xFFFFFFFFU)
+
+#define taskDISABLE_INTERRUPTS()	do {} while (0)
+
+typedef uint32_t		TickType_t;
+typedef long			BaseType_t;
+typedef unsigned long		UBaseType_t;
+
+typedef void			(* TaskFunction_t) (void *);
+typedef void			*TaskHandle_t;
+
+typedef enum {
+
+	eRunning = 0,
+	eReady,
+	eBlocked,
+	eSuspended,
+	eDeleted,
+	eInvalid
+}
+eTaskState;
+
+typedef struct {
+
+	TaskHandle_t		xHandle;
+	const char		*pcTaskName;
+	UBaseType_t		xTaskNumber;
+	eTaskState		eCurrentState;
+	UBaseType_t		uxCurrentPriority;
+	UBaseType_t		uxBasePriority;
+	uint32_t		ulRunTimeCounter;
+	void			*pxStackBase;
+	uint16_t		usStackHighWaterMark;
+}
+TaskStatus_t;
+
+typedef struct {
+
+	size_t			xAvailableHeapSpaceInBytes;
+	size_t			xSizeOfLargestFreeBlockInBytes;
+	size_t			xSizeOfSmallestFreeBlockInBytes;
+	size_t			xNumberOfFreeBlocks;
+	size_t			xMinimumEverFreeBytesRemaining;
+	size_t			xNumberOfSuccessfulAllocations;
+	size_t			xNumberOfSuccessfulFrees;
+}
+HeapStats_t;
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char *pcName,
+		uint16_t usStackDepth, void *pvParameters,
+		UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask);
+
+void vTaskDelete(TaskHandle_t xTask);
+void vTaskDelay(TickType_t xTicksToDelay);
+void vTaskDelayUntil(TickType_t *pxPreviousWakeTime, TickType_t xTimeIncrement);
+TickType_t xTaskGetTickCount();
+TaskHandle_t xTaskGetHandle(const char *pcNameToQuery);
+void vTaskStartScheduler();
+
+UBaseType_t uxTaskGetNumberOfTasks();
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *pxTaskStatusArray,
+		UBaseType_t uxArraySize, uint32_t *pulTotalRunTime);
+
+void *pvPortMalloc(size_t xSize);
+void vPortFree(void *pv);
+void vPortGetHeapStats(HeapStats_t *pxHeapStats);
+
+#endif /* _H_EMU_FW_ */
+
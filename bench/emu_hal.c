@@ -0,0 +1,557 @@
+#include <stddef.h>
+
+#include "hal/hal.h"
+#include "libc.h"
+
+#include "emu.h"
+
+/* This is the emulated HAL and FreeRTOS subset that firmware modules are
+ * linked with. It is built with the firmware headers and talks to the host
+ * side through emu.h only.
+ * */
+
+#define HAL_FLAG_SIGNATURE	0x2A7CEA64U
+#define HAL_TEXT_INC(np)	(((np) < sizeof(log.text) - 1U) ? (np) + 1 : 0)
+
+/* Emulated firmware image is placed at the beginning of flash just like
+ * the real one. The configuration sectors are the same as on STM32F4.
+ * */
+#define EMU_FLASH_BEGIN		0x08000000U
+#define EMU_IMAGE_SIZE		0x00020000U
+
+#define EMU_ADC_TEMPINT		25.f
+#define EMU_ADC_NTC_PCB		0.5f
+
+const FW_info_t		fw = {
+
+	EMU_FLASH_BEGIN,
+	EMU_FLASH_BEGIN + EMU_IMAGE_SIZE,
+
+	_HW_REV, __DATE__
+};
+
+const FLASH_config_t	FLASH_config = {
+
+	.begin = 8,
+	.total = 4,
+
+	.map = {
+
+		0x08080000U,
+		0x080A0000U,
+		0x080C0000U,
+		0x080E0000U,
+		0x08100000U,
+		0x08100000U
+	}
+};
+
+uint32_t			clock_cpu_hz = 168000000U;
+
+HAL_t				hal;
+LOG_t				log;
+
+void ADC_const_build()
+{
+	float			U_reference, R_equivalent;
+
+	U_reference = hal.ADC_reference_voltage / (float) ADC_RESOLUTION;
+	R_equivalent = hal.ADC_shunt_resistance * hal.ADC_amplifier_gain;
+
+	hal.const_ADC.GA = U_reference / R_equivalent;
+	hal.const_ADC.GU = U_reference / hal.ADC_voltage_ratio;
+	hal.const_ADC.GT[1] = U_reference / hal.ADC_terminal_ratio;
+	hal.const_ADC.GT[0] = - hal.ADC_terminal_bias / hal.ADC_terminal_ratio;
+	hal.const_ADC.TS[1] = 1.f;
+	hal.const_ADC.TS[0] = 0.f;
+	hal.const_ADC.GS = 1.f / (float) ADC_RESOLUTION;
+
+	hal.const_CNT[0] = 1.f / (float) CLOCK_TIM1_HZ;
+	hal.const_CNT[1] = 1.f / (float) CLOCK_TIM7_HZ;
+
+	/* Plant quantizes the samples within the same range that firmware
+	 * is able to measure.
+	 * */
+	emu.range_A = hal.const_ADC.GA * (float) (ADC_RESOLUTION / 2);
+	emu.range_B = hal.const_ADC.GU * (float) ADC_RESOLUTION;
+}
+
+void ADC_startup()
+{
+	ADC_const_build();
+}
+
+float ADC_get_sample(int xGPIO)
+{
+	float			um = 0.f;
+
+	if (xGPIO == GPIO_ADC_TEMPINT) {
+
+		um = EMU_ADC_TEMPINT;
+	}
+#ifdef GPIO_ADC_NTC_PCB
+	else if (xGPIO == GPIO_ADC_NTC_PCB) {
+
+		um = EMU_ADC_NTC_PCB;
+	}
+#endif /* GPIO_ADC_NTC_PCB */
+
+	return um;
+}
+
+static void
+PWM_build()
+{
+	int		resolution;
+
+	resolution = (int) ((float) (CLOCK_TIM1_HZ / 2U) / hal.PWM_frequency + 0.5f);
+
+	hal.PWM_frequency = (float) (CLOCK_TIM1_HZ / 2U) / (float) resolution;
+	hal.PWM_resolution = resolution;
+
+	emu.pwm_freq = hal.PWM_frequency;
+	emu.pwm_deadtime = hal.PWM_deadtime;
+	emu.pwm_resolution = hal.PWM_resolution;
+
+	emu.pwm_enabled = 1;
+}
+
+void PWM_startup()
+{
+	PWM_build();
+}
+
+void PWM_configure()
+{
+	PWM_build();
+}
+
+void PWM_set_DC(int A, int B, int C)
+{
+	emu.pwm_A = A;
+	emu.pwm_B = B;
+	emu.pwm_C = C;
+}
+
+void PWM_set_Z(int Z)
+{
+	int		N = 0;
+
+	N += (Z & LEG_A) ? 1 : 0;
+	N += (Z & LEG_B) ? 1 : 0;
+	N += (Z & LEG_C) ? 1 : 0;
+
+	/* Plant is only able to detach all of phase legs at once. But with
+	 * two legs in Z there is no current path anyway.
+	 * */
+	emu.pwm_Z = (N >= 2) ? 1 : 0;
+}
+
+int PWM_fault()
+{
+	return HAL_OK;
+}
+
+void DPS_startup() { }
+void DPS_configure() { }
+
+int DPS_get_HALL()
+{
+	return emu.pulse_HS;
+}
+
+int DPS_get_EP()
+{
+	return emu.pulse_EP;
+}
+
+void PPM_startup() { }
+void PPM_configure() { }
+
+float PPM_get_PULSE() { return 0.f; }
+float PPM_get_PERIOD() { return 0.f; }
+
+void DAC_startup(int mode) { }
+void DAC_halt() { }
+void DAC_set_OUT1(int xOUT) { }
+void DAC_set_OUT2(int xOUT) { }
+
+void RNG_startup() { }
+
+uint32_t RNG_urand()
+{
+	static uint32_t		rseed = 1U;
+
+	rseed = rseed * 1664525U + 1013904223U;
+
+	return rseed;
+}
+
+uint32_t RNG_make_UID()
+{
+	return 0x454D5500U;
+}
+
+void SPI_startup(int bus, int freq_hz, int mode) { }
+void SPI_halt(int bus) { }
+
+uint16_t SPI_transfer(int bus, uint16_t txbuf)
+{
+	return 0xFFFFU;
+}
+
+void SPI_transfer_dma(int bus, const uint16_t *txbuf, uint16_t *rxbuf, int len)
+{
+	int		n;
+
+	for (n = 0; n < len; ++n) {
+
+		rxbuf[n] = 0xFFFFU;
+	}
+}
+
+void GPIO_set_mode_INPUT(int xGPIO) { }
+void GPIO_set_mode_OUTPUT(int xGPIO) { }
+void GPIO_set_mode_ANALOG(int xGPIO) { }
+void GPIO_set_mode_FUNCTION(int xGPIO) { }
+void GPIO_set_mode_PUSH_PULL(int xGPIO) { }
+void GPIO_set_mode_OPEN_DRAIN(int xGPIO) { }
+void GPIO_set_mode_SPEED_LOW(int xGPIO) { }
+void GPIO_set_mode_SPEED_HIGH(int xGPIO) { }
+void GPIO_set_mode_SPEED_FAST(int xGPIO) { }
+void GPIO_set_mode_PULL_NONE(int xGPIO) { }
+void GPIO_set_mode_PULL_UP(int xGPIO) { }
+void GPIO_set_mode_PULL_DOWN(int xGPIO) { }
+void GPIO_set_HIGH(int xGPIO) { }
+void GPIO_set_LOW(int xGPIO) { }
+
+int GPIO_get_STATE(int xGPIO)
+{
+	return 0;
+}
+
+void TIM_startup() { }
+void TIM_wait_ns(int ns) { }
+
+int TIM_get_CNT()
+{
+	return 0;
+}
+
+void WD_startup() { }
+void WD_kick() { }
+
+void USART_startup() { }
+
+int USART_getc()
+{
+	return emu_getc();
+}
+
+int USART_poll()
+{
+	return emu_poll();
+}
+
+void USART_putc(int c)
+{
+	emu_putc(c);
+}
+
+void *FLASH_erase(void *flash)
+{
+	uint32_t	*ld_flash;
+	int		N;
+
+	for (N = 0; N < FLASH_config.total; ++N) {
+
+		if (		(uint32_t) flash >= FLASH_config.map[N]
+				&& (uint32_t) flash < FLASH_config.map[N + 1]) {
+
+			flash = (void *) (uintptr_t) FLASH_config.map[N];
+
+			for (	ld_flash = (uint32_t *) flash;
+				(uint32_t) ld_flash < FLASH_config.map[N + 1];
+				++ld_flash) {
+
+				*ld_flash = 0xFFFFFFFFU;
+			}
+
+			break;
+		}
+	}
+
+	return flash;
+}
+
+void FLASH_prog(void *flash, uint32_t value)
+{
+	uint32_t			*ld_flash = (uint32_t *) flash;
+
+	if (		(uint32_t) ld_flash >= fw.ld_end
+			&& (uint32_t) ld_flash < FLASH_config.map[FLASH_config.total]) {
+
+		/* Programming is only able to clear the bits.
+		 * */
+		*ld_flash &= value;
+	}
+}
+
+int hal_lock_irq()
+{
+	emu_irq_lock();
+
+	return 0;
+}
+
+void hal_unlock_irq(int irq)
+{
+	emu_irq_unlock();
+}
+
+void hal_system_reset()
+{
+	emu_reset();
+}
+
+void hal_bootload_jump()
+{
+	emu_reset();
+}
+
+void hal_cpu_sleep() { }
+
+void hal_memory_fence()
+{
+	__sync_synchronize();
+}
+
+int log_status()
+{
+	return (	log.boot_FLAG == HAL_FLAG_SIGNATURE
+			&& log.text_wp != log.text_rp) ? HAL_FAULT : HAL_OK;
+}
+
+void log_bootup()
+{
+	if (log.boot_FLAG != HAL_FLAG_SIGNATURE) {
+
+		log.boot_FLAG = HAL_FLAG_SIGNATURE;
+		log.boot_COUNT = 0U;
+
+		log.text_wp = 0;
+		log.text_rp = 0;
+	}
+	else {
+		log.boot_COUNT += 1U;
+	}
+}
+
+void log_putc(int c)
+{
+	if (unlikely(log.boot_FLAG != HAL_FLAG_SIGNATURE)) {
+
+		log.boot_FLAG = HAL_FLAG_SIGNATURE;
+
+		log.text_wp = 0;
+		log.text_rp = 0;
+	}
+
+	log.text[log.text_wp] = (char) c;
+
+	log.text_wp = HAL_TEXT_INC(log.text_wp);
+	log.text_rp = (log.text_rp == log.text_wp)
+		? HAL_TEXT_INC(log.text_rp) : log.text_rp;
+}
+
+void log_flush()
+{
+	int		rp, wp;
+
+	if (log.boot_FLAG == HAL_FLAG_SIGNATURE) {
+
+		rp = log.text_rp;
+		wp = log.text_wp;
+
+		while (rp != wp) {
+
+			putc(log.text[rp]);
+
+			rp = HAL_TEXT_INC(rp);
+		}
+
+		puts(EOL);
+	}
+}
+
+void log_clean()
+{
+	if (unlikely(log.boot_FLAG != HAL_FLAG_SIGNATURE)) {
+
+		log.boot_FLAG = HAL_FLAG_SIGNATURE;
+	}
+
+	log.text_wp = 0;
+	log.text_rp = 0;
+}
+
+void DBGMCU_mode_stop() { }
+
+static TaskHandle_t
+emu_handle(int id)
+{
+	return (id >= 0) ? (TaskHandle_t) (uintptr_t) (id + 1) : NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char *pcName,
+		uint16_t usStackDepth, void *pvParameters,
+		UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask)
+{
+	int		id;
+
+	id = emu_task_create(pxTaskCode, pcName, pvParameters);
+
+	if (pxCreatedTask != NULL) {
+
+		*pxCreatedTask = emu_handle(id);
+	}
+
+	return (id >= 0) ? pdPASS : pdFAIL;
+}
+
+void vTaskDelete(TaskHandle_t xTask)
+{
+	/* We only support the task to delete itself.
+	 * */
+	if (xTask == NULL) {
+
+		emu_task_exit();
+	}
+}
+
+void vTaskDelay(TickType_t xTicksToDelay)
+{
+	emu_tick_wait(emu_tick() + xTicksToDelay);
+}
+
+void vTaskDelayUntil(TickType_t *pxPreviousWakeTime, TickType_t xTimeIncrement)
+{
+	*pxPreviousWakeTime += xTimeIncrement;
+
+	emu_tick_wait(*pxPreviousWakeTime);
+}
+
+TickType_t xTaskGetTickCount()
+{
+	return (TickType_t) emu_tick();
+}
+
+TaskHandle_t xTaskGetHandle(const char *pcNameToQuery)
+{
+	return emu_handle(emu_task_lookup(pcNameToQuery));
+}
+
+void vTaskStartScheduler()
+{
+	/* The calling thread is not a task so we just leave it.
+	 * */
+}
+
+UBaseType_t uxTaskGetNumberOfTasks()
+{
+	const char		*name;
+	int			N, len = 0;
+
+	for (N = 0; (name = emu_task_name(N)) != NULL; ++N) {
+
+		if (*name != 0)
+			len++;
+	}
+
+	return len;
+}
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *pxTaskStatusArray,
+		UBaseType_t uxArraySize, uint32_t *pulTotalRunTime)
+{
+	TaskStatus_t		*ts;
+	const char		*name;
+	int			N, len = 0;
+
+	for (N = 0; len < uxArraySize; ++N) {
+
+		name = emu_task_name(N);
+
+		if (name == NULL)
+			break;
+
+		if (*name == 0)
+			continue;
+
+		ts = pxTaskStatusArray + len++;
+
+		ts->xHandle = emu_handle(N);
+		ts->pcTaskName = name;
+		ts->xTaskNumber = N + 1;
+		ts->eCurrentState = eBlocked;
+		ts->uxCurrentPriority = 0;
+		ts->uxBasePriority = 0;
+		ts->ulRunTimeCounter = 0;
+		ts->pxStackBase = NULL;
+		ts->usStackHighWaterMark = 0;
+	}
+
+	if (pulTotalRunTime != NULL) {
+
+		*pulTotalRunTime = 0;
+	}
+
+	return len;
+}
+
+void *pvPortMalloc(size_t xSize)
+{
+	return emu_malloc((int) xSize);
+}
+
+void vPortFree(void *pv)
+{
+	emu_free(pv);
+}
+
+void vPortGetHeapStats(HeapStats_t *pxHeapStats)
+{
+	pxHeapStats->xAvailableHeapSpaceInBytes = configTOTAL_HEAP_SIZE;
+	pxHeapStats->xSizeOfLargestFreeBlockInBytes = configTOTAL_HEAP_SIZE;
+	pxHeapStats->xSizeOfSmallestFreeBlockInBytes = configTOTAL_HEAP_SIZE;
+	pxHeapStats->xNumberOfFreeBlocks = 1;
+	pxHeapStats->xMinimumEverFreeBytesRemaining = configTOTAL_HEAP_SIZE;
+	pxHeapStats->xNumberOfSuccessfulAllocations = 0;
+	pxHeapStats->xNumberOfSuccessfulFrees = 0;
+}
+
+void emu_irq()
+{
+	hal.ADC_current_A = emu.analog_iA;
+	hal.ADC_current_B = emu.analog_iB;
+	hal.ADC_current_C = emu.analog_iC;
+	hal.ADC_voltage_U = emu.analog_uS;
+	hal.ADC_voltage_A = emu.analog_uA;
+	hal.ADC_voltage_B = emu.analog_uB;
+	hal.ADC_voltage_C = emu.analog_uC;
+
+	ADC_IRQ();
+}
+
+void emu_main()
+{
+	uint32_t	*ld_crc32 = (uint32_t *) (uintptr_t) fw.ld_end;
+
+	/* We write CRC32 of the emulated image as bootloader does.
+	 * */
+	*ld_crc32 = crc32b((const void *) (uintptr_t) fw.ld_begin,
+			fw.ld_end - fw.ld_begin);
+
+	app_MAIN();
+}
+
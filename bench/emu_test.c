@@ -0,0 +1,650 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+
+#include <unistd.h>
+#include <sys/select.h>
+
+#include "emu.h"
+
+/* Loopback test talks to the shell over the same pty as the host does.
+ * We grab telemetry and check that binary flush is decoded into exactly
+ * the same rows as text flush gives.
+ * */
+
+#define TEST_RX_MAX		1024
+#define TEST_ROW_MAX		4000
+#define TEST_INPUT_MAX		10
+#define TEST_FRAME_MAX		160
+
+#define TEST_TIMEOUT		20.
+
+typedef struct {
+
+	int		fd;
+
+	char		rx[TEST_RX_MAX];
+	int		rx_N;
+
+	char		line[TEST_RX_MAX];
+
+	int		layout_N;
+	int		precision;
+	double		dT;
+
+	char		fmt[TEST_INPUT_MAX][2];
+
+	int		clock;
+	int		lost;
+	int		overflow;
+
+	double		text[TEST_ROW_MAX][TEST_INPUT_MAX + 1];
+	int		text_N;
+
+	double		bin[TEST_ROW_MAX][TEST_INPUT_MAX + 1];
+	int		bin_N;
+
+	int		feature;
+	int		tlm_mode;
+}
+test_t;
+
+static test_t		t;
+
+static double
+test_clock()
+{
+	struct timespec		ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (double) ts.tv_sec + (double) ts.tv_nsec * 1.E-9;
+}
+
+static void
+test_write(const char *cmd)
+{
+	int		len, rc;
+
+	len = strlen(cmd);
+
+	while (len > 0) {
+
+		rc = write(t.fd, cmd, len);
+
+		if (rc < 0) {
+
+			if (errno == EINTR)
+				continue;
+
+			fprintf(stderr, "write: %s\n", strerror(errno));
+			exit(-1);
+		}
+
+		cmd += rc;
+		len -= rc;
+	}
+}
+
+/* Get the next line into t.line. Returns 1 on line, 0 on the shell
+ * prompt and -1 on timeout.
+ * */
+static int
+test_getline(double timeout)
+{
+	struct timeval		tv = { 0, 100000L };
+	fd_set			set;
+	char			*eol;
+	int			len;
+
+	timeout += test_clock();
+
+	do {
+		t.rx[t.rx_N] = 0;
+
+		eol = strchr(t.rx, '\n');
+
+		if (eol != NULL) {
+
+			len = (int) (eol - t.rx);
+
+			memcpy(t.line, t.rx, len);
+
+			t.line[len] = 0;
+
+			if (len > 0 && t.line[len - 1] == '\r')
+				t.line[len - 1] = 0;
+
+			t.rx_N -= len + 1;
+
+			memmove(t.rx, eol + 1, t.rx_N);
+
+			return 1;
+		}
+
+		if (strcmp(t.rx, "(pmc) ") == 0) {
+
+			t.rx_N = 0;
+
+			return 0;
+		}
+
+		if (t.rx_N >= TEST_RX_MAX - 1) {
+
+			fprintf(stderr, "emu: test line is too long\n");
+			exit(-1);
+		}
+
+		FD_ZERO(&set);
+		FD_SET(t.fd, &set);
+
+		tv.tv_sec = 0;
+		tv.tv_usec = 100000L;
+
+		if (select(t.fd + 1, &set, NULL, NULL, &tv) > 0) {
+
+			len = read(t.fd, t.rx + t.rx_N, TEST_RX_MAX - 1 - t.rx_N);
+
+			if (len < 0 && errno != EINTR) {
+
+				fprintf(stderr, "read: %s\n", strerror(errno));
+				exit(-1);
+			}
+
+			t.rx_N += (len > 0) ? len : 0;
+		}
+	}
+	while (test_clock() < timeout);
+
+	return -1;
+}
+
+static int
+test_command(const char *cmd, void (* proc) ())
+{
+	char		lbuf[80];
+	int		rc, echo = 0;
+
+	sprintf(lbuf, "%.70s\r\n", cmd);
+
+	test_write(lbuf);
+
+	do {
+		rc = test_getline(TEST_TIMEOUT);
+
+		if (rc == 1) {
+
+			if (echo == 0) {
+
+				/* Shell echoes the command first.
+				 * */
+				echo = 1;
+			}
+			else if (proc != NULL) {
+
+				proc();
+			}
+		}
+	}
+	while (rc == 1);
+
+	if (rc < 0) {
+
+		fprintf(stderr, "emu: test \"%s\" timed out\n", cmd);
+	}
+
+	return rc;
+}
+
+static void
+test_version()
+{
+	const char	*s = t.line;
+
+	if (strstr(s, "Feature ") == s) {
+
+		t.feature = (		   strstr(s, " tlm_flush_bin") != NULL
+				&& strstr(s, " tlm_stream_sync") != NULL
+				&& strstr(s, " reg_list") != NULL
+				&& strstr(s, " reg_set") != NULL) ? 1 : 0;
+	}
+}
+
+static void
+test_mode()
+{
+	t.tlm_mode = (strstr(t.line, "TLM_MODE_DISABLED") != NULL) ? 0 : 1;
+}
+
+static void
+test_text()
+{
+	char		*s = t.line, *eol;
+	double		*row;
+	int		N;
+
+	if (		strstr(s, "time@") == s
+			|| t.text_N >= TEST_ROW_MAX)
+		return ;
+
+	row = t.text[t.text_N++];
+
+	for (N = 0; N < TEST_INPUT_MAX + 1 && *s != 0; ++N) {
+
+		if (N > 0 && t.fmt[N - 1][1] == 'x') {
+
+			row[N] = (double) (int32_t) strtoul(s, &eol, 16);
+		}
+		else {
+			row[N] = strtod(s, &eol);
+		}
+
+		s = (*eol == ';') ? eol + 1 : eol;
+	}
+}
+
+static void
+test_header()
+{
+	char		*s = t.line + 3;
+	double		freq;
+	int		N, length, rate;
+
+	t.layout_N = 0;
+
+	N = strtol(s, &s, 10);
+	length = strtol(s, &s, 10);
+	t.precision = strtol(s, &s, 10);
+	rate = strtol(s, &s, 10);
+	freq = strtod(s, &s);
+
+	if (N < 1 || N > TEST_INPUT_MAX || length < 0)
+		return ;
+
+	for (t.layout_N = 0; t.layout_N < N; ++t.layout_N) {
+
+		while (*s == ' ') { ++s; }
+
+		if (s[0] == 0 || s[1] == 0)
+			break;
+
+		t.fmt[t.layout_N][0] = *s++;
+		t.fmt[t.layout_N][1] = *s++;
+	}
+
+	if (t.layout_N != N) {
+
+		t.layout_N = 0;
+		return ;
+	}
+
+	t.dT = (freq > 0.) ? (double) rate / freq : 1.;
+	t.clock = 0;
+}
+
+static uint32_t
+test_crc32b(const uint8_t *data, int len)
+{
+	uint32_t		crc = 0xFFFFFFFFU;
+	int			N;
+
+	while (len > 0) {
+
+		crc ^= *data++;
+
+		for (N = 0; N < 8; ++N) {
+
+			crc = (crc >> 1) ^ (0xEDB88320U & - (crc & 1U));
+		}
+
+		len--;
+	}
+
+	return crc ^ 0xFFFFFFFFU;
+}
+
+static int
+test_base64_decode(uint8_t *data, const char *s, int n)
+{
+	const char	*set = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+			       "abcdefghijklmnopqrstuvwxyz0123456789+/";
+	const char	*c;
+	uint32_t	x = 0U;
+	int		len = 0, bits = 0;
+
+	while (*s != 0 && *s != '=') {
+
+		c = strchr(set, *s++);
+
+		if (c == NULL || *c == 0)
+			return -1;
+
+		x = (x << 6) | (uint32_t) (c - set);
+		bits += 6;
+
+		if (bits >= 8) {
+
+			bits -= 8;
+
+			if (len >= n)
+				return -1;
+
+			data[len++] = (uint8_t) (x >> bits);
+		}
+	}
+
+	return len;
+}
+
+static void
+test_frame()
+{
+	uint8_t		frame[TEST_FRAME_MAX];
+	const uint8_t	*code, *data;
+	uint32_t	crc, x, lprev[TEST_INPUT_MAX];
+	double		*row;
+	int		len, clock, rows, delta, N, n, k;
+
+	union {
+
+		float		f;
+		int32_t		i;
+	}
+	rval;
+
+	len = test_base64_decode(frame, t.line + 1, sizeof(frame));
+
+	if (t.layout_N == 0 || len < 8 || (len & 3) != 0) {
+
+		fprintf(stderr, "emu: test frame is malformed\n");
+		return ;
+	}
+
+	len -= 4;
+
+	crc = (uint32_t) frame[len] | (uint32_t) frame[len + 1] << 8
+		| (uint32_t) frame[len + 2] << 16 | (uint32_t) frame[len + 3] << 24;
+
+	if (test_crc32b(frame, len) != crc) {
+
+		fprintf(stderr, "emu: test frame CRC does not match\n");
+		return ;
+	}
+
+	clock = (int) frame[0] | (int) frame[1] << 8;
+	rows = frame[2];
+	delta = frame[3];
+
+	/* Stream drops the lines on overflow so we count the gap.
+	 * */
+	clock = (clock - t.clock) & 0xFFFF;
+
+	t.lost += clock;
+	t.clock += clock;
+
+	memset(lprev, 0, sizeof(lprev));
+
+	data = frame + 4;
+
+	while (rows > 0) {
+
+		code = data;
+		data += (t.layout_N + 3) / 4;
+
+		if (data > frame + len)
+			break;
+
+		row = t.bin[t.bin_N % TEST_ROW_MAX];
+
+		t.bin_N++;
+
+		row[0] = (double) t.clock * t.dT;
+
+		for (N = 0; N < t.layout_N; ++N) {
+
+			n = (code[N / 4] >> ((N & 3) * 2)) & 3;
+			n = (n == 3) ? 4 : n;
+
+			x = 0U;
+
+			for (k = 0; k < n && data < frame + len; ++k) {
+
+				x |= (uint32_t) *data++ << (k * 8);
+			}
+
+			x = (delta != 0) ? x ^ lprev[N] : x;
+
+			lprev[N] = x;
+
+			memcpy(&rval, &x, sizeof(x));
+
+			row[N + 1] = (t.fmt[N][1] == 'i' || t.fmt[N][1] == 'x')
+				? (double) rval.i : (double) rval.f;
+		}
+
+		t.clock += 1;
+		rows--;
+	}
+}
+
+static void
+test_binary()
+{
+	if (strstr(t.line, "$H ") == t.line) {
+
+		test_header();
+	}
+	else if (strstr(t.line, "$O ") == t.line) {
+
+		t.overflow = strtol(t.line + 3, NULL, 10);
+	}
+	else if (t.line[0] == '$') {
+
+		test_frame();
+	}
+}
+
+/* Text has only a few digits so we allow the difference in the last one.
+ * */
+static int
+test_match(double text, double bin, int fmt, int k)
+{
+	double		tol;
+
+	switch (fmt) {
+
+		case 'i':
+		case 'x':
+			tol = 0.;
+			break;
+
+		case 'e':
+			tol = fabs(bin) * pow(10., - k);
+			break;
+
+		case 'g':
+			tol = fabs(bin) * pow(10., 1 - k);
+			break;
+
+		default:
+			tol = pow(10., - k);
+			break;
+	}
+
+	return (fabs(text - bin) <= tol * 1.01 + 1.E-30) ? 1 : 0;
+}
+
+static int
+test_compare(const char *name)
+{
+	int		rN, N, bad = 0;
+
+	if (t.bin_N != t.text_N || t.bin_N == 0 || t.lost != 0) {
+
+		fprintf(stderr, "emu: test %s has %i rows (%i lost) but text %i\n",
+				name, t.bin_N, t.lost, t.text_N);
+		return 1;
+	}
+
+	for (rN = 0; rN < t.text_N; ++rN) {
+
+		if (test_match(t.text[rN][0], t.bin[rN][0], 'f', t.precision) == 0) {
+
+			bad++;
+		}
+
+		for (N = 0; N < t.layout_N; ++N) {
+
+			if (test_match(t.text[rN][N + 1], t.bin[rN][N + 1],
+					t.fmt[N][1], t.fmt[N][0] - '0') == 0) {
+
+				if (bad < 10) {
+
+					fprintf(stderr, "emu: test %s row %i column %i"
+							" %.7g != %.7g\n", name, rN, N + 1,
+							t.bin[rN][N + 1], t.text[rN][N + 1]);
+				}
+
+				bad++;
+			}
+		}
+	}
+
+	return (bad != 0) ? 1 : 0;
+}
+
+static int
+test_stream()
+{
+	double		timeout;
+	int		rc;
+
+	t.bin_N = 0;
+	t.lost = 0;
+	t.overflow = 0;
+
+	test_write("tlm_stream_sync\r\n");
+
+	timeout = test_clock() + 1.;
+
+	do {
+		rc = test_getline(TEST_TIMEOUT);
+
+		if (rc == 1) {
+
+			test_binary();
+		}
+
+		if (test_clock() > timeout) {
+
+			/* Any key but LF stops the stream.
+			 * */
+			test_write("\r");
+
+			timeout += TEST_TIMEOUT;
+		}
+	}
+	while (rc == 1);
+
+	if (rc < 0) {
+
+		fprintf(stderr, "emu: test \"tlm_stream_sync\" timed out\n");
+		return 1;
+	}
+
+	/* Lines dropped by PMC are the gaps in the line numbers. The lines
+	 * dropped after the last frame are counted in overflow but no gap
+	 * shows them.
+	 * */
+	if (t.bin_N == 0 || t.lost > t.overflow) {
+
+		fprintf(stderr, "emu: test tlm_stream_sync has %i rows, %i lost"
+				" and %i overflow\n", t.bin_N, t.lost, t.overflow);
+		return 1;
+	}
+
+	printf("emu: test stream %i rows (%i overflow)\n", t.bin_N, t.overflow);
+
+	return 0;
+}
+
+int emu_test(int fd)
+{
+	double		timeout;
+	int		rc = 0;
+
+	t.fd = fd;
+
+	timeout = test_clock() + TEST_TIMEOUT;
+
+	/* Wait for the shell to boot.
+	 * */
+	do {
+		test_write("\r\n");
+
+		if (test_clock() > timeout) {
+
+			fprintf(stderr, "emu: test shell does not respond\n");
+			return 1;
+		}
+	}
+	while (test_getline(1.) != 0);
+
+	while (test_getline(.5) >= 0) ;
+
+	if (test_command("ap_version", &test_version) != 0)
+		return 1;
+
+	if (t.feature == 0) {
+
+		fprintf(stderr, "emu: test ap_version lacks a feature\n");
+		rc = 1;
+	}
+
+	if (test_command("tlm_grab", NULL) != 0)
+		return 1;
+
+	do {
+		if (test_command("reg tlm.mode", &test_mode) != 0)
+			return 1;
+
+		if (test_clock() > timeout) {
+
+			fprintf(stderr, "emu: test tlm_grab is not finished\n");
+			return 1;
+		}
+
+		usleep(100000);
+	}
+	while (t.tlm_mode != 0);
+
+	/* We need the layout before the text is parsed.
+	 * */
+	if (test_command("tlm_flush_bin", &test_binary) != 0)
+		return 1;
+
+	t.text_N = 0;
+
+	if (test_command("tlm_flush_sync", &test_text) != 0)
+		return 1;
+
+	rc |= test_compare("tlm_flush_bin");
+
+	t.bin_N = 0;
+
+	if (test_command("tlm_flush_bin 0", &test_binary) != 0)
+		return 1;
+
+	rc |= test_compare("tlm_flush_bin 0");
+
+	rc |= test_stream();
+
+	printf("emu: test %s (%i rows of %i columns)\n", (rc == 0) ? "OK" : "FAILED",
+			t.text_N, t.layout_N + 1);
+
+	return rc;
+}
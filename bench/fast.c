@@ -0,0 +1,422 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+#include "blm.h"
+#include "blmf.h"
+#include "fast.h"
+#include "lfg.h"
+#include "mc.h"
+#include "pm.h"
+#include "tsfunc.h"
+
+typedef struct {
+
+	blmf_t		*plant;
+
+	/* The controller is fed from fast plant instead of reference.
+	 * */
+	int		closed;
+
+	double		sync;
+	double		time_sync;
+
+	fast_error_t	err[FAST_MAX];
+
+	int		fault;
+	double		setpoint;
+	double		err_wS;
+
+	long		cycles;
+	double		wall_blm;
+
+	long		cycles_fast;
+	double		wall_blmf;
+
+	FILE		*fd;
+	double		time_log;
+}
+fast_t;
+
+static void
+fast_sync(fast_t *c)
+{
+	blmf_t		*mf = c->plant;
+	int		i;
+
+	/* Copy the reference state into the fast plant.
+	 * */
+	for (i = 0; i < 15; ++i) {
+
+		mf->state[i] = (float) m.state[i];
+	}
+
+	for (i = 0; i < 6; ++i) {
+
+		mf->xfet[i] = m.xfet[i];
+	}
+
+	mf->xdtu[0] = m.xdtu[0];
+	mf->xdtu[1] = m.xdtu[1];
+	mf->xdtu[2] = m.xdtu[2];
+
+	mf->revol = m.revol;
+	mf->time = m.time;
+
+	c->time_sync = m.time + c->sync;
+}
+
+static void
+fast_error(fast_t *c, int n, double e)
+{
+	e = fabs(e);
+
+	c->err[n].samples += 1;
+	c->err[n].sum += e * e;
+	c->err[n].max = (e > c->err[n].max) ? e : c->err[n].max;
+}
+
+static void
+fast_compare(fast_t *c)
+{
+	const blmf_t	*mf = c->plant;
+
+	double		eF;
+
+	eF = (double) mf->state[3] - m.state[3];
+	eF += (eF < - M_PI) ? 2. * M_PI : (eF > M_PI) ? - 2. * M_PI : 0.;
+
+	fast_error(c, FAST_iD, (double) mf->state[0] - m.state[0]);
+	fast_error(c, FAST_iQ, (double) mf->state[1] - m.state[1]);
+	fast_error(c, FAST_wS, (double) mf->state[2] - m.state[2]);
+	fast_error(c, FAST_THETA, eF);
+	fast_error(c, FAST_TEMP, (double) mf->state[4] - m.state[4]);
+	fast_error(c, FAST_UDC, (double) mf->state[6] - m.state[6]);
+	fast_error(c, FAST_SENS_iA, (double) mf->state[7] - m.state[7]);
+	fast_error(c, FAST_SENS_uA, (double) mf->state[12] - m.state[12]);
+
+	if (c->fd != NULL && m.time >= c->time_log) {
+
+		fprintf(c->fd, "%.6f %.4f %.4f %.4f %.4f %.3f %.3f %.5f %.5f %.3f %.3f\n",
+				m.time, m.state[0], (double) mf->state[0],
+				m.state[1], (double) mf->state[1],
+				m.state[2], (double) mf->state[2],
+				m.state[3], (double) mf->state[3],
+				m.state[6], (double) mf->state[6]);
+
+		c->time_log = m.time + FAST_LOG_DT;
+	}
+}
+
+static void
+fast_runtime(fast_t *c, double dT)
+{
+	blmf_t		*mf = c->plant;
+	pmfb_t		fb;
+
+	double		stop, clock[3];
+
+	stop = ((c->closed != 0) ? mf->time : m.time) + dT;
+
+	while (((c->closed != 0) ? mf->time : m.time) < stop) {
+
+		mf->pwm_A = m.pwm_A;
+		mf->pwm_B = m.pwm_B;
+		mf->pwm_C = m.pwm_C;
+		mf->pwm_Z = m.pwm_Z;
+
+		clock[0] = sim_clock();
+
+		if (c->closed == 0) {
+
+			/* Reference plant drives the controller.
+			 * */
+			blm_update(&m);
+		}
+
+		clock[1] = sim_clock();
+
+		blmf_update(mf);
+
+		clock[2] = sim_clock();
+
+		if (c->closed == 0) {
+
+			fb.current_A = m.analog_iA;
+			fb.current_B = m.analog_iB;
+			fb.current_C = m.analog_iC;
+			fb.voltage_U = m.analog_uS;
+			fb.voltage_A = m.analog_uA;
+			fb.voltage_B = m.analog_uB;
+			fb.voltage_C = m.analog_uC;
+
+			fb.analog_SIN = m.analog_SIN;
+			fb.analog_COS = m.analog_COS;
+
+			fb.pulse_HS = m.pulse_HS;
+			fb.pulse_EP = m.pulse_EP;
+
+			c->cycles += 1;
+			c->wall_blm += clock[1] - clock[0];
+
+			fast_compare(c);
+
+			if (m.time >= c->time_sync) {
+
+				fast_sync(c);
+			}
+		}
+		else {
+			fb.current_A = mf->analog_iA;
+			fb.current_B = mf->analog_iB;
+			fb.current_C = mf->analog_iC;
+			fb.voltage_U = mf->analog_uS;
+			fb.voltage_A = mf->analog_uA;
+			fb.voltage_B = mf->analog_uB;
+			fb.voltage_C = mf->analog_uC;
+
+			fb.analog_SIN = mf->analog_SIN;
+			fb.analog_COS = mf->analog_COS;
+
+			fb.pulse_HS = mf->pulse_HS;
+			fb.pulse_EP = mf->pulse_EP;
+		}
+
+		c->cycles_fast += 1;
+		c->wall_blmf += clock[2] - clock[1];
+
+		pm_feedback(&pm, &fb);
+
+		if (pm.fsm_errno != PM_OK) {
+
+			fprintf(stderr, "fsm_errno: %s\n", pm_strerror(pm.fsm_errno));
+
+			c->fault = 1;
+			break;
+		}
+	}
+}
+
+static void
+fast_request(fast_t *c, int req, double timeout)
+{
+	double		stop;
+
+	pm.fsm_req = req;
+
+	stop = ((c->closed != 0) ? c->plant->time : m.time) + timeout;
+
+	do {
+		fast_runtime(c, 10.E-3);
+	}
+	while (		c->fault == 0
+			&& pm.fsm_state != PM_STATE_IDLE
+			&& ((c->closed != 0) ? c->plant->time : m.time) < stop);
+}
+
+static void
+fast_speed_check(fast_t *c)
+{
+	double		err;
+
+	/* We check the speed of fast plant in both modes.
+	 * */
+	err = fabs((double) c->plant->state[2] - c->setpoint);
+
+	c->err_wS = (err > c->err_wS) ? err : c->err_wS;
+}
+
+static void
+fast_load_torque(fast_t *c, double kQ)
+{
+	m.Mq[0] = - 1.5 * m.Zp * m.lambda * kQ;
+
+	c->plant->Mq[0] = (float) m.Mq[0];
+}
+
+static void
+fast_drive(fast_t *c, double wS_high, double wS_low)
+{
+	fast_request(c, PM_STATE_LU_STARTUP, 1.);
+
+	c->setpoint = wS_high;
+	pm.s_setpoint_speed = (float) wS_high;
+
+	fast_runtime(c, 1.);
+	fast_speed_check(c);
+
+	fast_load_torque(c, 20.);
+	fast_runtime(c, 0.5);
+
+	fast_load_torque(c, 0.);
+	fast_runtime(c, 0.5);
+	fast_speed_check(c);
+
+	c->setpoint = wS_low;
+	pm.s_setpoint_speed = (float) wS_low;
+
+	fast_runtime(c, 1.);
+	fast_speed_check(c);
+
+	fast_request(c, PM_STATE_LU_SHUTDOWN, 1.);
+}
+
+static void
+fast_report(const fast_t *c, const char *label, double wall)
+{
+	const char	*name[FAST_MAX] = { "iD", "iQ", "wS", "theta",
+					"temp", "uDC", "sens_iA", "sens_uA" };
+
+	const char	*unit[FAST_MAX] = { "A", "A", "rad/s", "rad",
+					"C", "V", "A", "V" };
+
+	double		ns_blm, ns_blmf;
+	int		n;
+
+	printf("\n---- %s ----\n", label);
+
+	if (c->closed == 0) {
+
+		for (n = 0; n < FAST_MAX; ++n) {
+
+			printf("%s = %.4E (%s) rms %.4E max\n", name[n],
+					(c->err[n].samples > 0) ? sqrt(c->err[n].sum
+					/ c->err[n].samples) : 0., unit[n], c->err[n].max);
+		}
+	}
+
+	printf("err_wS = %.2f (rad/s) max %s\n", c->err_wS,
+			(c->fault != 0) ? "FAULT" : (c->err_wS < FAST_SPEED_TOL)
+			? "OK" : "SPEED");
+
+	ns_blm = (c->cycles > 0) ? c->wall_blm * 1.E+9 / c->cycles : 0.;
+	ns_blmf = (c->cycles_fast > 0) ? c->wall_blmf * 1.E+9 / c->cycles_fast : 0.;
+
+	if (c->closed == 0) {
+
+		printf("ns_blm = %.1f (ns) per cycle\n", ns_blm);
+	}
+
+	printf("ns_blmf = %.1f (ns) per cycle %.1fx real time\n", ns_blmf,
+			(ns_blmf > 0.) ? c->plant->pwm_dT * 1.E+9 / ns_blmf : 0.);
+
+	if (c->closed == 0 && ns_blmf > 0.) {
+
+		printf("speedup = %.1fx\n", ns_blm / ns_blmf);
+	}
+
+	printf("steps = %li\n", c->plant->sol_stat.steps);
+	printf("wall = %.3f (s)\n", wall);
+}
+
+int fast_script(int dt_skip, double sync, int seed)
+{
+	fast_t		c;
+	sim_perf_t	perf;
+
+	double		wall, wS_high, wS_low;
+
+	memset(&c, 0, sizeof(c));
+	memset(&perf, 0, sizeof(perf));
+
+	/* Telemetry would measure the disk instead of us.
+	 * */
+	tlm_setup(NULL, NULL);
+
+	ts_log = fopen("/dev/null", "w");
+
+	if (ts_log == NULL) {
+
+		fprintf(stderr, "fopen: %s\n", strerror(errno));
+		return -1;
+	}
+
+	fprintf(stderr, "  FAST	nominal\n");
+
+	if (sim_protect(&mc_nominal, (void *) &perf) != 0) {
+
+		fclose(ts_log);
+		ts_log = stdout;
+
+		return -1;
+	}
+
+	fclose(ts_log);
+	ts_log = stdout;
+
+	c.plant = calloc(1, sizeof(blmf_t));
+
+	if (c.plant == NULL) {
+
+		fprintf(stderr, "calloc: %s\n", strerror(errno));
+		return -1;
+	}
+
+	c.plant->dt_skip = dt_skip;
+	c.sync = (sync > 0.) ? sync : FAST_SYNC_DEFAULT;
+
+	lfg_start(&m.lfg, seed);
+
+	blmf_enable(c.plant, &m);
+	blmf_seed(c.plant, seed);
+	blmf_restart(c.plant);
+
+	fast_sync(&c);
+
+	c.fd = fopen(FAST_FILE, "w");
+
+	if (c.fd == NULL) {
+
+		fprintf(stderr, "fopen: %s\n", strerror(errno));
+	}
+	else {
+		fprintf(c.fd, "# time iD iD_f iQ iQ_f wS wS_f theta theta_f uDC uDC_f\n");
+	}
+
+	wS_high = 50.f * pm.k_EMAX / 100.f * pm.const_fb_U / pm.const_lambda;
+	wS_low = 10.f * pm.k_EMAX / 100.f * pm.const_fb_U / pm.const_lambda;
+
+	fprintf(stderr, "  FAST	shadow sync %.1f (ms) deadtime %s\n",
+			c.sync * 1.E+3, (dt_skip != 0) ? "skip" : "full");
+
+	/* Reference plant closes the loop and fast plant is shadowed with
+	 * the same PWM and resynchronized periodically.
+	 * */
+	wall = sim_clock();
+
+	fast_drive(&c, wS_high, wS_low);
+
+	fast_report(&c, "Shadow", sim_clock() - wall);
+
+	if (c.fd != NULL) {
+
+		fclose(c.fd);
+		c.fd = NULL;
+	}
+
+	fprintf(stderr, "  FAST	closed loop\n");
+
+	/* Now fast plant closes the loop as it does in HIL.
+	 * */
+	fast_sync(&c);
+
+	c.closed = 1;
+	c.fault = 0;
+	c.err_wS = 0.;
+	c.cycles_fast = 0;
+	c.wall_blmf = 0.;
+	c.plant->sol_stat.steps = 0;
+
+	wall = sim_clock();
+
+	fast_drive(&c, wS_high, wS_low);
+
+	fast_report(&c, "Closed loop", sim_clock() - wall);
+
+	free(c.plant);
+
+	return (c.fault != 0 || c.err_wS > FAST_SPEED_TOL) ? -1 : 0;
+}
+
@@ -0,0 +1,42 @@
+#ifndef _H_FAST_
+#define _H_FAST_
+
+#define FAST_FILE		"/tmp/pm-fast.txt"
+
+/* Interval to copy the reference state into the fast plant (Second).
+ * */
+#define FAST_SYNC_DEFAULT	10.E-3
+
+/* Interval of trajectory output into the file (Second).
+ * */
+#define FAST_LOG_DT		1.E-3
+
+/* Allowed speed error at the end of hold on fast plant (Radian/Sec).
+ * */
+#define FAST_SPEED_TOL		50.
+
+enum {
+	FAST_iD			= 0,
+	FAST_iQ,
+	FAST_wS,
+	FAST_THETA,
+	FAST_TEMP,
+	FAST_UDC,
+	FAST_SENS_iA,
+	FAST_SENS_uA,
+	FAST_MAX
+};
+
+typedef struct {
+
+	long		samples;
+
+	double		sum;
+	double		max;
+}
+fast_error_t;
+
+int fast_script(int dt_skip, double sync, int seed);
+
+#endif /* _H_FAST_ */
+
@@ -3,15 +3,6 @@
 
 #include "lfg.h"
 
-typedef struct {
-
-	double		seed[55];
-	int		ra, rb;
-}
-lfg_t;
-
-static lfg_t		lfg;
-
 static uint32_t
 lfg_lcgu(uint32_t rseed)
 {
@@ -21,7 +12,7 @@ lfg_lcgu(uint32_t rseed)
 	return rseed * 17317U + 1U;
 }
 
-void lfg_start(int seed)
+void lfg_start(lfg_t *lfg, int seed)
 {
 	uint32_t	lcgu;
 	int		i;
@@ -31,41 +22,41 @@ void lfg_start(int seed)
 
 	for (i = 0; i < 55; ++i) {
 
-		lfg.seed[i] = (double) (lcgu = lfg_lcgu(lcgu)) / 4294967296.;
+		lfg->seed[i] = (double) (lcgu = lfg_lcgu(lcgu)) / 4294967296.;
 	}
 
-	lfg.ra = 0;
-	lfg.rb = 31;
+	lfg->ra = 0;
+	lfg->rb = 31;
 }
 
-double lfg_urand()
+double lfg_urand(lfg_t *lfg)
 {
 	double		x, a, b;
 
 	/* Lagged Fibonacci generator.
 	 * */
 
-	a = lfg.seed[lfg.ra];
-	b = lfg.seed[lfg.rb];
+	a = lfg->seed[lfg->ra];
+	b = lfg->seed[lfg->rb];
 
 	x = (a < b) ? a - b + 1. : a - b - 1.;
 
-	lfg.seed[lfg.ra] = x;
+	lfg->seed[lfg->ra] = x;
 
-	lfg.ra = (lfg.ra < 54) ? lfg.ra + 1 : 0;
-	lfg.rb = (lfg.rb < 54) ? lfg.rb + 1 : 0;
+	lfg->ra = (lfg->ra < 54) ? lfg->ra + 1 : 0;
+	lfg->rb = (lfg->rb < 54) ? lfg->rb + 1 : 0;
 
 	return x;
 }
 
-double lfg_gauss()
+double lfg_gauss(lfg_t *lfg)
 {
 	double		x;
 
 	/* Normal distribution fast approximation.
 	 * */
 
-	x = lfg_urand() + lfg_urand() + lfg_urand();
+	x = lfg_urand(lfg) + lfg_urand(lfg) + lfg_urand(lfg);
 
 	return x;
 }
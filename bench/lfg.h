@@ -1,10 +1,17 @@
 #ifndef _H_LFG_
 #define _H_LFG_
 
-void lfg_start(int rseed);
+typedef struct {
 
-double lfg_urand();
-double lfg_gauss();
+	double		seed[55];
+	int		ra, rb;
+}
+lfg_t;
+
+void lfg_start(lfg_t *lfg, int rseed);
+
+double lfg_urand(lfg_t *lfg);
+double lfg_gauss(lfg_t *lfg);
 
 #endif /* _H_LFG_ */
 
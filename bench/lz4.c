@@ -0,0 +1 @@
+#include "../phobia/gp/lz4.c"
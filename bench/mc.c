@@ -0,0 +1,475 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+#include "blm.h"
+#include "blms.h"
+#include "lfg.h"
+#include "mc.h"
+#include "pm.h"
+#include "tsfunc.h"
+
+typedef struct {
+
+	blms_t		*plant;
+	pmc_t		*pm;
+	mc_lane_t	*lane;
+
+	int		N;
+
+	/* Collect the position error of sensorless observer.
+	 * */
+	int		measure;
+	double		setpoint;
+
+	long		cycles;
+	double		wall_blm;
+	double		wall_pm;
+}
+mc_t;
+
+static __thread blms_t		*mc_plant;
+static __thread int		mc_lane;
+
+static void
+mc_proc_DC(int A, int B, int C)
+{
+	mc_plant->pwm_A[mc_lane] = A;
+	mc_plant->pwm_B[mc_lane] = B;
+	mc_plant->pwm_C[mc_lane] = C;
+}
+
+static void
+mc_proc_Z(int Z)
+{
+	mc_plant->pwm_Z[mc_lane] = (Z != PM_Z_ABC) ? BLM_Z_NONE : BLM_Z_DETACHED;
+}
+
+void mc_nominal(void *arg)
+{
+	sim_perf_t	*perf = (sim_perf_t *) arg;
+
+	memset(&m, 0, sizeof(m));
+	memset(&pm, 0, sizeof(pm));
+
+	blm_enable(&m);
+
+	/* Turnigy machine from ts_script_test().
+	 * */
+	m.Rs = 14.E-3;
+	m.Ld = 10.E-6;
+	m.Lq = 15.E-6;
+	m.Udc = 22.;
+	m.Rdc = 0.1;
+	m.Zp = 14;
+	m.lambda = blm_Kv_lambda(&m, 270.);
+	m.Jm = 3.E-4;
+
+	blm_restart(&m);
+
+	/* We measure the scalar model on identification to compare with.
+	 * */
+	sim_perf = perf;
+
+	ts_script_default();
+	ts_script_base();
+
+	sim_perf = NULL;
+
+	if (pm.fsm_errno != PM_OK) {
+
+		fprintf(stderr, "fsm_errno: %s\n", pm_strerror(pm.fsm_errno));
+		sim_abort();
+	}
+
+	pm.config_LU_DRIVE = PM_DRIVE_SPEED;
+	pm.s_accel = 300000.f;
+}
+
+static void
+mc_runtime(mc_t *c, double dT)
+{
+	blms_t		*plant = c->plant;
+	pmfb_t		fb;
+
+	double		stop, clock[3], eF;
+	int		n;
+
+	stop = plant->time + dT;
+
+	while (plant->time < stop) {
+
+		clock[0] = sim_clock();
+
+		/* Plant model update of all instances.
+		 * */
+		blms_update(plant);
+
+		clock[1] = sim_clock();
+
+		for (n = 0; n < c->N; ++n) {
+
+			fb.current_A = plant->analog_iA[n];
+			fb.current_B = plant->analog_iB[n];
+			fb.current_C = plant->analog_iC[n];
+			fb.voltage_U = plant->analog_uS[n];
+			fb.voltage_A = plant->analog_uA[n];
+			fb.voltage_B = plant->analog_uB[n];
+			fb.voltage_C = plant->analog_uC[n];
+
+			fb.analog_SIN = plant->analog_SIN[n];
+			fb.analog_COS = plant->analog_COS[n];
+
+			fb.pulse_HS = plant->pulse_HS[n];
+			fb.pulse_EP = plant->pulse_EP[n];
+
+			mc_lane = n;
+
+			pm_feedback(&c->pm[n], &fb);
+		}
+
+		clock[2] = sim_clock();
+
+		c->cycles += 1;
+		c->wall_blm += clock[1] - clock[0];
+		c->wall_pm += clock[2] - clock[1];
+
+		for (n = 0; n < c->N; ++n) {
+
+			if (		c->pm[n].fsm_errno != PM_OK
+					&& c->lane[n].status != MC_FAULT) {
+
+				c->lane[n].status = MC_FAULT;
+				c->lane[n].fsm_errno = c->pm[n].fsm_errno;
+				c->lane[n].time_fault = plant->time;
+			}
+
+			if (		c->measure != 0
+					&& c->lane[n].status != MC_FAULT
+					&& c->pm[n].lu_MODE == PM_LU_ESTIMATE) {
+
+				eF = atan2(c->pm[n].lu_F[1], c->pm[n].lu_F[0])
+					- plant->state[3][n];
+
+				eF += (eF < - M_PI) ? 2. * M_PI : (eF > M_PI) ? - 2. * M_PI : 0.;
+				eF = fabs(eF) * (180. / M_PI);
+
+				c->lane[n].samples += 1;
+				c->lane[n].sum_F += eF * eF;
+				c->lane[n].max_F = (eF > c->lane[n].max_F) ? eF : c->lane[n].max_F;
+			}
+		}
+	}
+}
+
+static void
+mc_request(mc_t *c, int req, double timeout)
+{
+	double		stop;
+	int		n, busy;
+
+	for (n = 0; n < c->N; ++n) {
+
+		c->pm[n].fsm_req = req;
+	}
+
+	stop = c->plant->time + timeout;
+
+	do {
+		mc_runtime(c, 10.E-3);
+
+		busy = 0;
+
+		for (n = 0; n < c->N; ++n) {
+
+			busy += (	c->lane[n].status != MC_FAULT
+					&& c->pm[n].fsm_state != PM_STATE_IDLE) ? 1 : 0;
+		}
+	}
+	while (busy != 0 && c->plant->time < stop);
+}
+
+static void
+mc_setpoint(mc_t *c, double wS)
+{
+	int		n;
+
+	c->setpoint = wS;
+
+	for (n = 0; n < c->N; ++n) {
+
+		c->pm[n].s_setpoint_speed = (float) wS;
+	}
+}
+
+static void
+mc_speed_check(mc_t *c)
+{
+	double		err;
+	int		n;
+
+	for (n = 0; n < c->N; ++n) {
+
+		/* We check the real speed of machine but not the estimate.
+		 * */
+		err = fabs(c->plant->state[2][n] - c->setpoint);
+
+		c->lane[n].err_wS = (err > c->lane[n].err_wS) ? err : c->lane[n].err_wS;
+
+		if (		c->lane[n].status == MC_OK
+				&& err > MC_SPEED_TOL) {
+
+			c->lane[n].status = MC_SPEED;
+		}
+	}
+}
+
+static void
+mc_load_torque(mc_t *c, double kQ)
+{
+	int		n;
+
+	for (n = 0; n < c->N; ++n) {
+
+		c->plant->Mq[0][n] = - 1.5 * c->plant->Zp[n]
+			* c->plant->lambda[n] * kQ;
+	}
+}
+
+static void
+mc_report(const mc_t *c, const sim_perf_t *perf, double wall, FILE *fd)
+{
+	const char	*status_name[] = { "OK", "FAULT", "SPEED" };
+
+	const mc_lane_t	*l;
+
+	double		rms, rms_max = 0., rms_sum = 0., max_F = 0., err_wS = 0.;
+	double		ns_blm, ns_pm, ns_scalar;
+	int		n, count[3] = { 0, 0, 0 };
+
+	if (fd != stdout) {
+
+		fprintf(fd, "# lane Rs Ld Lq lambda Jm Udc status errno time_fault"
+				" rms_F max_F err_wS\n");
+	}
+
+	for (n = 0; n < c->N; ++n) {
+
+		l = &c->lane[n];
+
+		rms = (l->samples > 0) ? sqrt(l->sum_F / l->samples) : 0.;
+
+		if (fd != stdout) {
+
+			fprintf(fd, "%i %.4E %.4E %.4E %.4E %.4E %.2f %s %s %.4f %.3f %.3f %.2f\n",
+					n, l->Rs, l->Ld, l->Lq, l->lambda, l->Jm, l->Udc,
+					status_name[l->status], (l->status == MC_FAULT)
+					? pm_strerror(l->fsm_errno) : "-", l->time_fault,
+					rms, l->max_F, l->err_wS);
+		}
+
+		count[l->status] += 1;
+
+		if (l->status == MC_OK) {
+
+			rms_sum += rms;
+			rms_max = (rms > rms_max) ? rms : rms_max;
+			max_F = (l->max_F > max_F) ? l->max_F : max_F;
+			err_wS = (l->err_wS > err_wS) ? l->err_wS : err_wS;
+		}
+	}
+
+	if (fd != stdout)
+		return ;
+
+	printf("\n---- Monte-Carlo ----\n");
+
+	printf("lanes = %i OK %i FAULT %i SPEED %i\n", c->N,
+			count[MC_OK], count[MC_FAULT], count[MC_SPEED]);
+
+	if (count[MC_OK] > 0) {
+
+		printf("rms_F = %.3f (deg) mean %.3f (deg) max\n",
+				rms_sum / count[MC_OK], rms_max);
+		printf("max_F = %.3f (deg)\n", max_F);
+		printf("err_wS = %.2f (rad/s) max\n", err_wS);
+	}
+
+	ns_blm = c->wall_blm * 1.E+9 / (c->cycles * c->N);
+	ns_pm = c->wall_pm * 1.E+9 / (c->cycles * c->N);
+	ns_scalar = (perf->cycles > 0) ? perf->blm * 1.E+9 / perf->cycles : 0.;
+
+	printf("\n---- Throughput ----\n");
+
+	printf("cycles = %li x %i lanes\n", c->cycles, c->N);
+	printf("ns_blm = %.1f (ns) per lane cycle, scalar %.1f (ns) %.1fx\n",
+			ns_blm, ns_scalar, (ns_blm > 0.) ? ns_scalar / ns_blm : 0.);
+	printf("ns_pm = %.1f (ns) per lane cycle\n", ns_pm);
+	printf("wall = %.3f (s) %.3f (sim/wall)\n", wall,
+			c->plant->time * c->N / wall);
+}
+
+int mc_script(int N, double tol, int seed)
+{
+	mc_t		c;
+	sim_perf_t	perf;
+	lfg_t		lfg;
+
+	FILE		*fd;
+	double		wall, wS_high, wS_low, kQ;
+	int		n;
+
+	if (N < 1 || N > BLMS_MAX) {
+
+		fprintf(stderr, "Number of lanes must be 1 to %i\n", BLMS_MAX);
+		return -1;
+	}
+
+	memset(&c, 0, sizeof(c));
+	memset(&perf, 0, sizeof(perf));
+
+	/* Telemetry would measure the disk instead of us.
+	 * */
+	tlm_setup(NULL, NULL);
+
+	ts_log = fopen("/dev/null", "w");
+
+	if (ts_log == NULL) {
+
+		fprintf(stderr, "fopen: %s\n", strerror(errno));
+		return -1;
+	}
+
+	fprintf(stderr, "  MC	nominal\n");
+
+	/* The controller is configured once on the scalar model of the
+	 * nominal machine and then copied into each lane.
+	 * */
+	if (sim_protect(&mc_nominal, (void *) &perf) != 0) {
+
+		fclose(ts_log);
+		ts_log = stdout;
+
+		return -1;
+	}
+
+	fclose(ts_log);
+	ts_log = stdout;
+
+	c.N = N;
+	c.plant = calloc(1, sizeof(blms_t));
+	c.pm = calloc(N, sizeof(pmc_t));
+	c.lane = calloc(N, sizeof(mc_lane_t));
+
+	if (c.plant == NULL || c.pm == NULL || c.lane == NULL) {
+
+		fprintf(stderr, "calloc: %s\n", strerror(errno));
+
+		free(c.plant);
+		free(c.pm);
+		free(c.lane);
+
+		return -1;
+	}
+
+	blms_enable(c.plant, &m, N);
+
+	lfg_start(&lfg, seed);
+
+	for (n = 0; n < N; ++n) {
+
+		if (n > 0) {
+
+			/* Lane 0 keeps the nominal machine.
+			 * */
+			c.plant->Rs[n] *= 1. + tol * lfg_urand(&lfg);
+			c.plant->Ld[n] *= 1. + tol * lfg_urand(&lfg);
+			c.plant->Lq[n] *= 1. + tol * lfg_urand(&lfg);
+			c.plant->lambda[n] *= 1. + tol * lfg_urand(&lfg);
+			c.plant->Jm[n] *= 1. + tol * lfg_urand(&lfg);
+			c.plant->Udc[n] *= 1. + tol * lfg_urand(&lfg);
+		}
+
+		c.lane[n].Rs = c.plant->Rs[n];
+		c.lane[n].Ld = c.plant->Ld[n];
+		c.lane[n].Lq = c.plant->Lq[n];
+		c.lane[n].lambda = c.plant->lambda[n];
+		c.lane[n].Jm = c.plant->Jm[n];
+		c.lane[n].Udc = c.plant->Udc[n];
+
+		c.pm[n] = pm;
+		c.pm[n].proc_set_DC = &mc_proc_DC;
+		c.pm[n].proc_set_Z = &mc_proc_Z;
+	}
+
+	blms_seed(c.plant, seed);
+	blms_restart(c.plant);
+
+	mc_plant = c.plant;
+
+	wS_high = 50.f * pm.k_EMAX / 100.f * pm.const_fb_U / pm.const_lambda;
+	wS_low = 10.f * pm.k_EMAX / 100.f * pm.const_fb_U / pm.const_lambda;
+
+	kQ = 20.;
+
+	fprintf(stderr, "  MC	%i lanes tol %.1f%%\n", N, tol * 100.);
+
+	wall = sim_clock();
+
+	mc_request(&c, PM_STATE_LU_STARTUP, 1.);
+
+	mc_setpoint(&c, wS_high);
+	mc_runtime(&c, 0.5);
+
+	c.measure = 1;
+
+	mc_runtime(&c, 0.5);
+	mc_speed_check(&c);
+
+	mc_load_torque(&c, kQ);
+	mc_runtime(&c, 0.5);
+
+	mc_load_torque(&c, 0.);
+	mc_runtime(&c, 0.5);
+	mc_speed_check(&c);
+
+	c.measure = 0;
+
+	mc_setpoint(&c, wS_low);
+	mc_runtime(&c, 0.5);
+
+	c.measure = 1;
+
+	mc_runtime(&c, 0.5);
+	mc_speed_check(&c);
+
+	c.measure = 0;
+
+	mc_request(&c, PM_STATE_LU_SHUTDOWN, 1.);
+
+	wall = sim_clock() - wall;
+
+	mc_plant = NULL;
+
+	mc_report(&c, &perf, wall, stdout);
+
+	fd = fopen(MC_FILE, "w");
+
+	if (fd != NULL) {
+
+		mc_report(&c, &perf, wall, fd);
+		fclose(fd);
+	}
+	else {
+		fprintf(stderr, "fopen: %s\n", strerror(errno));
+	}
+
+	free(c.plant);
+	free(c.pm);
+	free(c.lane);
+
+	return 0;
+}
+
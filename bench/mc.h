@@ -0,0 +1,43 @@
+#ifndef _H_MC_
+#define _H_MC_
+
+#define MC_FILE			"/tmp/pm-mc.txt"
+
+#define MC_LANES_DEFAULT	64
+#define MC_TOL_DEFAULT		0.2
+
+/* Allowed speed error at the end of hold (Radian/Sec).
+ * */
+#define MC_SPEED_TOL		50.
+
+enum {
+	MC_OK			= 0,
+	MC_FAULT,
+	MC_SPEED
+};
+
+typedef struct {
+
+	double		Rs;
+	double		Ld;
+	double		Lq;
+	double		lambda;
+	double		Jm;
+	double		Udc;
+
+	int		status;
+	int		fsm_errno;
+	double		time_fault;
+
+	long		samples;
+	double		sum_F;
+	double		max_F;
+	double		err_wS;
+}
+mc_lane_t;
+
+void mc_nominal(void *arg);
+int mc_script(int N, double tol, int seed);
+
+#endif /* _H_MC_ */
+
@@ -0,0 +1,353 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+#include "blm.h"
+#include "lfg.h"
+#include "perf.h"
+#include "pm.h"
+#include "tsfunc.h"
+
+typedef struct {
+
+	int		solver;
+	int		script;
+
+	perf_run_t	*run;
+}
+perf_arg_t;
+
+static void
+perf_eabi_incremental() { ts_script_eabi(PM_EABI_INCREMENTAL); }
+
+static void
+perf_eabi_absolute() { ts_script_eabi(PM_EABI_ABSOLUTE); }
+
+static const char	*perf_solver_name[] = { "fixed", "rk21", "rk54" };
+
+/* Each script is run on the machine from ts_script_test() that it is
+ * known to pass on.
+ * */
+static const struct {
+
+	const char	*name;
+	void		(* proc) ();
+
+	double		Rs, Ld, Lq, Udc, Rdc;
+	int		Zp;
+	double		Kv, Jm;
+}
+perf_script_list[] = {
+
+	{ "speed",	&ts_script_speed,	14.E-3, 10.E-6, 15.E-6, 22., 0.1, 14, 270., 3.E-4 },
+	{ "hfi",	&ts_script_hfi,		14.E-3, 10.E-6, 15.E-6, 22., 0.1, 14, 270., 3.E-4 },
+	{ "weakening",	&ts_script_weakening,	0.24, 520.E-6, 650.E-6, 48., 0.5, 15, 15., 6.E-3 },
+	{ "hall",	&ts_script_hall,	0.24, 520.E-6, 650.E-6, 48., 0.5, 15, 15., 6.E-3 },
+	{ "eabi_inc",	&perf_eabi_incremental,	14.E-3, 10.E-6, 15.E-6, 22., 0.1, 14, 270., 3.E-4 },
+	{ "eabi_abs",	&perf_eabi_absolute,	14.E-3, 10.E-6, 15.E-6, 22., 0.1, 14, 270., 3.E-4 },
+
+	{ NULL }
+};
+
+static void
+perf_run_proc(void *arg)
+{
+	const perf_arg_t	*pa = (const perf_arg_t *) arg;
+	perf_run_t		*run = pa->run;
+
+	sim_perf_t		perf;
+	double			wall, time;
+
+	memset(&m, 0, sizeof(m));
+	memset(&pm, 0, sizeof(pm));
+
+	blm_enable(&m);
+
+	m.sol_mode = pa->solver;
+
+	/* We use the fixed seed to get the same workload on each run.
+	 * */
+	lfg_start(&m.lfg, 1);
+
+	m.Rs = perf_script_list[pa->script].Rs;
+	m.Ld = perf_script_list[pa->script].Ld;
+	m.Lq = perf_script_list[pa->script].Lq;
+	m.Udc = perf_script_list[pa->script].Udc;
+	m.Rdc = perf_script_list[pa->script].Rdc;
+	m.Zp = perf_script_list[pa->script].Zp;
+	m.lambda = blm_Kv_lambda(&m, perf_script_list[pa->script].Kv);
+	m.Jm = perf_script_list[pa->script].Jm;
+
+	blm_restart(&m);
+
+	ts_script_default();
+	ts_script_base();
+	blm_restart(&m);
+
+	memset(&perf, 0, sizeof(perf));
+
+	sim_perf = &perf;
+
+	time = m.time;
+	wall = sim_clock();
+
+	perf_script_list[pa->script].proc();
+
+	wall = sim_clock() - wall;
+	time = m.time - time;
+
+	sim_perf = NULL;
+
+	run->cycles = perf.cycles;
+	run->sim = time;
+	run->wall = wall;
+
+	if (perf.cycles > 0) {
+
+		run->ns_cycle = wall * 1.E+9 / perf.cycles;
+		run->ns_blm = perf.blm * 1.E+9 / perf.cycles;
+		run->ns_pm = perf.pm * 1.E+9 / perf.cycles;
+	}
+}
+
+static double
+perf_clock_overhead()
+{
+	double		wall;
+	int		N;
+
+	wall = sim_clock();
+
+	for (N = 0; N < 1000000; ++N) {
+
+		sim_clock();
+	}
+
+	return (sim_clock() - wall) * 1.E+9 / N;
+}
+
+static void
+perf_total(perf_run_t *run, int run_N)
+{
+	perf_run_t	*total = &run[run_N];
+	int		N;
+
+	memset(total, 0, sizeof(perf_run_t));
+
+	strcpy(total->name, "total");
+
+	for (N = 0; N < run_N; ++N) {
+
+		total->status = (run[N].status != 0) ? -1 : total->status;
+		total->cycles += run[N].cycles;
+		total->sim += run[N].sim;
+		total->wall += run[N].wall;
+
+		total->ns_blm += run[N].ns_blm * run[N].cycles;
+		total->ns_pm += run[N].ns_pm * run[N].cycles;
+	}
+
+	if (total->cycles > 0) {
+
+		total->ns_cycle = total->wall * 1.E+9 / total->cycles;
+		total->ns_blm /= total->cycles;
+		total->ns_pm /= total->cycles;
+	}
+}
+
+static void
+perf_report(const perf_run_t *run, int run_N, int solver, double ns_clock, FILE *fd)
+{
+	double		ns_other;
+	int		N;
+
+	fprintf(fd, "# solver %s\n", perf_solver_name[solver]);
+	fprintf(fd, "# clock %.1f (ns)\n", ns_clock);
+	fprintf(fd, "# name status cycles sim wall ns_cycle"
+			" ns_blm ns_pm ns_other sim_wall\n");
+
+	for (N = 0; N <= run_N; ++N) {
+
+		/* The rest of loop includes the feedback copy and the
+		 * clock overhead itself.
+		 * */
+		ns_other = run[N].ns_cycle - run[N].ns_blm - run[N].ns_pm;
+
+		fprintf(fd, "%s %s %li %.4f %.4f %.1f %.1f %.1f %.1f %.3f\n",
+				run[N].name, (run[N].status == 0) ? "OK" : "FAULT",
+				run[N].cycles, run[N].sim, run[N].wall, run[N].ns_cycle,
+				run[N].ns_blm, run[N].ns_pm, ns_other,
+				(run[N].wall > 0.) ? run[N].sim / run[N].wall : 0.);
+	}
+}
+
+static int
+perf_baseline(const perf_run_t *run, int run_N, int solver, const char *file_base)
+{
+	const char	*solver_name = perf_solver_name[solver];
+
+	FILE		*fd;
+	perf_run_t	base;
+
+	char		line[200], status[20];
+	double		ns_other, rel;
+	int		N, rc = 0, found = 0;
+
+	fd = fopen(file_base, "r");
+
+	if (fd == NULL) {
+
+		fprintf(stderr, "fopen: %s\n", strerror(errno));
+		return -1;
+	}
+
+	printf("\n---- Baseline %s ----\n", file_base);
+
+	while (fgets(line, sizeof(line), fd) != NULL) {
+
+		if (line[0] == '#') {
+
+			if (sscanf(line, "# solver %19s", status) == 1
+					&& strcmp(status, solver_name) != 0) {
+
+				printf("solver %s -> %s\n", status, solver_name);
+			}
+
+			continue;
+		}
+
+		memset(&base, 0, sizeof(base));
+
+		if (sscanf(line, "%39s %19s %li %lf %lf %lf %lf %lf %lf",
+					base.name, status, &base.cycles, &base.sim,
+					&base.wall, &base.ns_cycle, &base.ns_blm,
+					&base.ns_pm, &ns_other) != 9)
+			continue;
+
+		for (N = 0; N <= run_N; ++N) {
+
+			if (strcmp(run[N].name, base.name) == 0)
+				break;
+		}
+
+		if (N > run_N || base.ns_cycle <= 0.)
+			continue;
+
+		found++;
+
+		rel = run[N].ns_cycle / base.ns_cycle - 1.;
+
+		printf("%s ns_cycle %.1f -> %.1f (%+.1f%%) blm %.1f -> %.1f pm %.1f -> %.1f%s\n",
+				base.name, base.ns_cycle, run[N].ns_cycle, rel * 100.,
+				base.ns_blm, run[N].ns_blm, base.ns_pm, run[N].ns_pm,
+				(rel > PERF_REGRESS_TOL) ? " REGRESS" : "");
+
+		if (base.cycles != run[N].cycles) {
+
+			/* Workload was changed so the comparison is not
+			 * quite fair.
+			 * */
+			printf("%s cycles %li -> %li\n", base.name,
+					base.cycles, run[N].cycles);
+		}
+
+		rc = (rel > PERF_REGRESS_TOL) ? 1 : rc;
+	}
+
+	fclose(fd);
+
+	if (found == 0) {
+
+		fprintf(stderr, "%s: no runs to compare\n", file_base);
+		rc = -1;
+	}
+
+	return rc;
+}
+
+int perf_script(const char *file, const char *file_base, int solver)
+{
+	perf_run_t		run[PERF_SCRIPT_MAX + 1], best;
+	perf_arg_t		pa;
+
+	FILE			*fd;
+	double			ns_clock;
+	int			N, r, rc = 0;
+
+	memset(run, 0, sizeof(run));
+
+	/* Telemetry would measure the disk instead of us.
+	 * */
+	tlm_setup(NULL, NULL);
+
+	ts_log = fopen("/dev/null", "w");
+
+	if (ts_log == NULL) {
+
+		fprintf(stderr, "fopen: %s\n", strerror(errno));
+		return -1;
+	}
+
+	ns_clock = perf_clock_overhead();
+
+	for (N = 0; perf_script_list[N].name != NULL
+			&& N < PERF_SCRIPT_MAX; ++N) {
+
+		for (r = 0; r < PERF_REPEAT; ++r) {
+
+			memset(&best, 0, sizeof(best));
+
+			pa.solver = solver;
+			pa.script = N;
+			pa.run = &best;
+
+			best.status = sim_protect(&perf_run_proc, (void *) &pa);
+
+			sim_perf = NULL;
+
+			if (		r == 0 || best.status != 0
+					|| best.ns_cycle < run[N].ns_cycle) {
+
+				run[N] = best;
+			}
+
+			if (best.status != 0)
+				break;
+		}
+
+		strcpy(run[N].name, perf_script_list[N].name);
+
+		fprintf(stderr, "  PERF	%s %s %.1f (ns) %.1f (s)\n", run[N].name,
+				(run[N].status == 0) ? "OK" : "FAULT",
+				run[N].ns_cycle, run[N].wall);
+
+		rc = (run[N].status != 0) ? -1 : rc;
+	}
+
+	fclose(ts_log);
+	ts_log = stdout;
+
+	perf_total(run, N);
+	perf_report(run, N, solver, ns_clock, stdout);
+
+	fd = fopen(file, "w");
+
+	if (fd != NULL) {
+
+		perf_report(run, N, solver, ns_clock, fd);
+		fclose(fd);
+	}
+	else {
+		fprintf(stderr, "fopen: %s\n", strerror(errno));
+	}
+
+	if (rc == 0 && file_base != NULL) {
+
+		rc = perf_baseline(run, N, solver, file_base);
+	}
+
+	return rc;
+}
+
@@ -0,0 +1,36 @@
+#ifndef _H_PERF_
+#define _H_PERF_
+
+#define PERF_FILE		"/tmp/pm-perf.txt"
+
+#define PERF_SCRIPT_MAX		10
+
+/* Each script is repeated and the fastest run is taken to reject the
+ * noise from the rest of system.
+ * */
+#define PERF_REPEAT		3
+
+/* Allowed slowdown against the baseline before regression is reported.
+ * */
+#define PERF_REGRESS_TOL	0.10
+
+typedef struct {
+
+	char		name[40];
+	int		status;
+
+	long		cycles;
+
+	double		sim;
+	double		wall;
+
+	double		ns_cycle;
+	double		ns_blm;
+	double		ns_pm;
+}
+perf_run_t;
+
+int perf_script(const char *file, const char *file_base, int solver);
+
+#endif /* _H_PERF_ */
+
@@ -1,3 +1,10 @@
+/* Cost profiling hook of bench "cost" mode.
+ * */
+#define PM_PROFILE(id, call)	do { cost_enter(COST_ ## id); call; \
+				cost_leave(COST_ ## id); } while (0)
+
+#include "cost.h"
+
 #include "../src/phobia/libm.c"
 #include "../src/phobia/lse.c"
 #include "../src/phobia/pm.c"
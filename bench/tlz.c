@@ -0,0 +1,336 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include <pthread.h>
+
+#include "../phobia/gp/lz4.h"
+#include "tlz.h"
+
+static int
+tlz_put_header(tlz_t *z)
+{
+	uint32_t	hdr[4], map[2];
+	int		N, map_N = 0;
+
+	for (N = 0; N < z->column_N; ++N) {
+
+		map_N += (z->decimate[N] > 0) ? 1 : 0;
+	}
+
+	hdr[0] = TLZ_VERSION;
+	hdr[1] = z->column_N;
+	hdr[2] = map_N;
+	hdr[3] = TLZ_BLOCK_SIZE;
+
+	fwrite(TLZ_MAGIC, 8, 1, z->fd);
+	fwrite(hdr, sizeof(hdr), 1, z->fd);
+
+	for (N = 0; N < z->column_N; ++N) {
+
+		if (z->decimate[N] > 0) {
+
+			map[0] = N;
+			map[1] = z->decimate[N];
+
+			fwrite(map, sizeof(map), 1, z->fd);
+		}
+	}
+
+	return (ferror(z->fd) != 0) ? -1 : 0;
+}
+
+static void *
+tlz_thread(void *arg)
+{
+	tlz_t		*z = (tlz_t *) arg;
+	uint32_t	chunk[2];
+	int		lzLEN, failed;
+
+	do {
+		pthread_mutex_lock(&z->mutex);
+
+		while (z->count == 0 && z->stop == 0) {
+
+			pthread_cond_wait(&z->cond, &z->mutex);
+		}
+
+		if (z->count == 0) {
+
+			pthread_mutex_unlock(&z->mutex);
+			break;
+		}
+
+		pthread_mutex_unlock(&z->mutex);
+
+		/* Compress the oldest block out of the lock as producer
+		 * does not touch it until we release.
+		 * */
+		lzLEN = LZ4_compress_default(z->block[z->tail].raw, z->lz,
+				z->block[z->tail].length,
+				LZ4_compressBound(TLZ_BLOCK_SIZE));
+
+		failed = 0;
+
+		if (lzLEN > 0) {
+
+			chunk[0] = z->block[z->tail].length;
+			chunk[1] = lzLEN;
+
+			fwrite(chunk, sizeof(chunk), 1, z->fd);
+
+			if (fwrite(z->lz, lzLEN, 1, z->fd) != 1) {
+
+				failed = 1;
+			}
+		}
+		else {
+			failed = 1;
+		}
+
+		pthread_mutex_lock(&z->mutex);
+
+		z->failed |= failed;
+
+		z->tail = (z->tail + 1) % TLZ_QUEUE_MAX;
+		z->count -= 1;
+
+		pthread_cond_broadcast(&z->cond);
+		pthread_mutex_unlock(&z->mutex);
+	}
+	while (1);
+
+	return NULL;
+}
+
+static int
+tlz_failed(tlz_t *z)
+{
+	int		failed;
+
+	pthread_mutex_lock(&z->mutex);
+
+	failed = z->failed;
+
+	pthread_mutex_unlock(&z->mutex);
+
+	return failed;
+}
+
+static int
+tlz_push(tlz_t *z)
+{
+	int		rc;
+
+	pthread_mutex_lock(&z->mutex);
+
+	z->count += 1;
+
+	pthread_cond_broadcast(&z->cond);
+
+	while (z->count >= TLZ_QUEUE_MAX) {
+
+		/* All blocks are busy so we wait for compression.
+		 * */
+		pthread_cond_wait(&z->cond, &z->mutex);
+	}
+
+	z->fill = (z->tail + z->count) % TLZ_QUEUE_MAX;
+	z->block[z->fill].length = 0;
+
+	rc = (z->failed != 0) ? -1 : 0;
+
+	pthread_mutex_unlock(&z->mutex);
+
+	return rc;
+}
+
+tlz_t *tlz_open(const char *file, int column_N)
+{
+	tlz_t		*z;
+	int		N;
+
+	if (column_N < 1 || column_N > TLZ_COLUMN_MAX) {
+
+		fprintf(stderr, "tlz: invalid column_N %i\n", column_N);
+		return NULL;
+	}
+
+	z = calloc(1, sizeof(tlz_t));
+
+	if (z == NULL) {
+
+		fprintf(stderr, "calloc: %s\n", strerror(errno));
+		return NULL;
+	}
+
+	z->fd = fopen(file, "wb");
+
+	if (z->fd == NULL) {
+
+		fprintf(stderr, "fopen: %s\n", strerror(errno));
+
+		free(z);
+		return NULL;
+	}
+
+	z->column_N = column_N;
+
+	for (N = 0; N < column_N; ++N) {
+
+		z->decimate[N] = 1;
+	}
+
+	for (N = 0; N < TLZ_QUEUE_MAX; ++N) {
+
+		z->block[N].raw = malloc(TLZ_BLOCK_SIZE);
+
+		if (z->block[N].raw == NULL)
+			break;
+	}
+
+	z->lz = malloc(LZ4_compressBound(TLZ_BLOCK_SIZE));
+
+	if (N < TLZ_QUEUE_MAX || z->lz == NULL) {
+
+		fprintf(stderr, "malloc: %s\n", strerror(errno));
+
+		for (N = 0; N < TLZ_QUEUE_MAX; ++N) {
+
+			free(z->block[N].raw);
+		}
+
+		free(z->lz);
+		fclose(z->fd);
+
+		free(z);
+		return NULL;
+	}
+
+	pthread_mutex_init(&z->mutex, NULL);
+	pthread_cond_init(&z->cond, NULL);
+
+	if (pthread_create(&z->thread, NULL, &tlz_thread, z) != 0) {
+
+		fprintf(stderr, "pthread_create: %s\n", strerror(errno));
+
+		z->failed = 1;
+	}
+	else {
+		z->running = 1;
+	}
+
+	return z;
+}
+
+void tlz_column(tlz_t *z, int column, int decimate)
+{
+	if (z->started != 0) {
+
+		/* Column map is already in the header.
+		 * */
+		return ;
+	}
+
+	if (column >= 0 && column < z->column_N) {
+
+		z->decimate[column] = (decimate > 0) ? decimate : 0;
+	}
+}
+
+int tlz_write(tlz_t *z, const float *row)
+{
+	char		*raw;
+	int		N, *len;
+
+	if (z->running == 0)
+		return -1;
+
+	if (z->started == 0) {
+
+		if (tlz_failed(z) != 0)
+			return -1;
+
+		if (tlz_put_header(z) != 0) {
+
+			pthread_mutex_lock(&z->mutex);
+
+			z->failed = 1;
+
+			pthread_mutex_unlock(&z->mutex);
+			return -1;
+		}
+
+		z->started = 1;
+	}
+
+	if (z->block[z->fill].length + z->column_N * (int) sizeof(float) > TLZ_BLOCK_SIZE) {
+
+		/* Writer thread failure is seen once per block.
+		 * */
+		if (tlz_push(z) != 0)
+			return -1;
+	}
+
+	raw = z->block[z->fill].raw;
+	len = &z->block[z->fill].length;
+
+	for (N = 0; N < z->column_N; ++N) {
+
+		if (		z->decimate[N] > 0
+				&& z->row_N % z->decimate[N] == 0) {
+
+			memcpy(raw + *len, &row[N], sizeof(float));
+			*len += sizeof(float);
+		}
+	}
+
+	z->row_N += 1;
+
+	return 0;
+}
+
+int tlz_close(tlz_t *z)
+{
+	int		N, rc;
+
+	if (z->started == 0 && tlz_failed(z) == 0) {
+
+		tlz_put_header(z);
+	}
+
+	if (z->running != 0) {
+
+		if (z->block[z->fill].length > 0) {
+
+			tlz_push(z);
+		}
+
+		pthread_mutex_lock(&z->mutex);
+
+		z->stop = 1;
+
+		pthread_cond_broadcast(&z->cond);
+		pthread_mutex_unlock(&z->mutex);
+
+		pthread_join(z->thread, NULL);
+	}
+
+	rc = (z->failed != 0) ? -1 : 0;
+	rc = (fclose(z->fd) != 0) ? -1 : rc;
+
+	for (N = 0; N < TLZ_QUEUE_MAX; ++N) {
+
+		free(z->block[N].raw);
+	}
+
+	free(z->lz);
+
+	pthread_mutex_destroy(&z->mutex);
+	pthread_cond_destroy(&z->cond);
+
+	free(z);
+
+	return rc;
+}
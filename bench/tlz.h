@@ -0,0 +1,71 @@
+#ifndef _H_TLZ_
+#define _H_TLZ_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <pthread.h>
+
+/* Chunked LZ4 telemetry container. The file begins with a header that
+ * holds the full row width and the map of stored columns with their
+ * decimation, and continues with a sequence of LZ4 compressed chunks.
+ *
+ *	"TLMLZ4\r\n"
+ *	uint32_t	version, column_N, map_N, block_size
+ *	uint32_t	column, decimate	(map_N times)
+ *
+ *	uint32_t	raw_size, lz_size	(each chunk)
+ *	char		lz[lz_size]
+ *
+ * Each chunk keeps an integer number of rows. The column of row number R
+ * is stored only if (R % decimate) is zero, the reader holds the last
+ * value otherwise.
+ * */
+
+#define TLZ_MAGIC		"TLMLZ4\r\n"
+#define TLZ_VERSION		1
+
+#define TLZ_COLUMN_MAX		2000
+#define TLZ_BLOCK_SIZE		262144
+#define TLZ_QUEUE_MAX		4
+
+typedef struct {
+
+	FILE		*fd;
+
+	int		column_N;
+	int		decimate[TLZ_COLUMN_MAX];
+
+	int		started;
+	long		row_N;
+
+	struct {
+
+		char		*raw;
+		int		length;
+	}
+	block[TLZ_QUEUE_MAX];
+
+	int		fill;
+	int		tail;
+	int		count;
+
+	char		*lz;
+
+	int		running;
+	int		stop;
+	int		failed;
+
+	pthread_t	thread;
+	pthread_mutex_t	mutex;
+	pthread_cond_t	cond;
+}
+tlz_t;
+
+tlz_t *tlz_open(const char *file, int column_N);
+void tlz_column(tlz_t *z, int column, int decimate);
+int tlz_write(tlz_t *z, const float *row);
+int tlz_close(tlz_t *z);
+
+#endif /* _H_TLZ_ */
+
@@ -13,11 +13,13 @@
 #define TS_TOL			0.2
 
 #define TS_printf(s)		fprintf(stderr, "%s in %s:%i\n", (s), __FILE__, __LINE__)
-#define TS_assert(x)		if ((x) == 0) { TS_printf(#x); exit(-1); }
+#define TS_assert(x)		if ((x) == 0) { TS_printf(#x); sim_abort(); }
 
 #define TS_assert_absolute(x, r, a)	TS_assert(fabs((x) - (r)) < fabs(a))
 #define TS_assert_relative(x, r)	TS_assert(fabs((x) - (r)) < TS_TOL * fabs(r))
 
+__thread FILE		*ts_log;
+
 int ts_wait_IDLE()
 {
 	int			xTIME = 0;
@@ -106,12 +108,12 @@ void ts_self_adjust()
 		pm.fsm_req = PM_STATE_ZERO_DRIFT;
 		ts_wait_IDLE();
 
-		printf("const_fb_U = %.3f (V)\n", pm.const_fb_U);
+		fprintf(ts_log, "const_fb_U = %.3f (V)\n", pm.const_fb_U);
 
-		printf("scale_iABC0 = %.3f %.3f %.3f (A)\n", pm.scale_iA[0],
+		fprintf(ts_log, "scale_iABC0 = %.3f %.3f %.3f (A)\n", pm.scale_iA[0],
 				pm.scale_iB[0], pm.scale_iC[0]);
 
-		printf("self_STDi = %.3f %.3f %.3f (A)\n", pm.self_STDi[0],
+		fprintf(ts_log, "self_STDi = %.3f %.3f %.3f (A)\n", pm.self_STDi[0],
 				pm.self_STDi[1], pm.self_STDi[2]);
 
 		if (pm.fsm_errno != PM_OK)
@@ -122,19 +124,19 @@ void ts_self_adjust()
 			pm.fsm_req = PM_STATE_ADJUST_VOLTAGE;
 			ts_wait_IDLE();
 
-			printf("scale_uA = %.4E %.4f (V)\n", pm.scale_uA[1], pm.scale_uA[0]);
-			printf("scale_uB = %.4E %.4f (V)\n", pm.scale_uB[1], pm.scale_uB[0]);
-			printf("scale_uC = %.4E %.4f (V)\n", pm.scale_uC[1], pm.scale_uC[0]);
+			fprintf(ts_log, "scale_uA = %.4E %.4f (V)\n", pm.scale_uA[1], pm.scale_uA[0]);
+			fprintf(ts_log, "scale_uB = %.4E %.4f (V)\n", pm.scale_uB[1], pm.scale_uB[0]);
+			fprintf(ts_log, "scale_uC = %.4E %.4f (V)\n", pm.scale_uC[1], pm.scale_uC[0]);
 
 			tau_A = pm.m_dT / log(pm.tvm_FIR_A[0] / - pm.tvm_FIR_A[1]);
 			tau_B = pm.m_dT / log(pm.tvm_FIR_B[0] / - pm.tvm_FIR_B[1]);
 			tau_C = pm.m_dT / log(pm.tvm_FIR_C[0] / - pm.tvm_FIR_C[1]);
 
-			printf("tau_A = %.2f (us)\n", tau_A * 1000000.);
-			printf("tau_B = %.2f (us)\n", tau_B * 1000000.);
-			printf("tau_C = %.2f (us)\n", tau_C * 1000000.);
+			fprintf(ts_log, "tau_A = %.2f (us)\n", tau_A * 1000000.);
+			fprintf(ts_log, "tau_B = %.2f (us)\n", tau_B * 1000000.);
+			fprintf(ts_log, "tau_C = %.2f (us)\n", tau_C * 1000000.);
 
-			printf("self_RMSu = %.4f %.4f %.4f (V)\n", pm.self_RMSu[1],
+			fprintf(ts_log, "self_RMSu = %.4f %.4f %.4f (V)\n", pm.self_RMSu[1],
 					pm.self_RMSu[2], pm.self_RMSu[3]);
 
 			TS_assert_relative(tau_A, m.tau_B);
@@ -158,7 +160,7 @@ void ts_probe_impedance()
 
 		pm.const_Rs = pm.const_im_R;
 
-		printf("const_Rs = %.4E (Ohm)\n", pm.const_Rs);
+		fprintf(ts_log, "const_Rs = %.4E (Ohm)\n", pm.const_Rs);
 
 		TS_assert_relative(pm.const_Rs, m.Rs);
 
@@ -167,10 +169,10 @@ void ts_probe_impedance()
 		if (ts_wait_IDLE() != PM_OK)
 			break;
 
-		printf("const_im_L1 = %.4E (H)\n", pm.const_im_L1);
-		printf("const_im_L2 = %.4E (H)\n", pm.const_im_L2);
-		printf("const_im_B = %.2f (deg)\n", pm.const_im_B);
-		printf("const_im_R = %.4E (Ohm)\n", pm.const_im_R);
+		fprintf(ts_log, "const_im_L1 = %.4E (H)\n", pm.const_im_L1);
+		fprintf(ts_log, "const_im_L2 = %.4E (H)\n", pm.const_im_L2);
+		fprintf(ts_log, "const_im_B = %.2f (deg)\n", pm.const_im_B);
+		fprintf(ts_log, "const_im_R = %.4E (Ohm)\n", pm.const_im_R);
 
 		TS_assert_relative(pm.const_im_L1, m.Ld);
 		TS_assert_relative(pm.const_im_L2, m.Lq);
@@ -178,10 +180,10 @@ void ts_probe_impedance()
 		pm_auto(&pm, PM_AUTO_MAXIMAL_CURRENT);
 		pm_auto(&pm, PM_AUTO_LOOP_CURRENT);
 
-		printf("i_maixmal = %.3f (A) \n", pm.i_maximal);
-		printf("i_gain_P = %.2E \n", pm.i_gain_P);
-		printf("i_gain_I = %.2E \n", pm.i_gain_I);
-		printf("i_slew_rate = %.1f (A/s)\n", pm.i_slew_rate);
+		fprintf(ts_log, "i_maixmal = %.3f (A) \n", pm.i_maximal);
+		fprintf(ts_log, "i_gain_P = %.2E \n", pm.i_gain_P);
+		fprintf(ts_log, "i_gain_I = %.2E \n", pm.i_gain_I);
+		fprintf(ts_log, "i_slew_rate = %.1f (A/s)\n", pm.i_slew_rate);
 	}
 	while (0);
 }
@@ -203,7 +205,7 @@ void ts_probe_spinup()
 			if (ts_wait_spinup() != PM_OK)
 				break;
 
-			printf("zone_lpf_wS = %.2f (rad/s)\n", pm.zone_lpf_wS);
+			fprintf(ts_log, "zone_lpf_wS = %.2f (rad/s)\n", pm.zone_lpf_wS);
 
 			pm.fsm_req = PM_STATE_PROBE_CONST_FLUX_LINKAGE;
 
@@ -212,30 +214,30 @@ void ts_probe_spinup()
 
 			Kv = 60. / (2. * M_PI * sqrt(3.)) / (pm.const_lambda * pm.const_Zp);
 
-			printf("const_lambda = %.4E (Wb) %.2f (rpm/v)\n", pm.const_lambda, Kv);
+			fprintf(ts_log, "const_lambda = %.4E (Wb) %.2f (rpm/v)\n", pm.const_lambda, Kv);
 		}
 
 		pm_auto(&pm, PM_AUTO_ZONE_THRESHOLD);
 		pm_auto(&pm, PM_AUTO_PROBE_SPEED_HOLD);
 		pm_auto(&pm, PM_AUTO_FORCED_MAXIMAL);
 
-		printf("zone_noise = %.2f (rad/s) %.3f (V)\n",
+		fprintf(ts_log, "zone_noise = %.2f (rad/s) %.3f (V)\n",
 				pm.zone_noise,
 				pm.zone_noise * pm.const_lambda);
 
-		printf("zone_threshold = %.2f (rad/s) %.3f (V)\n",
+		fprintf(ts_log, "zone_threshold = %.2f (rad/s) %.3f (V)\n",
 				pm.zone_threshold,
 				pm.zone_threshold * pm.const_lambda);
 
-		printf("probe_speed_hold = %.2f (rad/s)\n", pm.probe_speed_hold);
-		printf("forced_maximal = %.2f (rad/s)\n", pm.forced_maximal);
+		fprintf(ts_log, "probe_speed_hold = %.2f (rad/s)\n", pm.probe_speed_hold);
+		fprintf(ts_log, "forced_maximal = %.2f (rad/s)\n", pm.forced_maximal);
 
 		pm.s_setpoint_speed = pm.probe_speed_hold;
 
 		if (ts_wait_spinup() != PM_OK)
 			break;
 
-		printf("zone_lpf_wS = %.2f (rad/s)\n", pm.zone_lpf_wS);
+		fprintf(ts_log, "zone_lpf_wS = %.2f (rad/s)\n", pm.zone_lpf_wS);
 
 		if (pm.flux_ZONE != PM_ZONE_HIGH) {
 
@@ -252,7 +254,7 @@ void ts_probe_spinup()
 
 			Kv = 60. / (2. * M_PI * sqrt(3.)) / (pm.const_lambda * pm.const_Zp);
 
-			printf("const_lambda = %.4E (Wb) %.2f (rpm/v)\n", pm.const_lambda, Kv);
+			fprintf(ts_log, "const_lambda = %.4E (Wb) %.2f (rpm/v)\n", pm.const_lambda, Kv);
 
 			TS_assert_relative(pm.const_lambda, m.lambda);
 		}
@@ -264,11 +266,11 @@ void ts_probe_spinup()
 
 		pm_auto(&pm, PM_AUTO_ZONE_THRESHOLD);
 
-		printf("zone_noise = %.2f (rad/s) %.3f (V)\n",
+		fprintf(ts_log, "zone_noise = %.2f (rad/s) %.3f (V)\n",
 				pm.zone_noise,
 				pm.zone_noise * pm.const_lambda);
 
-		printf("zone_threshold = %.2f (rad/s) %.3f (V)\n",
+		fprintf(ts_log, "zone_threshold = %.2f (rad/s) %.3f (V)\n",
 				pm.zone_threshold,
 				pm.zone_threshold * pm.const_lambda);
 
@@ -288,7 +290,7 @@ void ts_probe_spinup()
 		if (ts_wait_IDLE() != PM_OK)
 			break;
 
-		printf("const_Ja = %.4E (kgm2) \n", pm.const_Ja * pm.const_Zp * pm.const_Zp);
+		fprintf(ts_log, "const_Ja = %.4E (kgm2) \n", pm.const_Ja * pm.const_Zp * pm.const_Zp);
 
 		TS_assert_relative(pm.const_Ja * pm.const_Zp * pm.const_Zp, m.Jm);
 
@@ -301,11 +303,11 @@ void ts_probe_spinup()
 		pm_auto(&pm, PM_AUTO_FORCED_ACCEL);
 		pm_auto(&pm, PM_AUTO_LOOP_SPEED);
 
-		printf("forced_maximal = %.2f (rad/s)\n", pm.forced_maximal);
-		printf("forced_accel = %.1f (rad/s2)\n", pm.forced_accel);
-		printf("lu_gain_mq_LP = %.2E\n", pm.lu_gain_mq_LP);
-		printf("s_gain_P = %.2E\n", pm.s_gain_P);
-		printf("s_gain_D = %.2E\n", pm.s_gain_D);
+		fprintf(ts_log, "forced_maximal = %.2f (rad/s)\n", pm.forced_maximal);
+		fprintf(ts_log, "forced_accel = %.1f (rad/s2)\n", pm.forced_accel);
+		fprintf(ts_log, "lu_gain_mq_LP = %.2E\n", pm.lu_gain_mq_LP);
+		fprintf(ts_log, "s_gain_P = %.2E\n", pm.s_gain_P);
+		fprintf(ts_log, "s_gain_D = %.2E\n", pm.s_gain_D);
 	}
 	while (0);
 }
@@ -339,7 +341,7 @@ void ts_adjust_sensor_hall()
 
 			STg = atan2(pm.hall_ST[N].Y, pm.hall_ST[N].X) * (180. / M_PI);
 
-			printf("hall_ST[%i] = %.1f (deg)\n", N, STg);
+			fprintf(ts_log, "hall_ST[%i] = %.1f (deg)\n", N, STg);
 		}
 
 		pm.fsm_req = PM_STATE_LU_SHUTDOWN;
@@ -379,9 +381,9 @@ void ts_adjust_sensor_eabi()
 
 		F0g = atan2(pm.eabi_F0[1], pm.eabi_F0[0]) * (180. / M_PI);
 
-		printf("eabi_const_EP = %i\n", pm.eabi_const_EP);
-		printf("eabi_const_Zs = %i\n", pm.eabi_const_Zs);
-		printf("eabi_F0 = %.1f (deg)\n", F0g);
+		fprintf(ts_log, "eabi_const_EP = %i\n", pm.eabi_const_EP);
+		fprintf(ts_log, "eabi_const_Zs = %i\n", pm.eabi_const_Zs);
+		fprintf(ts_log, "eabi_F0 = %.1f (deg)\n", F0g);
 
 		pm.fsm_req = PM_STATE_LU_SHUTDOWN;
 
@@ -428,8 +430,7 @@ void ts_script_base()
 	ts_probe_spinup();
 }
 
-static void
-ts_script_speed()
+void ts_script_speed()
 {
 	pm.config_LU_DRIVE = PM_DRIVE_SPEED;
 	pm.s_accel = 300000.f;
@@ -469,8 +470,7 @@ ts_script_speed()
 	ts_wait_IDLE();
 }
 
-static void
-ts_script_hfi()
+void ts_script_hfi()
 {
 	pm.config_LU_ESTIMATE = PM_FLUX_KALMAN;
 	pm.config_LU_DRIVE = PM_DRIVE_SPEED;
@@ -507,8 +507,7 @@ ts_script_hfi()
 	pm.config_HFI_WAVETYPE = PM_HFI_NONE;
 }
 
-static void
-ts_script_weakening()
+void ts_script_weakening()
 {
 	pm.config_WEAKENING = PM_ENABLED;
 	pm.config_LU_DRIVE = PM_DRIVE_SPEED;
@@ -548,8 +547,7 @@ ts_script_weakening()
 	ts_wait_IDLE();
 }
 
-static void
-ts_script_hall()
+void ts_script_hall()
 {
 	int		backup_LU_ESTIMATE;
 
@@ -603,8 +601,7 @@ ts_script_hall()
 	pm.config_LU_SENSOR = PM_SENSOR_NONE;
 }
 
-static void
-ts_script_eabi(int knob_EABI)
+void ts_script_eabi(int knob_EABI)
 {
 	int		backup_LU_ESTIMATE;
 
@@ -675,7 +672,7 @@ void ts_script_test()
 	blm_enable(&m);
 	blm_restart(&m);
 
-	printf("\n---- XNOVA Lightning 4530 ----\n");
+	fprintf(ts_log, "\n---- XNOVA Lightning 4530 ----\n");
 
 	tlm_restart();
 
@@ -698,7 +695,7 @@ void ts_script_test()
 	/*ts_script_hfi();
 	  blm_restart(&m);*/
 
-	printf("\n---- Turnigy RotoMax 1.20 ----\n");
+	fprintf(ts_log, "\n---- Turnigy RotoMax 1.20 ----\n");
 
 	tlm_restart();
 
@@ -727,7 +724,7 @@ void ts_script_test()
 	ts_script_eabi(PM_EABI_ABSOLUTE);
 	blm_restart(&m);
 
-	printf("\n---- Hub Motor (250W) ----\n");
+	fprintf(ts_log, "\n---- Hub Motor (250W) ----\n");
 
 	tlm_restart();
 
@@ -753,7 +750,7 @@ void ts_script_test()
 	ts_script_hall();
 	blm_restart(&m);
 
-	printf("\n---- QS 138 (3000W) ----\n");
+	fprintf(ts_log, "\n---- QS 138 (3000W) ----\n");
 
 	tlm_restart();
 
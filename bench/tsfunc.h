@@ -1,10 +1,35 @@
 #ifndef _H_TSFUNC_
 #define _H_TSFUNC_
 
-extern blm_t			m;
-extern pmc_t			pm;
+#include <stdio.h>
 
+#define TLM_SIZE	100
+
+extern __thread blm_t		m;
+extern __thread pmc_t		pm;
+
+extern __thread FILE		*ts_log;
+
+typedef struct {
+
+	long		cycles;
+
+	double		blm;
+	double		pm;
+}
+sim_perf_t;
+
+extern __thread sim_perf_t	*sim_perf;
+
+extern void tlm_setup(const char *file_tlm, const char *file_gp);
 extern void tlm_restart();
+extern void tlm_decimate(int nGP, int N);
+extern void tlm_close();
+
+extern int sim_solver(const char *name);
+extern double sim_clock();
+extern void sim_abort();
+extern int sim_protect(void (* proc) (void *), void *arg);
 extern void sim_runtime(double dT);
 
 int ts_wait_IDLE();
@@ -13,6 +38,13 @@ int ts_wait_spinup();
 
 void ts_script_default();
 void ts_script_base();
+
+void ts_script_speed();
+void ts_script_hfi();
+void ts_script_weakening();
+void ts_script_hall();
+void ts_script_eabi(int knob_EABI);
+
 void ts_script_test();
 
 #endif /* _H_TSFUNC_ */
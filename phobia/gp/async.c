@@ -26,6 +26,11 @@
 #include "async.h"
 #include "plot.h"
 
+#if defined(__GNUC__) && defined(__SSE2__)
+#include <emmintrin.h>
+#define _ASYNC_SIMD_SSE2
+#endif
+
 static int
 async_READ(async_FILE *afd)
 {
@@ -178,9 +183,40 @@ int async_read(async_FILE *afd, char *sbuf, int n)
 	}
 }
 
+static int
+async_EOL(const char *s, int n)
+{
+	int		len = 0;
+
+#ifdef _ASYNC_SIMD_SSE2
+	__m128i		ls, lm;
+	int		mask;
+
+	while (len + 16 <= n) {
+
+		ls = _mm_loadu_si128((const __m128i *) (s + len));
+		lm = _mm_or_si128(_mm_cmpeq_epi8(ls, _mm_set1_epi8('\r')),
+				_mm_cmpeq_epi8(ls, _mm_set1_epi8('\n')));
+
+		mask = _mm_movemask_epi8(lm);
+
+		if (mask != 0) {
+
+			return len + __builtin_ctz(mask);
+		}
+
+		len += 16;
+	}
+#endif /* _ASYNC_SIMD_SSE2 */
+
+	while (len < n && s[len] != '\r' && s[len] != '\n') { len++; }
+
+	return len;
+}
+
 int async_gets(async_FILE *afd, char *sbuf, int n)
 {
-	int		rp, wp, eol, nq;
+	int		rp, wp, eol, nq, len, nl, cp;
 	char		c;
 
 	rp = SDL_AtomicGet(&afd->rp);
@@ -195,23 +231,38 @@ int async_gets(async_FILE *afd, char *sbuf, int n)
 			if (rp == wp)
 				break;
 
-			c = (int) afd->stream[rp];
+			if (eol == 0) {
 
-			if (c == '\r' || c == '\n') {
+				/* Line content is copied at once up to CR or LF
+				 * that is found in contiguous part of the stream.
+				 * */
+				len = ((rp < wp) ? wp : afd->preload) - rp;
+				nl = async_EOL(afd->stream + rp, len);
 
-				eol = (nq > 0) ? 1 : 0;
-			}
-			else if (eol == 1) {
+				cp = (nl < n - 1 - nq) ? nl : n - 1 - nq;
 
-				break;
-			}
-			else if (nq < n - 1) {
+				memcpy(sbuf, afd->stream + rp, cp);
+
+				sbuf += cp;
+				nq += cp;
+				rp += nl;
+
+				if (nl < len) {
 
-				*sbuf++ = (char) c;
-				nq++;
+					eol = (nq > 0) ? 1 : 0;
+					rp += 1;
+				}
+
+				rp = (rp < afd->preload) ? rp : 0;
 			}
+			else {
+				c = afd->stream[rp];
+
+				if (c != '\r' && c != '\n')
+					break;
 
-			rp = (rp < afd->preload - 1) ? rp + 1 : 0;
+				rp = (rp < afd->preload - 1) ? rp + 1 : 0;
+			}
 		}
 		while (1);
 
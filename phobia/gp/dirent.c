@@ -182,11 +182,54 @@ int file_remove(const char *file)
 	return (DeleteFileW(wfile) != 0) ? ENT_OK : ENT_ERROR_UNKNOWN;
 }
 
+void *file_map(const char *file, unsigned long long *nsize)
+{
+	wchar_t			wfile[DIRENT_PATH_MAX];
+	HANDLE			hFile, hMap;
+	LARGE_INTEGER		nSize = { 0 } ;
+	void			*map = NULL;
+
+	MultiByteToWideChar(CP_UTF8, 0, file, -1, wfile, DIRENT_PATH_MAX);
+
+	hFile = CreateFileW(wfile, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+			NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (hFile == INVALID_HANDLE_VALUE) {
+
+		return NULL;
+	}
+
+	if (GetFileSizeEx(hFile, &nSize) != 0 && nSize.QuadPart > 0) {
+
+		hMap = CreateFileMappingW(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+
+		if (hMap != NULL) {
+
+			map = MapViewOfFile(hMap, FILE_MAP_READ, 0, 0, 0);
+
+			CloseHandle(hMap);
+		}
+	}
+
+	CloseHandle(hFile);
+
+	*nsize = (map != NULL) ? nSize.QuadPart : 0U;
+
+	return map;
+}
+
+void file_unmap(void *map, unsigned long long nsize)
+{
+	UnmapViewOfFile(map);
+}
+
 #else /* _WINDOWS */
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
+#include <sys/mman.h>
 #include <dirent.h>
+#include <fcntl.h>
 #include <unistd.h>
 
 struct dirent_priv {
@@ -312,5 +355,37 @@ int file_remove(const char *file)
 	return (remove(file) == 0) ? ENT_OK : ENT_ERROR_UNKNOWN;
 }
 
+void *file_map(const char *file, unsigned long long *nsize)
+{
+	struct stat		sb;
+	void			*map = NULL;
+	int			fd;
+
+	fd = open(file, O_RDONLY);
+
+	if (fd < 0) {
+
+		return NULL;
+	}
+
+	if (fstat(fd, &sb) == 0 && sb.st_size > 0) {
+
+		map = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+		map = (map != MAP_FAILED) ? map : NULL;
+	}
+
+	close(fd);
+
+	*nsize = (map != NULL) ? sb.st_size : 0U;
+
+	return map;
+}
+
+void file_unmap(void *map, unsigned long long nsize)
+{
+	munmap(map, nsize);
+}
+
 #endif /* _WINDOWS */
 
@@ -26,6 +26,11 @@
 #include "plot.h"
 #include "svg.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define _DRAW_SIMD_X86
+#endif
+
 extern int fp_isfinite(double x);
 
 void drawDashReset(draw_t *dw)
@@ -106,6 +111,17 @@ void drawClearCanvas(draw_t *dw)
 {
 	int			len;
 
+	dw->tile.record = (dw->tiled != 0) ? (dw->tile.started == 0
+			|| dw->tile.thread_N > 0) : 0;
+
+	if (dw->tile.record != 0) {
+
+		/* Each tile clears its own rows before rasterisation.
+		 * */
+		dw->tile.cmd_N = 0;
+		return ;
+	}
+
 	len = dw->pixmap.yspan * dw->pixmap.h;
 
 	if (dw->antialiasing == DRAW_4X_MSAA) {
@@ -166,6 +182,7 @@ void drawPixmapAlloc(draw_t *dw, SDL_Surface *surface)
 
 			free(dw->pixmap.canvas);
 			free(dw->pixmap.trial);
+			free(dw->pixmap.layer);
 		}
 
 		dw->pixmap.len = len + 1048576UL;
@@ -182,15 +199,143 @@ void drawPixmapAlloc(draw_t *dw, SDL_Surface *surface)
 
 			ERROR("Unable to allocate memory of the trial pixmap\n");
 		}
+
+		dw->pixmap.layer = (void *) malloc(dw->pixmap.len);
+
+		if (dw->pixmap.layer == NULL) {
+
+			ERROR("Unable to allocate memory of the layer pixmap\n");
+		}
+	}
+}
+
+static void
+drawTileStop(draw_t *dw)
+{
+	int		N;
+
+	if (dw->tile.mutex != NULL && dw->tile.cond != NULL) {
+
+		SDL_LockMutex(dw->tile.mutex);
+
+		dw->tile.stop = 1;
+
+		SDL_CondBroadcast(dw->tile.cond);
+		SDL_UnlockMutex(dw->tile.mutex);
+
+		for (N = 0; N < dw->tile.thread_N; ++N) {
+
+			SDL_WaitThread(dw->tile.thread[N], NULL);
+		}
+	}
+
+	dw->tile.thread_N = 0;
+	dw->tile.started = 0;
+	dw->tile.stop = 0;
+
+	if (dw->tile.mutex != NULL) {
+
+		SDL_DestroyMutex(dw->tile.mutex);
+		dw->tile.mutex = NULL;
+	}
+
+	if (dw->tile.cond != NULL) {
+
+		SDL_DestroyCond(dw->tile.cond);
+		dw->tile.cond = NULL;
+	}
+
+	if (dw->tile.done != NULL) {
+
+		SDL_DestroyCond(dw->tile.done);
+		dw->tile.done = NULL;
 	}
 }
 
 void drawPixmapClean(draw_t *dw)
 {
+	drawTileStop(dw);
+
 	if (dw->pixmap.len != 0) {
 
 		free(dw->pixmap.canvas);
 		free(dw->pixmap.trial);
+		free(dw->pixmap.layer);
+	}
+
+	if (dw->tile.cmd != NULL) {
+
+		free(dw->tile.cmd);
+		dw->tile.cmd = NULL;
+	}
+
+	if (dw->tile.bin != NULL) {
+
+		free(dw->tile.bin);
+		dw->tile.bin = NULL;
+	}
+
+	if (dw->tile.bin_ofs != NULL) {
+
+		free(dw->tile.bin_ofs);
+		dw->tile.bin_ofs = NULL;
+	}
+}
+
+static void
+drawTileRecord(draw_t *dw, int cmd, clipBox_t *cb, clipBox_t *lcb,
+		double fxs, double fys, double fxe, double fye,
+		int ncol, int thickness, int dash, int space)
+{
+	drawTileCmd_t		*tc;
+
+	if (lcb->min_y > lcb->max_y || lcb->min_x > lcb->max_x)
+		return ;
+
+	if (dw->tile.cmd_N >= dw->tile.cmd_MAX) {
+
+		int		MAX = (dw->tile.cmd_MAX != 0) ? dw->tile.cmd_MAX * 2 : 4096;
+
+		tc = (drawTileCmd_t *) realloc(dw->tile.cmd, sizeof(drawTileCmd_t) * MAX);
+
+		if (tc == NULL) {
+
+			ERROR("No memory allocated for tile commands\n");
+			return ;
+		}
+
+		dw->tile.cmd = tc;
+		dw->tile.cmd_MAX = MAX;
+	}
+
+	tc = &dw->tile.cmd[dw->tile.cmd_N++];
+
+	tc->cmd = cmd;
+
+	tc->fxs = fxs;
+	tc->fys = fys;
+	tc->fxe = fxe;
+	tc->fye = fye;
+
+	tc->ncol = ncol;
+	tc->thickness = thickness;
+	tc->dash = dash;
+	tc->space = space;
+	tc->context = dw->dash_context;
+
+	tc->cb = *cb;
+
+	tc->min_y = lcb->min_y;
+	tc->max_y = lcb->max_y;
+}
+
+static void
+drawTileBand(draw_t *dw, clipBox_t *lcb)
+{
+	if (dw->tile.banded != 0) {
+
+		lcb->min_y = (lcb->min_y < dw->tile.band_min_y) ? dw->tile.band_min_y : lcb->min_y;
+		lcb->max_y = (lcb->max_y > dw->tile.band_max_y) ? dw->tile.band_max_y : lcb->max_y;
 	}
 }
 
@@ -608,6 +753,15 @@ void drawLineCanvas(draw_t *dw, SDL_Surface *surface, clipBox_t *cb, double fxs,
 	lcb.max_x = (lcb.max_x > cb->max_x) ? cb->max_x : lcb.max_x;
 	lcb.max_y = (lcb.max_y > cb->max_y) ? cb->max_y : lcb.max_y;
 
+	if (dw->tile.record != 0) {
+
+		drawTileRecord(dw, DRAW_TILE_LINE, cb, &lcb, fxs, fys, fxe, fye,
+				ncol, thickness, 0, 0);
+		return ;
+	}
+
+	drawTileBand(dw, &lcb);
+
 	l = (xs - xe) * (xs - xe) + (ys - ye) * (ys - ye);
 	d = (int) sqrtf((float) l);
 
@@ -1438,6 +1592,8 @@ void drawDashCanvas(draw_t *dw, SDL_Surface *surface, clipBox_t *cb, double fxs,
 	lcb.max_x = (lcb.max_x > cb->max_x) ? cb->max_x : lcb.max_x;
 	lcb.max_y = (lcb.max_y > cb->max_y) ? cb->max_y : lcb.max_y;
 
+	drawTileBand(dw, &lcb);
+
 	e = (xs - xe) * (xs - xe) + (ys - ye) * (ys - ye);
 	d = (int) sqrtf((float) e);
 
@@ -1452,6 +1608,12 @@ void drawDashCanvas(draw_t *dw, SDL_Surface *surface, clipBox_t *cb, double fxs,
 	w1dy = - (xs - xe) * 16;
 	w2dy = (ye - ys) * 16;
 
+	if (dw->tile.record != 0) {
+
+		drawTileRecord(dw, DRAW_TILE_DASH, cb, &lcb, fxs, fys, fxe, fye,
+				ncol, thickness, dash, space);
+	}
+
 	context = dw->dash_context;
 
 	ww2 = context * d;
@@ -1459,6 +1621,9 @@ void drawDashCanvas(draw_t *dw, SDL_Surface *surface, clipBox_t *cb, double fxs,
 
 	dw->dash_context = context;
 
+	if (dw->tile.record != 0)
+		return ;
+
 	if (dw->antialiasing == DRAW_SOLID) {
 
 		Uint8		*canvas = (Uint8 *) dw->pixmap.canvas;
@@ -2488,6 +2653,15 @@ void drawDotCanvas(draw_t *dw, SDL_Surface *surface, clipBox_t *cb, double fxs,
 	lcb.max_x = (lcb.max_x > cb->max_x) ? cb->max_x : lcb.max_x;
 	lcb.max_y = (lcb.max_y > cb->max_y) ? cb->max_y : lcb.max_y;
 
+	if (dw->tile.record != 0) {
+
+		drawTileRecord(dw, DRAW_TILE_DOT, cb, &lcb, fxs, fys, 0., 0.,
+				ncol, rsize, round, 0);
+		return ;
+	}
+
+	drawTileBand(dw, &lcb);
+
 	if (round == 0) {
 
 		w1 = lcb.min_x * 16 - xs + 8;
@@ -3274,35 +3448,453 @@ void drawMarkCanvas(draw_t *dw, SDL_Surface *surface, clipBox_t *cb, double fxs,
 	}
 }
 
-void drawFlushCanvas(draw_t *dw, SDL_Surface *surface, clipBox_t *cb)
+static void
+drawResolveSolid(draw_t *dw, Uint32 *pixels, const Uint8 *canvas, int min_x, int max_x)
+{
+	Uint32			*palette = dw->palette;
+
+	int			x;
+	Uint8			nb;
+
+	for (x = min_x; x <= max_x; ++x) {
+
+		nb = *(canvas + x);
+
+		if (nb != 0) {
+
+			*(pixels + x) = palette[nb];
+		}
+	}
+}
+
+static void
+drawResolve4x(draw_t *dw, Uint32 *pixels, const Uint16 *canvas, int min_x, int max_x)
 {
-	Uint32			*pixels = (Uint32 *) surface->pixels;
 	Uint32			*palette = dw->palette;
 	Uint8			*ltgamma = dw->ltgamma;
 
-	int			pitch, x, y;
-	int			yspan, ncol, blend[3];
+	int			x, ncol, blend[3];
+	Uint16			nb;
+
+	union {
+
+		Uint32          l;
+		Uint8           b[4];
+	}
+	vcol;
+
+	for (x = min_x; x <= max_x; ++x) {
+
+		nb = *(canvas + x);
+
+		if (nb != 0) {
+
+			palette[0] = *(pixels + x);
+
+			ncol = (nb & 0x000FU) >> 0;
+			vcol.l = palette[ncol];
+
+			blend[0] = vcol.b[0];
+			blend[1] = vcol.b[1];
+			blend[2] = vcol.b[2];
+
+			ncol = (nb & 0x00F0U) >> 4;
+			vcol.l = palette[ncol];
+
+			blend[0] += vcol.b[0];
+			blend[1] += vcol.b[1];
+			blend[2] += vcol.b[2];
+
+			ncol = (nb & 0x0F00U) >> 8;
+			vcol.l = palette[ncol];
+
+			blend[0] += vcol.b[0];
+			blend[1] += vcol.b[1];
+			blend[2] += vcol.b[2];
+
+			ncol = (nb & 0xF000U) >> 12;
+			vcol.l = palette[ncol];
+
+			blend[0] += vcol.b[0];
+			blend[1] += vcol.b[1];
+			blend[2] += vcol.b[2];
+
+			vcol.b[0] = ltgamma[(blend[0] >> 2) & 0xFFU];
+			vcol.b[1] = ltgamma[(blend[1] >> 2) & 0xFFU];
+			vcol.b[2] = ltgamma[(blend[2] >> 2) & 0xFFU];
+			vcol.b[3] = 0;
+
+			*(pixels + x) = vcol.l;
+		}
+	}
+}
+
+static void
+drawResolve8x(draw_t *dw, Uint32 *pixels, const Uint16 *canvas, int min_x, int max_x)
+{
+	Uint32			*palette = dw->palette;
+	Uint8			*ltgamma = dw->ltgamma;
+
+	int			x, ncol, blend[3];
+	Uint16			nb[2];
+
+	union {
+
+		Uint32          l;
+		Uint8           b[4];
+	}
+	vcol;
+
+	for (x = min_x; x <= max_x; ++x) {
+
+		nb[0] = *(canvas + x * 2 + 0);
+		nb[1] = *(canvas + x * 2 + 1);
+
+		if (		   nb[0] != 0
+				|| nb[1] != 0) {
+
+			palette[0] = *(pixels + x);
+
+			ncol = (nb[0] & 0x000FU) >> 0;
+			vcol.l = palette[ncol];
+
+			blend[0] = vcol.b[0];
+			blend[1] = vcol.b[1];
+			blend[2] = vcol.b[2];
+
+			ncol = (nb[0] & 0x00F0U) >> 4;
+			vcol.l = palette[ncol];
+
+			blend[0] += vcol.b[0];
+			blend[1] += vcol.b[1];
+			blend[2] += vcol.b[2];
+
+			ncol = (nb[0] & 0x0F00U) >> 8;
+			vcol.l = palette[ncol];
+
+			blend[0] += vcol.b[0];
+			blend[1] += vcol.b[1];
+			blend[2] += vcol.b[2];
+
+			ncol = (nb[0] & 0xF000U) >> 12;
+			vcol.l = palette[ncol];
+
+			blend[0] += vcol.b[0];
+			blend[1] += vcol.b[1];
+			blend[2] += vcol.b[2];
+
+			ncol = (nb[1] & 0x000FU) >> 0;
+			vcol.l = palette[ncol];
+
+			blend[0] += vcol.b[0];
+			blend[1] += vcol.b[1];
+			blend[2] += vcol.b[2];
+
+			ncol = (nb[1] & 0x00F0U) >> 4;
+			vcol.l = palette[ncol];
+
+			blend[0] += vcol.b[0];
+			blend[1] += vcol.b[1];
+			blend[2] += vcol.b[2];
+
+			ncol = (nb[1] & 0x0F00U) >> 8;
+			vcol.l = palette[ncol];
+
+			blend[0] += vcol.b[0];
+			blend[1] += vcol.b[1];
+			blend[2] += vcol.b[2];
+
+			ncol = (nb[1] & 0xF000U) >> 12;
+			vcol.l = palette[ncol];
+
+			blend[0] += vcol.b[0];
+			blend[1] += vcol.b[1];
+			blend[2] += vcol.b[2];
+
+			vcol.b[0] = ltgamma[(blend[0] >> 3) & 0xFFU];
+			vcol.b[1] = ltgamma[(blend[1] >> 3) & 0xFFU];
+			vcol.b[2] = ltgamma[(blend[2] >> 3) & 0xFFU];
+			vcol.b[3] = 0;
+
+			*(pixels + x) = vcol.l;
+		}
+	}
+}
+
+#ifdef _DRAW_SIMD_X86
+static inline int __attribute__ ((target("sse2"), always_inline))
+drawSpanEmpty_SSE2(const void *canvas)
+{
+	__m128i			nb = _mm_loadu_si128((const __m128i *) canvas);
+
+	return (_mm_movemask_epi8(_mm_cmpeq_epi8(nb, _mm_setzero_si128())) == 0xFFFF) ? 1 : 0;
+}
+
+/* SSE2 has no gather nor byte shuffle to look up the palette so we only
+ * skip empty spans of 16 bytes and pass the rest to scalar code in runs.
+ * */
+static void __attribute__ ((target("sse2")))
+drawResolveSolid_SSE2(draw_t *dw, Uint32 *pixels, const Uint8 *canvas, int min_x, int max_x)
+{
+	int			x, xs;
+
+	x = min_x;
+
+	while (x + 15 <= max_x) {
+
+		if (drawSpanEmpty_SSE2(canvas + x) != 0) {
+
+			x += 16;
+			continue;
+		}
+
+		xs = x;
+
+		do { x += 16; }
+		while (x + 15 <= max_x && drawSpanEmpty_SSE2(canvas + x) == 0);
+
+		drawResolveSolid(dw, pixels, canvas, xs, x - 1);
+	}
+
+	drawResolveSolid(dw, pixels, canvas, x, max_x);
+}
+
+static void __attribute__ ((target("sse2")))
+drawResolve4x_SSE2(draw_t *dw, Uint32 *pixels, const Uint16 *canvas, int min_x, int max_x)
+{
+	int			x, xs;
+
+	x = min_x;
+
+	while (x + 7 <= max_x) {
+
+		if (drawSpanEmpty_SSE2(canvas + x) != 0) {
+
+			x += 8;
+			continue;
+		}
+
+		xs = x;
+
+		do { x += 8; }
+		while (x + 7 <= max_x && drawSpanEmpty_SSE2(canvas + x) == 0);
+
+		drawResolve4x(dw, pixels, canvas, xs, x - 1);
+	}
+
+	drawResolve4x(dw, pixels, canvas, x, max_x);
+}
+
+static void __attribute__ ((target("sse2")))
+drawResolve8x_SSE2(draw_t *dw, Uint32 *pixels, const Uint16 *canvas, int min_x, int max_x)
+{
+	int			x, xs;
+
+	x = min_x;
+
+	while (x + 3 <= max_x) {
+
+		if (drawSpanEmpty_SSE2(canvas + x * 2) != 0) {
+
+			x += 4;
+			continue;
+		}
+
+		xs = x;
+
+		do { x += 4; }
+		while (x + 3 <= max_x && drawSpanEmpty_SSE2(canvas + x * 2) == 0);
+
+		drawResolve8x(dw, pixels, canvas, xs, x - 1);
+	}
+
+	drawResolve8x(dw, pixels, canvas, x, max_x);
+}
+
+static void __attribute__ ((target("avx2")))
+drawResolveSolid_AVX2(draw_t *dw, Uint32 *pixels, const Uint8 *canvas, int min_x, int max_x)
+{
+	__m256i			zero = _mm256_setzero_si256();
+	int			x, k;
+
+	for (x = min_x; x + 31 <= max_x; x += 32) {
+
+		__m256i		nb = _mm256_loadu_si256((const __m256i *) (canvas + x));
+
+		if (_mm256_testz_si256(nb, nb) != 0)
+			continue;
+
+		for (k = x; k < x + 32; k += 8) {
+
+			__m256i		idx, col, dst;
+
+			idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (canvas + k)));
+
+			if (_mm256_testz_si256(idx, idx) != 0)
+				continue;
+
+			dst = _mm256_loadu_si256((const __m256i *) (pixels + k));
+			col = _mm256_i32gather_epi32((const int *) dw->palette, idx, 4);
+			col = _mm256_blendv_epi8(col, dst, _mm256_cmpeq_epi32(idx, zero));
+
+			_mm256_storeu_si256((__m256i *) (pixels + k), col);
+		}
+	}
+
+	drawResolveSolid(dw, pixels, canvas, x, max_x);
+}
+
+static inline __m256i __attribute__ ((target("avx2"), always_inline))
+drawResolveBlend_AVX2(draw_t *dw, __m256i nb, __m256i dst, int samples, int shift)
+{
+	__m256i			zero = _mm256_setzero_si256();
+	__m256i			mask_F = _mm256_set1_epi32(0x0F);
+	__m256i			mask_FF = _mm256_set1_epi32(0xFF);
+	__m256i			mask_RB = _mm256_set1_epi32(0x00FF00FF);
+	__m256i			idx, col, rb, g, r, b;
+
+	int			k;
+
+	rb = zero;
+	g = zero;
+
+	/* Sum of up to 8 samples fits into 16 bits so we accumulate red and
+	 * blue in the halves of one word.
+	 * */
+	for (k = 0; k < samples; ++k) {
+
+		idx = _mm256_and_si256(nb, mask_F);
+		nb = _mm256_srli_epi32(nb, 4);
+
+		col = _mm256_i32gather_epi32((const int *) dw->palette, idx, 4);
+		col = _mm256_blendv_epi8(col, dst, _mm256_cmpeq_epi32(idx, zero));
+
+		rb = _mm256_add_epi32(rb, _mm256_and_si256(col, mask_RB));
+		g = _mm256_add_epi32(g, _mm256_and_si256(_mm256_srli_epi32(col, 8), mask_FF));
+	}
+
+	b = _mm256_and_si256(_mm256_srl_epi32(rb, _mm_cvtsi32_si128(shift)), mask_FF);
+	r = _mm256_and_si256(_mm256_srl_epi32(rb, _mm_cvtsi32_si128(16 + shift)), mask_FF);
+	g = _mm256_and_si256(_mm256_srl_epi32(g, _mm_cvtsi32_si128(shift)), mask_FF);
+
+	/* Gather of 32-bit words from byte table reads up to three bytes
+	 * beyond \ltgamma that are within \ltcomap.
+	 * */
+	b = _mm256_and_si256(_mm256_i32gather_epi32((const int *) dw->ltgamma, b, 1), mask_FF);
+	g = _mm256_and_si256(_mm256_i32gather_epi32((const int *) dw->ltgamma, g, 1), mask_FF);
+	r = _mm256_and_si256(_mm256_i32gather_epi32((const int *) dw->ltgamma, r, 1), mask_FF);
+
+	return _mm256_or_si256(_mm256_or_si256(b, _mm256_slli_epi32(g, 8)),
+			_mm256_slli_epi32(r, 16));
+}
+
+static void __attribute__ ((target("avx2")))
+drawResolve4x_AVX2(draw_t *dw, Uint32 *pixels, const Uint16 *canvas, int min_x, int max_x)
+{
+	__m256i			zero = _mm256_setzero_si256();
+	int			x;
+
+	for (x = min_x; x + 7 <= max_x; x += 8) {
+
+		__m256i		nb, dst, col;
+
+		nb = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *) (canvas + x)));
+
+		if (_mm256_testz_si256(nb, nb) != 0)
+			continue;
+
+		dst = _mm256_loadu_si256((const __m256i *) (pixels + x));
+		col = drawResolveBlend_AVX2(dw, nb, dst, 4, 2);
+		col = _mm256_blendv_epi8(col, dst, _mm256_cmpeq_epi32(nb, zero));
+
+		_mm256_storeu_si256((__m256i *) (pixels + x), col);
+	}
+
+	drawResolve4x(dw, pixels, canvas, x, max_x);
+}
+
+static void __attribute__ ((target("avx2")))
+drawResolve8x_AVX2(draw_t *dw, Uint32 *pixels, const Uint16 *canvas, int min_x, int max_x)
+{
+	__m256i			zero = _mm256_setzero_si256();
+	int			x;
+
+	for (x = min_x; x + 7 <= max_x; x += 8) {
+
+		__m256i		nb, dst, col;
+
+		/* Two words of one pixel make 8 samples in 32-bit lane.
+		 * */
+		nb = _mm256_loadu_si256((const __m256i *) (canvas + x * 2));
+
+		if (_mm256_testz_si256(nb, nb) != 0)
+			continue;
+
+		dst = _mm256_loadu_si256((const __m256i *) (pixels + x));
+		col = drawResolveBlend_AVX2(dw, nb, dst, 8, 3);
+		col = _mm256_blendv_epi8(col, dst, _mm256_cmpeq_epi32(nb, zero));
+
+		_mm256_storeu_si256((__m256i *) (pixels + x), col);
+	}
+
+	drawResolve8x(dw, pixels, canvas, x, max_x);
+}
+#endif /* _DRAW_SIMD_X86 */
+
+int drawResolveAvail(int resolve)
+{
+	int		rc = 0;
+
+	if (resolve == DRAW_RESOLVE_SCALAR) {
+
+		rc = 1;
+	}
+#ifdef _DRAW_SIMD_X86
+	else if (resolve == DRAW_RESOLVE_SSE2) {
+
+		rc = (SDL_HasSSE2() == SDL_TRUE) ? 1 : 0;
+	}
+	else if (resolve == DRAW_RESOLVE_AVX2) {
+
+		rc = (SDL_HasAVX2() == SDL_TRUE) ? 1 : 0;
+	}
+#endif /* _DRAW_SIMD_X86 */
+
+	return rc;
+}
+
+static void
+drawFlushRows(draw_t *dw, SDL_Surface *surface, clipBox_t *cb)
+{
+	Uint32			*pixels = (Uint32 *) surface->pixels;
+
+	int			pitch, y, yspan;
 
 	pitch = surface->pitch / 4;
 	pixels += cb->min_y * pitch;
 
 	if (dw->antialiasing == DRAW_SOLID) {
 
-		Uint8		nb, *canvas = (Uint8 *) dw->pixmap.canvas;
+		Uint8		*canvas = (Uint8 *) dw->pixmap.canvas;
 
 		yspan = dw->pixmap.yspan;
 		canvas += cb->min_y * yspan;
 
 		for (y = cb->min_y; y <= cb->max_y; ++y) {
 
-			for (x = cb->min_x; x <= cb->max_x; ++x) {
+#ifdef _DRAW_SIMD_X86
+			if (dw->resolve == DRAW_RESOLVE_AVX2) {
 
-				nb = *(canvas + x);
-
-				if (nb != 0) {
+				drawResolveSolid_AVX2(dw, pixels, canvas, cb->min_x, cb->max_x);
+			}
+			else if (dw->resolve == DRAW_RESOLVE_SSE2) {
 
-					*(pixels + x) = palette[nb];
-				}
+				drawResolveSolid_SSE2(dw, pixels, canvas, cb->min_x, cb->max_x);
+			}
+			else
+#endif /* _DRAW_SIMD_X86 */
+			{
+				drawResolveSolid(dw, pixels, canvas, cb->min_x, cb->max_x);
 			}
 
 			pixels += pitch;
@@ -3311,163 +3903,521 @@ void drawFlushCanvas(draw_t *dw, SDL_Surface *surface, clipBox_t *cb)
 	}
 	else if (dw->antialiasing == DRAW_4X_MSAA) {
 
-		Uint16		nb, *canvas = (Uint16 *) dw->pixmap.canvas;
+		Uint16		*canvas = (Uint16 *) dw->pixmap.canvas;
+
+		yspan = dw->pixmap.yspan;
+		canvas += cb->min_y * yspan;
+
+		for (y = cb->min_y; y <= cb->max_y; ++y) {
+
+#ifdef _DRAW_SIMD_X86
+			if (dw->resolve == DRAW_RESOLVE_AVX2) {
+
+				drawResolve4x_AVX2(dw, pixels, canvas, cb->min_x, cb->max_x);
+			}
+			else if (dw->resolve == DRAW_RESOLVE_SSE2) {
 
-		union {
+				drawResolve4x_SSE2(dw, pixels, canvas, cb->min_x, cb->max_x);
+			}
+			else
+#endif /* _DRAW_SIMD_X86 */
+			{
+				drawResolve4x(dw, pixels, canvas, cb->min_x, cb->max_x);
+			}
 
-			Uint32          l;
-			Uint8           b[4];
+			pixels += pitch;
+			canvas += yspan;
 		}
-		vcol;
+	}
+	else if (dw->antialiasing == DRAW_8X_MSAA) {
 
-		yspan = dw->pixmap.yspan;
+		Uint16		*canvas = (Uint16 *) dw->pixmap.canvas;
+
+		yspan = dw->pixmap.yspan * 2;
 		canvas += cb->min_y * yspan;
 
 		for (y = cb->min_y; y <= cb->max_y; ++y) {
 
-			for (x = cb->min_x; x <= cb->max_x; ++x) {
+#ifdef _DRAW_SIMD_X86
+			if (dw->resolve == DRAW_RESOLVE_AVX2) {
 
-				nb = *(canvas + x);
+				drawResolve8x_AVX2(dw, pixels, canvas, cb->min_x, cb->max_x);
+			}
+			else if (dw->resolve == DRAW_RESOLVE_SSE2) {
 
-				if (nb != 0) {
+				drawResolve8x_SSE2(dw, pixels, canvas, cb->min_x, cb->max_x);
+			}
+			else
+#endif /* _DRAW_SIMD_X86 */
+			{
+				drawResolve8x(dw, pixels, canvas, cb->min_x, cb->max_x);
+			}
 
-					palette[0] = *(pixels + x);
+			pixels += pitch;
+			canvas += yspan;
+		}
+	}
+}
 
-					ncol = (nb & 0x000FU) >> 0;
-					vcol.l = palette[ncol];
+static void
+drawTileClear(draw_t *dw, int min_y, int max_y)
+{
+	char		*canvas = (char *) dw->pixmap.canvas;
+	int		yspan;
 
-					blend[0] = vcol.b[0];
-					blend[1] = vcol.b[1];
-					blend[2] = vcol.b[2];
+	yspan = dw->pixmap.yspan;
 
-					ncol = (nb & 0x00F0U) >> 4;
-					vcol.l = palette[ncol];
+	if (dw->antialiasing == DRAW_4X_MSAA) {
 
-					blend[0] += vcol.b[0];
-					blend[1] += vcol.b[1];
-					blend[2] += vcol.b[2];
+		yspan *= 2;
+	}
+	else if (dw->antialiasing == DRAW_8X_MSAA) {
 
-					ncol = (nb & 0x0F00U) >> 8;
-					vcol.l = palette[ncol];
+		yspan *= 4;
+	}
 
-					blend[0] += vcol.b[0];
-					blend[1] += vcol.b[1];
-					blend[2] += vcol.b[2];
+	memset(canvas + min_y * yspan, 0, (max_y - min_y + 1) * yspan);
+}
 
-					ncol = (nb & 0xF000U) >> 12;
-					vcol.l = palette[ncol];
+static void
+drawTileRun(draw_t *dw, int tN)
+{
+	SDL_Surface		surface;
+	drawTileCmd_t		*tc;
+	clipBox_t		cb;
 
-					blend[0] += vcol.b[0];
-					blend[1] += vcol.b[1];
-					blend[2] += vcol.b[2];
+	int			N;
 
-					vcol.b[0] = ltgamma[(blend[0] >> 2) & 0xFFU];
-					vcol.b[1] = ltgamma[(blend[1] >> 2) & 0xFFU];
-					vcol.b[2] = ltgamma[(blend[2] >> 2) & 0xFFU];
-					vcol.b[3] = 0;
+	/* Replay commands into the canvas is done on the copy of surface
+	 * that does not refer to SVG so it was written once when recorded.
+	 * */
+	surface = *dw->tile.surface;
+	surface.userdata = NULL;
 
-					*(pixels + x) = vcol.l;
-				}
-			}
+	cb = dw->tile.viewport;
 
-			pixels += pitch;
-			canvas += yspan;
+	cb.min_y = dw->tile.viewport.min_y + tN * dw->tile.tile_H;
+	cb.max_y = cb.min_y + dw->tile.tile_H - 1;
+	cb.max_y = (cb.max_y > dw->tile.viewport.max_y) ? dw->tile.viewport.max_y : cb.max_y;
+
+	dw->tile.record = 0;
+	dw->tile.banded = 1;
+	dw->tile.band_min_y = cb.min_y;
+	dw->tile.band_max_y = cb.max_y;
+
+	drawTileClear(dw, cb.min_y, cb.max_y);
+
+	for (N = dw->tile.bin_ofs[tN]; N < dw->tile.bin_ofs[tN + 1]; ++N) {
+
+		tc = &dw->tile.cmd[dw->tile.bin[N]];
+
+		if (tc->cmd == DRAW_TILE_LINE) {
+
+			drawLineCanvas(dw, &surface, &tc->cb, tc->fxs, tc->fys,
+					tc->fxe, tc->fye, tc->ncol, tc->thickness);
+		}
+		else if (tc->cmd == DRAW_TILE_DASH) {
+
+			dw->dash_context = tc->context;
+
+			drawDashCanvas(dw, &surface, &tc->cb, tc->fxs, tc->fys,
+					tc->fxe, tc->fye, tc->ncol, tc->thickness,
+					tc->dash, tc->space);
+		}
+		else if (tc->cmd == DRAW_TILE_DOT) {
+
+			drawDotCanvas(dw, &surface, &tc->cb, tc->fxs, tc->fys,
+					tc->thickness, tc->ncol, tc->dash);
 		}
 	}
-	else if (dw->antialiasing == DRAW_8X_MSAA) {
 
-		Uint16		nb[2], *canvas = (Uint16 *) dw->pixmap.canvas;
+	drawFlushRows(dw, dw->tile.surface, &cb);
+}
+
+static int
+drawTileTake(draw_t *dw, draw_t *local, int *tN, int gen)
+{
+	int		rc = 0;
 
-		union {
+	SDL_LockMutex(dw->tile.mutex);
 
-			Uint32          l;
-			Uint8           b[4];
+	if (*tN >= 0) {
+
+		dw->tile.tile_done += 1;
+
+		if (dw->tile.tile_done >= dw->tile.tile_N) {
+
+			SDL_CondSignal(dw->tile.done);
 		}
-		vcol;
+	}
 
-		yspan = dw->pixmap.yspan * 2;
-		canvas += cb->min_y * yspan;
+	/* Worker that wakes up late must not take the tiles of another
+	 * generation as its copy of draw_t would be out of date.
+	 * */
+	if (		dw->tile.gen == gen
+			&& dw->tile.tile_next < dw->tile.tile_N) {
 
-		for (y = cb->min_y; y <= cb->max_y; ++y) {
+		if (*tN < 0) {
 
-			for (x = cb->min_x; x <= cb->max_x; ++x) {
+			/* Take the copy of draw_t under the lock as UI thread
+			 * does not modify it until all tiles are done.
+			 * */
+			*local = *dw;
+		}
 
-				nb[0] = *(canvas + x * 2 + 0);
-				nb[1] = *(canvas + x * 2 + 1);
+		*tN = dw->tile.tile_next++;
+		rc = 1;
+	}
 
-				if (		   nb[0] != 0
-						|| nb[1] != 0) {
+	SDL_UnlockMutex(dw->tile.mutex);
 
-					palette[0] = *(pixels + x);
+	return rc;
+}
 
-					ncol = (nb[0] & 0x000FU) >> 0;
-					vcol.l = palette[ncol];
+static int
+drawTileThread(void *arg)
+{
+	draw_t		*dw = (draw_t *) arg;
+	draw_t		*local;
 
-					blend[0] = vcol.b[0];
-					blend[1] = vcol.b[1];
-					blend[2] = vcol.b[2];
+	int		gen = 0, stop, tN;
 
-					ncol = (nb[0] & 0x00F0U) >> 4;
-					vcol.l = palette[ncol];
+	local = (draw_t *) malloc(sizeof(draw_t));
 
-					blend[0] += vcol.b[0];
-					blend[1] += vcol.b[1];
-					blend[2] += vcol.b[2];
+	if (local == NULL) {
 
-					ncol = (nb[0] & 0x0F00U) >> 8;
-					vcol.l = palette[ncol];
+		ERROR("No memory allocated for tile worker\n");
+		return 0;
+	}
 
-					blend[0] += vcol.b[0];
-					blend[1] += vcol.b[1];
-					blend[2] += vcol.b[2];
+	do {
+		SDL_LockMutex(dw->tile.mutex);
 
-					ncol = (nb[0] & 0xF000U) >> 12;
-					vcol.l = palette[ncol];
+		while (		dw->tile.gen == gen
+				&& dw->tile.stop == 0) {
 
-					blend[0] += vcol.b[0];
-					blend[1] += vcol.b[1];
-					blend[2] += vcol.b[2];
+			SDL_CondWait(dw->tile.cond, dw->tile.mutex);
+		}
 
-					ncol = (nb[1] & 0x000FU) >> 0;
-					vcol.l = palette[ncol];
+		gen = dw->tile.gen;
+		stop = dw->tile.stop;
 
-					blend[0] += vcol.b[0];
-					blend[1] += vcol.b[1];
-					blend[2] += vcol.b[2];
+		SDL_UnlockMutex(dw->tile.mutex);
 
-					ncol = (nb[1] & 0x00F0U) >> 4;
-					vcol.l = palette[ncol];
+		if (stop != 0)
+			break;
 
-					blend[0] += vcol.b[0];
-					blend[1] += vcol.b[1];
-					blend[2] += vcol.b[2];
+		tN = -1;
 
-					ncol = (nb[1] & 0x0F00U) >> 8;
-					vcol.l = palette[ncol];
+		while (drawTileTake(dw, local, &tN, gen) != 0) {
 
-					blend[0] += vcol.b[0];
-					blend[1] += vcol.b[1];
-					blend[2] += vcol.b[2];
+			drawTileRun(local, tN);
+		}
+	}
+	while (1);
 
-					ncol = (nb[1] & 0xF000U) >> 12;
-					vcol.l = palette[ncol];
+	free(local);
 
-					blend[0] += vcol.b[0];
-					blend[1] += vcol.b[1];
-					blend[2] += vcol.b[2];
+	return 0;
+}
 
-					vcol.b[0] = ltgamma[(blend[0] >> 3) & 0xFFU];
-					vcol.b[1] = ltgamma[(blend[1] >> 3) & 0xFFU];
-					vcol.b[2] = ltgamma[(blend[2] >> 3) & 0xFFU];
-					vcol.b[3] = 0;
+static void
+drawTileStart(draw_t *dw)
+{
+	int		N;
 
-					*(pixels + x) = vcol.l;
-				}
+	dw->tile.started = 1;
+
+	dw->tile.mutex = SDL_CreateMutex();
+	dw->tile.cond = SDL_CreateCond();
+	dw->tile.done = SDL_CreateCond();
+
+	if (		dw->tile.mutex == NULL
+			|| dw->tile.cond == NULL
+			|| dw->tile.done == NULL) {
+
+		ERROR("Unable to create tile worker sync \"%s\"\n", SDL_GetError());
+		return ;
+	}
+
+	N = ((dw->threads > 0) ? dw->threads : SDL_GetCPUCount()) - 1;
+	N = (N < 0) ? 0 : (N > DRAW_TILE_THREAD_MAX) ? DRAW_TILE_THREAD_MAX : N;
+
+	for (dw->tile.thread_N = 0; dw->tile.thread_N < N; ++dw->tile.thread_N) {
+
+		dw->tile.thread[dw->tile.thread_N] = SDL_CreateThread(
+				&drawTileThread, "drawTile", dw);
+
+		if (dw->tile.thread[dw->tile.thread_N] == NULL) {
+
+			ERROR("SDL_CreateThread: \"%s\"\n", SDL_GetError());
+			break;
+		}
+	}
+}
+
+static int
+drawTileBin(draw_t *dw, clipBox_t *cb)
+{
+	drawTileCmd_t		*tc;
+
+	int			N, tN, tMIN, tMAX, len, tile_N, *ptr;
+
+	/* We take a few tiles per thread to balance the load but not too
+	 * thin as the segment geometry is built again in each tile.
+	 * */
+	len = cb->max_y - cb->min_y + 1;
+
+	dw->tile.tile_H = (len + (dw->tile.thread_N + 1) * 4 - 1)
+		/ ((dw->tile.thread_N + 1) * 4);
+	dw->tile.tile_H = (dw->tile.tile_H < DRAW_TILE_HEIGHT)
+		? DRAW_TILE_HEIGHT : dw->tile.tile_H;
+
+	tile_N = (len + dw->tile.tile_H - 1) / dw->tile.tile_H;
+
+	if (tile_N + 1 > dw->tile.bin_ofs_MAX) {
+
+		ptr = (int *) realloc(dw->tile.bin_ofs, sizeof(int) * (tile_N + 1));
+
+		if (ptr == NULL) {
+
+			ERROR("No memory allocated for tile bins\n");
+			return -1;
+		}
+
+		dw->tile.bin_ofs = ptr;
+		dw->tile.bin_ofs_MAX = tile_N + 1;
+	}
+
+	memset(dw->tile.bin_ofs, 0, sizeof(int) * (tile_N + 1));
+
+	/* Count the commands of each tile then place the indices into the
+	 * bins with order of recording kept.
+	 * */
+	for (N = 0; N < dw->tile.cmd_N; ++N) {
+
+		tc = &dw->tile.cmd[N];
+
+		tMIN = (tc->min_y - cb->min_y) / dw->tile.tile_H;
+		tMAX = (tc->max_y - cb->min_y) / dw->tile.tile_H;
+
+		tMIN = (tc->min_y < cb->min_y) ? 0 : tMIN;
+		tMAX = (tMAX > tile_N - 1) ? tile_N - 1 : tMAX;
+
+		for (tN = tMIN; tN <= tMAX && tc->max_y >= cb->min_y; ++tN) {
+
+			dw->tile.bin_ofs[tN + 1] += 1;
+		}
+	}
+
+	for (tN = 0; tN < tile_N; ++tN) {
+
+		dw->tile.bin_ofs[tN + 1] += dw->tile.bin_ofs[tN];
+	}
+
+	len = dw->tile.bin_ofs[tile_N];
+
+	if (len > dw->tile.bin_MAX) {
+
+		ptr = (int *) realloc(dw->tile.bin, sizeof(int) * (len + 4096));
+
+		if (ptr == NULL) {
+
+			ERROR("No memory allocated for tile bins\n");
+			return -1;
+		}
+
+		dw->tile.bin = ptr;
+		dw->tile.bin_MAX = len + 4096;
+	}
+
+	for (N = 0; N < dw->tile.cmd_N; ++N) {
+
+		tc = &dw->tile.cmd[N];
+
+		tMIN = (tc->min_y - cb->min_y) / dw->tile.tile_H;
+		tMAX = (tc->max_y - cb->min_y) / dw->tile.tile_H;
+
+		tMIN = (tc->min_y < cb->min_y) ? 0 : tMIN;
+		tMAX = (tMAX > tile_N - 1) ? tile_N - 1 : tMAX;
+
+		for (tN = tMIN; tN <= tMAX && tc->max_y >= cb->min_y; ++tN) {
+
+			dw->tile.bin[dw->tile.bin_ofs[tN]++] = N;
+		}
+	}
+
+	/* Offsets were moved to the end of bins so shift them back.
+	 * */
+	for (tN = tile_N; tN > 0; --tN) {
+
+		dw->tile.bin_ofs[tN] = dw->tile.bin_ofs[tN - 1];
+	}
+
+	dw->tile.bin_ofs[0] = 0;
+
+	return tile_N;
+}
+
+static void
+drawTileFlush(draw_t *dw, SDL_Surface *surface, clipBox_t *cb)
+{
+	draw_t		*local;
+	int		tN, tile_N;
+
+	if (dw->tile.started == 0) {
+
+		drawTileStart(dw);
+	}
+
+	if (dw->tile.thread_N > 0) {
+
+		/* Bins are rebuilt below so no tile can be taken until they
+		 * are published again under the lock.
+		 * */
+		SDL_LockMutex(dw->tile.mutex);
+
+		dw->tile.tile_N = 0;
+		dw->tile.tile_next = 0;
+
+		SDL_UnlockMutex(dw->tile.mutex);
+	}
+
+	tile_N = (cb->min_y <= cb->max_y) ? drawTileBin(dw, cb) : -1;
+
+	dw->tile.record = 0;
+
+	if (tile_N < 0)
+		return ;
+
+	dw->tile.surface = surface;
+	dw->tile.viewport = *cb;
+
+	if (dw->tile.thread_N < 1) {
+
+		dw->tile.tile_N = tile_N;
+
+		/* No workers so we run all the tiles ourselves.
+		 * */
+		local = (draw_t *) malloc(sizeof(draw_t));
+
+		if (local != NULL) {
+
+			for (tN = 0; tN < dw->tile.tile_N; ++tN) {
+
+				*local = *dw;
+
+				drawTileRun(local, tN);
 			}
 
-			pixels += pitch;
-			canvas += yspan;
+			free(local);
 		}
+
+		return ;
+	}
+
+	local = (draw_t *) malloc(sizeof(draw_t));
+
+	if (local == NULL) {
+
+		ERROR("No memory allocated for tile worker\n");
+		return ;
 	}
+
+	SDL_LockMutex(dw->tile.mutex);
+
+	dw->tile.tile_N = tile_N;
+	dw->tile.tile_next = 0;
+	dw->tile.tile_done = 0;
+	dw->tile.gen += 1;
+
+	SDL_CondBroadcast(dw->tile.cond);
+	SDL_UnlockMutex(dw->tile.mutex);
+
+	/* UI thread takes the tiles too.
+	 * */
+	tN = -1;
+
+	while (drawTileTake(dw, local, &tN, dw->tile.gen) != 0) {
+
+		drawTileRun(local, tN);
+	}
+
+	SDL_LockMutex(dw->tile.mutex);
+
+	while (dw->tile.tile_done < dw->tile.tile_N) {
+
+		SDL_CondWait(dw->tile.done, dw->tile.mutex);
+	}
+
+	SDL_UnlockMutex(dw->tile.mutex);
+
+	free(local);
+}
+
+static void
+drawResolveSelect(draw_t *dw)
+{
+	if (		dw->resolve == DRAW_RESOLVE_AUTO
+			|| drawResolveAvail(dw->resolve) == 0) {
+
+		dw->resolve = (drawResolveAvail(DRAW_RESOLVE_AVX2) != 0) ? DRAW_RESOLVE_AVX2
+			: (drawResolveAvail(DRAW_RESOLVE_SSE2) != 0) ? DRAW_RESOLVE_SSE2
+			: DRAW_RESOLVE_SCALAR;
+	}
+}
+
+void drawFlushCanvas(draw_t *dw, SDL_Surface *surface, clipBox_t *cb)
+{
+	drawResolveSelect(dw);
+
+	if (dw->tile.record != 0) {
+
+		drawTileFlush(dw, surface, cb);
+	}
+	else {
+		drawFlushRows(dw, surface, cb);
+	}
+}
+
+void drawLayerSave(draw_t *dw)
+{
+	void		*canvas;
+
+	/* Flushed canvas becomes the layer and the previous layer buffer is
+	 * taken as the canvas to be cleared.
+	 * */
+	canvas = dw->pixmap.canvas;
+
+	dw->pixmap.canvas = dw->pixmap.layer;
+	dw->pixmap.layer = canvas;
+}
+
+void drawLayerRestore(draw_t *dw)
+{
+	void		*canvas;
+
+	canvas = dw->pixmap.canvas;
+
+	dw->pixmap.canvas = dw->pixmap.layer;
+	dw->pixmap.layer = canvas;
+
+	/* We draw over the layer content directly as tiles would clear it.
+	 * */
+	dw->tile.record = 0;
+}
+
+void drawLayerFlush(draw_t *dw, SDL_Surface *surface, clipBox_t *cb)
+{
+	void		*canvas;
+
+	drawResolveSelect(dw);
+
+	canvas = dw->pixmap.canvas;
+	dw->pixmap.canvas = dw->pixmap.layer;
+
+	drawFlushRows(dw, surface, cb);
+
+	dw->pixmap.canvas = canvas;
 }
 
@@ -46,6 +46,22 @@ enum {
 	DRAW_8X_MSAA,
 };
 
+enum {
+	DRAW_RESOLVE_AUTO	= 0,
+	DRAW_RESOLVE_SCALAR,
+	DRAW_RESOLVE_SSE2,
+	DRAW_RESOLVE_AVX2
+};
+
+#define DRAW_TILE_HEIGHT	32
+#define DRAW_TILE_THREAD_MAX	16
+
+enum {
+	DRAW_TILE_LINE		= 0,
+	DRAW_TILE_DASH,
+	DRAW_TILE_DOT
+};
+
 typedef struct {
 
 	int		min_x;
@@ -55,6 +71,28 @@ typedef struct {
 }
 clipBox_t;
 
+typedef struct {
+
+	int		cmd;
+
+	double		fxs;
+	double		fys;
+	double		fxe;
+	double		fye;
+
+	int		ncol;
+	int		thickness;
+	int		dash;
+	int		space;
+	int		context;
+
+	clipBox_t	cb;
+
+	int		min_y;
+	int		max_y;
+}
+drawTileCmd_t;
+
 typedef struct {
 
 	int		antialiasing;
@@ -79,12 +117,69 @@ typedef struct {
 
 		void	*canvas;
 		void	*trial;
+
+		/* Persistent layer of canvas format that is kept between
+		 * frames and resolved again without rasterisation.
+		 * */
+		void	*layer;
 	}
 	pixmap;
 
 	Uint32		palette[16];
 	Uint8		ltgamma[256];
 	Uint8		ltcomap[256];
+
+	int		resolve;
+	int		tiled;
+
+	/* Number of threads that take the tiles including the UI thread or
+	 * zero to have one per CPU.
+	 * */
+	int		threads;
+
+	/* Canvas functions record the commands between clear and flush of
+	 * the canvas in tiled mode. Then the viewport is split into bands of
+	 * rows and each band is rasterised and resolved by worker thread.
+	 * Worker takes its own copy of draw_t with \banded set so canvas
+	 * functions clip the rows to the band after the geometry was built
+	 * in the same way as in serial mode.
+	 * */
+	struct {
+
+		SDL_Thread	*thread[DRAW_TILE_THREAD_MAX];
+		int		thread_N;
+		int		started;
+
+		SDL_mutex	*mutex;
+		SDL_cond	*cond;
+		SDL_cond	*done;
+
+		int		record;
+		int		stop;
+		int		gen;
+
+		drawTileCmd_t	*cmd;
+		int		cmd_N;
+		int		cmd_MAX;
+
+		int		*bin;
+		int		bin_MAX;
+		int		*bin_ofs;
+		int		bin_ofs_MAX;
+
+		int		tile_H;
+		int		tile_N;
+		int		tile_next;
+		int		tile_done;
+
+		SDL_Surface	*surface;
+		clipBox_t	viewport;
+
+		int		banded;
+		int		band_min_y;
+		int		band_max_y;
+	}
+	tile;
 }
 draw_t;
 
@@ -135,7 +230,12 @@ int drawDotTrial(draw_t *dw, clipBox_t *cb, double fxs, double fys,
 void drawMarkCanvas(draw_t *dw, SDL_Surface *surface, clipBox_t *cb, double fxs, double fys,
 		int rsize, int shape, int ncol, int thickness);
 
+int drawResolveAvail(int resolve);
 void drawFlushCanvas(draw_t *dw, SDL_Surface *surface, clipBox_t *cb);
 
+void drawLayerSave(draw_t *dw);
+void drawLayerRestore(draw_t *dw);
+void drawLayerFlush(draw_t *dw, SDL_Surface *surface, clipBox_t *cb);
+
 #endif /* _H_DRAW_ */
 
@@ -0,0 +1,331 @@
+/*
+   Graph Plotter is a tool to analyse numerical data.
+   Copyright (C) 2023 Roman Belov <romblv@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include <SDL2/SDL.h>
+
+#include "draw.h"
+#include "plot.h"
+
+#define BENCH_WIDTH		1600
+#define BENCH_HEIGHT		1000
+#define BENCH_FIGURE		8
+
+/* Draw benchmark renders dense figures into the offscreen surface with
+ * serial and tiled canvas. It reports the frame time and checks that the
+ * tiled output is identical to the serial one. Then the canvas resolve
+ * kernels are timed against the scalar one.
+ * */
+typedef struct {
+
+	draw_t		*dw;
+	SDL_Surface	*surface;
+	clipBox_t	viewport;
+
+	int		length_N;
+	double		*fY[BENCH_FIGURE];
+
+	Uint32		*reference;
+}
+bench_t;
+
+static void
+benchData(bench_t *b)
+{
+	unsigned int	lcg = 1;
+	double		fY, fU;
+	int		N, rN;
+
+	for (N = 0; N < BENCH_FIGURE; ++N) {
+
+		b->fY[N] = (double *) malloc(sizeof(double) * b->length_N);
+
+		if (b->fY[N] == NULL) {
+
+			ERROR("No memory allocated for bench data\n");
+			exit(1);
+		}
+
+		fY = (b->viewport.min_y + b->viewport.max_y) / 2.;
+
+		for (rN = 0; rN < b->length_N; ++rN) {
+
+			lcg = lcg * 1664525U + 1013904223U;
+			fU = (double) (lcg >> 8) / 16777216. - .5;
+
+			fY += fU * 40.;
+			fY = (fY < b->viewport.min_y - 20) ? b->viewport.min_y - 20 : fY;
+			fY = (fY > b->viewport.max_y + 20) ? b->viewport.max_y + 20 : fY;
+
+			b->fY[N][rN] = fY + 20. * sin(rN * (N + 1) * 1E-3);
+		}
+	}
+}
+
+static void
+benchFrame(bench_t *b)
+{
+	draw_t		*dw = b->dw;
+	double		fX, fXs, fYs, kX;
+	int		N, rN;
+
+	drawClearSurface(dw, b->surface, 0x101010);
+	drawClearCanvas(dw);
+
+	kX = (double) (b->viewport.max_x - b->viewport.min_x) / (b->length_N - 1);
+
+	for (N = 0; N < BENCH_FIGURE; ++N) {
+
+		drawDashReset(dw);
+
+		fXs = b->viewport.min_x;
+		fYs = b->fY[N][0];
+
+		for (rN = 1; rN < b->length_N; ++rN) {
+
+			fX = b->viewport.min_x + rN * kX;
+
+			if (N < BENCH_FIGURE - 2) {
+
+				drawLineCanvas(dw, b->surface, &b->viewport, fXs, fYs,
+						fX, b->fY[N][rN], N + 1, dw->thickness);
+			}
+			else if (N < BENCH_FIGURE - 1) {
+
+				drawDashCanvas(dw, b->surface, &b->viewport, fXs, fYs,
+						fX, b->fY[N][rN], N + 1, dw->thickness, 8, 8);
+			}
+			else {
+				drawDotCanvas(dw, b->surface, &b->viewport, fX,
+						b->fY[N][rN], 4, N + 1, rN & 1);
+			}
+
+			fXs = fX;
+			fYs = b->fY[N][rN];
+		}
+	}
+
+	SDL_LockSurface(b->surface);
+
+	drawFlushCanvas(dw, b->surface, &b->viewport);
+
+	SDL_UnlockSurface(b->surface);
+}
+
+static int
+benchRun(bench_t *b, int antialiasing, int tiled, int frames)
+{
+	const char	*ls_aa[] = { "Solid", "4x MSAA", "8x MSAA" };
+
+	draw_t		*dw = b->dw;
+	Uint64		tick, freq, tmin = 0, tsum = 0;
+	int		N, rc = 0;
+
+	dw->antialiasing = antialiasing;
+	dw->tiled = tiled;
+
+	dw->palette[0] = drawRGBMap(dw, 0x101010);
+
+	for (N = 1; N < 16; ++N) {
+
+		dw->palette[N] = drawRGBMap(dw, 0x3050A0 + N * 0x1B3D27);
+	}
+
+	drawPixmapAlloc(dw, b->surface);
+
+	freq = SDL_GetPerformanceFrequency();
+
+	for (N = 0; N < frames; ++N) {
+
+		tick = SDL_GetPerformanceCounter();
+
+		benchFrame(b);
+
+		tick = SDL_GetPerformanceCounter() - tick;
+
+		tsum += tick;
+		tmin = (N == 0 || tick < tmin) ? tick : tmin;
+	}
+
+	if (tiled == 0) {
+
+		memcpy(b->reference, b->surface->pixels, b->surface->pitch * b->surface->h);
+	}
+	else {
+		rc = memcmp(b->reference, b->surface->pixels, b->surface->pitch * b->surface->h);
+	}
+
+	printf("%-8s %-6s avg %7.2f (ms) min %7.2f (ms) %s\n", ls_aa[antialiasing],
+			(tiled != 0) ? "tiled" : "serial",
+			(double) tsum * 1000. / (double) (freq * frames),
+			(double) tmin * 1000. / (double) freq,
+			(tiled == 0) ? "" : (rc == 0) ? "identical" : "MISMATCH");
+
+	return rc;
+}
+
+static int
+benchResolve(bench_t *b, int antialiasing, int frames)
+{
+	const char	*ls_aa[] = { "Solid", "4x MSAA", "8x MSAA" };
+	const char	*ls_resolve[] = { "", "scalar", "SSE2", "AVX2" };
+
+	draw_t		*dw = b->dw;
+	Uint64		tick, freq, tscalar = 0, tmin;
+	int		N, resolve, rc = 0;
+
+	dw->antialiasing = antialiasing;
+	dw->tiled = 0;
+	dw->resolve = DRAW_RESOLVE_SCALAR;
+
+	dw->palette[0] = drawRGBMap(dw, 0x101010);
+
+	for (N = 1; N < 16; ++N) {
+
+		dw->palette[N] = drawRGBMap(dw, 0x3050A0 + N * 0x1B3D27);
+	}
+
+	drawPixmapAlloc(dw, b->surface);
+
+	/* The canvas is kept after flush so we resolve it many times onto
+	 * the same background.
+	 * */
+	benchFrame(b);
+
+	memcpy(b->reference, b->surface->pixels, b->surface->pitch * b->surface->h);
+
+	freq = SDL_GetPerformanceFrequency();
+
+	for (resolve = DRAW_RESOLVE_SCALAR; resolve <= DRAW_RESOLVE_AVX2; ++resolve) {
+
+		if (drawResolveAvail(resolve) == 0)
+			continue;
+
+		dw->resolve = resolve;
+		tmin = 0;
+
+		for (N = 0; N < frames; ++N) {
+
+			drawClearSurface(dw, b->surface, 0x101010);
+
+			tick = SDL_GetPerformanceCounter();
+
+			drawFlushCanvas(dw, b->surface, &b->viewport);
+
+			tick = SDL_GetPerformanceCounter() - tick;
+			tmin = (N == 0 || tick < tmin) ? tick : tmin;
+		}
+
+		tscalar = (resolve == DRAW_RESOLVE_SCALAR) ? tmin : tscalar;
+
+		N = memcmp(b->reference, b->surface->pixels, b->surface->pitch * b->surface->h);
+		rc |= N;
+
+		printf("%-8s %-6s resolve %7.3f (ms) %5.1fx %s\n", ls_aa[antialiasing],
+				ls_resolve[resolve], (double) tmin * 1000. / (double) freq,
+				(double) tscalar / (double) tmin,
+				(N == 0) ? "identical" : "MISMATCH");
+	}
+
+	dw->resolve = DRAW_RESOLVE_AUTO;
+
+	return rc;
+}
+
+int main(int argn, char *argv[])
+{
+	bench_t		b;
+	int		N, frames = 10, threads = 0, failed = 0;
+
+	memset(&b, 0, sizeof(b));
+
+	b.length_N = (argn >= 2) ? atoi(argv[1]) : 100000;
+	frames = (argn >= 3) ? atoi(argv[2]) : frames;
+	threads = (argn >= 4) ? atoi(argv[3]) : threads;
+
+	b.length_N = (b.length_N < 2) ? 2 : b.length_N;
+	frames = (frames < 1) ? 1 : frames;
+
+	b.dw = (draw_t *) calloc(1, sizeof(draw_t));
+	b.surface = SDL_CreateRGBSurfaceWithFormat(0, BENCH_WIDTH,
+			BENCH_HEIGHT, 32, SDL_PIXELFORMAT_XRGB8888);
+
+	if (b.dw == NULL || b.surface == NULL) {
+
+		ERROR("Unable to allocate the bench surface\n");
+		return 1;
+	}
+
+	b.reference = (Uint32 *) malloc(b.surface->pitch * b.surface->h);
+
+	if (b.reference == NULL) {
+
+		ERROR("No memory allocated for reference surface\n");
+		return 1;
+	}
+
+	b.viewport.min_x = 40;
+	b.viewport.min_y = 30;
+	b.viewport.max_x = BENCH_WIDTH - 41;
+	b.viewport.max_y = BENCH_HEIGHT - 31;
+
+	/* Number of threads can be forced to test the workers on host with
+	 * a single CPU.
+	 * */
+	b.dw->threads = (threads < 0) ? 0 : threads;
+	b.dw->thickness = 1;
+	b.dw->gamma = 50;
+
+	drawGamma(b.dw);
+	benchData(&b);
+
+	printf("%i figures of %i points on %ix%i with %i CPU and %i threads\n",
+			BENCH_FIGURE, b.length_N, BENCH_WIDTH, BENCH_HEIGHT,
+			SDL_GetCPUCount(), (b.dw->threads > 0) ? b.dw->threads
+			: SDL_GetCPUCount());
+
+	for (N = DRAW_SOLID; N <= DRAW_8X_MSAA; ++N) {
+
+		benchRun(&b, N, 0, frames);
+		failed |= benchRun(&b, N, 1, frames);
+	}
+
+	for (N = DRAW_SOLID; N <= DRAW_8X_MSAA; ++N) {
+
+		failed |= benchResolve(&b, N, frames * 10);
+	}
+
+	drawPixmapClean(b.dw);
+
+	for (N = 0; N < BENCH_FIGURE; ++N) {
+
+		free(b.fY[N]);
+	}
+
+	free(b.reference);
+	free(b.dw);
+
+	SDL_FreeSurface(b.surface);
+
+	return (failed != 0) ? 1 : 0;
+}
+
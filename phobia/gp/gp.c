@@ -87,6 +87,7 @@ struct gp_struct {
 	int		active;
 	int		unfinished;
 	int		drawn;
+	int		taken;
 
 	int		clock;
 	int		idled;
@@ -275,6 +276,8 @@ gpDefaultFile(gp_t *gp)
 				"colorscheme 0\n"
 				"antialiasing 1\n"
 				"blendfont 1\n"
+				"tiled 1\n"
+				"threads 0\n"
 				"thickness 1\n"
 				"gamma 50\n"
 				"drawing line 2\n"
@@ -331,6 +334,8 @@ gpWriteFile(gp_t *gp)
 		fprintf(fd, "colorscheme %i\n", rd->colorscheme);
 		fprintf(fd, "antialiasing %i\n", dw->antialiasing);
 		fprintf(fd, "blendfont %i\n", dw->blendfont);
+		fprintf(fd, "tiled %i\n", dw->tiled);
+		fprintf(fd, "threads %i\n", dw->threads);
 		fprintf(fd, "thickness %i\n", dw->thickness);
 		fprintf(fd, "gamma %i\n", dw->gamma);
 
@@ -959,6 +964,10 @@ gpInsertDataset(gp_t *gp, char **la, int dN)
 
 		sformat = "DOUBLE";
 	}
+	else if (rd->data[dN].format == FORMAT_BINARY_LZ4) {
+
+		sformat = "LZ4   ";
+	}
 	else {
 		sformat = "LEGACY";
 	}
@@ -3263,6 +3272,10 @@ gpEventHandle(gp_t *gp, const SDL_Event *ev)
 
 				gp->i_show_fps = gp->i_show_fps ? 0 : 1;
 			}
+			else if (ev->key.keysym.sym == SDLK_ESCAPE) {
+
+				plotDataSubtractCancel(pl);
+			}
 			else if (	ev->key.keysym.sym == SDLK_PAGEUP
 					|| ev->key.keysym.sym == SDLK_UP) {
 
@@ -4214,6 +4227,7 @@ gp_t *gp_Alloc()
 
 	dw->antialiasing = DRAW_4X_MSAA;
 	dw->blendfont = 1;
+	dw->tiled = 1;
 	dw->thickness = 1;
 	dw->gamma = 50;
 
@@ -4312,6 +4326,39 @@ void gp_TakeConfig(gp_t *gp, const char *config)
 	readConfigIN(gp->rd, config, 0);
 }
 
+void gp_OpenDataset(gp_t *gp, int dN, int cN, const char *label)
+{
+	if (dN < 0 || dN >= PLOT_DATASET_MAX) {
+
+		ERROR("Dataset number is out of range\n");
+		return ;
+	}
+
+	if (cN < 1 || cN > READ_COLUMN_MAX) {
+
+		ERROR("Column number %i is out of range\n", cN);
+		return ;
+	}
+
+	readOpenDirect(gp->rd, dN, cN, label);
+}
+
+void gp_TakeRow(gp_t *gp, int dN, const double *row)
+{
+	if (dN < 0 || dN >= PLOT_DATASET_MAX) {
+
+		ERROR("Dataset number is out of range\n");
+		return ;
+	}
+
+	if (gp->pl->data[dN].column_N == 0)
+		return ;
+
+	readInsertRow(gp->rd, dN, row);
+
+	gp->taken |= 1U << dN;
+}
+
 int gp_OpenWindow(gp_t *gp)
 {
 	scheme_t	*sch = gp->sch;
@@ -4400,6 +4447,8 @@ int gp_Draw(gp_t *gp)
 	menu_t		*mu = gp->mu;
 	edit_t		*ed = gp->ed;
 
+	int		dN;
+
 	gp->clock = SDL_GetTicks();
 	gp->drawn = 0;
 
@@ -4410,10 +4459,38 @@ int gp_Draw(gp_t *gp)
 			gp->active = 1;
 		}
 	}
-	else {
+	else if (gp->taken == 0) {
+
 		plotAxisScaleLock(pl, LOCK_FREE);
 	}
 
+	if (gp->taken != 0) {
+
+		/* Rows given by the host are taken the same way as from
+		 * file so we apply subtracts to them once per frame.
+		 * */
+		for (dN = 0; dN < PLOT_DATASET_MAX; ++dN) {
+
+			if (gp->taken & (1U << dN)) {
+
+				plotDataSubtractResidual(pl, dN);
+			}
+		}
+
+		gp->taken = 0;
+		gp->active = 1;
+	}
+
+	if (plotDataSubtractUpdate(pl) != 0) {
+
+		gp->active = 1;
+	}
+
+	if (plotAxisScaleDeferred(pl) != 0) {
+
+		gp->active = 1;
+	}
+
 	if (gp->i_show_fps != 0) {
 
 		gp->active = 1;
@@ -4535,6 +4612,24 @@ int gp_Draw(gp_t *gp)
 					gp->sbuf[0], TEXT_CENTERED_ON_Y, 0xFF2222);
 		}
 
+		if (plotDataSubtractProgress(pl) >= 0) {
+
+			int		len, jam;
+
+			sprintf(gp->sbuf[0], "SUB %3d%%", plotDataSubtractProgress(pl));
+
+			TTF_SizeUTF8(pl->font, gp->sbuf[0], &len, &jam);
+
+			drawFillRect(gp->surface, pl->screen.min_x,
+					pl->screen.min_y - gp->layout_page_box,
+					pl->screen.min_x + (len + 12), pl->screen.min_y,
+					pl->sch->plot_background);
+
+			drawText(gp->dw, gp->surface, pl->font, pl->screen.min_x + 6,
+					pl->screen.min_y + gp->layout_page_title_offset,
+					gp->sbuf[0], TEXT_CENTERED_ON_Y, sch->plot_text);
+		}
+
 		SDL_BlitSurface(gp->surface, NULL, gp->fb, NULL);
 		SDL_UpdateWindowSurface(gp->window);
 
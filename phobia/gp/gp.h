@@ -30,6 +30,8 @@ gp_t *gp_Alloc();
 void gp_Clean(gp_t *gp);
 
 void gp_TakeConfig(gp_t *gp, const char *config);
+void gp_OpenDataset(gp_t *gp, int dN, int cN, const char *label);
+void gp_TakeRow(gp_t *gp, int dN, const double *row);
 int gp_OpenWindow(gp_t *gp);
 
 void gp_TakeEvent(gp_t *gp, const SDL_Event *ev);
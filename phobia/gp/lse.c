@@ -16,6 +16,7 @@
    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <stdlib.h>
 #include <math.h>
 
 #include "lse.h"
@@ -293,7 +294,9 @@ int lse_getsize(int n_cascades, int n_full)
 		  + n_cascades * n_full
 #endif /* LSE_FAST_TRANSFORM */
 
-		  + n_full * n_full / 4 + n_full / 2 + 1;
+		  + n_full * n_full / 4 + n_full / 2 + 1
+
+		  + (LSE_BLOCK_MAX + 2) * n_full;
 
 	return n_lse_len + sizeof(lse_float_t) * n_vma_len;
 }
@@ -334,10 +337,27 @@ void lse_construct(lse_t *ls, int n_cascades, int n_len_of_x, int n_len_of_z)
 	ls->std.len = ls->n_len_of_z;
 	ls->std.m = vm + ls->sol.len;
 
+	ls->blk.len = (LSE_BLOCK_MAX + 2) * n_full;
+	ls->blk.m = vm + n_full * n_full / 4 + n_full / 2 + 1;
+
 	ls->esv.max = (lse_float_t) 0;
 	ls->esv.min = (lse_float_t) 0;
 }
 
+lse_t *lse_alloc(int n_cascades, int n_len_of_x, int n_len_of_z)
+{
+	lse_t		*ls;
+
+	ls = malloc(lse_getsize(n_cascades, n_len_of_x + n_len_of_z));
+
+	if (ls != NULL) {
+
+		lse_construct(ls, n_cascades, n_len_of_x, n_len_of_z);
+	}
+
+	return ls;
+}
+
 void lse_insert(lse_t *ls, lse_float_t *xz)
 {
 #if LSE_FAST_TRANSFORM != 0
@@ -349,6 +369,280 @@ void lse_insert(lse_t *ls, lse_float_t *xz)
 	ls->n_total += 1;
 }
 
+static void
+lse_hhprepare(lse_t *ls, lse_upper_t *rm)
+{
+	lse_float_t	*m = rm->m;
+#if LSE_FAST_TRANSFORM != 0
+	lse_float_t	*d = rm->d;
+	lse_float_t	u;
+#endif /* LSE_FAST_TRANSFORM */
+
+	int		i, j, len, nul;
+
+	if (rm->lazy != 0) {
+
+		/* Retained content goes into the upper cascade.
+		 * */
+		lse_qrmerge(ls, rm);
+	}
+
+	if (rm->keep < rm->len) {
+
+		/* Zero out uninitialized tail content.
+		 * */
+		len = rm->keep * rm->len - rm->keep * (rm->keep - 1) / 2;
+		nul = rm->len * (rm->len + 1) / 2;
+
+		for (i = len; i < nul; ++i)
+			m[i] = (lse_float_t) 0;
+
+#if LSE_FAST_TRANSFORM != 0
+		for (i = rm->keep; i < rm->len; ++i)
+			d[i] = (lse_float_t) 1;
+#endif /* LSE_FAST_TRANSFORM */
+	}
+
+#if LSE_FAST_TRANSFORM != 0
+	for (i = 0; i < rm->len; ++i) {
+
+		m += - i;
+
+		if (d[i] != (lse_float_t) 1) {
+
+			/* Bring the row-vector to the actual scale as
+			 * Householder transformation does not keep \d.
+			 * */
+			u = (lse_float_t) 1 / lse_sqrtf(d[i]);
+
+			for (j = i; j < rm->len; ++j)
+				m[j] *= u;
+
+			d[i] = (lse_float_t) 1;
+		}
+
+		m += rm->len;
+	}
+#else /* LSE_FAST_TRANSFORM */
+	(void) j;
+#endif
+}
+
+static void
+lse_hhupdate(lse_t *ls, lse_upper_t *rm, int n_rows)
+{
+	lse_float_t	*m = rm->m;
+	lse_float_t	*b = ls->blk.m;
+	lse_float_t	*u = ls->blk.m + LSE_BLOCK_MAX * rm->len;
+	lse_float_t	*g = ls->blk.m + (LSE_BLOCK_MAX + 1) * rm->len;
+	lse_float_t	*v, x0, x1, x2, x3, y0, y1, y2, y3;
+	lse_float_t	w0, w1, w2, w3, alpa, beta;
+
+	int		i, j, k;
+
+	for (j = 0; j < rm->len; ++j)
+		g[j] = (lse_float_t) 0;
+
+	/* We need the products of the first block column with all the rest.
+	 * */
+	for (k = 0; k < n_rows; ++k) {
+
+		v = b + k * rm->len;
+		x0 = v[0];
+
+		for (j = 0; j < rm->len; ++j)
+			g[j] += x0 * v[j];
+	}
+
+	for (i = 0; i < rm->len; ++i) {
+
+		m += - i;
+
+		if (g[i] != (lse_float_t) 0) {
+
+			/* We build the Householder reflection that zeroes out
+			 * the \i column of the block into diagonal of \R.
+			 * */
+			x0 = m[i];
+
+			alpa = lse_sqrtf(x0 * x0 + g[i]);
+			alpa = (x0 < (lse_float_t) 0) ? alpa : - alpa;
+
+			x0 = x0 - alpa;
+			beta = - (lse_float_t) 1 / (alpa * x0);
+
+			for (j = i + 1; j < rm->len; ++j) {
+
+				u[j] = (x0 * m[j] + g[j]) * beta;
+				m[j] += - u[j] * x0;
+			}
+
+			m[i] = alpa;
+		}
+		else {
+			for (j = i + 1; j < rm->len; ++j)
+				u[j] = (lse_float_t) 0;
+		}
+
+		for (j = i + 1; j < rm->len; ++j)
+			g[j] = (lse_float_t) 0;
+
+		if (i + 1 < rm->len) {
+
+			/* We apply the reflection to the block and get the
+			 * products of the next column in the same pass. The
+			 * inner loop is contiguous along the row.
+			 * */
+			for (k = 0; k + 4 <= n_rows; k += 4) {
+
+				/* We take four rows at once to reuse \u and \g
+				 * that are loaded from memory.
+				 * */
+				v = b + k * rm->len;
+
+				x0 = v[i];
+				x1 = v[rm->len + i];
+				x2 = v[rm->len * 2 + i];
+				x3 = v[rm->len * 3 + i];
+
+				y0 = v[i + 1] - u[i + 1] * x0;
+				y1 = v[rm->len + i + 1] - u[i + 1] * x1;
+				y2 = v[rm->len * 2 + i + 1] - u[i + 1] * x2;
+				y3 = v[rm->len * 3 + i + 1] - u[i + 1] * x3;
+
+				for (j = i + 1; j < rm->len; ++j) {
+
+					w0 = v[j] - u[j] * x0;
+					w1 = v[rm->len + j] - u[j] * x1;
+					w2 = v[rm->len * 2 + j] - u[j] * x2;
+					w3 = v[rm->len * 3 + j] - u[j] * x3;
+
+					v[j] = w0;
+					v[rm->len + j] = w1;
+					v[rm->len * 2 + j] = w2;
+					v[rm->len * 3 + j] = w3;
+
+					g[j] += y0 * w0 + y1 * w1 + y2 * w2 + y3 * w3;
+				}
+			}
+
+			for (; k < n_rows; ++k) {
+
+				v = b + k * rm->len;
+
+				x0 = v[i];
+				y0 = v[i + 1] - u[i + 1] * x0;
+
+				for (j = i + 1; j < rm->len; ++j) {
+
+					v[j] += - u[j] * x0;
+					g[j] += y0 * v[j];
+				}
+			}
+		}
+
+		m += rm->len;
+	}
+}
+
+static void
+lse_hhkeep(lse_t *ls, lse_upper_t *rm, int n_rows);
+
+static void
+lse_hhmerge(lse_t *ls, lse_upper_t *rm, lse_upper_t *um)
+{
+	lse_float_t	*m, *b;
+
+	int		n0, i, j, k;
+
+	lse_hhprepare(ls, rm);
+	lse_hhprepare(ls, um);
+
+	n0 = (rm->len < rm->keep) ? rm->len : rm->keep;
+
+	m = rm->m;
+
+	for (i = 0; i < n0; i += k) {
+
+		b = ls->blk.m;
+
+		/* Extract the row-vectors of \rm into the block.
+		 * */
+		for (k = 0; k < LSE_BLOCK_MAX && i + k < n0; ++k) {
+
+			m += - (i + k);
+
+			for (j = 0; j < i + k; ++j)
+				b[j] = (lse_float_t) 0;
+
+			for (j = i + k; j < rm->len; ++j)
+				b[j] = m[j];
+
+			m += rm->len;
+			b += rm->len;
+		}
+
+		lse_hhupdate(ls, um, k);
+	}
+
+	rm->keep = 0;
+	rm->lazy = 0;
+
+	lse_hhkeep(ls, um, n0);
+}
+
+static void
+lse_hhkeep(lse_t *ls, lse_upper_t *rm, int n_rows)
+{
+	rm->keep += n_rows;
+
+	if (rm->keep >= ls->n_threshold) {
+
+		if (rm < ls->rm + ls->n_cascades - 1) {
+
+			/* Merge the cascade immediately as the block has
+			 * nothing to keep out of the matrix.
+			 * */
+			lse_hhmerge(ls, rm, rm + 1);
+		}
+		else {
+			ls->n_threshold = (rm->keep > ls->n_threshold)
+				? rm->keep : ls->n_threshold;
+		}
+	}
+}
+
+void lse_insert_block(lse_t *ls, const lse_float_t *xz, int n_rows)
+{
+	lse_upper_t	*rm = ls->rm;
+	lse_float_t	*b;
+
+	int		len, i, n;
+
+	while (n_rows > 0) {
+
+		n = (n_rows < LSE_BLOCK_MAX) ? n_rows : LSE_BLOCK_MAX;
+		len = n * rm->len;
+
+		lse_hhprepare(ls, rm);
+
+		/* Copy the block as the transformation is done in place.
+		 * */
+		b = ls->blk.m;
+
+		for (i = 0; i < len; ++i)
+			b[i] = xz[i];
+
+		lse_hhupdate(ls, rm, n);
+		lse_hhkeep(ls, rm, n);
+
+		ls->n_total += n;
+
+		xz += len;
+		n_rows -= n;
+	}
+}
+
 void lse_ridge(lse_t *ls, lse_float_t la)
 {
 	lse_float_t	*xz = ls->sol.m;
@@ -430,6 +724,20 @@ lse_merge(lse_t *ls)
 	}
 }
 
+void lse_reduce(lse_t *ls, lse_t *lp)
+{
+	lse_upper_t	*rm = lp->rm + lp->n_cascades - 1;
+
+	lse_merge(lp);
+
+	/* The top matrix of \lp represents all its DATA rows so we merge
+	 * it into the top cascade of \ls.
+	 * */
+	lse_hhmerge(ls, rm, ls->rm + ls->n_cascades - 1);
+
+	ls->n_total += lp->n_total;
+}
+
 void lse_solve(lse_t *ls)
 {
 	lse_upper_t	*rm = ls->rm + ls->n_cascades - 1;
@@ -34,6 +34,11 @@
  * */
 #define LSE_FAST_TRANSFORM		1
 
+/* Define the number of data rows that are transformed together by block QR
+ * update. Larger block gives longer vector loops but consumes more memory.
+ * */
+#define LSE_BLOCK_MAX			32
+
 /* Define native floating-point type to use inside of LSE.
  * */
 typedef double		lse_float_t;
@@ -115,6 +120,11 @@ typedef struct {
 	 * */
 	lse_row_t	std;
 
+	/* Block of data rows to be inserted with Householder transformation.
+	 * The last two rows are used as temporal storage.
+	 * */
+	lse_row_t	blk;
+
 	/* Approximate extremal singular values of \Rx.
 	 * */
 	struct {
@@ -132,7 +142,9 @@ typedef struct {
 			 + LSE_CASCADE_MAX * LSE_FULL_MAX
 #endif /* LSE_FAST_TRANSFORM */
 
-			 + LSE_FULL_MAX * LSE_FULL_MAX / 4 + LSE_FULL_MAX / 2 + 1];
+			 + LSE_FULL_MAX * LSE_FULL_MAX / 4 + LSE_FULL_MAX / 2 + 1
+
+			 + (LSE_BLOCK_MAX + 2) * LSE_FULL_MAX];
 }
 lse_t;
 
@@ -145,12 +157,32 @@ int lse_getsize(int n_cascades, int n_full);
  * */
 void lse_construct(lse_t *ls, int n_cascades, int n_len_of_x, int n_len_of_z);
 
+/* The function allocates and constructs the instance of LSE from the heap. So
+ * the full size is not limited by \LSE_FULL_MAX. Returns NULL if allocation
+ * fails. Use free() to release.
+ * */
+lse_t *lse_alloc(int n_cascades, int n_len_of_x, int n_len_of_z);
+
 /* The function updates \R with a new data row-vector \xz which contains \x and
  * \z concatenated. We does QR update of \R by orthogonal transformation. Note
  * that the contents of \xz will be modified.
  * */
 void lse_insert(lse_t *ls, lse_float_t *xz);
 
+/* The function updates \R with a block of \n_rows data row-vectors \xz stored
+ * row-major one by one. We do QR update by Householder transformation of the
+ * whole block so the inner loops run along the rows and can be vectorized.
+ * The contents of \xz is not modified.
+ * */
+void lse_insert_block(lse_t *ls, const lse_float_t *xz, int n_rows);
+
+/* The function merges the QR factor of \lp into \ls. Both instances must be
+ * constructed with the same sizes. So you can insert different parts of DATA
+ * into separate instances on worker threads and then reduce them into one.
+ * Note that \lp is merged into its top cascade in place.
+ * */
+void lse_reduce(lse_t *ls, lse_t *lp);
+
 /* The function introduces ridge regularization with \la. Most reasonable \la
  * value is \n_len_of_x * \esv.max * \machine_epsilon.
  * */
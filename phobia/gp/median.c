@@ -0,0 +1,337 @@
+/*
+   Graph Plotter is a tool to analyse numerical data.
+   Copyright (C) 2023 Roman Belov <romblv@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+
+#include "median.h"
+
+/* We do not use isfinite() as it is folded by -ffinite-math-only.
+ * */
+static inline int
+median_isfinite(double x)
+{
+	union {
+		double			f;
+		unsigned long long	l;
+	}
+	u = { x };
+
+	return ((0x7FFUL & (unsigned long) (u.l >> 52)) != 0x7FFUL) ? 1 : 0;
+}
+
+/* We keep the samples in descending order and break ties by the window
+ * slot. So the median is the same that is given by the stable sort.
+ * */
+static inline int
+median_less(const double *key, int a, int b)
+{
+	return (key[a] > key[b]) || (key[a] == key[b] && a < b);
+}
+
+static int
+median_list_alloc(median_list_t *ls, int length)
+{
+	int		N, level_N;
+
+	for (level_N = 1; level_N < MEDIAN_LEVEL_MAX; ++level_N) {
+
+		if ((1 << level_N) > length)
+			break;
+	}
+
+	ls->length = length;
+	ls->level_N = level_N;
+
+	ls->next = (int *) malloc(sizeof(int) * (length + 1) * level_N);
+	ls->width = (int *) malloc(sizeof(int) * (length + 1) * level_N);
+	ls->height = (int *) malloc(sizeof(int) * (length + 1));
+
+	if (ls->next == NULL || ls->width == NULL || ls->height == NULL)
+		return -1;
+
+	ls->height[length] = level_N;
+
+	for (N = 0; N < level_N; ++N) {
+
+		ls->next[length * level_N + N] = -1;
+		ls->width[length * level_N + N] = 1;
+	}
+
+	ls->size = 0;
+
+	return 0;
+}
+
+static void
+median_list_free(median_list_t *ls)
+{
+	free(ls->next);
+	free(ls->width);
+	free(ls->height);
+}
+
+static void
+median_list_reset(median_list_t *ls)
+{
+	int		N, hN;
+
+	hN = ls->length * ls->level_N;
+
+	for (N = 0; N < ls->level_N; ++N) {
+
+		ls->next[hN + N] = -1;
+		ls->width[hN + N] = 1;
+	}
+
+	ls->size = 0;
+}
+
+static int
+median_list_height(median_t *md, int level_N)
+{
+	unsigned int	x = md->seed;
+	int		height = 1;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	md->seed = x;
+
+	while ((x & 1U) != 0 && height < level_N) {
+
+		x >>= 1;
+		height++;
+	}
+
+	return height;
+}
+
+static void
+median_list_insert(median_t *md, median_list_t *ls, const double *key, int sN)
+{
+	int		chain[MEDIAN_LEVEL_MAX], steps[MEDIAN_LEVEL_MAX];
+	int		N, L, xN, nN, height, step;
+
+	L = ls->level_N;
+	xN = ls->length;
+
+	for (N = L - 1; N >= 0; --N) {
+
+		steps[N] = 0;
+
+		while (		(nN = ls->next[xN * L + N]) >= 0
+				&& median_less(key, nN, sN)) {
+
+			steps[N] += ls->width[xN * L + N];
+			xN = nN;
+		}
+
+		chain[N] = xN;
+	}
+
+	height = median_list_height(md, L);
+
+	ls->height[sN] = height;
+
+	step = 0;
+
+	for (N = 0; N < height; ++N) {
+
+		xN = chain[N];
+
+		ls->next[sN * L + N] = ls->next[xN * L + N];
+		ls->next[xN * L + N] = sN;
+
+		ls->width[sN * L + N] = ls->width[xN * L + N] - step;
+		ls->width[xN * L + N] = step + 1;
+
+		step += steps[N];
+	}
+
+	for (N = height; N < L; ++N) {
+
+		ls->width[chain[N] * L + N] += 1;
+	}
+
+	ls->size += 1;
+}
+
+static void
+median_list_remove(median_list_t *ls, const double *key, int sN)
+{
+	int		chain[MEDIAN_LEVEL_MAX];
+	int		N, L, xN, nN;
+
+	L = ls->level_N;
+	xN = ls->length;
+
+	for (N = L - 1; N >= 0; --N) {
+
+		while (		(nN = ls->next[xN * L + N]) >= 0
+				&& median_less(key, nN, sN)) {
+
+			xN = nN;
+		}
+
+		chain[N] = xN;
+	}
+
+	for (N = 0; N < ls->height[sN]; ++N) {
+
+		xN = chain[N];
+
+		ls->width[xN * L + N] += ls->width[sN * L + N] - 1;
+		ls->next[xN * L + N] = ls->next[sN * L + N];
+	}
+
+	for (N = ls->height[sN]; N < L; ++N) {
+
+		ls->width[chain[N] * L + N] -= 1;
+	}
+
+	ls->size -= 1;
+}
+
+static int
+median_list_get(const median_list_t *ls, int rank)
+{
+	int		N, L, xN;
+
+	L = ls->level_N;
+	xN = ls->length;
+
+	rank += 1;
+
+	for (N = L - 1; N >= 0; --N) {
+
+		while (ls->width[xN * L + N] <= rank) {
+
+			rank -= ls->width[xN * L + N];
+			xN = ls->next[xN * L + N];
+		}
+	}
+
+	return xN;
+}
+
+median_t *median_alloc(int length, int opdata)
+{
+	median_t	*md;
+	int		rc;
+
+	md = (median_t *) calloc(1, sizeof(median_t));
+
+	if (md == NULL)
+		return NULL;
+
+	md->length = length;
+	md->seed = 1U;
+
+	md->fval = (double *) malloc(sizeof(double) * length);
+	md->fpay = (double *) malloc(sizeof(double) * length);
+
+	rc = median_list_alloc(&md->lx, length);
+
+	if (opdata != 0) {
+
+		rc = (median_list_alloc(&md->ly, length) != 0) ? -1 : rc;
+	}
+
+	if (md->fval == NULL || md->fpay == NULL || rc != 0) {
+
+		median_free(md);
+		return NULL;
+	}
+
+	return md;
+}
+
+void median_free(median_t *md)
+{
+	free(md->fval);
+	free(md->fpay);
+
+	median_list_free(&md->lx);
+	median_list_free(&md->ly);
+
+	free(md);
+}
+
+void median_reset(median_t *md)
+{
+	md->keep = 0;
+	md->tail = 0;
+
+	median_list_reset(&md->lx);
+
+	if (md->ly.next != NULL) {
+
+		median_list_reset(&md->ly);
+	}
+}
+
+void median_insert(median_t *md, double fval, double fpay)
+{
+	int		sN = md->tail;
+
+	if (md->keep == md->length) {
+
+		/* Remove the oldest sample that we are about to overwrite.
+		 * */
+		if (median_isfinite(md->fval[sN])) {
+
+			median_list_remove(&md->lx, md->fval, sN);
+
+			if (md->ly.next != NULL && median_isfinite(md->fpay[sN])) {
+
+				median_list_remove(&md->ly, md->fpay, sN);
+			}
+		}
+	}
+
+	md->fval[sN] = fval;
+	md->fpay[sN] = fpay;
+
+	if (median_isfinite(fval)) {
+
+		median_list_insert(md, &md->lx, md->fval, sN);
+
+		if (md->ly.next != NULL && median_isfinite(fpay)) {
+
+			median_list_insert(md, &md->ly, md->fpay, sN);
+		}
+	}
+
+	md->keep = (md->keep < md->length) ? md->keep + 1 : md->length;
+	md->tail = (md->tail < md->length - 1) ? md->tail + 1 : 0;
+}
+
+int median_get_X(median_t *md)
+{
+	return (md->lx.size > 0) ? median_list_get(&md->lx, md->lx.size / 2) : -1;
+}
+
+int median_get_Y(median_t *md)
+{
+	if (md->ly.next == NULL)
+		return median_get_X(md);
+
+	return (md->ly.size > 0) ? median_list_get(&md->ly, md->ly.size / 2) : -1;
+}
+
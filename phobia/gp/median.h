@@ -0,0 +1,103 @@
+/*
+   Graph Plotter is a tool to analyse numerical data.
+   Copyright (C) 2023 Roman Belov <romblv@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _H_MEDIAN_
+#define _H_MEDIAN_
+
+/* Define the maximal number of skip-list levels. This limits the window
+ * length to about (1 << MEDIAN_LEVEL_MAX) samples with no loss of speed.
+ * */
+#define MEDIAN_LEVEL_MAX		20
+
+typedef struct {
+
+	/* The number of window slots and the number of levels in use.
+	 * */
+	int		length;
+	int		level_N;
+
+	/* The head node is at the \length slot.
+	 * */
+	int		*next;
+	int		*width;
+	int		*height;
+
+	/* The number of linked samples.
+	 * */
+	int		size;
+}
+median_list_t;
+
+typedef struct {
+
+	/* The length of sliding window.
+	 * */
+	int		length;
+
+	/* The number of samples that window keep.
+	 * */
+	int		keep;
+	int		tail;
+
+	/* Ring of window samples.
+	 * */
+	double		*fval;
+	double		*fpay;
+
+	/* Indexed skip-lists ordered by \fval and \fpay respectively.
+	 * Only finite samples are linked.
+	 * */
+	median_list_t	lx;
+	median_list_t	ly;
+
+	/* The state of pseudo-random generator of node heights.
+	 * */
+	unsigned int	seed;
+}
+median_t;
+
+/* The function allocates the median filter of \length window size. The
+ * \opdata flag enables the second list ordered by payload.
+ * */
+median_t *median_alloc(int length, int opdata);
+
+/* The function releases all memory of median filter.
+ * */
+void median_free(median_t *md);
+
+/* The function clears the window.
+ * */
+void median_reset(median_t *md);
+
+/* The function inserts a new sample into the window and removes the oldest
+ * one. It takes O(log n) on the average.
+ * */
+void median_insert(median_t *md, double fval, double fpay);
+
+/* The function returns the window slot of the median of finite \fval
+ * samples or -1 if there are no such samples.
+ * */
+int median_get_X(median_t *md);
+
+/* The function returns the window slot of the median of \fpay taken over
+ * the samples which both values are finite or -1 if there are no such.
+ * */
+int median_get_Y(median_t *md);
+
+#endif /* _H_MEDIAN_ */
+
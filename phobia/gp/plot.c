@@ -16,10 +16,13 @@
    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
+#include <limits.h>
+#include <float.h>
 #include <math.h>
 
 #include <SDL2/SDL.h>
@@ -57,1595 +60,3477 @@ int fp_isfinite(double x)
 	return ((0x7FFUL & (unsigned long) (u.l >> 52)) != 0x7FFUL) ? 1 : 0;
 }
 
-plot_t *plotAlloc(draw_t *dw, scheme_t *sch)
+static int
+plotDataTypeSize(int type)
 {
-	plot_t		*pl;
-	int		N;
+	int		bSIZE;
 
-	pl = calloc(1, sizeof(plot_t));
+	switch (type) {
 
-	pl->dw = dw;
-	pl->sch = sch;
+		case COLUMN_FLOAT:
+			bSIZE = sizeof(float);
+			break;
 
-	for (N = 0; N < PLOT_SKETCH_MAX - 1; ++N)
-		pl->sketch[N].linked = N + 1;
+		case COLUMN_INT:
+			bSIZE = sizeof(int);
+			break;
 
-	pl->sketch[PLOT_SKETCH_MAX - 1].linked = -1;
+		default:
+			bSIZE = sizeof(fval_t);
+			break;
+	}
 
-	pl->sketch_list_garbage = 0;
-	pl->sketch_list_todraw = -1;
-	pl->sketch_list_current = -1;
-	pl->sketch_list_current_end = -1;
+	return bSIZE;
+}
 
-	for (N = 0; N < PLOT_FIGURE_MAX; ++N)
-		pl->draw[N].list_self = -1;
+static fval_t
+plotDataTypeLoad(const void *raw, int type, int jN)
+{
+	fval_t		fval;
+	int		ival;
 
-	pl->layout_font_long = 11;
-	pl->layout_font_space = 16;
-	pl->layout_border = 5;
-	pl->layout_tick_tooth = 5;
-	pl->layout_grid_dash = 2;
-	pl->layout_grid_space = 8;
-	pl->layout_drawing_dash = 8;
-	pl->layout_drawing_space = 12;
-	pl->layout_fence_dash = 10;
-	pl->layout_fence_space = 10;
-	pl->layout_fence_point = 10;
+	switch (type) {
 
-	pl->interpolation = 1;
-	pl->defungap = 10;
+		case COLUMN_FLOAT:
+			fval = (fval_t) ((const float *) raw)[jN];
+			break;
 
-	pl->mark_size = 40;
-	pl->mark_density = 40;
+		case COLUMN_INT:
+			ival = ((const int *) raw)[jN];
+			fval = (ival != INT_MIN) ? (fval_t) ival : FP_NAN;
+			break;
 
-	pl->default_drawing = FIGURE_DRAWING_LINE;
-	pl->default_width = 2;
+		default:
+			fval = ((const fval_t *) raw)[jN];
+			break;
+	}
 
-	pl->transparency = 1;
-	pl->fprecision = 9;
-	pl->lz4_compress = 1;
+	return fval;
+}
 
-	return pl;
+static void
+plotDataTypeStore(void *raw, int type, int jN, fval_t fval)
+{
+	switch (type) {
+
+		case COLUMN_FLOAT:
+			((float *) raw)[jN] = (float) fval;
+			break;
+
+		case COLUMN_INT:
+			((int *) raw)[jN] = (fp_isfinite(fval) && fval > (fval_t) INT_MIN
+					&& fval < (fval_t) INT_MAX)
+				? (int) (fval + ((fval < 0.) ? - .5 : .5)) : INT_MIN;
+			break;
+
+		default:
+			((fval_t *) raw)[jN] = fval;
+			break;
+	}
 }
 
 static void
-plotSketchFree(plot_t *pl)
+plotDataTypeConvert(fval_t *fval, const void *raw, int type, int jN, int length_N)
 {
-	int		N;
+	int		N, ival;
 
-	plotSketchClean(pl);
+	switch (type) {
 
-	for (N = 0; N < PLOT_SKETCH_MAX; ++N) {
+		case COLUMN_FLOAT:
+			for (N = 0; N < length_N; ++N)
+				fval[N] = (fval_t) ((const float *) raw)[jN + N];
+			break;
 
-		if (pl->sketch[N].chunk != NULL) {
+		case COLUMN_INT:
+			for (N = 0; N < length_N; ++N) {
 
-			free(pl->sketch[N].chunk);
+				ival = ((const int *) raw)[jN + N];
+				fval[N] = (ival != INT_MIN) ? (fval_t) ival : FP_NAN;
+			}
+			break;
 
-			pl->sketch[N].chunk = NULL;
-		}
+		default:
+			memcpy(fval, (const fval_t *) raw + jN, length_N * sizeof(fval_t));
+			break;
 	}
 }
 
-void plotClean(plot_t *pl)
+static void
+plotDataMapConvert(void *raw, int type, const char *map, int fsize,
+		int length_N, int map_column_N, int cN)
 {
-	int		dN;
+	int		N;
 
-	drawPixmapClean(pl->dw);
-	plotSketchFree(pl);
+	map += cN * fsize;
 
-	for (dN = 0; dN < PLOT_DATASET_MAX; ++dN) {
+	if (fsize == sizeof(float) && type == COLUMN_FLOAT) {
 
-		if (pl->data[dN].column_N != 0)
-			plotDataClean(pl, dN);
+		for (N = 0; N < length_N; ++N) {
+
+			((float *) raw)[N] = *(const float *) map;
+			map += map_column_N * fsize;
+		}
 	}
+	else {
+		for (N = 0; N < length_N; ++N) {
 
-	free(pl);
+			plotDataTypeStore(raw, type, N, (fsize == sizeof(float))
+					? (fval_t) *(const float *) map
+					: (fval_t) *(const double *) map);
+
+			map += map_column_N * fsize;
+		}
+	}
 }
 
 static void
-plotFontLayout(plot_t *pl)
+plotDataRangeUpdate(const fval_t *fval, int length_N, fval_t *fmin, fval_t *fmax)
 {
-	TTF_SizeUTF8(pl->font, "M", &pl->layout_font_long, &pl->layout_font_height);
+	typedef unsigned long long __attribute__ ((may_alias)) ubits_t;
 
-	pl->layout_font_height = TTF_FontHeight(pl->font);
-
-	pl->layout_font_space = pl->layout_font_long * 14 / 10;
-	pl->layout_axis_box = pl->layout_tick_tooth + pl->layout_font_height;
-	pl->layout_label_box = pl->layout_font_height;
+	fval_t			ymin, ymax;
+	long long		finite;
+	int			N;
 
-	pl->layout_mark_size = pl->layout_font_height * pl->mark_size / 200;
-	pl->layout_mark_size = (pl->layout_mark_size < 1) ? 1 : pl->layout_mark_size;
-}
+	ymin = *fmin;
+	ymax = *fmax;
 
-void plotFontDefault(plot_t *pl, int ttfnum, int ptsize, int style)
-{
-	if (pl->font != NULL) {
+	/* The loop is branch free. Column without finite values ends up
+	 * with \fmin > \fmax.
+	 * */
+	for (N = 0; N < length_N; ++N) {
 
-		TTF_CloseFont(pl->font);
+		finite = (((const ubits_t *) fval)[N] & 0x7FF0000000000000ULL)
+			!= 0x7FF0000000000000ULL;
 
-		pl->font = NULL;
+		ymin = (finite && fval[N] < ymin) ? fval[N] : ymin;
+		ymax = (finite && fval[N] > ymax) ? fval[N] : ymax;
 	}
 
-	switch (ttfnum) {
+	*fmin = ymin;
+	*fmax = ymax;
+}
 
-		default:
-			ttfnum = TTF_ID_ROBOTO_MONO_NORMAL;
+static void
+plotDataRangeScan(const void *raw, int type, int length_N, fval_t *fmin, fval_t *fmax)
+{
+	fval_t		fval[1 << PLOT_LOD_BASE];
+	int		N, lN;
 
-		case TTF_ID_ROBOTO_MONO_NORMAL:
-			pl->font = TTF_OpenFontRW(TTF_RW_roboto_mono_normal(), 1, ptsize);
-			break;
+	*fmin = (fval_t) DBL_MAX;
+	*fmax = (fval_t) - DBL_MAX;
 
-		case TTF_ID_ROBOTO_MONO_THIN:
-			pl->font = TTF_OpenFontRW(TTF_RW_roboto_mono_thin(), 1, ptsize);
-			break;
+	if (type == COLUMN_DOUBLE) {
+
+		plotDataRangeUpdate((const fval_t *) raw, length_N, fmin, fmax);
+		return ;
 	}
 
-	TTF_SetFontStyle(pl->font, style);
+	/* We convert the column by small blocks that stay in cache.
+	 * */
+	for (N = 0; N < length_N; N += lN) {
 
-	pl->layout_font_ttf = ttfnum;
-	pl->layout_font_pt = ptsize;
+		lN = length_N - N;
+		lN = (lN > (1 << PLOT_LOD_BASE)) ? (1 << PLOT_LOD_BASE) : lN;
 
-	plotFontLayout(pl);
+		plotDataTypeConvert(fval, raw, type, N, lN);
+		plotDataRangeUpdate(fval, lN, fmin, fmax);
+	}
 }
 
-int plotFontOpen(plot_t *pl, const char *ttf, int ptsize, int style)
+static void
+plotDataRangeScanMap(const char *map, int fsize, int length_N, int map_column_N,
+		fval_t *fmin, fval_t *fmax)
 {
-	if (pl->font != NULL) {
+	fval_t		fval[1 << PLOT_LOD_BASE];
+	int		N, cN, lN;
 
-		TTF_CloseFont(pl->font);
+	for (cN = 0; cN < map_column_N; ++cN) {
 
-		pl->font = NULL;
+		fmin[cN] = (fval_t) DBL_MAX;
+		fmax[cN] = (fval_t) - DBL_MAX;
 	}
 
-	pl->font = TTF_OpenFont(ttf, ptsize);
-
-	if (pl->font == NULL) {
-
-		ERROR("TTF_OpenFont: \"%s\"\n", TTF_GetError());
-		return -1;
-	}
+	/* Mapped rows are kept in file order so we pass all the columns of
+	 * a small block of rows while it stays in cache.
+	 * */
+	for (N = 0; N < length_N; N += lN) {
 
-	TTF_SetFontStyle(pl->font, style);
+		lN = length_N - N;
+		lN = (lN > (1 << PLOT_LOD_BASE)) ? (1 << PLOT_LOD_BASE) : lN;
 
-	pl->layout_font_ttf = 0;
-	pl->layout_font_pt = ptsize;
+		for (cN = 0; cN < map_column_N; ++cN) {
 
-	plotFontLayout(pl);
+			plotDataMapConvert(fval, COLUMN_DOUBLE, map + (long long) N
+					* map_column_N * fsize, fsize, lN, map_column_N, cN);
 
-	return 0;
+			plotDataRangeUpdate(fval, lN, fmin + cN, fmax + cN);
+		}
+	}
 }
 
 static void
-plotDataChunkAlloc(plot_t *pl, int dN, int lN)
+plotDataRangeScanChunk(plot_t *pl, int dN, int kN, const char *map,
+		int fsize, int length_N)
 {
-	int		N, kN, lSHIFT;
+	fval_t		*fmin, *fmax;
+	void		**raw;
+	int		cN, column_N;
 
-	lSHIFT = pl->data[dN].chunk_SHIFT;
+	fmin = pl->data[dN].summary[kN].fmin;
+	fmax = pl->data[dN].summary[kN].fmax;
+	raw = pl->data[dN].summary[kN].raw;
 
-	kN = (lN & pl->data[dN].chunk_MASK) ? 1 : 0;
-	kN += lN >> lSHIFT;
+	column_N = pl->data[dN].column_N;
 
-	if (kN > PLOT_CHUNK_MAX) {
+	if (map != NULL) {
 
-		kN = PLOT_CHUNK_MAX;
-		lN = kN * (1UL << lSHIFT);
+		plotDataRangeScanMap(map, fsize, length_N, column_N, fmin, fmax);
 	}
 
-	if (pl->data[dN].lz4_compress != 0) {
+	for (cN = (map != NULL) ? column_N : 0; cN < column_N + PLOT_SUBTRACT; ++cN) {
 
-		for (N = kN; N < PLOT_CHUNK_MAX; ++N) {
+		if (raw[cN] != NULL) {
 
-			if (pl->data[dN].compress[N].raw != NULL) {
+			plotDataRangeScan(raw[cN], pl->data[dN].col[cN].type,
+					length_N, fmin + cN, fmax + cN);
+		}
+		else {
+			fmin[cN] = FP_NAN;
+			fmax[cN] = FP_NAN;
+		}
+	}
+}
 
-				free(pl->data[dN].compress[N].raw);
+static void
+plotDataSubtractLoad(plot_t *pl, int dN, fval_t *fval, void **raw, int cN,
+		int jN, int length_N, int id_N)
+{
+	int		N;
 
-				pl->data[dN].compress[N].raw = NULL;
-			}
-		}
+	if (cN < 0) {
+
+		for (N = 0; N < length_N; ++N)
+			fval[N] = (fval_t) (id_N + N);
 	}
 	else {
-		for (N = 0; N < kN; ++N) {
+		plotDataTypeConvert(fval, raw[cN], pl->data[dN].col[cN].type,
+				jN, length_N);
+	}
+}
 
-			if (pl->data[dN].raw[N] == NULL) {
+static void
+plotDataSubtractChunk(plot_t *pl, int dN, int kN, int jN, int length_N, int id_N)
+{
+	fval_t		X1[1 << PLOT_LOD_BASE], X2[1 << PLOT_LOD_BASE];
+	double		scale, offset;
+	void		**raw;
+	int		N, rN, bN, lN, op_N, mode, cN;
 
-				pl->data[dN].raw[N] = (fval_t *) malloc(pl->data[dN].chunk_bSIZE);
+	raw = pl->data[dN].summary[kN].raw;
+	op_N = pl->data[dN].sub_op_N;
 
-				if (pl->data[dN].raw[N] == NULL) {
+	/* We go by small blocks of rows through all parallel subtracts so
+	 * the operands stay in cache. List is in order of subtracts so any
+	 * operand that is taken from the list is already computed.
+	 * */
+	for (bN = 0; bN < length_N; bN += lN) {
 
-					lN = N * (1UL << lSHIFT);
+		lN = length_N - bN;
+		lN = (lN > (1 << PLOT_LOD_BASE)) ? (1 << PLOT_LOD_BASE) : lN;
 
-					ERROR("Unable to allocate memory of %i dataset\n", dN);
-					break;
-				}
-			}
-		}
+		for (N = 0; N < op_N; ++N) {
 
-		for (N = kN; N < PLOT_CHUNK_MAX; ++N) {
+			mode = pl->data[dN].sub_op[N].mode;
 
-			if (pl->data[dN].raw[N] != NULL) {
+			plotDataSubtractLoad(pl, dN, X1, raw, pl->data[dN].sub_op[N].column_1,
+					jN + bN, lN, id_N + bN);
 
-				free(pl->data[dN].raw[N]);
+			if (mode != SUBTRACT_SCALE) {
 
-				pl->data[dN].raw[N] = NULL;
+				plotDataSubtractLoad(pl, dN, X2, raw,
+						pl->data[dN].sub_op[N].column_2,
+						jN + bN, lN, id_N + bN);
 			}
-		}
-	}
 
-	pl->data[dN].length_N = lN;
-}
+			switch (mode) {
 
-unsigned long long plotDataMemoryUsage(plot_t *pl, int dN)
-{
-	int			N;
-	unsigned long long	bUSAGE;
+				case SUBTRACT_SCALE:
+					scale = pl->data[dN].sub_op[N].scale;
+					offset = pl->data[dN].sub_op[N].offset;
 
-	if (dN < 0 || dN >= PLOT_DATASET_MAX) {
+					for (rN = 0; rN < lN; ++rN)
+						X1[rN] = X1[rN] * scale + offset;
+					break;
 
-		ERROR("Dataset number is out of range\n");
-		return 0;
-	}
+				case SUBTRACT_BINARY_SUBTRACTION:
+					for (rN = 0; rN < lN; ++rN)
+						X1[rN] = X1[rN] - X2[rN];
+					break;
 
-	bUSAGE = 0;
+				case SUBTRACT_BINARY_ADDITION:
+					for (rN = 0; rN < lN; ++rN)
+						X1[rN] = X1[rN] + X2[rN];
+					break;
 
-	for (N = 0; N < PLOT_CHUNK_MAX; ++N) {
+				case SUBTRACT_BINARY_MULTIPLICATION:
+					for (rN = 0; rN < lN; ++rN)
+						X1[rN] = X1[rN] * X2[rN];
+					break;
 
-		if (pl->data[dN].raw[N] != NULL) {
+				case SUBTRACT_BINARY_HYPOTENUSE:
+					for (rN = 0; rN < lN; ++rN)
+						X1[rN] = sqrt(X1[rN] * X1[rN] + X2[rN] * X2[rN]);
+					break;
 
-			bUSAGE += pl->data[dN].chunk_bSIZE;
-		}
+				default:
+					break;
+			}
 
-		if (pl->data[dN].compress[N].raw != NULL) {
+			cN = pl->data[dN].sub_op[N].column;
 
-			bUSAGE += pl->data[dN].compress[N].length;
+			for (rN = 0; rN < lN; ++rN) {
+
+				plotDataTypeStore(raw[cN], pl->data[dN].col[cN].type,
+						jN + bN + rN, X1[rN]);
+			}
 		}
 	}
-
-	return bUSAGE;
 }
 
-unsigned long long plotDataMemoryUncompressed(plot_t *pl, int dN)
+static int
+plotDataRangeThread(void *arg)
 {
-	int			N;
-	unsigned long long	bUSAGE;
+	plot_t		*pl = (plot_t *) arg;
 
-	if (dN < 0 || dN >= PLOT_DATASET_MAX) {
+	const char	*map;
+	int		dN, kN, gen, sub, row_N, id_N, length_N, fsize;
 
-		ERROR("Dataset number is out of range\n");
-		return 0;
-	}
+	do {
+		SDL_LockMutex(pl->range.mutex);
 
-	bUSAGE = 0;
+		while (		pl->range.head == pl->range.tail
+				&& pl->range.stop == 0) {
 
-	for (N = 0; N < PLOT_CHUNK_MAX; ++N) {
+			SDL_CondWait(pl->range.cond, pl->range.mutex);
+		}
 
-		if (		pl->data[dN].raw[N] != NULL
-				|| pl->data[dN].compress[N].raw != NULL) {
+		if (pl->range.head == pl->range.tail) {
 
-			bUSAGE += pl->data[dN].chunk_bSIZE;
+			SDL_UnlockMutex(pl->range.mutex);
+			break;
 		}
-	}
 
-	return bUSAGE;
-}
+		dN = pl->range.queue[pl->range.tail].data_N;
+		kN = pl->range.queue[pl->range.tail].chunk_N;
+		gen = pl->range.queue[pl->range.tail].gen;
+		map = pl->range.queue[pl->range.tail].map;
+		sub = pl->range.queue[pl->range.tail].sub;
+		row_N = pl->range.queue[pl->range.tail].row_N;
+		id_N = pl->range.queue[pl->range.tail].id_N;
+		length_N = pl->range.queue[pl->range.tail].length_N;
+		fsize = pl->range.queue[pl->range.tail].fsize;
 
-unsigned long long plotDataMemoryCached(plot_t *pl, int dN)
-{
-	int			N;
-	unsigned long long	bUSAGE;
+		pl->range.tail = (pl->range.tail + 1) % PLOT_RANGE_QUEUE;
 
-	if (dN < 0 || dN >= PLOT_DATASET_MAX) {
+		SDL_UnlockMutex(pl->range.mutex);
 
-		ERROR("Dataset number is out of range\n");
-		return 0;
-	}
+		if (sub != 0) {
 
-	bUSAGE = 0;
+			/* Subtract job rows are computed here. Summary is
+			 * left to be invalidated by UI thread.
+			 * */
+			plotDataSubtractChunk(pl, dN, kN, row_N, length_N, id_N);
+		}
+		else {
+			plotDataRangeScanChunk(pl, dN, kN, map, fsize, length_N);
+		}
 
-	for (N = 0; N < PLOT_CHUNK_CACHE; ++N) {
+		/* Release the chunk. UI thread does not touch the chunk
+		 * memory and the summary until \busy is released.
+		 * */
+		SDL_MemoryBarrierRelease();
 
-		if (pl->data[dN].cache[N].raw != NULL) {
+		if (sub == 0) {
 
-			bUSAGE += pl->data[dN].chunk_bSIZE;
+			SDL_AtomicSet(&pl->data[dN].summary[kN].done, gen);
 		}
+
+		SDL_AtomicAdd(&pl->data[dN].summary[kN].busy, -1);
+
+		SDL_LockMutex(pl->range.mutex);
+		SDL_CondBroadcast(pl->range.done);
+		SDL_UnlockMutex(pl->range.mutex);
 	}
+	while (1);
 
-	return bUSAGE;
+	return 0;
 }
 
-static int
-plotDataCacheGetNode(plot_t *pl, int dN, int kN)
+static void
+plotDataRangeStart(plot_t *pl)
 {
-	int		N, kNOT, xN = -1;
+	int		N;
 
-	for (N = 0; N < PLOT_CHUNK_CACHE; ++N) {
+	pl->range.mutex = SDL_CreateMutex();
+	pl->range.cond = SDL_CreateCond();
+	pl->range.done = SDL_CreateCond();
 
-		if (pl->data[dN].cache[N].raw == NULL) {
+	if (		pl->range.mutex == NULL || pl->range.cond == NULL
+			|| pl->range.done == NULL) {
 
-			xN = N;
-			break;
-		}
+		ERROR("Unable to create range worker sync \"%s\"\n", SDL_GetError());
+		return ;
 	}
 
-	if (xN < 0) {
+	N = SDL_GetCPUCount() - 1;
+	N = (N < 1) ? 1 : (N > PLOT_RANGE_THREAD_MAX) ? PLOT_RANGE_THREAD_MAX : N;
 
-		kNOT = pl->data[dN].tail_N >> pl->data[dN].chunk_SHIFT;
+	for (pl->range.thread_N = 0; pl->range.thread_N < N; ++pl->range.thread_N) {
 
-		N = (pl->data[dN].cache_ID < PLOT_CHUNK_CACHE - 1)
-			? pl->data[dN].cache_ID + 1 : 0;
+		pl->range.thread[pl->range.thread_N] = SDL_CreateThread(
+				&plotDataRangeThread, "plotDataRange", pl);
 
-		if (pl->data[dN].cache[N].chunk_N == kNOT) {
+		if (pl->range.thread[pl->range.thread_N] == NULL) {
 
-			N = (N < PLOT_CHUNK_CACHE - 1) ? N + 1 : 0;
+			ERROR("SDL_CreateThread: \"%s\"\n", SDL_GetError());
+			break;
 		}
-
-		xN = N;
-
-		pl->data[dN].cache_ID = N;
 	}
-
-	return xN;
 }
 
 static void
-plotDataCacheFetch(plot_t *pl, int dN, int kN)
+plotDataRangeStop(plot_t *pl)
 {
-	int		xN, kNZ, lzLEN;
+	int		N;
 
-	xN = plotDataCacheGetNode(pl, dN, kN);
+	if (		pl->range.mutex != NULL && pl->range.cond != NULL
+			&& pl->range.done != NULL) {
 
-	if (pl->data[dN].cache[xN].raw != NULL) {
+		SDL_LockMutex(pl->range.mutex);
 
-		kNZ = pl->data[dN].cache[xN].chunk_N;
+		pl->range.stop = 1;
 
-		if (pl->data[dN].cache[xN].dirty != 0) {
+		SDL_CondBroadcast(pl->range.cond);
+		SDL_UnlockMutex(pl->range.mutex);
 
-			lzLEN = LZ4_compressBound(pl->data[dN].chunk_bSIZE);
+		for (N = 0; N < pl->range.thread_N; ++N) {
 
-			if (pl->data[dN].compress[kNZ].raw != NULL) {
+			SDL_WaitThread(pl->range.thread[N], NULL);
+		}
+	}
 
-				free(pl->data[dN].compress[kNZ].raw);
-			}
+	pl->range.thread_N = 0;
 
-			pl->data[dN].compress[kNZ].raw = (void *) malloc(lzLEN);
+	if (pl->range.mutex != NULL) {
 
-			if (pl->data[dN].compress[kNZ].raw == NULL) {
-
-				ERROR("Unable to allocate LZ4 memory of %i dataset\n", dN);
-			}
-
-			lzLEN = LZ4_compress_default(
-					(const char *) pl->data[dN].cache[xN].raw,
-					(char *) pl->data[dN].compress[kNZ].raw,
-					pl->data[dN].chunk_bSIZE, lzLEN);
-
-			if (lzLEN > 0) {
-
-				pl->data[dN].compress[kNZ].raw =
-					realloc(pl->data[dN].compress[kNZ].raw, lzLEN);
-				pl->data[dN].compress[kNZ].length = lzLEN;
-			}
-			else {
-				ERROR("Unable to compress the chunk of %i dataset\n", dN);
-
-				free(pl->data[dN].compress[kNZ].raw);
-
-				pl->data[dN].compress[kNZ].raw = NULL;
-				pl->data[dN].compress[kNZ].length = 0;
-			}
-		}
-
-		pl->data[dN].raw[kNZ] = NULL;
+		SDL_DestroyMutex(pl->range.mutex);
+		pl->range.mutex = NULL;
 	}
-	else {
-		pl->data[dN].cache[xN].raw = (fval_t *) malloc(pl->data[dN].chunk_bSIZE);
 
-		if (pl->data[dN].cache[xN].raw == NULL) {
+	if (pl->range.cond != NULL) {
 
-			ERROR("Unable to allocate cache of %i dataset\n", dN);
-		}
+		SDL_DestroyCond(pl->range.cond);
+		pl->range.cond = NULL;
 	}
 
-	pl->data[dN].cache[xN].chunk_N = kN;
-	pl->data[dN].cache[xN].dirty = 0;
+	if (pl->range.done != NULL) {
 
-	pl->data[dN].raw[kN] = pl->data[dN].cache[xN].raw;
+		SDL_DestroyCond(pl->range.done);
+		pl->range.done = NULL;
+	}
+}
 
-	if (pl->data[dN].compress[kN].raw != NULL) {
+static void
+plotDataRangeWait(plot_t *pl, int dN, int kN)
+{
+	/* The chunk memory is about to be released or reused so we have to
+	 * wait for worker thread. Scan of one chunk takes a few milliseconds.
+	 * */
+	if (SDL_AtomicGet(&pl->data[dN].summary[kN].busy) != 0) {
 
-		lzLEN = LZ4_decompress_safe(
-				(const char *) pl->data[dN].compress[kN].raw,
-				(char *) pl->data[dN].raw[kN],
-				pl->data[dN].compress[kN].length,
-				pl->data[dN].chunk_bSIZE);
+		SDL_LockMutex(pl->range.mutex);
 
-		if (lzLEN != pl->data[dN].chunk_bSIZE) {
+		while (SDL_AtomicGet(&pl->data[dN].summary[kN].busy) != 0) {
 
-			ERROR("Unable to decompress the chunk of %i dataset\n", dN);
+			SDL_CondWait(pl->range.done, pl->range.mutex);
 		}
+
+		SDL_UnlockMutex(pl->range.mutex);
 	}
 }
 
 static void
-plotDataChunkFetch(plot_t *pl, int dN, int kN)
+plotDataRangeInvalidate(plot_t *pl, int dN, int kN)
 {
-	if (		   pl->data[dN].raw[kN] == NULL
-			&& pl->data[dN].length_N != 0) {
-
-		plotDataCacheFetch(pl, dN, kN);
-	}
+	pl->data[dN].summary[kN].gen += 1;
 }
 
-static void
-plotDataChunkWrite(plot_t *pl, int dN, int kN)
+static int
+plotDataRangeAlloc(plot_t *pl, int dN, int kN)
 {
-	int		N;
+	int		cN;
 
-	if (		   pl->data[dN].raw[kN] == NULL
-			&& pl->data[dN].length_N != 0) {
+	if (pl->data[dN].summary[kN].fmin == NULL) {
 
-		plotDataCacheFetch(pl, dN, kN);
-	}
+		cN = pl->data[dN].column_N + PLOT_SUBTRACT;
 
-	if (pl->data[dN].raw[kN] != NULL) {
+		pl->data[dN].summary[kN].fmin = (fval_t *) malloc(sizeof(fval_t) * cN * 2);
+		pl->data[dN].summary[kN].raw = (void **) calloc(cN, sizeof(void *));
 
-		for (N = 0; N < PLOT_CHUNK_CACHE; ++N) {
+		if (		pl->data[dN].summary[kN].fmin == NULL
+				|| pl->data[dN].summary[kN].raw == NULL) {
 
-			if (pl->data[dN].cache[N].chunk_N == kN) {
+			ERROR("No memory allocated for range summary\n");
 
-				pl->data[dN].cache[N].dirty = 1;
-				break;
-			}
+			free(pl->data[dN].summary[kN].fmin);
+			free(pl->data[dN].summary[kN].raw);
+
+			pl->data[dN].summary[kN].fmin = NULL;
+			pl->data[dN].summary[kN].raw = NULL;
+
+			return -1;
 		}
+
+		pl->data[dN].summary[kN].fmax = pl->data[dN].summary[kN].fmin + cN;
 	}
+
+	return 0;
 }
 
-void plotDataAlloc(plot_t *pl, int dN, int cN, int lN)
+static int
+plotDataRangeLength(plot_t *pl, int dN, int kN)
 {
-	int		*map;
-	int		N, bSIZE;
+	int		lN;
 
-	if (dN < 0 || dN >= PLOT_DATASET_MAX) {
+	lN = pl->data[dN].length_N - (kN << pl->data[dN].chunk_SHIFT);
+	lN = (lN > (1 << pl->data[dN].chunk_SHIFT)) ? (1 << pl->data[dN].chunk_SHIFT) : lN;
 
-		ERROR("Dataset number is out of range\n");
-		return ;
-	}
+	return lN;
+}
 
-	if (cN < 1) {
+static void
+plotDataRangeQueue(plot_t *pl, int dN, int kN)
+{
+	plotColumn_t	*col;
+	const char	*map = NULL;
+	void		*raw;
+	int		cN, qN, job = 0, written = 0;
 
-		ERROR("Number of columns is too few\n");
+	if (pl->range.thread_N < 1)
 		return ;
-	}
 
-	if (lN < 1) {
+	if (		SDL_AtomicGet(&pl->data[dN].summary[kN].busy) != 0
+			|| (pl->data[dN].summary[kN].fmin != NULL
+				&& SDL_AtomicGet(&pl->data[dN].summary[kN].done)
+					== pl->data[dN].summary[kN].gen))
+		return ;
 
-		ERROR("Length of dataset is too short\n");
+	if (plotDataRangeAlloc(pl, dN, kN) != 0)
 		return ;
-	}
 
-	if (pl->data[dN].column_N != 0) {
+	/* We take the column chunks that are in memory now. Others are
+	 * scanned by UI thread when the column is asked for.
+	 * */
+	for (cN = 0; cN < pl->data[dN].column_N + PLOT_SUBTRACT; ++cN) {
 
-		if (pl->data[dN].column_N != cN) {
+		col = pl->data[dN].col + cN;
+		raw = (col->chunk != NULL) ? col->chunk[kN].raw : NULL;
 
-			ERROR("Number of columns cannot be changed\n");
-			return ;
-		}
+		pl->data[dN].summary[kN].raw[cN] = raw;
 
-		plotSketchClean(pl);
+		job += (raw != NULL) ? 1 : 0;
+		written += (col->chunk != NULL && col->chunk[kN].lz != NULL) ? 1 : 0;
+	}
 
-		plotDataRangeCacheClean(pl, dN);
-		plotDataChunkAlloc(pl, dN, lN);
+	if (		job == 0 && written == 0
+			&& pl->data[dN].mapped.raw != NULL
+			&& ((kN + 1) << pl->data[dN].chunk_SHIFT)
+				<= pl->data[dN].mapped.length_N) {
 
-		pl->data[dN].head_N = 0;
-		pl->data[dN].tail_N = 0;
-		pl->data[dN].id_N = 0;
-		pl->data[dN].sub_N = 0;
+		/* Chunk is not in memory so we scan the mapping.
+		 * */
+		map = pl->data[dN].mapped.raw + (long long) (kN << pl->data[dN].chunk_SHIFT)
+			* pl->data[dN].column_N * pl->data[dN].mapped.fsize;
 	}
-	else {
-		pl->data[dN].column_N = cN;
 
-		for (N = 0; N < 30; ++N) {
-
-			bSIZE = sizeof(fval_t) * (cN + PLOT_SUBTRACT) * (1UL << N);
+	if (job == 0 && map == NULL)
+		return ;
 
-			if (bSIZE >= PLOT_CHUNK_SIZE) {
+	SDL_LockMutex(pl->range.mutex);
 
-				pl->data[dN].chunk_SHIFT = N;
-				pl->data[dN].chunk_MASK = (1UL << N) - 1UL;
-				pl->data[dN].chunk_bSIZE = bSIZE;
-				break;
-			}
-		}
+	qN = (pl->range.head + 1) % PLOT_RANGE_QUEUE;
 
-		pl->data[dN].lz4_compress = pl->lz4_compress;
+	if (qN != pl->range.tail) {
 
-		plotDataChunkAlloc(pl, dN, lN);
+		pl->range.queue[pl->range.head].data_N = dN;
+		pl->range.queue[pl->range.head].chunk_N = kN;
+		pl->range.queue[pl->range.head].gen = pl->data[dN].summary[kN].gen;
+		pl->range.queue[pl->range.head].map = map;
+		pl->range.queue[pl->range.head].sub = 0;
+		pl->range.queue[pl->range.head].row_N = 0;
+		pl->range.queue[pl->range.head].id_N = 0;
+		pl->range.queue[pl->range.head].length_N = plotDataRangeLength(pl, dN, kN);
+		pl->range.queue[pl->range.head].fsize = pl->data[dN].mapped.fsize;
 
-		pl->data[dN].cache_ID = 0;
+		pl->range.head = qN;
 
-		pl->data[dN].head_N = 0;
-		pl->data[dN].tail_N = 0;
-		pl->data[dN].id_N = 0;
-		pl->data[dN].sub_N = 0;
+		SDL_AtomicSet(&pl->data[dN].summary[kN].busy, 1);
 
-		for (N = 0; N < PLOT_SUBTRACT; ++N) {
+		SDL_CondSignal(pl->range.cond);
+	}
 
-			pl->data[dN].sub[N].busy = SUBTRACT_FREE;
-		}
+	SDL_UnlockMutex(pl->range.mutex);
+}
 
-		map = (int *) malloc(sizeof(int) * (cN + PLOT_SUBTRACT + 1));
+static void
+plotDataRangeFree(plot_t *pl, int dN)
+{
+	int		kN;
 
-		if (map == NULL) {
+	for (kN = 0; kN < PLOT_CHUNK_MAX; ++kN) {
 
-			ERROR("No memory allocated for %i map\n", dN);
-			return ;
-		}
+		plotDataRangeWait(pl, dN, kN);
+		plotDataRangeInvalidate(pl, dN, kN);
 
-		pl->data[dN].map = (int *) map + 1;
+		if (pl->data[dN].summary[kN].fmin != NULL) {
 
-		for (N = -1; N < (cN + PLOT_SUBTRACT); ++N) {
+			free(pl->data[dN].summary[kN].fmin);
+			free(pl->data[dN].summary[kN].raw);
 
-			pl->data[dN].map[N] = -1;
+			pl->data[dN].summary[kN].fmin = NULL;
+			pl->data[dN].summary[kN].fmax = NULL;
+			pl->data[dN].summary[kN].raw = NULL;
 		}
 	}
 }
 
-void plotDataResize(plot_t *pl, int dN, int lN)
+static void
+plotDataLodBucket(fval_t *bk, const fval_t *fval, int length_N)
 {
-	if (dN < 0 || dN >= PLOT_DATASET_MAX) {
-
-		ERROR("Dataset number is out of range\n");
-		return ;
-	}
-
-	if (lN < 1) {
+	bk[0] = (fval_t) DBL_MAX;
+	bk[1] = (fval_t) - DBL_MAX;
 
-		ERROR("Length of dataset is too short\n");
-		return ;
-	}
-
-	if (pl->data[dN].column_N != 0) {
-
-		if (lN < pl->data[dN].length_N) {
-
-			pl->data[dN].head_N = 0;
-			pl->data[dN].tail_N = 0;
-			pl->data[dN].id_N = 0;
-			pl->data[dN].sub_N = 0;
-		}
+	plotDataRangeUpdate(fval, length_N, &bk[0], &bk[1]);
 
-		plotDataChunkAlloc(pl, dN, lN);
-	}
+	bk[2] = fval[0];
+	bk[3] = fval[length_N - 1];
 }
 
-int plotDataSpaceLeft(plot_t *pl, int dN)
+static void
+plotDataLodMerge(fval_t *bp, const fval_t *bc, int first)
 {
-	int		N;
+	if (first != 0) {
 
-	N = pl->data[dN].tail_N - pl->data[dN].head_N;
-	N += (N < 0) ? pl->data[dN].length_N : 0;
+		bp[0] = bc[0];
+		bp[1] = bc[1];
+		bp[2] = bc[2];
+	}
+	else {
+		bp[0] = (bc[0] < bp[0]) ? bc[0] : bp[0];
+		bp[1] = (bc[1] > bp[1]) ? bc[1] : bp[1];
+	}
 
-	return pl->data[dN].length_N - N;
+	bp[3] = bc[3];
 }
 
-void plotDataGrowUp(plot_t *pl, int dN)
+static void
+plotDataLodFree(plot_t *pl, int dN, int cN, int kN)
 {
-	int			lSHIFT, lN;
+	plotColumn_t	*col = pl->data[dN].col + cN;
 
-	lSHIFT = pl->data[dN].chunk_SHIFT;
+	if (col->chunk[kN].lod != NULL) {
 
-	lN = pl->data[dN].length_N;
-	lN = ((lN >> lSHIFT) + 1) << lSHIFT;
+		free(col->chunk[kN].lod);
 
-	plotDataResize(pl, dN, lN);
+		col->chunk[kN].lod = NULL;
+	}
 }
 
-static const fval_t *
-plotDataGet(plot_t *pl, int dN, int *rN)
+static void
+plotDataLodAlloc(plot_t *pl, int dN, int cN, int kN)
 {
-	const fval_t	*row = NULL;
-	int		lN, kN, jN;
-
-	if (*rN != pl->data[dN].tail_N) {
-
-		kN = *rN >> pl->data[dN].chunk_SHIFT;
-		jN = *rN & pl->data[dN].chunk_MASK;
+	plotColumn_t	*col = pl->data[dN].col + cN;
+	int		N, lSIZE, bSIZE;
 
-		if (pl->data[dN].lz4_compress != 0) {
+	if (		pl->data[dN].lod_N < 1
+			|| col->chunk[kN].lod != NULL)
+		return ;
 
-			plotDataChunkFetch(pl, dN, kN);
-		}
+	N = pl->data[dN].lod_N - 1;
 
-		row = pl->data[dN].raw[kN];
+	lSIZE = pl->data[dN].chunk_SHIFT - PLOT_LOD_BASE - PLOT_LOD_SHIFT * N;
+	bSIZE = pl->data[dN].lod_offset[N] + (1 << lSIZE) * 4;
 
-		if (row != NULL) {
+	col->chunk[kN].lod = (fval_t *) malloc(sizeof(fval_t) * bSIZE);
 
-			row += (pl->data[dN].column_N + PLOT_SUBTRACT) * jN;
+	if (col->chunk[kN].lod == NULL) {
 
-			lN = pl->data[dN].length_N;
-			*rN = (*rN < lN - 1) ? *rN + 1 : 0;
-		}
+		ERROR("No memory allocated for LOD of %i dataset\n", dN);
 	}
 
-	return row;
+	/* LOD is built on first use.
+	 * */
+	col->chunk[kN].dirty_min = 0;
+	col->chunk[kN].dirty_max = pl->data[dN].chunk_MASK;
 }
 
-static void
-plotDataRangeCacheWipe(plot_t *pl, int dN, int kN)
+plot_t *plotAlloc(draw_t *dw, scheme_t *sch)
 {
+	plot_t		*pl;
 	int		N;
 
-	for (N = 0; N < PLOT_RCACHE_SIZE; ++N) {
-
-		if (		pl->rcache[N].busy != 0
-				&& pl->rcache[N].data_N == dN) {
-
-			pl->rcache[N].chunk[kN].computed = 0;
-			pl->rcache[N].cached = 0;
-		}
-	}
-}
-
-static fval_t *
-plotDataWrite(plot_t *pl, int dN, int *rN)
-{
-	fval_t		*row = NULL;
-	int		lN, kN, jN;
+	pl = calloc(1, sizeof(plot_t));
 
-	if (*rN != pl->data[dN].tail_N) {
+	pl->dw = dw;
+	pl->sch = sch;
 
-		kN = *rN >> pl->data[dN].chunk_SHIFT;
-		jN = *rN & pl->data[dN].chunk_MASK;
+	for (N = 0; N < PLOT_SKETCH_MAX - 1; ++N)
+		pl->sketch[N].linked = N + 1;
 
-		if (pl->data[dN].lz4_compress != 0) {
+	pl->sketch[PLOT_SKETCH_MAX - 1].linked = -1;
 
-			plotDataChunkWrite(pl, dN, kN);
-		}
+	pl->sketch_list_garbage = 0;
+	pl->sketch_list_todraw = -1;
+	pl->sketch_list_current = -1;
+	pl->sketch_list_current_end = -1;
 
-		if (		   pl->rcache_wipe_data_N != dN
-				|| pl->rcache_wipe_chunk_N != kN) {
+	for (N = 0; N < PLOT_FIGURE_MAX; ++N)
+		pl->draw[N].list_self = -1;
 
-			plotDataRangeCacheWipe(pl, dN, kN);
+	pl->layout_font_long = 11;
+	pl->layout_font_space = 16;
+	pl->layout_border = 5;
+	pl->layout_tick_tooth = 5;
+	pl->layout_grid_dash = 2;
+	pl->layout_grid_space = 8;
+	pl->layout_drawing_dash = 8;
+	pl->layout_drawing_space = 12;
+	pl->layout_fence_dash = 10;
+	pl->layout_fence_space = 10;
+	pl->layout_fence_point = 10;
 
-			pl->rcache_wipe_data_N = dN;
-			pl->rcache_wipe_chunk_N = kN;
-		}
+	pl->interpolation = 1;
+	pl->defungap = 10;
 
-		row = pl->data[dN].raw[kN];
+	pl->mark_size = 40;
+	pl->mark_density = 40;
 
-		if (row != NULL) {
+	pl->default_drawing = FIGURE_DRAWING_LINE;
+	pl->default_width = 2;
 
-			row += (pl->data[dN].column_N + PLOT_SUBTRACT) * jN;
+	pl->transparency = 1;
+	pl->fprecision = 9;
+	pl->lz4_compress = 1;
 
-			lN = pl->data[dN].length_N;
-			*rN = (*rN < lN - 1) ? *rN + 1 : 0;
-		}
-	}
+	plotDataRangeStart(pl);
 
-	return row;
+	return pl;
 }
 
 static void
-plotDataSkip(plot_t *pl, int dN, int *rN, int *id_N, int iN)
+plotSketchFree(plot_t *pl)
 {
-	int		N, lN, tN;
+	int		N;
 
-	lN = pl->data[dN].length_N;
+	plotSketchClean(pl);
 
-	N = *rN - pl->data[dN].head_N;
-	N = (N < 0) ? N + lN : N;
+	for (N = 0; N < PLOT_SKETCH_MAX; ++N) {
 
-	tN = pl->data[dN].tail_N - pl->data[dN].head_N;
-	tN = (tN < 0) ? tN + lN : tN;
+		if (pl->sketch[N].chunk != NULL) {
 
-	iN = (N + iN < 0) ? - N : iN;
-	iN = (N + iN > tN) ? tN - N : iN;
+			free(pl->sketch[N].chunk);
 
-	N += iN;
+			pl->sketch[N].chunk = NULL;
+		}
+	}
+}
 
-	N = pl->data[dN].head_N + N;
-	N = (N > lN - 1) ? N - lN : N;
+void plotClean(plot_t *pl)
+{
+	int		dN;
 
-	if (rN != NULL) {
+	drawPixmapClean(pl->dw);
+	plotSketchFree(pl);
 
-		*rN = N;
-	}
+	plotDataRangeStop(pl);
 
-	if (id_N != NULL) {
+	for (dN = 0; dN < PLOT_DATASET_MAX; ++dN) {
 
-		*id_N += iN;
+		if (pl->data[dN].column_N != 0)
+			plotDataClean(pl, dN);
 	}
+
+	free(pl);
 }
 
-static int
-plotDataChunkN(plot_t *pl, int dN, int rN)
+static void
+plotFontLayout(plot_t *pl)
 {
-	int		kN;
+	TTF_SizeUTF8(pl->font, "M", &pl->layout_font_long, &pl->layout_font_height);
 
-	kN = rN >> pl->data[dN].chunk_SHIFT;
+	pl->layout_font_height = TTF_FontHeight(pl->font);
 
-	return kN;
+	pl->layout_font_space = pl->layout_font_long * 14 / 10;
+	pl->layout_axis_box = pl->layout_tick_tooth + pl->layout_font_height;
+	pl->layout_label_box = pl->layout_font_height;
+
+	pl->layout_mark_size = pl->layout_font_height * pl->mark_size / 200;
+	pl->layout_mark_size = (pl->layout_mark_size < 1) ? 1 : pl->layout_mark_size;
 }
 
-static void
-plotDataChunkSkip(plot_t *pl, int dN, int *rN, int *id_N)
+void plotFontDefault(plot_t *pl, int ttfnum, int ptsize, int style)
 {
-	int		skip_N, wrap_N;
+	if (pl->font != NULL) {
 
-	skip_N = (1UL << pl->data[dN].chunk_SHIFT)
-		- (*rN & pl->data[dN].chunk_MASK);
+		TTF_CloseFont(pl->font);
 
-	wrap_N = pl->data[dN].length_N - *rN;
-	skip_N = (wrap_N < skip_N) ? wrap_N : skip_N;
+		pl->font = NULL;
+	}
 
-	plotDataSkip(pl, dN, rN, id_N, skip_N);
+	switch (ttfnum) {
+
+		default:
+			ttfnum = TTF_ID_ROBOTO_MONO_NORMAL;
+
+		case TTF_ID_ROBOTO_MONO_NORMAL:
+			pl->font = TTF_OpenFontRW(TTF_RW_roboto_mono_normal(), 1, ptsize);
+			break;
+
+		case TTF_ID_ROBOTO_MONO_THIN:
+			pl->font = TTF_OpenFontRW(TTF_RW_roboto_mono_thin(), 1, ptsize);
+			break;
+	}
+
+	TTF_SetFontStyle(pl->font, style);
+
+	pl->layout_font_ttf = ttfnum;
+	pl->layout_font_pt = ptsize;
+
+	plotFontLayout(pl);
 }
 
-static tuple_t
-plotDataMedianAdd(plot_t *pl, int dN, int sN, double fval, double fpay)
+int plotFontOpen(plot_t *pl, const char *ttf, int ptsize, int style)
 {
-	int		index[PLOT_MEDIAN_MAX];
-	int		N, Nq, N0, N1, length, keep, tail, N_len;
+	if (pl->font != NULL) {
 
-	tuple_t		mN = { -1, -1 };
+		TTF_CloseFont(pl->font);
 
-	length = pl->data[dN].sub[sN].op.median.length;
-	keep = pl->data[dN].sub[sN].op.median.keep;
-	tail = pl->data[dN].sub[sN].op.median.tail;
+		pl->font = NULL;
+	}
 
-	pl->data[dN].sub[sN].op.median.window[tail].fval = fval;
-	pl->data[dN].sub[sN].op.median.window[tail].fpay = fpay;
+	pl->font = TTF_OpenFont(ttf, ptsize);
 
-	keep = (keep < length - 1) ? keep + 1 : length;
-	tail = (tail < length - 1) ? tail + 1 : 0;
+	if (pl->font == NULL) {
 
-	pl->data[dN].sub[sN].op.median.keep = keep;
-	pl->data[dN].sub[sN].op.median.tail = tail;
+		ERROR("TTF_OpenFont: \"%s\"\n", TTF_GetError());
+		return -1;
+	}
 
-	for (N = 0, N_len = 0; N < keep; ++N) {
+	TTF_SetFontStyle(pl->font, style);
 
-		fval = pl->data[dN].sub[sN].op.median.window[N].fval;
+	pl->layout_font_ttf = 0;
+	pl->layout_font_pt = ptsize;
 
-		if (fp_isfinite(fval)) {
+	plotFontLayout(pl);
 
-			index[N_len++] = N;
+	return 0;
+}
 
-			for (Nq = N_len - 1; Nq > 0; --Nq) {
+static void
+plotDataLayout(plot_t *pl, int dN)
+{
+	int		N, bSIZE, lSIZE;
 
-				N0 = index[Nq - 1];
-				N1 = index[Nq];
+	pl->data[dN].lod_N = 0;
+	bSIZE = 0;
 
-				fval = pl->data[dN].sub[sN].op.median.window[N0].fval;
-				fpay = pl->data[dN].sub[sN].op.median.window[N1].fval;
+	for (N = 0; N < PLOT_LOD_MAX; ++N) {
 
-				if (fval < fpay) {
+		lSIZE = pl->data[dN].chunk_SHIFT - PLOT_LOD_BASE - PLOT_LOD_SHIFT * N;
 
-					index[Nq - 1] = N1;
-					index[Nq] = N0;
-				}
-			}
-		}
-	}
+		if (lSIZE < 0)
+			break;
 
-	if (N_len > 0) {
+		pl->data[dN].lod_offset[N] = bSIZE;
+		pl->data[dN].lod_N = N + 1;
 
-		mN.X = index[N_len / 2];
-		mN.Y = mN.X;
+		bSIZE += (1 << lSIZE) * 4;
 	}
+}
+
+static void
+plotDataCacheDrop(plot_t *pl, int dN, int cN, int xN)
+{
+	plotColumn_t	*col = pl->data[dN].col + cN;
+	int		kNZ, lzLEN;
 
-	if (pl->data[dN].sub[sN].op.median.opdata != 0) {
+	kNZ = col->cache[xN].chunk_N;
 
-		for (N = 0, N_len = 0; N < keep; ++N) {
+	if (col->cache[xN].raw == NULL || kNZ < 0)
+		return ;
 
-			fval = pl->data[dN].sub[sN].op.median.window[N].fval;
-			fpay = pl->data[dN].sub[sN].op.median.window[N].fpay;
+	plotDataRangeWait(pl, dN, kNZ);
 
-			if (fp_isfinite(fval) && fp_isfinite(fpay)) {
+	if (col->chunk[kNZ].dirty != 0) {
 
-				index[N_len++] = N;
+		lzLEN = LZ4_compressBound(col->chunk_bSIZE);
 
-				for (Nq = N_len - 1; Nq > 0; --Nq) {
+		if (col->chunk[kNZ].lz != NULL) {
 
-					N0 = index[Nq - 1];
-					N1 = index[Nq];
+			free(col->chunk[kNZ].lz);
+		}
 
-					fval = pl->data[dN].sub[sN].op.median.window[N0].fpay;
-					fpay = pl->data[dN].sub[sN].op.median.window[N1].fpay;
+		col->chunk[kNZ].lz = (void *) malloc(lzLEN);
 
-					if (fval < fpay) {
+		if (col->chunk[kNZ].lz != NULL) {
 
-						index[Nq - 1] = N1;
-						index[Nq] = N0;
-					}
-				}
-			}
+			lzLEN = LZ4_compress_default((const char *) col->cache[xN].raw,
+					(char *) col->chunk[kNZ].lz, col->chunk_bSIZE, lzLEN);
+		}
+		else {
+			ERROR("Unable to allocate LZ4 memory of %i dataset\n", dN);
+
+			lzLEN = 0;
 		}
 
-		if (N_len > 0) {
+		if (lzLEN > 0) {
 
-			mN.Y = index[N_len / 2];
+			col->chunk[kNZ].lz = realloc(col->chunk[kNZ].lz, lzLEN);
+			col->chunk[kNZ].length = lzLEN;
+		}
+		else {
+			ERROR("Unable to compress the chunk of %i dataset\n", dN);
+
+			free(col->chunk[kNZ].lz);
+
+			col->chunk[kNZ].lz = NULL;
+			col->chunk[kNZ].length = 0;
 		}
 	}
 
-	return mN;
+	col->chunk[kNZ].raw = NULL;
+	col->chunk[kNZ].dirty = 0;
+
+	col->cache[xN].chunk_N = -1;
 }
 
-static void
-plotDataResample(plot_t *pl, int dN, int cNX, int cNY, int in_dN, int in_cNX, int in_cNY)
+static int
+plotDataColumnChunks(plot_t *pl, int dN, int cN, int kN)
 {
-	fval_t		*row, X, Y, X2, Y2, prev_X2, prev_Y2, Qf;
-	const fval_t	*prey;
+	plotColumn_t	*col = pl->data[dN].col + cN;
+	int		N;
 
-	int		rN, id_N, rN2, id_N2;
+	for (N = 0; N < PLOT_CHUNK_CACHE; ++N) {
 
-	rN = pl->data[dN].head_N;
-	id_N = pl->data[dN].id_N;
+		if (col->cache[N].chunk_N >= kN) {
 
-	rN2 = pl->data[in_dN].head_N;
-	id_N2 = pl->data[in_dN].id_N;
+			col->chunk[col->cache[N].chunk_N].raw = NULL;
+			col->chunk[col->cache[N].chunk_N].dirty = 0;
 
-	do {
-		prey = plotDataGet(pl, in_dN, &rN2);
+			col->cache[N].chunk_N = -1;
+		}
+	}
 
-		if (prey == NULL)
-			break;
+	for (N = kN; N < PLOT_CHUNK_MAX; ++N) {
 
-		X2 = (in_cNX < 0) ? id_N2 : prey[in_cNX];
-		Y2 = (in_cNY < 0) ? id_N2 : prey[in_cNY];
+		plotDataLodFree(pl, dN, cN, N);
 
-		id_N2++;
+		if (col->chunk[N].lz != NULL) {
 
-		if (fp_isfinite(X2))
-			break;
-	}
-	while (1);
+			free(col->chunk[N].lz);
 
-	if (id_N2 != pl->data[in_dN].id_N) {
+			col->chunk[N].lz = NULL;
+			col->chunk[N].length = 0;
+		}
 
-		prev_X2 = X2;
-		prev_Y2 = Y2;
+		if (		pl->data[dN].lz4_compress == 0
+				&& col->chunk[N].raw != NULL) {
+
+			free(col->chunk[N].raw);
+
+			col->chunk[N].raw = NULL;
+		}
 	}
-	else {
-		ERROR("No data to resample in dataset %i column %i\n", in_dN, in_cNX);
-		return ;
+
+	if (pl->data[dN].lz4_compress == 0) {
+
+		for (N = 0; N < kN; ++N) {
+
+			if (col->chunk[N].raw == NULL) {
+
+				col->chunk[N].raw = (void *) malloc(col->chunk_bSIZE);
+
+				if (col->chunk[N].raw == NULL) {
+
+					ERROR("Unable to allocate memory of %i dataset\n", dN);
+					return N;
+				}
+			}
+		}
 	}
 
-	do {
-		row = plotDataWrite(pl, dN, &rN);
+	return kN;
+}
 
-		if (row == NULL)
-			break;
+static int
+plotDataColumnUse(plot_t *pl, int dN, int cN)
+{
+	plotColumn_t	*col = pl->data[dN].col + cN;
+	int		N, kN;
 
-		X = (cNX < 0) ? id_N : row[cNX];
+	if (col->chunk != NULL)
+		return 0;
 
-		if (fp_isfinite(X)) {
+	col->chunk = calloc(PLOT_CHUNK_MAX, sizeof(col->chunk[0]));
 
-			do {
-				if (X2 >= X)
-					break;
+	if (col->chunk == NULL) {
 
-				prey = plotDataGet(pl, in_dN, &rN2);
+		ERROR("No memory allocated for column %i of %i dataset\n", cN, dN);
+		return -1;
+	}
 
-				if (prey == NULL)
-					break;
+	col->chunk_bSIZE = plotDataTypeSize(col->type) << pl->data[dN].chunk_SHIFT;
 
-				if (fp_isfinite(X2)) {
+	for (N = 0; N < PLOT_CHUNK_CACHE; ++N)
+		col->cache[N].chunk_N = -1;
 
-					prev_X2 = X2;
-					prev_Y2 = Y2;
-				}
+	col->cache_ID = 0;
 
-				X2 = (in_cNX < 0) ? id_N2 : prey[in_cNX];
-				Y2 = (in_cNY < 0) ? id_N2 : prey[in_cNY];
+	/* Column that came into use late gets the chunks up to the
+	 * current length of dataset.
+	 * */
+	kN = (pl->data[dN].length_N + pl->data[dN].chunk_MASK) >> pl->data[dN].chunk_SHIFT;
 
-				id_N2++;
-			}
-			while (1);
+	plotDataColumnChunks(pl, dN, cN, kN);
 
-			if (		pl->interpolation != 0
-					&& X2 >= X) {
+	return 0;
+}
 
-				if (		prev_X2 <= X
-						&& prev_X2 < X2) {
+static void
+plotDataColumnFree(plot_t *pl, int dN, int cN)
+{
+	plotColumn_t	*col = pl->data[dN].col + cN;
+	int		N;
 
-					Qf = (X - prev_X2) / (X2 - prev_X2);
-					Y = prev_Y2 + (Y2 - prev_Y2) * Qf;
-				}
-				else {
-					Y = prev_Y2;
-				}
-			}
-			else {
-				Y = Y2;
-			}
+	/* Caller waits for the workers to release all the chunks.
+	 * */
+	if (col->chunk == NULL)
+		return ;
+
+	for (N = 0; N < PLOT_CHUNK_CACHE; ++N) {
+
+		if (col->cache[N].raw != NULL) {
+
+			free(col->cache[N].raw);
+
+			col->cache[N].raw = NULL;
 		}
-		else {
-			Y = FP_NAN;
+
+		col->cache[N].chunk_N = -1;
+	}
+
+	for (N = 0; N < PLOT_CHUNK_MAX; ++N) {
+
+		plotDataLodFree(pl, dN, cN, N);
+
+		if (col->chunk[N].lz != NULL) {
+
+			free(col->chunk[N].lz);
 		}
 
-		row[cNY] = Y;
+		if (		pl->data[dN].lz4_compress == 0
+				&& col->chunk[N].raw != NULL) {
 
-		id_N++;
+			free(col->chunk[N].raw);
+		}
 	}
-	while (1);
+
+	free(col->chunk);
+
+	col->chunk = NULL;
 }
 
 static void
-plotDataPolyfit(plot_t *pl, int dN, int cNX, int cNY,
-		double scale_X, double offset_X,
-		double scale_Y, double offset_Y, int N0, int N1)
+plotDataChunkAlloc(plot_t *pl, int dN, int lN)
 {
-	const fval_t	*row;
-	double		fval_X, fval_Y, fvec[LSE_FULL_MAX];
-	int		N, xN, yN, kN, rN, id_N, job;
+	int		N, kN, cN, lSHIFT;
 
-	lse_construct(&pl->lsq, LSE_CASCADE_MAX, N1 - N0 + 1, 1);
+	lSHIFT = pl->data[dN].chunk_SHIFT;
 
-	xN = plotDataRangeCacheFetch(pl, dN, cNX);
-	yN = plotDataRangeCacheFetch(pl, dN, cNY);
+	kN = (lN & pl->data[dN].chunk_MASK) ? 1 : 0;
+	kN += lN >> lSHIFT;
 
-	rN = pl->data[dN].head_N;
-	id_N = pl->data[dN].id_N;
+	if (kN > PLOT_CHUNK_MAX) {
 
-	do {
-		kN = plotDataChunkN(pl, dN, rN);
-		job = 1;
+		kN = PLOT_CHUNK_MAX;
+		lN = kN * (1UL << lSHIFT);
+	}
 
-		if (xN >= 0 && pl->rcache[xN].chunk[kN].computed != 0) {
+	for (N = kN; N < PLOT_CHUNK_MAX; ++N) {
 
-			if (pl->rcache[xN].chunk[kN].finite != 0) {
+		plotDataRangeWait(pl, dN, N);
+		plotDataRangeInvalidate(pl, dN, N);
+	}
 
-				fvec[0] = pl->rcache[xN].chunk[kN].fmin * scale_X + offset_X;
-				fvec[1] = pl->rcache[xN].chunk[kN].fmax * scale_X + offset_X;
+	for (cN = 0; cN < pl->data[dN].column_N + PLOT_SUBTRACT; ++cN) {
 
-				if (fvec[0] > 1. || fvec[1] < 0.) {
+		if (pl->data[dN].col[cN].chunk == NULL)
+			continue;
 
-					job = 0;
-				}
-			}
-			else {
-				job = 0;
-			}
-		}
+		N = plotDataColumnChunks(pl, dN, cN, kN);
 
-		if (yN >= 0 && pl->rcache[yN].chunk[kN].computed != 0) {
+		if (N < kN) {
 
-			if (pl->rcache[yN].chunk[kN].finite != 0) {
+			lN = (lN < N * (1UL << lSHIFT)) ? lN : N * (1UL << lSHIFT);
+		}
+	}
 
-				fvec[0] = pl->rcache[yN].chunk[kN].fmin * scale_Y + offset_Y;
-				fvec[1] = pl->rcache[yN].chunk[kN].fmax * scale_Y + offset_Y;
+	pl->data[dN].length_N = lN;
+}
 
-				if (fvec[0] > 1. || fvec[1] < 0.) {
+unsigned long long plotDataMemoryUsage(plot_t *pl, int dN)
+{
+	plotColumn_t		*col;
+	int			N, cN;
+	unsigned long long	bUSAGE;
 
-					job = 0;
-				}
-			}
-			else {
-				job = 0;
-			}
-		}
+	if (dN < 0 || dN >= PLOT_DATASET_MAX) {
 
-		if (job != 0) {
+		ERROR("Dataset number is out of range\n");
+		return 0;
+	}
 
-			do {
-				if (kN != plotDataChunkN(pl, dN, rN))
-					break;
+	bUSAGE = 0;
 
-				row = plotDataGet(pl, dN, &rN);
+	for (cN = 0; cN < pl->data[dN].column_N + PLOT_SUBTRACT; ++cN) {
 
-				if (row == NULL)
-					break;
+		col = pl->data[dN].col + cN;
 
-				fval_X = (cNX < 0) ? id_N : row[cNX];
-				fval_Y = (cNY < 0) ? id_N : row[cNY];
+		if (col->chunk == NULL)
+			continue;
 
-				if (fp_isfinite(fval_X) && fp_isfinite(fval_Y)) {
+		for (N = 0; N < PLOT_CHUNK_MAX; ++N) {
 
-					fvec[0] = fval_X * scale_X + offset_X;
-					fvec[1] = fval_Y * scale_Y + offset_Y;
+			if (col->chunk[N].raw != NULL) {
 
-					if (		   fvec[0] >= 0. && fvec[0] <= 1.
-							&& fvec[1] >= 0. && fvec[1] <= 1.) {
+				bUSAGE += col->chunk_bSIZE;
+			}
 
-						fvec[0] = 1.;
+			if (col->chunk[N].lz != NULL) {
 
-						for (N = 0; N < N1; ++N)
-							fvec[N + 1] = fvec[N] * fval_X;
+				bUSAGE += col->chunk[N].length;
+			}
+		}
+	}
+
+	return bUSAGE;
+}
+
+unsigned long long plotDataMemoryUncompressed(plot_t *pl, int dN)
+{
+	plotColumn_t		*col;
+	int			N, cN;
+	unsigned long long	bUSAGE;
+
+	if (dN < 0 || dN >= PLOT_DATASET_MAX) {
+
+		ERROR("Dataset number is out of range\n");
+		return 0;
+	}
+
+	bUSAGE = 0;
+
+	for (cN = 0; cN < pl->data[dN].column_N + PLOT_SUBTRACT; ++cN) {
+
+		col = pl->data[dN].col + cN;
+
+		if (col->chunk == NULL)
+			continue;
+
+		for (N = 0; N < PLOT_CHUNK_MAX; ++N) {
+
+			if (		col->chunk[N].raw != NULL
+					|| col->chunk[N].lz != NULL) {
+
+				bUSAGE += col->chunk_bSIZE;
+			}
+		}
+	}
+
+	return bUSAGE;
+}
+
+unsigned long long plotDataMemoryCached(plot_t *pl, int dN)
+{
+	plotColumn_t		*col;
+	int			N, cN;
+	unsigned long long	bUSAGE;
+
+	if (dN < 0 || dN >= PLOT_DATASET_MAX) {
+
+		ERROR("Dataset number is out of range\n");
+		return 0;
+	}
+
+	bUSAGE = 0;
+
+	for (cN = 0; cN < pl->data[dN].column_N + PLOT_SUBTRACT; ++cN) {
+
+		col = pl->data[dN].col + cN;
+
+		if (col->chunk == NULL)
+			continue;
+
+		for (N = 0; N < PLOT_CHUNK_CACHE; ++N) {
+
+			if (col->cache[N].raw != NULL) {
+
+				bUSAGE += col->chunk_bSIZE;
+			}
+		}
+	}
+
+	return bUSAGE;
+}
+
+static int
+plotDataCacheGetNode(plot_t *pl, int dN, int cN)
+{
+	plotColumn_t	*col = pl->data[dN].col + cN;
+	int		N, kNOT, xN = -1;
+
+	for (N = 0; N < PLOT_CHUNK_CACHE; ++N) {
+
+		if (		col->cache[N].raw == NULL
+				|| col->cache[N].chunk_N < 0) {
+
+			xN = N;
+			break;
+		}
+	}
+
+	if (xN < 0) {
+
+		kNOT = pl->data[dN].tail_N >> pl->data[dN].chunk_SHIFT;
+
+		N = (col->cache_ID < PLOT_CHUNK_CACHE - 1)
+			? col->cache_ID + 1 : 0;
+
+		if (col->cache[N].chunk_N == kNOT) {
+
+			N = (N < PLOT_CHUNK_CACHE - 1) ? N + 1 : 0;
+		}
+
+		xN = N;
+
+		col->cache_ID = N;
+	}
+
+	return xN;
+}
+
+static void *
+plotDataCacheFetch(plot_t *pl, int dN, int cN, int kN)
+{
+	plotColumn_t	*col = pl->data[dN].col + cN;
+	void		*raw;
+	int		xN, jN, lzLEN;
+
+	xN = plotDataCacheGetNode(pl, dN, cN);
+
+	if (col->cache[xN].raw != NULL) {
+
+		plotDataCacheDrop(pl, dN, cN, xN);
+	}
+	else {
+		col->cache[xN].raw = (void *) malloc(col->chunk_bSIZE);
+
+		if (col->cache[xN].raw == NULL) {
+
+			ERROR("Unable to allocate cache of %i dataset\n", dN);
+			return NULL;
+		}
+	}
+
+	raw = col->cache[xN].raw;
+
+	col->cache[xN].chunk_N = kN;
+
+	col->chunk[kN].raw = raw;
+	col->chunk[kN].dirty = 0;
+
+	if (		col->chunk[kN].lz == NULL
+			&& pl->data[dN].mapped.raw != NULL
+			&& cN < pl->data[dN].column_N
+			&& (kN << pl->data[dN].chunk_SHIFT) < pl->data[dN].mapped.length_N) {
+
+		/* Chunk was not written since mapping so we take the column
+		 * from the file. Clean chunk is dropped on eviction.
+		 * */
+		jN = pl->data[dN].mapped.length_N - (kN << pl->data[dN].chunk_SHIFT);
+		jN = (jN > (1 << pl->data[dN].chunk_SHIFT)) ? (1 << pl->data[dN].chunk_SHIFT) : jN;
+
+		plotDataMapConvert(raw, col->type, pl->data[dN].mapped.raw
+				+ (long long) (kN << pl->data[dN].chunk_SHIFT)
+				* pl->data[dN].column_N * pl->data[dN].mapped.fsize,
+				pl->data[dN].mapped.fsize, jN, pl->data[dN].column_N, cN);
+	}
+	else if (col->chunk[kN].lz != NULL) {
+
+		lzLEN = LZ4_decompress_safe((const char *) col->chunk[kN].lz,
+				(char *) raw, col->chunk[kN].length, col->chunk_bSIZE);
+
+		if (lzLEN != col->chunk_bSIZE) {
+
+			ERROR("Unable to decompress the chunk of %i dataset\n", dN);
+		}
+	}
+	else {
+		memset(raw, 0, col->chunk_bSIZE);
+	}
+
+	return raw;
+}
+
+static void *
+plotDataChunkFetch(plot_t *pl, int dN, int cN, int kN)
+{
+	plotColumn_t	*col = pl->data[dN].col + cN;
+
+	if (col->chunk == NULL)
+		return NULL;
+
+	if (		col->chunk[kN].raw == NULL
+			&& pl->data[dN].lz4_compress != 0
+			&& pl->data[dN].length_N != 0) {
+
+		return plotDataCacheFetch(pl, dN, cN, kN);
+	}
+
+	return col->chunk[kN].raw;
+}
+
+static void *
+plotDataChunkWrite(plot_t *pl, int dN, int cN, int kN)
+{
+	plotColumn_t	*col = pl->data[dN].col + cN;
+	void		*raw;
+
+	if (plotDataColumnUse(pl, dN, cN) != 0)
+		return NULL;
+
+	raw = plotDataChunkFetch(pl, dN, cN, kN);
+
+	if (raw != NULL) {
+
+		col->chunk[kN].dirty = 1;
+	}
+
+	return raw;
+}
+
+void plotDataAlloc(plot_t *pl, int dN, int cN, int lN)
+{
+	int		*map;
+	int		N, bSIZE;
+
+	if (dN < 0 || dN >= PLOT_DATASET_MAX) {
+
+		ERROR("Dataset number is out of range\n");
+		return ;
+	}
+
+	if (cN < 1) {
+
+		ERROR("Number of columns is too few\n");
+		return ;
+	}
+
+	if (lN < 1) {
+
+		ERROR("Length of dataset is too short\n");
+		return ;
+	}
+
+	pl->data[dN].gen += 1;
+
+	if (pl->data[dN].column_N != 0) {
+
+		if (pl->data[dN].column_N != cN) {
+
+			ERROR("Number of columns cannot be changed\n");
+			return ;
+		}
+
+		plotSketchClean(pl);
+
+		for (N = 0; N < PLOT_CHUNK_MAX; ++N)
+			plotDataRangeWait(pl, dN, N);
+
+		pl->data[dN].sub_flight_head = 0;
+		pl->data[dN].sub_flight_tail = 0;
+
+		pl->data[dN].mapped.raw = NULL;
+		pl->data[dN].mapped.length_N = 0;
+
+		plotDataRangeCacheClean(pl, dN);
+		plotDataChunkAlloc(pl, dN, lN);
+
+		for (N = 0; N < PLOT_CHUNK_MAX; ++N)
+			plotDataRangeInvalidate(pl, dN, N);
+
+		pl->data[dN].head_N = 0;
+		pl->data[dN].tail_N = 0;
+		pl->data[dN].id_N = 0;
+		pl->data[dN].sub_N = 0;
+	}
+	else {
+		pl->data[dN].col = (plotColumn_t *) calloc(cN + PLOT_SUBTRACT,
+				sizeof(plotColumn_t));
+
+		if (pl->data[dN].col == NULL) {
+
+			ERROR("No memory allocated for %i dataset\n", dN);
+			return ;
+		}
+
+		pl->data[dN].column_N = cN;
+
+		/* Number of rows in chunk is taken for the file columns as
+		 * if they were double. Subtract columns have their own chunks
+		 * so they do not make the chunk shorter.
+		 * */
+		for (N = 0; N < 30; ++N) {
+
+			bSIZE = sizeof(fval_t) * cN * (1UL << N);
+
+			if (bSIZE >= PLOT_CHUNK_SIZE) {
+
+				pl->data[dN].chunk_SHIFT = N;
+				pl->data[dN].chunk_MASK = (1UL << N) - 1UL;
+				break;
+			}
+		}
+
+		plotDataLayout(pl, dN);
+
+		pl->data[dN].lz4_compress = pl->lz4_compress;
+		pl->data[dN].length_N = 0;
+
+		for (N = 0; N < cN; ++N)
+			plotDataColumnUse(pl, dN, N);
+
+		plotDataChunkAlloc(pl, dN, lN);
+
+		pl->data[dN].head_N = 0;
+		pl->data[dN].tail_N = 0;
+		pl->data[dN].id_N = 0;
+		pl->data[dN].sub_N = 0;
+
+		for (N = 0; N < PLOT_SUBTRACT; ++N) {
+
+			pl->data[dN].sub[N].busy = SUBTRACT_FREE;
+			pl->data[dN].sub[N].pending = 0;
+		}
+
+		map = (int *) malloc(sizeof(int) * (cN + PLOT_SUBTRACT + 1));
+
+		if (map == NULL) {
+
+			ERROR("No memory allocated for %i map\n", dN);
+			return ;
+		}
+
+		pl->data[dN].map = (int *) map + 1;
+
+		for (N = -1; N < (cN + PLOT_SUBTRACT); ++N) {
+
+			pl->data[dN].map[N] = -1;
+		}
+	}
+}
+
+void plotDataColumnType(plot_t *pl, int dN, int cN, int type)
+{
+	plotColumn_t	*col;
+	fval_t		*fval;
+	void		*temp, *raw;
+	int		N, kN, bSIZE, lzLEN;
+
+	if (dN < 0 || dN >= PLOT_DATASET_MAX) {
+
+		ERROR("Dataset number is out of range\n");
+		return ;
+	}
+
+	if (cN < 0 || cN >= pl->data[dN].column_N) {
+
+		ERROR("Column number %i is out of range\n", cN);
+		return ;
+	}
+
+	if (type != COLUMN_DOUBLE && type != COLUMN_FLOAT && type != COLUMN_INT) {
+
+		ERROR("Column type %i is unknown\n", type);
+		return ;
+	}
+
+	col = pl->data[dN].col + cN;
+
+	if (col->type == type)
+		return ;
+
+	if (col->chunk == NULL) {
+
+		col->type = type;
+		return ;
+	}
+
+	plotSketchClean(pl);
+
+	pl->data[dN].gen += 1;
+
+	for (kN = 0; kN < PLOT_CHUNK_MAX; ++kN) {
+
+		plotDataRangeWait(pl, dN, kN);
+		plotDataRangeInvalidate(pl, dN, kN);
+		plotDataLodFree(pl, dN, cN, kN);
+	}
+
+	/* Cached chunks are compressed back so we convert each chunk
+	 * in one place.
+	 * */
+	for (N = 0; N < PLOT_CHUNK_CACHE; ++N) {
+
+		plotDataCacheDrop(pl, dN, cN, N);
+
+		if (col->cache[N].raw != NULL) {
+
+			free(col->cache[N].raw);
+
+			col->cache[N].raw = NULL;
+		}
+	}
+
+	bSIZE = plotDataTypeSize(type) << pl->data[dN].chunk_SHIFT;
+
+	fval = (fval_t *) malloc(sizeof(fval_t) << pl->data[dN].chunk_SHIFT);
+	temp = (void *) malloc((col->chunk_bSIZE > bSIZE) ? col->chunk_bSIZE : bSIZE);
+
+	if (fval == NULL || temp == NULL) {
+
+		ERROR("No memory allocated for column %i of %i dataset\n", cN, dN);
+
+		free(fval);
+		free(temp);
+		return ;
+	}
+
+	for (kN = 0; kN < PLOT_CHUNK_MAX; ++kN) {
+
+		if (col->chunk[kN].lz != NULL) {
+
+			lzLEN = LZ4_decompress_safe((const char *) col->chunk[kN].lz,
+					(char *) temp, col->chunk[kN].length, col->chunk_bSIZE);
+
+			if (lzLEN != col->chunk_bSIZE) {
+
+				ERROR("Unable to decompress the chunk of %i dataset\n", dN);
+			}
+
+			plotDataTypeConvert(fval, temp, col->type, 0, 1 << pl->data[dN].chunk_SHIFT);
+
+			for (N = 0; N < (1 << pl->data[dN].chunk_SHIFT); ++N)
+				plotDataTypeStore(temp, type, N, fval[N]);
+
+			free(col->chunk[kN].lz);
+
+			lzLEN = LZ4_compressBound(bSIZE);
+
+			col->chunk[kN].lz = (void *) malloc(lzLEN);
+			col->chunk[kN].length = 0;
+
+			if (col->chunk[kN].lz != NULL) {
+
+				lzLEN = LZ4_compress_default((const char *) temp,
+						(char *) col->chunk[kN].lz, bSIZE, lzLEN);
+
+				if (lzLEN > 0) {
+
+					col->chunk[kN].lz = realloc(col->chunk[kN].lz, lzLEN);
+					col->chunk[kN].length = lzLEN;
+				}
+			}
+
+			if (col->chunk[kN].length == 0) {
+
+				ERROR("Unable to compress the chunk of %i dataset\n", dN);
+
+				free(col->chunk[kN].lz);
+
+				col->chunk[kN].lz = NULL;
+			}
+		}
+		else if (	pl->data[dN].lz4_compress == 0
+				&& col->chunk[kN].raw != NULL) {
+
+			plotDataTypeConvert(fval, col->chunk[kN].raw, col->type,
+					0, 1 << pl->data[dN].chunk_SHIFT);
+
+			free(col->chunk[kN].raw);
+
+			raw = (void *) malloc(bSIZE);
+
+			if (raw == NULL) {
+
+				ERROR("Unable to allocate memory of %i dataset\n", dN);
+			}
+			else {
+				for (N = 0; N < (1 << pl->data[dN].chunk_SHIFT); ++N)
+					plotDataTypeStore(raw, type, N, fval[N]);
+			}
+
+			col->chunk[kN].raw = raw;
+		}
+	}
+
+	free(fval);
+	free(temp);
+
+	col->type = type;
+	col->chunk_bSIZE = bSIZE;
+
+	plotDataRangeCacheClean(pl, dN);
+}
+
+void plotDataResize(plot_t *pl, int dN, int lN)
+{
+	int		N;
+
+	if (dN < 0 || dN >= PLOT_DATASET_MAX) {
+
+		ERROR("Dataset number is out of range\n");
+		return ;
+	}
+
+	if (lN < 1) {
+
+		ERROR("Length of dataset is too short\n");
+		return ;
+	}
+
+	if (pl->data[dN].column_N != 0) {
+
+		pl->data[dN].gen += 1;
+
+		for (N = 0; N < PLOT_CHUNK_MAX; ++N)
+			plotDataRangeWait(pl, dN, N);
+
+		pl->data[dN].sub_flight_head = 0;
+		pl->data[dN].sub_flight_tail = 0;
+
+		if (lN < pl->data[dN].length_N) {
+
+			pl->data[dN].head_N = 0;
+			pl->data[dN].tail_N = 0;
+			pl->data[dN].id_N = 0;
+			pl->data[dN].sub_N = 0;
+		}
+
+		plotDataChunkAlloc(pl, dN, lN);
+	}
+}
+
+int plotDataSpaceLeft(plot_t *pl, int dN)
+{
+	int		N;
+
+	N = pl->data[dN].tail_N - pl->data[dN].head_N;
+	N += (N < 0) ? pl->data[dN].length_N : 0;
+
+	return pl->data[dN].length_N - N;
+}
+
+void plotDataGrowUp(plot_t *pl, int dN)
+{
+	int			lSHIFT, lN;
+
+	lSHIFT = pl->data[dN].chunk_SHIFT;
+
+	lN = pl->data[dN].length_N;
+	lN = ((lN >> lSHIFT) + 1) << lSHIFT;
+
+	plotDataResize(pl, dN, lN);
+}
+
+static int
+plotDataGet(plot_t *pl, int dN, int *rN)
+{
+	int		lN, qN = -1;
+
+	if (*rN != pl->data[dN].tail_N) {
+
+		qN = *rN;
+
+		lN = pl->data[dN].length_N;
+		*rN = (*rN < lN - 1) ? *rN + 1 : 0;
+	}
+
+	return qN;
+}
+
+static fval_t
+plotDataFetch(plot_t *pl, int dN, int cN, int rN)
+{
+	const void	*raw;
+
+	raw = plotDataChunkFetch(pl, dN, cN, rN >> pl->data[dN].chunk_SHIFT);
+
+	return (raw != NULL) ? plotDataTypeLoad(raw, pl->data[dN].col[cN].type,
+			rN & pl->data[dN].chunk_MASK) : FP_NAN;
+}
+
+static void
+plotDataRangeCacheWipe(plot_t *pl, int dN, int kN)
+{
+	int		N;
+
+	for (N = 0; N < PLOT_RCACHE_SIZE; ++N) {
+
+		if (		pl->rcache[N].busy != 0
+				&& pl->rcache[N].data_N == dN) {
+
+			pl->rcache[N].chunk[kN].computed = 0;
+			pl->rcache[N].cached = 0;
+		}
+	}
+
+	plotDataRangeInvalidate(pl, dN, kN);
+}
+
+static void
+plotDataRangeCacheExtend(plot_t *pl, int dN)
+{
+	int		N;
+
+	for (N = 0; N < PLOT_RCACHE_SIZE; ++N) {
+
+		if (		pl->rcache[N].busy != 0
+				&& pl->rcache[N].data_N == dN) {
+
+			pl->rcache[N].cached = 0;
+		}
+	}
+}
+
+static int
+plotDataWrite(plot_t *pl, int dN, int *rN)
+{
+	int		lN, kN, qN = -1;
+
+	if (*rN != pl->data[dN].tail_N) {
+
+		kN = *rN >> pl->data[dN].chunk_SHIFT;
+
+		if (		   pl->rcache_wipe_data_N != dN
+				|| pl->rcache_wipe_chunk_N != kN) {
+
+			plotDataRangeCacheWipe(pl, dN, kN);
+
+			pl->rcache_wipe_data_N = dN;
+			pl->rcache_wipe_chunk_N = kN;
+		}
+
+		pl->data[dN].gen += 1;
+
+		qN = *rN;
+
+		lN = pl->data[dN].length_N;
+		*rN = (*rN < lN - 1) ? *rN + 1 : 0;
+	}
+
+	return qN;
+}
+
+static void
+plotDataLodDirty(plot_t *pl, int dN, int cN, int kN, int jN, int jN_end)
+{
+	plotColumn_t	*col = pl->data[dN].col + cN;
+
+	if (col->chunk != NULL && col->chunk[kN].lod != NULL) {
+
+		if (jN < col->chunk[kN].dirty_min)
+			col->chunk[kN].dirty_min = jN;
+
+		if (jN_end > col->chunk[kN].dirty_max)
+			col->chunk[kN].dirty_max = jN_end;
+	}
+}
+
+static void
+plotDataPut(plot_t *pl, int dN, int cN, int rN, fval_t fval)
+{
+	void		*raw;
+	int		kN, jN;
+
+	kN = rN >> pl->data[dN].chunk_SHIFT;
+	jN = rN & pl->data[dN].chunk_MASK;
+
+	raw = plotDataChunkWrite(pl, dN, cN, kN);
+
+	if (raw != NULL) {
+
+		plotDataTypeStore(raw, pl->data[dN].col[cN].type, jN, fval);
+		plotDataLodDirty(pl, dN, cN, kN, jN, jN);
+	}
+}
+
+static void
+plotDataLodRebuild(plot_t *pl, int dN, int cN, int kN)
+{
+	plotColumn_t	*col = pl->data[dN].col + cN;
+	fval_t		fval[1 << PLOT_LOD_BASE], *lod, *bp;
+	const void	*raw;
+	int		N, L, bN, bN_end, lN, jN, bSHIFT;
+
+	lod = col->chunk[kN].lod;
+
+	/* Subtract rows of the chunk may be still written by worker.
+	 * */
+	plotDataRangeWait(pl, dN, kN);
+
+	raw = plotDataChunkFetch(pl, dN, cN, kN);
+
+	if (raw == NULL)
+		return ;
+
+	lN = plotDataRangeLength(pl, dN, kN);
+
+	if (		pl->data[dN].head_N == 0
+			&& kN == (pl->data[dN].tail_N >> pl->data[dN].chunk_SHIFT)) {
+
+		/* Rows after the tail are not written yet.
+		 * */
+		lN = pl->data[dN].tail_N & pl->data[dN].chunk_MASK;
+	}
+
+	bN = col->chunk[kN].dirty_min >> PLOT_LOD_BASE;
+	bN_end = col->chunk[kN].dirty_max >> PLOT_LOD_BASE;
+
+	for (N = bN; N <= bN_end; ++N) {
+
+		jN = N << PLOT_LOD_BASE;
+
+		if (jN >= lN)
+			break;
+
+		jN = (lN - jN < (1 << PLOT_LOD_BASE)) ? lN - jN : (1 << PLOT_LOD_BASE);
+
+		plotDataTypeConvert(fval, raw, col->type, N << PLOT_LOD_BASE, jN);
+		plotDataLodBucket(lod + N * 4, fval, jN);
+	}
+
+	for (L = 1; L < pl->data[dN].lod_N; ++L) {
+
+		bN = bN >> PLOT_LOD_SHIFT;
+		bN_end = bN_end >> PLOT_LOD_SHIFT;
+
+		bSHIFT = PLOT_LOD_BASE + PLOT_LOD_SHIFT * L;
+
+		for (N = bN; N <= bN_end; ++N) {
+
+			bp = lod + pl->data[dN].lod_offset[L] + N * 4;
+
+			for (jN = 0; jN < (1 << PLOT_LOD_SHIFT); ++jN) {
+
+				if (((N << bSHIFT) + (jN << (bSHIFT - PLOT_LOD_SHIFT))) >= lN)
+					break;
+
+				plotDataLodMerge(bp, lod + pl->data[dN].lod_offset[L - 1]
+						+ ((N << PLOT_LOD_SHIFT) + jN) * 4, jN == 0);
+			}
+		}
+	}
+
+	col->chunk[kN].dirty_min = 1 << pl->data[dN].chunk_SHIFT;
+	col->chunk[kN].dirty_max = -1;
+}
+
+static const fval_t *
+plotDataLodChunk(plot_t *pl, int dN, int cN, int kN)
+{
+	plotColumn_t	*col = pl->data[dN].col + cN;
+
+	if (col->chunk == NULL)
+		return NULL;
+
+	if (col->chunk[kN].lod == NULL) {
+
+		plotDataLodAlloc(pl, dN, cN, kN);
+
+		if (col->chunk[kN].lod == NULL)
+			return NULL;
+	}
+
+	if (col->chunk[kN].dirty_max >= 0) {
+
+		plotDataLodRebuild(pl, dN, cN, kN);
+
+		if (col->chunk[kN].dirty_max >= 0)
+			return NULL;
+	}
+
+	return col->chunk[kN].lod;
+}
+
+static int
+plotDataLodGet(plot_t *pl, int dN, int rN, int xN, int yN, double scale,
+		const fval_t **bx, const fval_t **by)
+{
+	const fval_t	*lod_X = NULL, *lod_Y, *bp;
+	double		span;
+	int		L, kN, jN, tN, bSHIFT;
+
+	kN = rN >> pl->data[dN].chunk_SHIFT;
+	jN = rN & pl->data[dN].chunk_MASK;
+
+	if ((jN & ((1 << PLOT_LOD_BASE) - 1)) != 0)
+		return 0;
+
+	/* Bucket must not contain the tail as the rows after the tail are
+	 * not related to the dataset.
+	 * */
+	tN = pl->data[dN].tail_N;
+
+	if (rN == tN)
+		return 0;
+
+	tN = (rN < tN) ? tN : pl->data[dN].length_N;
+
+	if (xN >= 0) {
+
+		lod_X = plotDataLodChunk(pl, dN, xN, kN);
+
+		if (lod_X == NULL)
+			return 0;
+	}
+
+	for (L = pl->data[dN].lod_N - 1; L >= 0; --L) {
+
+		bSHIFT = PLOT_LOD_BASE + PLOT_LOD_SHIFT * L;
+
+		if (		(jN & ((1 << bSHIFT) - 1)) != 0
+				|| rN + (1 << bSHIFT) > tN)
+			continue;
+
+		bp = (lod_X != NULL) ? lod_X + pl->data[dN].lod_offset[L]
+			+ (jN >> bSHIFT) * 4 : NULL;
+
+		if (bp == NULL) {
+
+			span = (double) (1 << bSHIFT);
+		}
+		else if (bp[0] <= bp[1]) {
+
+			span = bp[1] - bp[0];
+		}
+		else {
+			continue;
+		}
+
+		/* We take the coarsest bucket that fits into one pixel. LOD
+		 * of Y column is only built when the bucket is found.
+		 * */
+		if (span * fabs(scale) < 1.) {
+
+			*bx = bp;
+			*by = NULL;
+
+			if (yN >= 0) {
+
+				lod_Y = plotDataLodChunk(pl, dN, yN, kN);
+
+				if (lod_Y == NULL)
+					return 0;
+
+				*by = lod_Y + pl->data[dN].lod_offset[L] + (jN >> bSHIFT) * 4;
+			}
+
+			return 1 << bSHIFT;
+		}
+	}
+
+	return 0;
+}
+
+static void
+plotDataSkip(plot_t *pl, int dN, int *rN, int *id_N, int iN)
+{
+	int		N, lN, tN;
+
+	lN = pl->data[dN].length_N;
+
+	N = *rN - pl->data[dN].head_N;
+	N = (N < 0) ? N + lN : N;
+
+	tN = pl->data[dN].tail_N - pl->data[dN].head_N;
+	tN = (tN < 0) ? tN + lN : tN;
+
+	iN = (N + iN < 0) ? - N : iN;
+	iN = (N + iN > tN) ? tN - N : iN;
+
+	N += iN;
+
+	N = pl->data[dN].head_N + N;
+	N = (N > lN - 1) ? N - lN : N;
+
+	if (rN != NULL) {
+
+		*rN = N;
+	}
+
+	if (id_N != NULL) {
+
+		*id_N += iN;
+	}
+}
+
+static int
+plotDataChunkN(plot_t *pl, int dN, int rN)
+{
+	int		kN;
+
+	kN = rN >> pl->data[dN].chunk_SHIFT;
+
+	return kN;
+}
+
+static void
+plotDataChunkSkip(plot_t *pl, int dN, int *rN, int *id_N)
+{
+	int		skip_N, wrap_N;
+
+	skip_N = (1UL << pl->data[dN].chunk_SHIFT)
+		- (*rN & pl->data[dN].chunk_MASK);
+
+	wrap_N = pl->data[dN].length_N - *rN;
+	skip_N = (wrap_N < skip_N) ? wrap_N : skip_N;
+
+	plotDataSkip(pl, dN, rN, id_N, skip_N);
+}
+
+static median_t *
+plotDataMedianAlloc(plot_t *pl, int dN, int sN)
+{
+	median_t	*md = pl->data[dN].sub[sN].md;
+	int		length, opdata;
+
+	length = pl->data[dN].sub[sN].op.median.length;
+	opdata = (pl->data[dN].sub[sN].busy == SUBTRACT_DATA_MEDIAN)
+		? pl->data[dN].sub[sN].op.median.opdata : 0;
+
+	if (		md != NULL
+			&& (md->length != length
+				|| (md->ly.next != NULL) != (opdata != 0))) {
+
+		median_free(md);
+		md = NULL;
+	}
+
+	if (md == NULL) {
+
+		md = median_alloc(length, opdata);
+
+		if (md == NULL) {
+
+			ERROR("No memory allocated for median of %i dataset\n", dN);
+		}
+	}
+
+	pl->data[dN].sub[sN].md = md;
+
+	return md;
+}
+
+static void
+plotDataResample(plot_t *pl, int dN, int cNX, int cNY, int in_dN, int in_cNX, int in_cNY)
+{
+	fval_t		X, Y, X2, Y2, prev_X2, prev_Y2, Qf;
+	int		qN, qN2, rN, id_N, rN2, id_N2;
+
+	rN = pl->data[dN].head_N;
+	id_N = pl->data[dN].id_N;
+
+	rN2 = pl->data[in_dN].head_N;
+	id_N2 = pl->data[in_dN].id_N;
+
+	do {
+		qN2 = plotDataGet(pl, in_dN, &rN2);
+
+		if (qN2 < 0)
+			break;
+
+		X2 = (in_cNX < 0) ? id_N2 : plotDataFetch(pl, in_dN, in_cNX, qN2);
+		Y2 = (in_cNY < 0) ? id_N2 : plotDataFetch(pl, in_dN, in_cNY, qN2);
+
+		id_N2++;
+
+		if (fp_isfinite(X2))
+			break;
+	}
+	while (1);
+
+	if (id_N2 != pl->data[in_dN].id_N) {
+
+		prev_X2 = X2;
+		prev_Y2 = Y2;
+	}
+	else {
+		ERROR("No data to resample in dataset %i column %i\n", in_dN, in_cNX);
+		return ;
+	}
+
+	do {
+		qN = plotDataWrite(pl, dN, &rN);
+
+		if (qN < 0)
+			break;
+
+		X = (cNX < 0) ? id_N : plotDataFetch(pl, dN, cNX, qN);
+
+		if (fp_isfinite(X)) {
+
+			do {
+				if (X2 >= X)
+					break;
+
+				qN2 = plotDataGet(pl, in_dN, &rN2);
+
+				if (qN2 < 0)
+					break;
+
+				if (fp_isfinite(X2)) {
+
+					prev_X2 = X2;
+					prev_Y2 = Y2;
+				}
+
+				X2 = (in_cNX < 0) ? id_N2 : plotDataFetch(pl, in_dN, in_cNX, qN2);
+				Y2 = (in_cNY < 0) ? id_N2 : plotDataFetch(pl, in_dN, in_cNY, qN2);
+
+				id_N2++;
+			}
+			while (1);
+
+			if (		pl->interpolation != 0
+					&& X2 >= X) {
+
+				if (		prev_X2 <= X
+						&& prev_X2 < X2) {
+
+					Qf = (X - prev_X2) / (X2 - prev_X2);
+					Y = prev_Y2 + (Y2 - prev_Y2) * Qf;
+				}
+				else {
+					Y = prev_Y2;
+				}
+			}
+			else {
+				Y = Y2;
+			}
+		}
+		else {
+			Y = FP_NAN;
+		}
+
+		plotDataPut(pl, dN, cNY, qN, Y);
+
+		id_N++;
+	}
+	while (1);
+}
+
+static void
+plotDataPolyfit(plot_t *pl, int dN, int cNX, int cNY,
+		double scale_X, double offset_X,
+		double scale_Y, double offset_Y, int N0, int N1)
+{
+	double		fval_X, fval_Y, fvec[LSE_FULL_MAX];
+	lse_float_t	fblk[LSE_BLOCK_MAX * LSE_FULL_MAX];
+	int		N, xN, yN, kN, qN, rN, id_N, job, bN = 0;
+
+	lse_construct(&pl->lsq, LSE_CASCADE_MAX, N1 - N0 + 1, 1);
+
+	xN = plotDataRangeCacheFetch(pl, dN, cNX);
+	yN = plotDataRangeCacheFetch(pl, dN, cNY);
+
+	rN = pl->data[dN].head_N;
+	id_N = pl->data[dN].id_N;
+
+	do {
+		kN = plotDataChunkN(pl, dN, rN);
+		job = 1;
+
+		if (xN >= 0 && pl->rcache[xN].chunk[kN].computed != 0) {
+
+			if (pl->rcache[xN].chunk[kN].finite != 0) {
+
+				fvec[0] = pl->rcache[xN].chunk[kN].fmin * scale_X + offset_X;
+				fvec[1] = pl->rcache[xN].chunk[kN].fmax * scale_X + offset_X;
+
+				if (fvec[0] > 1. || fvec[1] < 0.) {
+
+					job = 0;
+				}
+			}
+			else {
+				job = 0;
+			}
+		}
+
+		if (yN >= 0 && pl->rcache[yN].chunk[kN].computed != 0) {
+
+			if (pl->rcache[yN].chunk[kN].finite != 0) {
+
+				fvec[0] = pl->rcache[yN].chunk[kN].fmin * scale_Y + offset_Y;
+				fvec[1] = pl->rcache[yN].chunk[kN].fmax * scale_Y + offset_Y;
+
+				if (fvec[0] > 1. || fvec[1] < 0.) {
+
+					job = 0;
+				}
+			}
+			else {
+				job = 0;
+			}
+		}
+
+		if (job != 0) {
+
+			do {
+				if (kN != plotDataChunkN(pl, dN, rN))
+					break;
+
+				qN = plotDataGet(pl, dN, &rN);
+
+				if (qN < 0)
+					break;
+
+				fval_X = (cNX < 0) ? id_N : plotDataFetch(pl, dN, cNX, qN);
+				fval_Y = (cNY < 0) ? id_N : plotDataFetch(pl, dN, cNY, qN);
+
+				if (fp_isfinite(fval_X) && fp_isfinite(fval_Y)) {
+
+					fvec[0] = fval_X * scale_X + offset_X;
+					fvec[1] = fval_Y * scale_Y + offset_Y;
+
+					if (		   fvec[0] >= 0. && fvec[0] <= 1.
+							&& fvec[1] >= 0. && fvec[1] <= 1.) {
+
+						fvec[0] = 1.;
+
+						for (N = 0; N < N1; ++N)
+							fvec[N + 1] = fvec[N] * fval_X;
+
+						for (N = 0; N < N1 - N0 + 1; ++N)
+							fvec[N] = fvec[N + N0];
+
+						fvec[N1 - N0 + 1] = fval_Y;
+
+						for (N = 0; N < N1 - N0 + 2; ++N)
+							fblk[bN * (N1 - N0 + 2) + N] = fvec[N];
+
+						bN++;
+
+						if (bN >= LSE_BLOCK_MAX) {
+
+							lse_insert_block(&pl->lsq, fblk, bN);
+							bN = 0;
+						}
+					}
+				}
+
+				id_N++;
+			}
+			while (1);
+		}
+		else {
+			plotDataChunkSkip(pl, dN, &rN, &id_N);
+		}
+
+		if (rN == pl->data[dN].tail_N)
+			break;
+	}
+	while (1);
+
+	if (bN > 0) {
+
+		lse_insert_block(&pl->lsq, fblk, bN);
+	}
+
+	lse_solve(&pl->lsq);
+	lse_std(&pl->lsq);
+}
+
+static void
+plotDataFileCSV(plot_t *pl, int *list_dN, int *list_cN, int len_N, FILE *fd_csv)
+{
+	char		numfmt[PLOT_STRING_MAX];
+
+	fval_t		fval;
+	int		N, dN, job;
+
+	struct {
+
+		int		qN;
+		int		rN;
+		int		id_N;
+	}
+	local[PLOT_DATASET_MAX];
+
+	for (dN = 0; dN < PLOT_DATASET_MAX; ++dN) {
+
+		job = 0;
+
+		if (pl->data[dN].column_N != 0) {
+
+			for (N = 0; N < len_N; ++N) {
+
+				if (list_dN[N] == dN) {
+
+					job = 1;
+					break;
+				}
+			}
+		}
+
+		if (job != 0) {
+
+			local[dN].qN = 0;
+			local[dN].rN = pl->data[dN].head_N;
+			local[dN].id_N = pl->data[dN].id_N;
+		}
+		else {
+			local[dN].qN = -1;
+		}
+	}
+
+	do {
+		job = 0;
+
+		for (dN = 0; dN < PLOT_DATASET_MAX; ++dN) {
+
+			if (local[dN].qN >= 0) {
+
+				local[dN].qN = plotDataGet(pl, dN, &local[dN].rN);
+			}
+
+			if (local[dN].qN >= 0)
+				job = 1;
+		}
+
+		if (job == 0)
+			break;
+
+		for (N = 0; N < len_N; ++N) {
+
+			dN = list_dN[N];
+
+			if (local[dN].qN >= 0) {
+
+				fval = (list_cN[N] < 0) ? local[dN].id_N
+					: plotDataFetch(pl, dN, list_cN[N], local[dN].qN);
+
+				sprintf(numfmt, "%%.%iE;", pl->fprecision - 1);
+				fprintf(fd_csv, numfmt, fval);
+			}
+			else {
+				fprintf(fd_csv, "NAN;");
+			}
+		}
+
+		fprintf(fd_csv, "\n");
+
+		for (dN = 0; dN < PLOT_DATASET_MAX; ++dN) {
+
+			if (local[dN].qN >= 0)
+				local[dN].id_N++;
+		}
+	}
+	while (1);
+}
+
+static int
+plotDataSubtractOperand(plot_t *pl, int dN, int sN, int list[3])
+{
+	int		N = 0;
+
+	switch (pl->data[dN].sub[sN].busy) {
+
+		case SUBTRACT_TIME_MEDIAN:
+		case SUBTRACT_FILTER_MEDIAN:
+			list[N++] = pl->data[dN].sub[sN].op.median.column_1;
+			break;
+
+		case SUBTRACT_DATA_MEDIAN:
+			list[N++] = pl->data[dN].sub[sN].op.median.column_1;
+			list[N++] = pl->data[dN].sub[sN].op.median.column_2;
+			list[N++] = pl->data[dN].sub[sN].op.median.column_3;
+			break;
+
+		case SUBTRACT_SCALE:
+			list[N++] = pl->data[dN].sub[sN].op.scale.column_1;
+			break;
+
+		case SUBTRACT_RESAMPLE:
+			list[N++] = pl->data[dN].sub[sN].op.resample.column_X;
+			break;
+
+		case SUBTRACT_POLYFIT:
+			list[N++] = pl->data[dN].sub[sN].op.polyfit.column_X;
+			list[N++] = pl->data[dN].sub[sN].op.polyfit.column_Y;
+			break;
+
+		case SUBTRACT_BINARY_SUBTRACTION:
+		case SUBTRACT_BINARY_ADDITION:
+		case SUBTRACT_BINARY_MULTIPLICATION:
+		case SUBTRACT_BINARY_HYPOTENUSE:
+			list[N++] = pl->data[dN].sub[sN].op.binary.column_1;
+			list[N++] = pl->data[dN].sub[sN].op.binary.column_2;
+			break;
+
+		case SUBTRACT_FILTER_DIFFERENCE:
+		case SUBTRACT_FILTER_CUMULATIVE:
+		case SUBTRACT_FILTER_BITMASK:
+		case SUBTRACT_FILTER_LOW_PASS:
+			list[N++] = pl->data[dN].sub[sN].op.filter.column_1;
+			break;
+
+		default:
+			break;
+	}
+
+	return N;
+}
+
+static void
+plotDataSubtractWrite(plot_t *pl, int dN, int sN, int rN_beg, int id_N_beg, int rN_end)
+{
+	fval_t		X1, X2, X3, X4;
+	double		scale, offset, gain;
+	int		cN, qN, rN, id_N, cN1, cN2, cN3, mode;
+
+	mode = pl->data[dN].sub[sN].busy;
+
+	if (mode != SUBTRACT_FREE) {
+
+		cN = sN + pl->data[dN].column_N;
+
+		rN = rN_beg;
+		id_N = id_N_beg;
+	}
+
+	if (mode == SUBTRACT_TIME_MEDIAN) {
+
+		/* Do not to calculate HERE */
+	}
+	else if (mode == SUBTRACT_DATA_MEDIAN) {
+
+		median_t	*md = pl->data[dN].sub[sN].md;
+		tuple_t		mN;
+
+		if (rN_beg == pl->data[dN].head_N || md == NULL) {
+
+			md = plotDataMedianAlloc(pl, dN, sN);
+
+			if (md == NULL)
+				return ;
+
+			median_reset(md);
+
+			pl->data[dN].sub[sN].op.median.offset = (double) 0.;
+			pl->data[dN].sub[sN].op.median.prev[0] = FP_NAN;
+			pl->data[dN].sub[sN].op.median.prev[1] = FP_NAN;
+		}
+
+		cN1 = pl->data[dN].sub[sN].op.median.column_1;
+		cN2 = pl->data[dN].sub[sN].op.median.column_2;
+		cN3 = pl->data[dN].sub[sN].op.median.column_3;
+
+		offset = pl->data[dN].sub[sN].op.median.offset;
+
+		if (pl->data[dN].sub[sN].op.median.unwrap != 0) {
+
+			X3 = (fval_t) pl->data[dN].sub[sN].op.median.prev[0];
+			X4 = (fval_t) pl->data[dN].sub[sN].op.median.prev[1];
+		}
+
+		do {
+			qN = plotDataWrite(pl, dN, &rN);
+
+			if (qN < 0)
+				break;
+
+			X1 = (cN1 < 0) ? id_N : plotDataFetch(pl, dN, cN1, qN);
+			X2 = (cN2 < 0) ? id_N : plotDataFetch(pl, dN, cN2, qN);
+
+			median_insert(md, X1, X2);
+
+			mN.X = median_get_X(md);
+			mN.Y = median_get_Y(md);
+			mN.Y = (mN.Y < 0) ? mN.X : mN.Y;
+
+			if (mN.X < 0) {
+
+				X1 = FP_NAN;
+				X2 = FP_NAN;
+			}
+			else {
+				X1 = md->fval[mN.X];
+				X2 = md->fpay[mN.Y];
+			}
+
+			if (pl->data[dN].sub[sN].op.median.unwrap != 0) {
+
+				if (X1 + (fval_t) pl->defungap < X3) {
+
+					offset += X3 - X1;
+
+					if (X4 < X3) {
+
+						offset += X3 - X4;
+					}
+				}
+
+				if (fp_isfinite(X1)) {
+
+					X4 = X3;
+					X3 = X1;
+				}
+			}
 
-						for (N = 0; N < N1 - N0 + 1; ++N)
-							fvec[N] = fvec[N + N0];
+			plotDataPut(pl, dN, cN3, qN, X1 + offset);
+			plotDataPut(pl, dN, cN, qN, X2);
+
+			id_N++;
+
+			if (rN == rN_end)
+				break;
+		}
+		while (1);
+
+		pl->data[dN].sub[sN].op.median.offset = offset;
+
+		if (pl->data[dN].sub[sN].op.median.unwrap != 0) {
+
+			pl->data[dN].sub[sN].op.median.prev[0] = (double) X3;
+			pl->data[dN].sub[sN].op.median.prev[1] = (double) X4;
+		}
+	}
+	else if (mode == SUBTRACT_SCALE) {
+
+		cN1 = pl->data[dN].sub[sN].op.scale.column_1;
+		scale = pl->data[dN].sub[sN].op.scale.scale;
+		offset = pl->data[dN].sub[sN].op.scale.offset;
+
+		do {
+			qN = plotDataWrite(pl, dN, &rN);
+
+			if (qN < 0)
+				break;
+
+			X1 = (cN1 < 0) ? id_N : plotDataFetch(pl, dN, cN1, qN);
+			X1 = X1 * scale + offset;
+
+			plotDataPut(pl, dN, cN, qN, X1);
+
+			id_N++;
+
+			if (rN == rN_end)
+				break;
+		}
+		while (1);
+	}
+	else if (mode == SUBTRACT_RESAMPLE) {
+
+		/* Do not to calculate HERE */
+	}
+	else if (mode == SUBTRACT_POLYFIT) {
+
+		const double	*coefs;
+		int		N, N0, N1;
+
+		cN1 = pl->data[dN].sub[sN].op.polyfit.column_X;
+		N0 = pl->data[dN].sub[sN].op.polyfit.poly_N0;
+		N1 = pl->data[dN].sub[sN].op.polyfit.poly_N1;
+		coefs = pl->data[dN].sub[sN].op.polyfit.coefs;
+
+		do {
+			qN = plotDataWrite(pl, dN, &rN);
+
+			if (qN < 0)
+				break;
+
+			X1 = (cN1 < 0) ? id_N : plotDataFetch(pl, dN, cN1, qN);
+			X2 = coefs[N1 - N0];
+
+			for (N = N1 - N0 - 1; N >= 0; --N)
+				X2 = X2 * X1 + coefs[N];
+
+			for (N = N0 - 1; N >= 0; --N)
+				X2 = X2 * X1;
+
+			plotDataPut(pl, dN, cN, qN, X2);
+
+			id_N++;
+
+			if (rN == rN_end)
+				break;
+		}
+		while (1);
+	}
+	else if (mode == SUBTRACT_BINARY_SUBTRACTION) {
+
+		cN1 = pl->data[dN].sub[sN].op.binary.column_1;
+		cN2 = pl->data[dN].sub[sN].op.binary.column_2;
+
+		do {
+			qN = plotDataWrite(pl, dN, &rN);
+
+			if (qN < 0)
+				break;
+
+			X1 = (cN1 < 0) ? id_N : plotDataFetch(pl, dN, cN1, qN);
+			X2 = (cN2 < 0) ? id_N : plotDataFetch(pl, dN, cN2, qN);
+
+			plotDataPut(pl, dN, cN, qN, X1 - X2);
+
+			id_N++;
+
+			if (rN == rN_end)
+				break;
+		}
+		while (1);
+	}
+	else if (mode == SUBTRACT_BINARY_ADDITION) {
+
+		cN1 = pl->data[dN].sub[sN].op.binary.column_1;
+		cN2 = pl->data[dN].sub[sN].op.binary.column_2;
+
+		do {
+			qN = plotDataWrite(pl, dN, &rN);
+
+			if (qN < 0)
+				break;
+
+			X1 = (cN1 < 0) ? id_N : plotDataFetch(pl, dN, cN1, qN);
+			X2 = (cN2 < 0) ? id_N : plotDataFetch(pl, dN, cN2, qN);
+
+			plotDataPut(pl, dN, cN, qN, X1 + X2);
+
+			id_N++;
+
+			if (rN == rN_end)
+				break;
+		}
+		while (1);
+	}
+	else if (mode == SUBTRACT_BINARY_MULTIPLICATION) {
+
+		cN1 = pl->data[dN].sub[sN].op.binary.column_1;
+		cN2 = pl->data[dN].sub[sN].op.binary.column_2;
+
+		do {
+			qN = plotDataWrite(pl, dN, &rN);
+
+			if (qN < 0)
+				break;
+
+			X1 = (cN1 < 0) ? id_N : plotDataFetch(pl, dN, cN1, qN);
+			X2 = (cN2 < 0) ? id_N : plotDataFetch(pl, dN, cN2, qN);
+
+			plotDataPut(pl, dN, cN, qN, X1 * X2);
+
+			id_N++;
+
+			if (rN == rN_end)
+				break;
+		}
+		while (1);
+	}
+	else if (mode == SUBTRACT_BINARY_HYPOTENUSE) {
+
+		cN1 = pl->data[dN].sub[sN].op.binary.column_1;
+		cN2 = pl->data[dN].sub[sN].op.binary.column_2;
+
+		do {
+			qN = plotDataWrite(pl, dN, &rN);
+
+			if (qN < 0)
+				break;
+
+			X1 = (cN1 < 0) ? id_N : plotDataFetch(pl, dN, cN1, qN);
+			X2 = (cN2 < 0) ? id_N : plotDataFetch(pl, dN, cN2, qN);
+
+			plotDataPut(pl, dN, cN, qN, sqrt(X1 * X1 + X2 * X2));
+
+			id_N++;
+
+			if (rN == rN_end)
+				break;
+		}
+		while (1);
+	}
+	else if (mode == SUBTRACT_FILTER_DIFFERENCE) {
+
+		if (rN_beg == pl->data[dN].head_N) {
+
+			pl->data[dN].sub[sN].op.filter.state = FP_NAN;
+		}
+
+		cN1 = pl->data[dN].sub[sN].op.filter.column_1;
+		X2 = (fval_t) pl->data[dN].sub[sN].op.filter.state;
+
+		do {
+			qN = plotDataWrite(pl, dN, &rN);
+
+			if (qN < 0)
+				break;
+
+			X1 = (cN1 < 0) ? id_N : plotDataFetch(pl, dN, cN1, qN);
+
+			plotDataPut(pl, dN, cN, qN, X1 - X2);
+
+			X2 = X1;
+
+			id_N++;
+
+			if (rN == rN_end)
+				break;
+		}
+		while (1);
+
+		pl->data[dN].sub[sN].op.filter.state = (double) X2;
+	}
+	else if (mode == SUBTRACT_FILTER_CUMULATIVE) {
+
+		if (rN_beg == pl->data[dN].head_N) {
+
+			pl->data[dN].sub[sN].op.filter.state = 0.;
+		}
+
+		cN1 = pl->data[dN].sub[sN].op.filter.column_1;
+		X2 = (fval_t) pl->data[dN].sub[sN].op.filter.state;
+
+		do {
+			qN = plotDataWrite(pl, dN, &rN);
+
+			if (qN < 0)
+				break;
+
+			X1 = (cN1 < 0) ? id_N : plotDataFetch(pl, dN, cN1, qN);
+
+			if (fp_isfinite(X1)) {
+
+				X2 += X1;
+			}
+
+			plotDataPut(pl, dN, cN, qN, X2);
+
+			id_N++;
+
+			if (rN == rN_end)
+				break;
+		}
+		while (1);
+
+		pl->data[dN].sub[sN].op.filter.state = (double) X2;
+	}
+	else if (mode == SUBTRACT_FILTER_BITMASK) {
+
+		unsigned long	shift, mask, ulval;
+
+		cN1 = pl->data[dN].sub[sN].op.filter.column_1;
+		ulval = (unsigned long) pl->data[dN].sub[sN].op.filter.gain;
+
+		shift = ulval & 0xFFU;
+		ulval = ulval >> 8;
+
+		mask = ((1U << (ulval - shift + 1U)) - 1U) << shift;
+
+		do {
+			qN = plotDataWrite(pl, dN, &rN);
+
+			if (qN < 0)
+				break;
+
+			X1 = (cN1 < 0) ? id_N : plotDataFetch(pl, dN, cN1, qN);
+
+			ulval = ((unsigned long) X1 & mask) >> shift;
+			plotDataPut(pl, dN, cN, qN, (fval_t) ulval);
+
+			id_N++;
+
+			if (rN == rN_end)
+				break;
+		}
+		while (1);
+	}
+	else if (mode == SUBTRACT_FILTER_LOW_PASS) {
+
+		if (rN_beg == pl->data[dN].head_N) {
+
+			pl->data[dN].sub[sN].op.filter.state = FP_NAN;
+		}
+
+		cN1 = pl->data[dN].sub[sN].op.filter.column_1;
+		gain = pl->data[dN].sub[sN].op.filter.gain;
+		X2 = (fval_t) pl->data[dN].sub[sN].op.filter.state;
+
+		do {
+			qN = plotDataWrite(pl, dN, &rN);
+
+			if (qN < 0)
+				break;
+
+			X1 = (cN1 < 0) ? id_N : plotDataFetch(pl, dN, cN1, qN);
+
+			if (fp_isfinite(X1)) {
+
+				if (fp_isfinite(X2)) {
+
+					X2 += (X1 - X2) * gain;
+				}
+				else {
+					X2 = X1;
+				}
+			}
 
-						fvec[N1 - N0 + 1] = fval_Y;
+			plotDataPut(pl, dN, cN, qN, X2);
 
-						lse_insert(&pl->lsq, fvec);
-					}
-				}
+			id_N++;
 
-				id_N++;
-			}
-			while (1);
-		}
-		else {
-			plotDataChunkSkip(pl, dN, &rN, &id_N);
+			if (rN == rN_end)
+				break;
 		}
+		while (1);
 
-		if (rN == pl->data[dN].tail_N)
-			break;
+		pl->data[dN].sub[sN].op.filter.state = (double) X2;
 	}
-	while (1);
+	else if (mode == SUBTRACT_FILTER_MEDIAN) {
 
-	lse_solve(&pl->lsq);
-	lse_std(&pl->lsq);
-}
+		median_t	*md = pl->data[dN].sub[sN].md;
+		int		mN;
 
-static void
-plotDataFileCSV(plot_t *pl, int *list_dN, int *list_cN, int len_N, FILE *fd_csv)
-{
-	char		numfmt[PLOT_STRING_MAX];
+		if (rN_beg == pl->data[dN].head_N || md == NULL) {
 
-	fval_t		fval;
-	int		N, dN, job;
+			md = plotDataMedianAlloc(pl, dN, sN);
 
-	struct {
+			if (md == NULL)
+				return ;
 
-		const fval_t	*row;
+			median_reset(md);
+		}
 
-		int		rN;
-		int		id_N;
-	}
-	local[PLOT_DATASET_MAX];
+		cN1 = pl->data[dN].sub[sN].op.median.column_1;
 
-	for (dN = 0; dN < PLOT_DATASET_MAX; ++dN) {
+		do {
+			qN = plotDataWrite(pl, dN, &rN);
 
-		job = 0;
+			if (qN < 0)
+				break;
 
-		if (pl->data[dN].column_N != 0) {
+			X1 = (cN1 < 0) ? id_N : plotDataFetch(pl, dN, cN1, qN);
 
-			for (N = 0; N < len_N; ++N) {
+			median_insert(md, X1, X1);
 
-				if (list_dN[N] == dN) {
+			mN = median_get_X(md);
 
-					job = 1;
-					break;
-				}
-			}
-		}
+			X2 = (mN < 0) ? FP_NAN : md->fval[mN];
 
-		if (job != 0) {
+			plotDataPut(pl, dN, cN, qN, X2);
 
-			local[dN].row = (const fval_t *) 1;
-			local[dN].rN = pl->data[dN].head_N;
-			local[dN].id_N = pl->data[dN].id_N;
-		}
-		else {
-			local[dN].row = NULL;
+			id_N++;
+
+			if (rN == rN_end)
+				break;
 		}
+		while (1);
 	}
+}
 
-	do {
-		job = 0;
+static void
+plotDataSubtractResample(plot_t *pl, int dN, int sN)
+{
+	int		cNX, cNY, in_dN, in_cNX, in_cNY;
 
-		for (dN = 0; dN < PLOT_DATASET_MAX; ++dN) {
+	if (pl->data[dN].sub[sN].busy == SUBTRACT_RESAMPLE) {
 
-			if (local[dN].row != NULL) {
+		cNX = pl->data[dN].sub[sN].op.resample.column_X;
+		cNY = sN + pl->data[dN].column_N;
 
-				local[dN].row = plotDataGet(pl, dN, &local[dN].rN);
-			}
+		in_dN = pl->data[dN].sub[sN].op.resample.in_data_N;
+		in_cNX = pl->data[dN].sub[sN].op.resample.in_column_X;
+		in_cNY = pl->data[dN].sub[sN].op.resample.in_column_Y;
 
-			if (local[dN].row != NULL)
-				job = 1;
-		}
+		plotDataResample(pl, dN, cNX, cNY, in_dN, in_cNX, in_cNY);
+	}
+}
 
-		if (job == 0)
-			break;
+static void
+plotDataSubtractWriteSeq(plot_t *pl, int dN, int rN_beg, int id_N_beg, int rN_end)
+{
+	int		N;
 
-		for (N = 0; N < len_N; ++N) {
+	for (N = 0; N < PLOT_SUBTRACT; ++N) {
 
-			dN = list_dN[N];
+		if (pl->data[dN].sub[N].pending == 0) {
 
-			if (local[dN].row != NULL) {
+			plotDataSubtractWrite(pl, dN, N, rN_beg, id_N_beg, rN_end);
+		}
+	}
+}
 
-				fval = (list_cN[N] < 0) ? local[dN].id_N
-					: local[dN].row[list_cN[N]];
+static int
+plotDataSubtractPending(plot_t *pl, int dN, int cN)
+{
+	cN -= pl->data[dN].column_N;
 
-				sprintf(numfmt, "%%.%iE;", pl->fprecision - 1);
-				fprintf(fd_csv, numfmt, fval);
-			}
-			else {
-				fprintf(fd_csv, "NAN;");
-			}
-		}
+	return (cN >= 0 && cN < PLOT_SUBTRACT) ? pl->data[dN].sub[cN].pending : 0;
+}
 
-		fprintf(fd_csv, "\n");
+static int
+plotDataSubtractStateless(int mode)
+{
+	return (	mode == SUBTRACT_SCALE
+			|| mode == SUBTRACT_BINARY_SUBTRACTION
+			|| mode == SUBTRACT_BINARY_ADDITION
+			|| mode == SUBTRACT_BINARY_MULTIPLICATION
+			|| mode == SUBTRACT_BINARY_HYPOTENUSE) ? 1 : 0;
+}
 
-		for (dN = 0; dN < PLOT_DATASET_MAX; ++dN) {
+static int
+plotDataSubtractMarked(plot_t *pl, int dN, const int *mark, int cN, int flag)
+{
+	int		sN;
 
-			if (local[dN].row != NULL)
-				local[dN].id_N++;
-		}
+	for (sN = 0; sN < PLOT_SUBTRACT; ++sN) {
+
+		if (mark[sN] != flag)
+			continue;
+
+		if (		sN + pl->data[dN].column_N == cN
+				|| (	pl->data[dN].sub[sN].busy == SUBTRACT_DATA_MEDIAN
+					&& pl->data[dN].sub[sN].op.median.column_3 == cN))
+			return 1;
 	}
-	while (1);
+
+	return 0;
 }
 
 static void
-plotDataSubtractWrite(plot_t *pl, int dN, int sN, int rN_beg, int id_N_beg, int rN_end)
+plotDataSubtractParallel(plot_t *pl, int dN)
 {
-	fval_t		*row, X1, X2, X3, X4;
-	double		scale, offset, gain;
-	int		cN, rN, id_N, cN1, cN2, cN3, mode;
+	int		N, sN, cN, op_N, mark[PLOT_SUBTRACT], list[3];
 
-	mode = pl->data[dN].sub[sN].busy;
+	pl->data[dN].sub_op_N = 0;
 
-	if (mode != SUBTRACT_FREE) {
+	for (sN = 0; sN < PLOT_SUBTRACT; ++sN) {
 
-		cN = sN + pl->data[dN].column_N;
+		pl->data[dN].sub[sN].parallel = 0;
 
-		rN = rN_beg;
-		id_N = id_N_beg;
+		mark[sN] = (pl->data[dN].sub[sN].pending != 0
+			&& plotDataSubtractStateless(pl->data[dN].sub[sN].busy) == 0) ? 1 : 0;
 	}
 
-	if (mode == SUBTRACT_TIME_MEDIAN) {
+	if (pl->range.thread_N < 1)
+		return ;
 
-		/* Do not to calculate HERE */
-	}
-	else if (mode == SUBTRACT_DATA_MEDIAN) {
+	/* Scale and binary subtracts have no state between the rows so they
+	 * are computed by workers chunk by chunk. Subtract that takes its
+	 * operand from sequential one is left sequential too.
+	 * */
+	for (sN = 0; sN < PLOT_SUBTRACT; ++sN) {
 
-		tuple_t		mN;
+		if (		pl->data[dN].sub[sN].pending == 0
+				|| mark[sN] != 0)
+			continue;
 
-		if (rN_beg == pl->data[dN].head_N) {
+		mark[sN] = 2;
 
-			pl->data[dN].sub[sN].op.median.keep = 0;
-			pl->data[dN].sub[sN].op.median.tail = 0;
+		N = plotDataSubtractOperand(pl, dN, sN, list);
 
-			pl->data[dN].sub[sN].op.median.offset = (double) 0.;
-			pl->data[dN].sub[sN].op.median.prev[0] = FP_NAN;
-			pl->data[dN].sub[sN].op.median.prev[1] = FP_NAN;
-		}
+		while (N > 0) {
 
-		cN1 = pl->data[dN].sub[sN].op.median.column_1;
-		cN2 = pl->data[dN].sub[sN].op.median.column_2;
-		cN3 = pl->data[dN].sub[sN].op.median.column_3;
+			cN = list[--N];
 
-		offset = pl->data[dN].sub[sN].op.median.offset;
+			if (plotDataSubtractMarked(pl, dN, mark, cN, 1) != 0)
+				mark[sN] = 1;
 
-		if (pl->data[dN].sub[sN].op.median.unwrap != 0) {
+			cN -= pl->data[dN].column_N;
 
-			X3 = (fval_t) pl->data[dN].sub[sN].op.median.prev[0];
-			X4 = (fval_t) pl->data[dN].sub[sN].op.median.prev[1];
+			if (		cN > sN && cN < PLOT_SUBTRACT
+					&& pl->data[dN].sub[cN].pending != 0)
+				mark[sN] = 1;
 		}
+	}
 
-		do {
-			row = plotDataWrite(pl, dN, &rN);
+	/* Sequential subtract is computed before the chunk is passed to the
+	 * worker so it cannot take its operand from the parallel one.
+	 * */
+	for (sN = 0; sN < PLOT_SUBTRACT; ++sN) {
 
-			if (row == NULL)
-				break;
+		if (mark[sN] != 1)
+			continue;
 
-			X1 = (cN1 < 0) ? id_N : row[cN1];
-			X2 = (cN2 < 0) ? id_N : row[cN2];
+		N = plotDataSubtractOperand(pl, dN, sN, list);
 
-			mN = plotDataMedianAdd(pl, dN, sN, X1, X2);
+		while (N > 0) {
 
-			if (mN.X < 0) {
+			if (plotDataSubtractMarked(pl, dN, mark, list[--N], 2) != 0)
+				return ;
+		}
+	}
 
-				X1 = FP_NAN;
-				X2 = FP_NAN;
-			}
-			else {
-				X1 = pl->data[dN].sub[sN].op.median.window[mN.X].fval;
-				X2 = pl->data[dN].sub[sN].op.median.window[mN.Y].fpay;
-			}
+	op_N = 0;
 
-			if (pl->data[dN].sub[sN].op.median.unwrap != 0) {
+	for (sN = 0; sN < PLOT_SUBTRACT; ++sN) {
 
-				if (X1 + (fval_t) pl->defungap < X3) {
+		if (mark[sN] != 2)
+			continue;
 
-					offset += X3 - X1;
+		pl->data[dN].sub_op[op_N].mode = pl->data[dN].sub[sN].busy;
+		pl->data[dN].sub_op[op_N].column = sN + pl->data[dN].column_N;
 
-					if (X4 < X3) {
+		if (pl->data[dN].sub[sN].busy == SUBTRACT_SCALE) {
 
-						offset += X3 - X4;
-					}
-				}
+			pl->data[dN].sub_op[op_N].column_1 = pl->data[dN].sub[sN].op.scale.column_1;
+			pl->data[dN].sub_op[op_N].column_2 = -1;
+			pl->data[dN].sub_op[op_N].scale = pl->data[dN].sub[sN].op.scale.scale;
+			pl->data[dN].sub_op[op_N].offset = pl->data[dN].sub[sN].op.scale.offset;
+		}
+		else {
+			pl->data[dN].sub_op[op_N].column_1 = pl->data[dN].sub[sN].op.binary.column_1;
+			pl->data[dN].sub_op[op_N].column_2 = pl->data[dN].sub[sN].op.binary.column_2;
+			pl->data[dN].sub_op[op_N].scale = 1.;
+			pl->data[dN].sub_op[op_N].offset = 0.;
+		}
 
-				if (fp_isfinite(X1)) {
+		pl->data[dN].sub[sN].parallel = 1;
 
-					X4 = X3;
-					X3 = X1;
-				}
-			}
+		op_N++;
+	}
 
-			row[cN3] = X1 + offset;
-			row[cN] = X2;
+	pl->data[dN].sub_op_N = op_N;
+}
 
-			id_N++;
+static int
+plotDataSubtractQueue(plot_t *pl, int dN, int rN, int id_N, int lN)
+{
+	void		**raw;
+	int		N, fN, qN, kN, jN, cN, rc = -1;
 
-			if (rN == rN_end)
-				break;
-		}
-		while (1);
+	fN = (pl->data[dN].sub_flight_head + 1) % PLOT_SUBTRACT_FLIGHT;
 
-		pl->data[dN].sub[sN].op.median.offset = offset;
+	if (		fN == pl->data[dN].sub_flight_tail
+			|| pl->range.thread_N < 1)
+		return -1;
 
-		if (pl->data[dN].sub[sN].op.median.unwrap != 0) {
+	kN = plotDataChunkN(pl, dN, rN);
+	jN = rN & pl->data[dN].chunk_MASK;
 
-			pl->data[dN].sub[sN].op.median.prev[0] = (double) X3;
-			pl->data[dN].sub[sN].op.median.prev[1] = (double) X4;
-		}
-	}
-	else if (mode == SUBTRACT_SCALE) {
+	/* Chunk may be still scanned by worker that would read the rows
+	 * we are about to write.
+	 * */
+	plotDataRangeWait(pl, dN, kN);
 
-		cN1 = pl->data[dN].sub[sN].op.scale.column_1;
-		scale = pl->data[dN].sub[sN].op.scale.scale;
-		offset = pl->data[dN].sub[sN].op.scale.offset;
+	if (plotDataRangeAlloc(pl, dN, kN) != 0)
+		return -1;
 
-		do {
-			row = plotDataWrite(pl, dN, &rN);
+	raw = pl->data[dN].summary[kN].raw;
 
-			if (row == NULL)
-				break;
+	for (cN = 0; cN < pl->data[dN].column_N + PLOT_SUBTRACT; ++cN)
+		raw[cN] = NULL;
 
-			X1 = (cN1 < 0) ? id_N : row[cN1];
-			X1 = X1 * scale + offset;
+	/* Worker is given the column chunks of operands and results only.
+	 * */
+	for (N = 0; N < pl->data[dN].sub_op_N; ++N) {
 
-			row[cN] = X1;
+		cN = pl->data[dN].sub_op[N].column_1;
 
-			id_N++;
+		if (cN >= 0 && raw[cN] == NULL)
+			raw[cN] = plotDataChunkFetch(pl, dN, cN, kN);
 
-			if (rN == rN_end)
-				break;
-		}
-		while (1);
-	}
-	else if (mode == SUBTRACT_RESAMPLE) {
+		cN = pl->data[dN].sub_op[N].column_2;
 
-		/* Do not to calculate HERE */
+		if (cN >= 0 && raw[cN] == NULL)
+			raw[cN] = plotDataChunkFetch(pl, dN, cN, kN);
+
+		cN = pl->data[dN].sub_op[N].column;
+
+		raw[cN] = plotDataChunkWrite(pl, dN, cN, kN);
 	}
-	else if (mode == SUBTRACT_POLYFIT) {
 
-		const double	*coefs;
-		int		N, N0, N1;
+	for (N = 0; N < pl->data[dN].sub_op_N; ++N) {
 
-		cN1 = pl->data[dN].sub[sN].op.polyfit.column_X;
-		N0 = pl->data[dN].sub[sN].op.polyfit.poly_N0;
-		N1 = pl->data[dN].sub[sN].op.polyfit.poly_N1;
-		coefs = pl->data[dN].sub[sN].op.polyfit.coefs;
+		if (		(pl->data[dN].sub_op[N].column_1 >= 0
+					&& raw[pl->data[dN].sub_op[N].column_1] == NULL)
+				|| (pl->data[dN].sub_op[N].column_2 >= 0
+					&& raw[pl->data[dN].sub_op[N].column_2] == NULL)
+				|| raw[pl->data[dN].sub_op[N].column] == NULL)
+			return -1;
+	}
 
-		do {
-			row = plotDataWrite(pl, dN, &rN);
+	plotDataRangeCacheWipe(pl, dN, kN);
 
-			if (row == NULL)
-				break;
+	pl->data[dN].gen += 1;
 
-			X1 = (cN1 < 0) ? id_N : row[cN1];
-			X2 = coefs[N1 - N0];
+	SDL_LockMutex(pl->range.mutex);
 
-			for (N = N1 - N0 - 1; N >= 0; --N)
-				X2 = X2 * X1 + coefs[N];
+	qN = (pl->range.head + 1) % PLOT_RANGE_QUEUE;
 
-			for (N = N0 - 1; N >= 0; --N)
-				X2 = X2 * X1;
+	if (qN != pl->range.tail) {
 
-			row[cN] = X2;
+		pl->range.queue[pl->range.head].data_N = dN;
+		pl->range.queue[pl->range.head].chunk_N = kN;
+		pl->range.queue[pl->range.head].gen = pl->data[dN].summary[kN].gen;
+		pl->range.queue[pl->range.head].map = NULL;
+		pl->range.queue[pl->range.head].sub = 1;
+		pl->range.queue[pl->range.head].row_N = jN;
+		pl->range.queue[pl->range.head].id_N = id_N;
+		pl->range.queue[pl->range.head].length_N = lN;
+		pl->range.queue[pl->range.head].fsize = 0;
 
-			id_N++;
+		pl->range.head = qN;
 
-			if (rN == rN_end)
-				break;
-		}
-		while (1);
-	}
-	else if (mode == SUBTRACT_BINARY_SUBTRACTION) {
+		SDL_AtomicAdd(&pl->data[dN].summary[kN].busy, 1);
 
-		cN1 = pl->data[dN].sub[sN].op.binary.column_1;
-		cN2 = pl->data[dN].sub[sN].op.binary.column_2;
+		SDL_CondSignal(pl->range.cond);
 
-		do {
-			row = plotDataWrite(pl, dN, &rN);
+		rc = 0;
+	}
 
-			if (row == NULL)
-				break;
+	SDL_UnlockMutex(pl->range.mutex);
 
-			X1 = (cN1 < 0) ? id_N : row[cN1];
-			X2 = (cN2 < 0) ? id_N : row[cN2];
+	if (rc == 0) {
 
-			row[cN] = X1 - X2;
+		fN = pl->data[dN].sub_flight_head;
 
-			id_N++;
+		pl->data[dN].sub_flight[fN].chunk_N = kN;
+		pl->data[dN].sub_flight[fN].row_N = rN;
+		pl->data[dN].sub_flight[fN].id_N = id_N;
+		pl->data[dN].sub_flight[fN].length_N = lN;
 
-			if (rN == rN_end)
-				break;
-		}
-		while (1);
+		pl->data[dN].sub_flight_head = (fN + 1) % PLOT_SUBTRACT_FLIGHT;
 	}
-	else if (mode == SUBTRACT_BINARY_ADDITION) {
 
-		cN1 = pl->data[dN].sub[sN].op.binary.column_1;
-		cN2 = pl->data[dN].sub[sN].op.binary.column_2;
-
-		do {
-			row = plotDataWrite(pl, dN, &rN);
+	return rc;
+}
 
-			if (row == NULL)
-				break;
+static void
+plotDataSubtractRetire(plot_t *pl, int dN, int wait)
+{
+	int		N, fN, kN, jN;
 
-			X1 = (cN1 < 0) ? id_N : row[cN1];
-			X2 = (cN2 < 0) ? id_N : row[cN2];
+	while (pl->data[dN].sub_flight_tail != pl->data[dN].sub_flight_head) {
 
-			row[cN] = X1 + X2;
+		fN = pl->data[dN].sub_flight_tail;
+		kN = pl->data[dN].sub_flight[fN].chunk_N;
 
-			id_N++;
+		if (SDL_AtomicGet(&pl->data[dN].summary[kN].busy) != 0) {
 
-			if (rN == rN_end)
+			if (wait == 0)
 				break;
-		}
-		while (1);
-	}
-	else if (mode == SUBTRACT_BINARY_MULTIPLICATION) {
 
-		cN1 = pl->data[dN].sub[sN].op.binary.column_1;
-		cN2 = pl->data[dN].sub[sN].op.binary.column_2;
+			plotDataRangeWait(pl, dN, kN);
+		}
 
-		do {
-			row = plotDataWrite(pl, dN, &rN);
+		SDL_MemoryBarrierAcquire();
 
-			if (row == NULL)
-				break;
+		/* Rows are written so we drop the summary and range cache
+		 * that may have been taken meanwhile and mark the LOD.
+		 * */
+		plotDataRangeCacheWipe(pl, dN, kN);
 
-			X1 = (cN1 < 0) ? id_N : row[cN1];
-			X2 = (cN2 < 0) ? id_N : row[cN2];
+		pl->data[dN].gen += 1;
 
-			row[cN] = X1 * X2;
+		jN = pl->data[dN].sub_flight[fN].row_N & pl->data[dN].chunk_MASK;
 
-			id_N++;
+		for (N = 0; N < pl->data[dN].sub_op_N; ++N) {
 
-			if (rN == rN_end)
-				break;
+			plotDataLodDirty(pl, dN, pl->data[dN].sub_op[N].column, kN,
+					jN, jN + pl->data[dN].sub_flight[fN].length_N - 1);
 		}
-		while (1);
+
+		pl->data[dN].sub_flight_tail = (fN + 1) % PLOT_SUBTRACT_FLIGHT;
 	}
-	else if (mode == SUBTRACT_BINARY_HYPOTENUSE) {
+}
 
-		cN1 = pl->data[dN].sub[sN].op.binary.column_1;
-		cN2 = pl->data[dN].sub[sN].op.binary.column_2;
+static int
+plotDataSubtractDone(plot_t *pl, int dN, int *id_N)
+{
+	int		fN, lN, hN, pN, eN, rN;
 
-		do {
-			row = plotDataWrite(pl, dN, &rN);
+	/* Rows before the first chunk in flight or before the job cursor
+	 * are done.
+	 * */
+	if (pl->data[dN].sub_flight_tail != pl->data[dN].sub_flight_head) {
 
-			if (row == NULL)
-				break;
+		fN = pl->data[dN].sub_flight_tail;
 
-			X1 = (cN1 < 0) ? id_N : row[cN1];
-			X2 = (cN2 < 0) ? id_N : row[cN2];
+		rN = pl->data[dN].sub_flight[fN].row_N;
+		*id_N = pl->data[dN].sub_flight[fN].id_N;
+	}
+	else {
+		rN = pl->data[dN].sub_job_rN;
+		*id_N = pl->data[dN].sub_job_id_N;
+	}
 
-			row[cN] = sqrt(X1 * X1 + X2 * X2);
+	lN = pl->data[dN].length_N;
+	hN = pl->data[dN].head_N;
 
-			id_N++;
+	pN = rN - hN;
+	pN = (pN < 0) ? pN + lN : pN;
 
-			if (rN == rN_end)
-				break;
-		}
-		while (1);
-	}
-	else if (mode == SUBTRACT_FILTER_DIFFERENCE) {
+	eN = pl->data[dN].tail_N - hN;
+	eN = (eN < 0) ? eN + lN : eN;
 
-		if (rN_beg == pl->data[dN].head_N) {
+	if (*id_N - pl->data[dN].id_N != pN || pN > eN) {
 
-			pl->data[dN].sub[sN].op.filter.state = FP_NAN;
-		}
+		rN = hN;
+		*id_N = pl->data[dN].id_N;
+	}
 
-		cN1 = pl->data[dN].sub[sN].op.filter.column_1;
-		X2 = (fval_t) pl->data[dN].sub[sN].op.filter.state;
+	return rN;
+}
 
-		do {
-			row = plotDataWrite(pl, dN, &rN);
+static int
+plotDataSubtractTop(plot_t *pl, int dN, int cN, int *id_N)
+{
+	int		lN, eN;
 
-			if (row == NULL)
-				break;
+	if (plotDataSubtractPending(pl, dN, cN) == 0) {
 
-			X1 = (cN1 < 0) ? id_N : row[cN1];
+		lN = pl->data[dN].length_N;
 
-			row[cN] = X1 - X2;
+		eN = pl->data[dN].tail_N - pl->data[dN].head_N;
+		eN = (eN < 0) ? eN + lN : eN;
 
-			X2 = X1;
+		*id_N = pl->data[dN].id_N + eN;
 
-			id_N++;
+		return pl->data[dN].tail_N;
+	}
 
-			if (rN == rN_end)
-				break;
-		}
-		while (1);
+	if (pl->data[dN].sub[cN - pl->data[dN].column_N].busy == SUBTRACT_RESAMPLE) {
 
-		pl->data[dN].sub[sN].op.filter.state = (double) X2;
+		/* Resample is computed at once when the job is done.
+		 * */
+		*id_N = pl->data[dN].id_N;
+
+		return pl->data[dN].head_N;
 	}
-	else if (mode == SUBTRACT_FILTER_CUMULATIVE) {
 
-		if (rN_beg == pl->data[dN].head_N) {
+	return plotDataSubtractDone(pl, dN, id_N);
+}
 
-			pl->data[dN].sub[sN].op.filter.state = 0.;
-		}
+static int
+plotDataSubtractBehind(plot_t *pl, int dN)
+{
+	int		N, id_N;
 
-		cN1 = pl->data[dN].sub[sN].op.filter.column_1;
-		X2 = (fval_t) pl->data[dN].sub[sN].op.filter.state;
+	if (		pl->data[dN].column_N == 0
+			|| pl->data[dN].sub_paused != 0)
+		return 0;
 
-		do {
-			row = plotDataWrite(pl, dN, &rN);
+	for (N = 0; N < PLOT_SUBTRACT; ++N) {
 
-			if (row == NULL)
-				break;
+		if (pl->data[dN].sub[N].pending != 0) {
 
-			X1 = (cN1 < 0) ? id_N : row[cN1];
+			return (pl->data[dN].sub_flight_tail != pl->data[dN].sub_flight_head
+				|| plotDataSubtractDone(pl, dN, &id_N) != pl->data[dN].tail_N) ? 1 : 0;
+		}
+	}
 
-			if (fp_isfinite(X1)) {
+	return 0;
+}
 
-				X2 += X1;
-			}
+static int
+plotDataSubtractJob(plot_t *pl, int dN, int tTOP)
+{
+	int		N, lN, hN, pN, eN, rN, id_N, rN_end, id_N_end, kN, fN, in_dN, job = 0;
 
-			row[cN] = X2;
+	for (N = 0; N < PLOT_SUBTRACT; ++N) {
 
-			id_N++;
+		job += (pl->data[dN].sub[N].pending != 0) ? 1 : 0;
+	}
 
-			if (rN == rN_end)
-				break;
-		}
-		while (1);
+	if (job == 0)
+		return 0;
 
-		pl->data[dN].sub[sN].op.filter.state = (double) X2;
-	}
-	else if (mode == SUBTRACT_FILTER_BITMASK) {
+	plotDataSubtractRetire(pl, dN, 0);
 
-		unsigned long	shift, mask, ulval;
+	lN = pl->data[dN].length_N;
+	hN = pl->data[dN].head_N;
 
-		cN1 = pl->data[dN].sub[sN].op.filter.column_1;
-		ulval = (unsigned long) pl->data[dN].sub[sN].op.filter.gain;
+	rN = pl->data[dN].sub_job_rN;
+	id_N = pl->data[dN].sub_job_id_N;
 
-		shift = ulval & 0xFFU;
-		ulval = ulval >> 8;
+	pN = rN - hN;
+	pN = (pN < 0) ? pN + lN : pN;
 
-		mask = ((1U << (ulval - shift + 1U)) - 1U) << shift;
+	eN = pl->data[dN].tail_N - hN;
+	eN = (eN < 0) ? eN + lN : eN;
 
-		do {
-			row = plotDataWrite(pl, dN, &rN);
+	if (id_N - pl->data[dN].id_N != pN || pN > eN) {
 
-			if (row == NULL)
-				break;
+		/* Head has overwritten the job cursor or dataset was reset so
+		 * we start over.
+		 * */
+		plotDataSubtractRetire(pl, dN, 1);
 
-			X1 = (cN1 < 0) ? id_N : row[cN1];
+		rN = hN;
+		id_N = pl->data[dN].id_N;
 
-			ulval = ((unsigned long) X1 & mask) >> shift;
-			row[cN] = (fval_t) ulval;
+		pN = 0;
+	}
 
-			id_N++;
+	/* We go chunk by chunk so that recurrent subtracts keep their state
+	 * between the slices.
+	 * */
+	while (pN < eN) {
 
-			if (rN == rN_end)
+		fN = (pl->data[dN].sub_flight_head + 1) % PLOT_SUBTRACT_FLIGHT;
+
+		if (		pl->data[dN].sub_op_N > 0
+				&& fN == pl->data[dN].sub_flight_tail) {
+
+			/* Too many chunks in flight so we wait for the first
+			 * one to free the slot.
+			 * */
+			if (SDL_GetTicks() > tTOP)
 				break;
-		}
-		while (1);
-	}
-	else if (mode == SUBTRACT_FILTER_LOW_PASS) {
 
-		if (rN_beg == pl->data[dN].head_N) {
+			fN = pl->data[dN].sub_flight_tail;
 
-			pl->data[dN].sub[sN].op.filter.state = FP_NAN;
+			plotDataRangeWait(pl, dN, pl->data[dN].sub_flight[fN].chunk_N);
+			plotDataSubtractRetire(pl, dN, 0);
 		}
 
-		cN1 = pl->data[dN].sub[sN].op.filter.column_1;
-		gain = pl->data[dN].sub[sN].op.filter.gain;
-		X2 = (fval_t) pl->data[dN].sub[sN].op.filter.state;
+		rN_end = rN;
+		id_N_end = id_N;
 
-		do {
-			row = plotDataWrite(pl, dN, &rN);
+		plotDataChunkSkip(pl, dN, &rN_end, &id_N_end);
 
-			if (row == NULL)
-				break;
+		if (id_N_end - id_N > eN - pN) {
 
-			X1 = (cN1 < 0) ? id_N : row[cN1];
+			rN_end = pl->data[dN].tail_N;
+			id_N_end = id_N + eN - pN;
+		}
 
-			if (fp_isfinite(X1)) {
+		for (N = 0; N < PLOT_SUBTRACT; ++N) {
 
-				if (fp_isfinite(X2)) {
+			if (		pl->data[dN].sub[N].pending != 0
+					&& pl->data[dN].sub[N].parallel == 0) {
 
-					X2 += (X1 - X2) * gain;
-				}
-				else {
-					X2 = X1;
-				}
+				plotDataSubtractWrite(pl, dN, N, rN, id_N, rN_end);
 			}
+		}
 
-			row[cN] = X2;
-
-			id_N++;
+		if (pl->data[dN].sub_op_N > 0) {
 
-			if (rN == rN_end)
-				break;
-		}
-		while (1);
+			kN = plotDataChunkN(pl, dN, rN);
 
-		pl->data[dN].sub[sN].op.filter.state = (double) X2;
-	}
-	else if (mode == SUBTRACT_FILTER_MEDIAN) {
+			/* Chunk at the tail is being filled by insert so we do
+			 * not pass it to the worker.
+			 * */
+			if (		kN == plotDataChunkN(pl, dN, pl->data[dN].tail_N)
+					|| plotDataSubtractQueue(pl, dN, rN, id_N,
+						id_N_end - id_N) != 0) {
 
-		tuple_t		mN;
+				for (N = 0; N < PLOT_SUBTRACT; ++N) {
 
-		if (rN_beg == pl->data[dN].head_N) {
+					if (pl->data[dN].sub[N].parallel != 0) {
 
-			pl->data[dN].sub[sN].op.median.keep = 0;
-			pl->data[dN].sub[sN].op.median.tail = 0;
+						plotDataSubtractWrite(pl, dN, N, rN, id_N, rN_end);
+					}
+				}
+			}
 		}
 
-		cN1 = pl->data[dN].sub[sN].op.median.column_1;
+		pN += id_N_end - id_N;
 
-		do {
-			row = plotDataWrite(pl, dN, &rN);
+		rN = rN_end;
+		id_N = id_N_end;
 
-			if (row == NULL)
-				break;
+		if (SDL_GetTicks() > tTOP)
+			break;
+	}
 
-			X1 = (cN1 < 0) ? id_N : row[cN1];
+	pl->data[dN].sub_job_rN = rN;
+	pl->data[dN].sub_job_id_N = id_N;
 
-			mN = plotDataMedianAdd(pl, dN, sN, X1, X1);
+	if (pN < eN)
+		return 1;
 
-			if (mN.X < 0) {
+	plotDataSubtractRetire(pl, dN, (SDL_GetTicks() < tTOP) ? 1 : 0);
 
-				X2 = FP_NAN;
-			}
-			else {
-				X2 = pl->data[dN].sub[sN].op.median.window[mN.X].fval;
-			}
+	if (pl->data[dN].sub_flight_tail != pl->data[dN].sub_flight_head)
+		return 1;
+
+	for (N = 0; N < PLOT_SUBTRACT; ++N) {
 
-			row[cN] = X2;
+		if (		pl->data[dN].sub[N].pending != 0
+				&& pl->data[dN].sub[N].busy == SUBTRACT_RESAMPLE) {
 
-			id_N++;
+			in_dN = pl->data[dN].sub[N].op.resample.in_data_N;
 
-			if (rN == rN_end)
-				break;
+			/* Resample reads the input dataset so we wait for its
+			 * job to pass all the rows.
+			 * */
+			if (in_dN != dN && plotDataSubtractBehind(pl, in_dN) != 0)
+				return 1;
 		}
-		while (1);
 	}
-}
 
-static void
-plotDataSubtractResample(plot_t *pl, int dN, int sN)
-{
-	int		cNX, cNY, in_dN, in_cNX, in_cNY;
+	/* Bring the rest of subtracts to the same row before the job is
+	 * merged with residual computation.
+	 * */
+	plotDataSubtractResidual(pl, dN);
 
-	if (pl->data[dN].sub[sN].busy == SUBTRACT_RESAMPLE) {
+	for (N = 0; N < PLOT_SUBTRACT; ++N) {
 
-		cNX = pl->data[dN].sub[sN].op.resample.column_X;
-		cNY = sN + pl->data[dN].column_N;
+		if (pl->data[dN].sub[N].pending != 0) {
 
-		in_dN = pl->data[dN].sub[sN].op.resample.in_data_N;
-		in_cNX = pl->data[dN].sub[sN].op.resample.in_column_X;
-		in_cNY = pl->data[dN].sub[sN].op.resample.in_column_Y;
+			plotDataSubtractResample(pl, dN, N);
 
-		plotDataResample(pl, dN, cNX, cNY, in_dN, in_cNX, in_cNY);
+			pl->data[dN].sub[N].pending = 0;
+			pl->data[dN].sub[N].parallel = 0;
+		}
 	}
-}
 
-static void
-plotDataSubtractWriteSeq(plot_t *pl, int dN, int rN_beg, int id_N_beg, int rN_end)
-{
-	int		N;
+	pl->data[dN].sub_op_N = 0;
 
-	for (N = 0; N < PLOT_SUBTRACT; ++N) {
-
-		plotDataSubtractWrite(pl, dN, N, rN_beg, id_N_beg, rN_end);
-	}
+	return 0;
 }
 
 static void
-plotDataSubtractResampleSeq(plot_t *pl, int dN)
+plotDataSubtractStart(plot_t *pl, int dN)
 {
-	int		N;
+	/* Workers read the list of parallel subtracts so we take it again
+	 * only when no chunk is in flight.
+	 * */
+	plotDataSubtractRetire(pl, dN, 1);
+	plotDataSubtractParallel(pl, dN);
 
-	for (N = 0; N < PLOT_SUBTRACT; ++N) {
+	pl->data[dN].sub_job_rN = pl->data[dN].head_N;
+	pl->data[dN].sub_job_id_N = pl->data[dN].id_N;
 
-		plotDataSubtractResample(pl, dN, N);
-	}
+	plotDataSubtractJob(pl, dN, SDL_GetTicks() + PLOT_SUBTRACT_SLICE);
 }
 
 void plotDataSubtractCompute(plot_t *pl, int dN, int sN)
 {
-	int		rN, id_N, rN_end;
-
 	if (dN < 0 || dN >= PLOT_DATASET_MAX) {
 
 		ERROR("Dataset number is out of range\n");
@@ -1661,16 +3546,12 @@ void plotDataSubtractCompute(plot_t *pl, int dN, int sN)
 	if (pl->data[dN].sub_paused != 0)
 		return ;
 
-	rN = pl->data[dN].head_N;
-	id_N = pl->data[dN].id_N;
-
-	rN_end = pl->data[dN].tail_N;
-
-	if (rN == rN_end)
-		return ;
+	/* Subtract is computed by background job that runs in time slices
+	 * until it reaches the tail.
+	 * */
+	pl->data[dN].sub[sN].pending = 1;
 
-	plotDataSubtractWrite(pl, dN, sN, rN, id_N, rN_end);
-	plotDataSubtractResample(pl, dN, sN);
+	plotDataSubtractStart(pl, dN);
 }
 
 void plotDataSubtractResidual(plot_t *pl, int dN)
@@ -1696,76 +3577,208 @@ void plotDataSubtractResidual(plot_t *pl, int dN)
 	pl->data[dN].sub_N = rN_end;
 }
 
+static void
+plotDataSubtractFree(plot_t *pl, int dN)
+{
+	int		N, kN, job = 0;
+
+	for (N = 0; N < PLOT_SUBTRACT; ++N) {
+
+		if (		pl->data[dN].sub[N].busy == SUBTRACT_FREE
+				&& pl->data[dN].col[pl->data[dN].column_N + N].chunk != NULL)
+			job = 1;
+	}
+
+	if (job == 0)
+		return ;
+
+	/* Workers may still hold the column chunks we are about to free.
+	 * */
+	plotDataSubtractRetire(pl, dN, 1);
+
+	for (kN = 0; kN < PLOT_CHUNK_MAX; ++kN) {
+
+		plotDataRangeWait(pl, dN, kN);
+		plotDataRangeInvalidate(pl, dN, kN);
+	}
+
+	for (N = 0; N < PLOT_SUBTRACT; ++N) {
+
+		if (pl->data[dN].sub[N].busy == SUBTRACT_FREE)
+			plotDataColumnFree(pl, dN, pl->data[dN].column_N + N);
+	}
+}
+
 void plotDataSubtractClean(plot_t *pl)
 {
-	int		dN, N;
+	int		dN, N;
+
+	for (dN = 0; dN < PLOT_DATASET_MAX; ++dN) {
+
+		if (pl->data[dN].column_N != 0) {
+
+			plotDataSubtractRetire(pl, dN, 1);
+
+			for (N = 0; N < PLOT_SUBTRACT; ++N) {
+
+				pl->data[dN].sub[N].busy = SUBTRACT_FREE;
+				pl->data[dN].sub[N].pending = 0;
+				pl->data[dN].sub[N].parallel = 0;
+			}
+
+			pl->data[dN].sub_op_N = 0;
+
+			plotDataSubtractFree(pl, dN);
+		}
+	}
+}
+
+void plotDataSubtractPaused(plot_t *pl)
+{
+	int		dN;
+
+	for (dN = 0; dN < PLOT_DATASET_MAX; ++dN) {
+
+		if (pl->data[dN].column_N != 0) {
+
+			pl->data[dN].sub_paused = 1;
+		}
+	}
+}
+
+void plotDataSubtractAlternate(plot_t *pl)
+{
+	int		dN, N;
+
+	for (dN = 0; dN < PLOT_DATASET_MAX; ++dN) {
+
+		if (pl->data[dN].column_N != 0) {
+
+			for (N = 0; N < PLOT_SUBTRACT; ++N) {
+
+				pl->data[dN].sub[N].pending =
+					(pl->data[dN].sub[N].busy != SUBTRACT_FREE) ? 1 : 0;
+			}
+
+			pl->data[dN].sub_N = pl->data[dN].tail_N;
+			pl->data[dN].sub_paused = 0;
+
+			plotDataSubtractStart(pl, dN);
+		}
+	}
+}
+
+int plotDataSubtractUpdate(plot_t *pl)
+{
+	int		dN, tTOP, job = 0;
 
-	for (dN = 0; dN < PLOT_DATASET_MAX; ++dN) {
+	tTOP = SDL_GetTicks() + PLOT_SUBTRACT_SLICE;
 
-		if (pl->data[dN].column_N != 0) {
+	for (dN = 0; dN < PLOT_DATASET_MAX; ++dN) {
 
-			for (N = 0; N < PLOT_SUBTRACT; ++N) {
+		if (		pl->data[dN].column_N != 0
+				&& pl->data[dN].sub_paused == 0) {
 
-				pl->data[dN].sub[N].busy = SUBTRACT_FREE;
-			}
+			job += plotDataSubtractJob(pl, dN, tTOP);
 		}
 	}
+
+	return job;
 }
 
-void plotDataSubtractPaused(plot_t *pl)
+static void
+plotDataSubtractFlush(plot_t *pl)
 {
-	int		dN;
+	/* Export and fit read all the rows so we complete the jobs here.
+	 * */
+	while (plotDataSubtractUpdate(pl) != 0) ;
+}
+
+int plotDataSubtractProgress(plot_t *pl)
+{
+	double		done = 0., total = 0.;
+	int		dN, N, pN, eN, lN, hN, id_N;
 
 	for (dN = 0; dN < PLOT_DATASET_MAX; ++dN) {
 
-		if (pl->data[dN].column_N != 0) {
+		if (pl->data[dN].column_N == 0)
+			continue;
 
-			pl->data[dN].sub_paused = 1;
+		for (N = 0; N < PLOT_SUBTRACT; ++N) {
+
+			if (pl->data[dN].sub[N].pending != 0)
+				break;
 		}
+
+		if (N >= PLOT_SUBTRACT)
+			continue;
+
+		lN = pl->data[dN].length_N;
+		hN = pl->data[dN].head_N;
+
+		pN = plotDataSubtractDone(pl, dN, &id_N) - hN;
+		pN = (pN < 0) ? pN + lN : pN;
+
+		eN = pl->data[dN].tail_N - hN;
+		eN = (eN < 0) ? eN + lN : eN;
+
+		done += (double) ((pN < eN) ? pN : eN);
+		total += (double) eN;
+	}
+
+	if (total > 0.) {
+
+		return (int) (100. * done / total);
 	}
+
+	return -1;
 }
 
-void plotDataSubtractAlternate(plot_t *pl)
+void plotDataSubtractCancel(plot_t *pl)
 {
-	int		dN, rN, id_N, rN_end, id_N_end, lCHUNK;
+	int		dN, fN, N;
 
-	for (dN = 0; dN < PLOT_DATASET_MAX; ++dN) {
+	for (fN = 0; fN < PLOT_FIGURE_MAX; ++fN) {
 
-		if (pl->data[dN].column_N != 0) {
+		if (pl->figure[fN].busy != 0) {
 
-			rN = pl->data[dN].head_N;
-			id_N = pl->data[dN].id_N;
+			dN = pl->figure[fN].data_N;
 
-			if (rN != pl->data[dN].tail_N) {
+			if (		plotDataSubtractPending(pl, dN, pl->figure[fN].column_X) != 0
+					|| plotDataSubtractPending(pl, dN, pl->figure[fN].column_Y) != 0) {
+
+				plotFigureRemove(pl, fN);
+			}
+		}
+	}
 
-				lCHUNK = (1UL << pl->data[dN].chunk_SHIFT);
+	for (dN = 0; dN < PLOT_DATASET_MAX; ++dN) {
 
-				rN_end = rN;
-				id_N_end = id_N;
+		if (pl->data[dN].column_N != 0) {
 
-				do {
-					plotDataSkip(pl, dN, &rN_end, &id_N_end, lCHUNK);
-					plotDataSubtractWriteSeq(pl, dN, rN, id_N, rN_end);
+			plotDataSubtractRetire(pl, dN, 1);
 
-					rN = rN_end;
-					id_N = id_N_end;
-				}
-				while (rN != pl->data[dN].tail_N);
+			for (N = 0; N < PLOT_SUBTRACT; ++N) {
 
-				pl->data[dN].sub_N = rN_end;
+				if (pl->data[dN].sub[N].pending != 0) {
 
-				plotDataSubtractResampleSeq(pl, dN);
+					pl->data[dN].sub[N].busy = SUBTRACT_FREE;
+					pl->data[dN].sub[N].pending = 0;
+					pl->data[dN].sub[N].parallel = 0;
+				}
 			}
 
-			pl->data[dN].sub_paused = 0;
+			pl->data[dN].sub_op_N = 0;
+
+			plotDataSubtractFree(pl, dN);
 		}
 	}
 }
 
 void plotDataInsert(plot_t *pl, int dN, const fval_t *row)
 {
-	fval_t		*place;
-	int		cN, lN, hN, tN, kN, jN, sN;
+	void		*raw;
+	int		N, cN, lN, hN, tN, kN, jN, sN, pN;
 
 	cN = pl->data[dN].column_N;
 	lN = pl->data[dN].length_N;
@@ -1775,12 +3788,36 @@ void plotDataInsert(plot_t *pl, int dN, const fval_t *row)
 	kN = tN >> pl->data[dN].chunk_SHIFT;
 	jN = tN & pl->data[dN].chunk_MASK;
 
-	if (pl->data[dN].lz4_compress != 0) {
+	if (jN == 0) {
+
+		/* Ring may come back to the chunk that worker still holds.
+		 * */
+		plotDataRangeWait(pl, dN, kN);
+		plotDataRangeInvalidate(pl, dN, kN);
+
+		if (hN != tN) {
 
-		plotDataChunkWrite(pl, dN, kN);
+			/* Previous chunk is complete so we compute its range
+			 * summary in background.
+			 * */
+			pN = (tN > 0) ? tN - 1 : lN - 1;
+			pN = pN >> pl->data[dN].chunk_SHIFT;
+
+			if (pN != kN) {
+
+				plotDataRangeQueue(pl, dN, pN);
+			}
+		}
 	}
 
-	if (		   pl->rcache_wipe_data_N != dN
+	if (jN != 0 && ((tN < lN - 1) ? tN + 1 : 0) != hN) {
+
+		/* Row is appended to the tail chunk while the dataset is not
+		 * full so the range of chunk is only extended.
+		 * */
+		plotDataRangeCacheExtend(pl, dN);
+	}
+	else if (	   pl->rcache_wipe_data_N != dN
 			|| pl->rcache_wipe_chunk_N != kN) {
 
 		plotDataRangeCacheWipe(pl, dN, kN);
@@ -1789,14 +3826,26 @@ void plotDataInsert(plot_t *pl, int dN, const fval_t *row)
 		pl->rcache_wipe_chunk_N = kN;
 	}
 
-	place = pl->data[dN].raw[kN];
+	/* Row is scattered over the column chunks.
+	 * */
+	for (N = 0; N < cN; ++N) {
+
+		raw = plotDataChunkWrite(pl, dN, N, kN);
+
+		if (raw == NULL)
+			break;
+
+		plotDataTypeStore(raw, pl->data[dN].col[N].type, jN, row[N]);
+		plotDataLodDirty(pl, dN, N, kN, jN, jN);
+	}
 
-	if (place != NULL) {
+	if (N == cN) {
 
-		place += (cN + PLOT_SUBTRACT) * jN;
+		for (N = cN; N < cN + PLOT_SUBTRACT; ++N) {
 
-		memcpy(place, row, cN * sizeof(fval_t));
-		memset(place + cN, 0, PLOT_SUBTRACT * sizeof(fval_t));
+			if (pl->data[dN].col[N].chunk != NULL)
+				plotDataPut(pl, dN, N, tN, (fval_t) 0.);
+		}
 
 		tN = (tN < lN - 1) ? tN + 1 : 0;
 
@@ -1815,51 +3864,98 @@ void plotDataInsert(plot_t *pl, int dN, const fval_t *row)
 	}
 }
 
-void plotDataClean(plot_t *pl, int dN)
+int plotDataMap(plot_t *pl, int dN, const void *map, int fsize, int lN)
 {
-	int		N;
+	int		N, kN;
 
-	if (pl->data[dN].column_N != 0) {
+	if (dN < 0 || dN >= PLOT_DATASET_MAX) {
 
-		pl->data[dN].column_N = 0;
-		pl->data[dN].length_N = 0;
+		ERROR("Dataset number is out of range\n");
+		return -1;
+	}
 
-		if (pl->data[dN].lz4_compress != 0) {
+	if (		map == NULL
+			|| pl->data[dN].column_N == 0
+			|| pl->data[dN].lz4_compress == 0
+			|| (fsize != sizeof(float) && fsize != sizeof(double))
+			|| lN < 1 || lN >= pl->data[dN].length_N)
+		return -1;
 
-			for (N = 0; N < PLOT_CHUNK_CACHE; ++N) {
+	plotSketchClean(pl);
 
-				if (pl->data[dN].cache[N].raw) {
+	pl->data[dN].gen += 1;
 
-					free(pl->data[dN].cache[N].raw);
+	for (N = 0; N < PLOT_CHUNK_MAX; ++N) {
 
-					pl->data[dN].cache[N].raw = NULL;
-				}
-			}
+		plotDataRangeWait(pl, dN, N);
+		plotDataRangeInvalidate(pl, dN, N);
+	}
 
-			for (N = 0; N < PLOT_CHUNK_MAX; ++N) {
+	for (N = 0; N < pl->data[dN].column_N + PLOT_SUBTRACT; ++N)
+		plotDataColumnFree(pl, dN, N);
 
-				pl->data[dN].raw[N] = NULL;
+	for (N = 0; N < pl->data[dN].column_N; ++N)
+		plotDataColumnUse(pl, dN, N);
 
-				if (pl->data[dN].compress[N].raw != NULL) {
+	pl->data[dN].mapped.raw = (const char *) map;
+	pl->data[dN].mapped.fsize = fsize;
+	pl->data[dN].mapped.length_N = lN;
 
-					free(pl->data[dN].compress[N].raw);
+	pl->data[dN].head_N = 0;
+	pl->data[dN].tail_N = lN;
+	pl->data[dN].id_N = 0;
+	pl->data[dN].sub_N = 0;
 
-					pl->data[dN].compress[N].raw = NULL;
-				}
-			}
-		}
-		else {
-			for (N = 0; N < PLOT_CHUNK_MAX; ++N) {
+	plotDataRangeCacheClean(pl, dN);
+
+	pl->rcache_wipe_data_N = -1;
 
-				if (pl->data[dN].raw[N] != NULL) {
+	kN = lN >> pl->data[dN].chunk_SHIFT;
 
-					free(pl->data[dN].raw[N]);
+	for (N = 0; N < kN; ++N) {
 
-					pl->data[dN].raw[N] = NULL;
-				}
+		plotDataRangeQueue(pl, dN, N);
+	}
+
+	return 0;
+}
+
+void plotDataClean(plot_t *pl, int dN)
+{
+	int		N;
+
+	if (pl->data[dN].column_N != 0) {
+
+		pl->data[dN].gen += 1;
+
+		plotDataRangeFree(pl, dN);
+
+		pl->data[dN].sub_flight_head = 0;
+		pl->data[dN].sub_flight_tail = 0;
+
+		for (N = 0; N < PLOT_SUBTRACT; ++N) {
+
+			if (pl->data[dN].sub[N].md != NULL) {
+
+				median_free(pl->data[dN].sub[N].md);
+
+				pl->data[dN].sub[N].md = NULL;
 			}
 		}
 
+		for (N = 0; N < pl->data[dN].column_N + PLOT_SUBTRACT; ++N)
+			plotDataColumnFree(pl, dN, N);
+
+		free(pl->data[dN].col);
+
+		pl->data[dN].col = NULL;
+
+		pl->data[dN].mapped.raw = NULL;
+		pl->data[dN].mapped.length_N = 0;
+
+		pl->data[dN].column_N = 0;
+		pl->data[dN].length_N = 0;
+
 		free(pl->data[dN].map - 1);
 
 		pl->data[dN].map = NULL;
@@ -1885,6 +3981,56 @@ plotDataRangeCacheGetNode(plot_t *pl, int dN, int cN)
 	return xN;
 }
 
+static int
+plotDataRangeSummary(plot_t *pl, int dN, int kN, int rN, int cN,
+		fval_t *ymin, fval_t *ymax)
+{
+	const void	*raw;
+	int		tN;
+
+	tN = plotDataChunkN(pl, dN, pl->data[dN].tail_N);
+
+	if (		kN == tN
+			|| (rN & pl->data[dN].chunk_MASK) != 0)
+		return 0;
+
+	if (SDL_AtomicGet(&pl->data[dN].summary[kN].busy) != 0) {
+
+		/* Worker thread is still scanning this chunk so we do not
+		 * wait and use the row by row path.
+		 * */
+		return 0;
+	}
+
+	if (		pl->data[dN].summary[kN].fmin != NULL
+			&& SDL_AtomicGet(&pl->data[dN].summary[kN].done)
+				== pl->data[dN].summary[kN].gen) {
+
+		SDL_MemoryBarrierAcquire();
+
+		if (fp_isfinite(pl->data[dN].summary[kN].fmin[cN])) {
+
+			*ymin = pl->data[dN].summary[kN].fmin[cN];
+			*ymax = pl->data[dN].summary[kN].fmax[cN];
+
+			return 1;
+		}
+	}
+
+	/* Summary was invalidated by write or the column chunk was not in
+	 * memory for worker so we scan this column chunk alone.
+	 * */
+	raw = plotDataChunkFetch(pl, dN, cN, kN);
+
+	if (raw == NULL)
+		return 0;
+
+	plotDataRangeScan(raw, pl->data[dN].col[cN].type,
+			plotDataRangeLength(pl, dN, kN), ymin, ymax);
+
+	return 1;
+}
+
 void plotDataRangeCacheClean(plot_t *pl, int dN)
 {
 	int		N;
@@ -1918,9 +4064,8 @@ void plotDataRangeCacheSubtractClean(plot_t *pl)
 
 int plotDataRangeCacheFetch(plot_t *pl, int dN, int cN)
 {
-	const fval_t	*row;
 	fval_t		fval, fmin, fmax, ymin, ymax;
-	int		N, xN, rN, id_N, kN;
+	int		N, xN, qN, rN, rN_top, id_N, kN;
 	int		job, finite, started;
 
 	xN = plotDataRangeCacheGetNode(pl, dN, cN);
@@ -1942,6 +4087,11 @@ int plotDataRangeCacheFetch(plot_t *pl, int dN, int cN)
 		}
 	}
 
+	/* Rows of pending subtract after the first unfinished chunk are
+	 * not taken into the range.
+	 * */
+	rN_top = plotDataSubtractTop(pl, dN, cN, &id_N);
+
 	rN = pl->data[dN].head_N;
 	id_N = pl->data[dN].id_N;
 
@@ -1951,22 +4101,50 @@ int plotDataRangeCacheFetch(plot_t *pl, int dN, int cN)
 	started = 0;
 
 	do {
+		if (rN == rN_top && rN != pl->data[dN].tail_N)
+			break;
+
 		kN = plotDataChunkN(pl, dN, rN);
 
 		if (pl->rcache[xN].chunk[kN].computed != 0) {
 
-			if (kN == plotDataChunkN(pl, dN, pl->data[dN].tail_N)) {
+			if (		kN == plotDataChunkN(pl, dN, pl->data[dN].tail_N)
+					|| pl->rcache[xN].chunk[kN].scan_N >= 0) {
 
 				job = 1;
 
 				finite = pl->rcache[xN].chunk[kN].finite;
 				ymin = pl->rcache[xN].chunk[kN].fmin;
 				ymax = pl->rcache[xN].chunk[kN].fmax;
+
+				N = pl->rcache[xN].chunk[kN].scan_N;
+
+				if (		N >= rN
+						&& plotDataChunkN(pl, dN, N) == kN) {
+
+					plotDataSkip(pl, dN, &rN, &id_N, N - rN);
+				}
 			}
 			else {
 				job = 0;
 			}
 		}
+		else if (	cN >= 0
+				&& plotDataRangeSummary(pl, dN, kN, rN, cN, &ymin, &ymax) != 0) {
+
+			finite = (ymin <= ymax) ? 1 : 0;
+			job = 0;
+
+			pl->rcache[xN].chunk[kN].computed = 1;
+			pl->rcache[xN].chunk[kN].finite = finite;
+			pl->rcache[xN].chunk[kN].scan_N = -1;
+
+			if (finite != 0) {
+
+				pl->rcache[xN].chunk[kN].fmin = ymin;
+				pl->rcache[xN].chunk[kN].fmax = ymax;
+			}
+		}
 		else {
 			finite = 0;
 			job = 1;
@@ -1975,15 +4153,15 @@ int plotDataRangeCacheFetch(plot_t *pl, int dN, int cN)
 		if (job != 0) {
 
 			do {
-				if (kN != plotDataChunkN(pl, dN, rN))
+				if (kN != plotDataChunkN(pl, dN, rN) || rN == rN_top)
 					break;
 
-				row = plotDataGet(pl, dN, &rN);
+				qN = plotDataGet(pl, dN, &rN);
 
-				if (row == NULL)
+				if (qN < 0)
 					break;
 
-				fval = (cN < 0) ? id_N : row[cN];
+				fval = (cN < 0) ? id_N : plotDataFetch(pl, dN, cN, qN);
 
 				if (fp_isfinite(fval)) {
 
@@ -2006,6 +4184,8 @@ int plotDataRangeCacheFetch(plot_t *pl, int dN, int cN)
 
 			pl->rcache[xN].chunk[kN].computed = 1;
 			pl->rcache[xN].chunk[kN].finite = finite;
+			pl->rcache[xN].chunk[kN].scan_N = (rN == pl->data[dN].tail_N
+					&& plotDataChunkN(pl, dN, rN) == kN) ? rN : -1;
 
 			if (finite != 0) {
 
@@ -2068,9 +4248,8 @@ static void
 plotDataRangeCond(plot_t *pl, int dN, int cN, int cN_cond, int *pflag,
 		double scale, double offset, double *pmin, double *pmax)
 {
-	const fval_t	*row;
 	double		fval, fmin, fmax, fcond, vmin, vmax;
-	int		xN, yN, kN, rN, id_N, job, started;
+	int		xN, yN, kN, qN, rN, rN_top, id_N, job, started;
 
 	started = *pflag;
 	fmin = *pmin;
@@ -2110,10 +4289,16 @@ plotDataRangeCond(plot_t *pl, int dN, int cN, int cN_cond, int *pflag,
 		}
 	}
 
+	rN_top = plotDataSubtractTop(pl, dN, (plotDataSubtractPending(pl, dN, cN) != 0)
+			? cN : cN_cond, &id_N);
+
 	rN = pl->data[dN].head_N;
 	id_N = pl->data[dN].id_N;
 
 	do {
+		if (rN == rN_top && rN != pl->data[dN].tail_N)
+			break;
+
 		kN = plotDataChunkN(pl, dN, rN);
 		job = 1;
 
@@ -2161,16 +4346,16 @@ plotDataRangeCond(plot_t *pl, int dN, int cN, int cN_cond, int *pflag,
 		if (job != 0) {
 
 			do {
-				if (kN != plotDataChunkN(pl, dN, rN))
+				if (kN != plotDataChunkN(pl, dN, rN) || rN == rN_top)
 					break;
 
-				row = plotDataGet(pl, dN, &rN);
+				qN = plotDataGet(pl, dN, &rN);
 
-				if (row == NULL)
+				if (qN < 0)
 					break;
 
-				fval = (cN < 0) ? id_N : row[cN];
-				fcond = (cN_cond < 0) ? id_N : row[cN_cond];
+				fval = (cN < 0) ? id_N : plotDataFetch(pl, dN, cN, qN);
+				fcond = (cN_cond < 0) ? id_N : plotDataFetch(pl, dN, cN_cond, qN);
 
 				fcond = fcond * scale + offset;
 
@@ -2289,16 +4474,31 @@ plotDataRangeAxis(plot_t *pl, int dN, int cN, int aN, double *pmin, double *pmax
 	return started;
 }
 
-static const fval_t *
+static int
 plotDataSliceGet(plot_t *pl, int dN, int cN, double fsamp, int *m_id_N)
 {
-	const fval_t	*row;
 	double		fval, fbest, fmin, fmax, fneard;
-	int		xN, lN, rN, id_N, kN, kN_rep, best_N;
+	int		N, xN, lN, qN, rN, rN_top, id_N, id_N_top, kN, kN_rep, best_N;
 	int		job, started, span;
 
 	xN = plotDataRangeCacheFetch(pl, dN, cN);
 
+	/* Caller takes any column from the row so we stop at the first
+	 * unfinished chunk of any pending subtract.
+	 * */
+	rN_top = plotDataSubtractTop(pl, dN, -1, &id_N_top);
+
+	for (N = 0; N < PLOT_SUBTRACT; ++N) {
+
+		rN = plotDataSubtractTop(pl, dN, N + pl->data[dN].column_N, &id_N);
+
+		if (id_N < id_N_top) {
+
+			rN_top = rN;
+			id_N_top = id_N;
+		}
+	}
+
 	rN = pl->data[dN].head_N;
 	id_N = pl->data[dN].id_N;
 
@@ -2308,6 +4508,9 @@ plotDataSliceGet(plot_t *pl, int dN, int cN, double fsamp, int *m_id_N)
 	span = 0;
 
 	do {
+		if (rN == rN_top && rN != pl->data[dN].tail_N)
+			break;
+
 		kN = plotDataChunkN(pl, dN, rN);
 		job = 1;
 
@@ -2357,15 +4560,15 @@ plotDataSliceGet(plot_t *pl, int dN, int cN, double fsamp, int *m_id_N)
 			span++;
 
 			do {
-				if (kN != plotDataChunkN(pl, dN, rN))
+				if (kN != plotDataChunkN(pl, dN, rN) || rN == rN_top)
 					break;
 
-				row = plotDataGet(pl, dN, &rN);
+				qN = plotDataGet(pl, dN, &rN);
 
-				if (row == NULL)
+				if (qN < 0)
 					break;
 
-				fval = (cN < 0) ? id_N : row[cN];
+				fval = (cN < 0) ? id_N : plotDataFetch(pl, dN, cN, qN);
 
 				if (fp_isfinite(fval)) {
 
@@ -2410,21 +4613,24 @@ plotDataSliceGet(plot_t *pl, int dN, int cN, double fsamp, int *m_id_N)
 		id_N = pl->data[dN].id_N;
 
 		do {
+			if (rN == rN_top && rN != pl->data[dN].tail_N)
+				break;
+
 			kN = plotDataChunkN(pl, dN, rN);
 			job = 1;
 
 			if (kN == kN_rep) {
 
 				do {
-					if (kN != plotDataChunkN(pl, dN, rN))
+					if (kN != plotDataChunkN(pl, dN, rN) || rN == rN_top)
 						break;
 
-					row = plotDataGet(pl, dN, &rN);
+					qN = plotDataGet(pl, dN, &rN);
 
-					if (row == NULL)
+					if (qN < 0)
 						break;
 
-					fval = (cN < 0) ? id_N : row[cN];
+					fval = (cN < 0) ? id_N : plotDataFetch(pl, dN, cN, qN);
 
 					if (fp_isfinite(fval)) {
 
@@ -2469,13 +4675,13 @@ plotDataSliceGet(plot_t *pl, int dN, int cN, double fsamp, int *m_id_N)
 		rN = pl->data[dN].head_N + (best_N - pl->data[dN].id_N);
 		rN = (rN > lN - 1) ? rN - lN : rN;
 
-		row = plotDataGet(pl, dN, &rN);
+		qN = plotDataGet(pl, dN, &rN);
 	}
 	else {
-		row = NULL;
+		qN = -1;
 	}
 
-	return row;
+	return qN;
 }
 
 void plotAxisLabel(plot_t *pl, int aN, const char *label)
@@ -2699,6 +4905,33 @@ plotAxisRangeCond(plot_t *pl, int aN, int bN, double *pmin, double *pmax)
 	return started;
 }
 
+static int
+plotAxisSubtractPending(plot_t *pl, int aN)
+{
+	int		fN, dN, xN, yN;
+
+	for (fN = 0; fN < PLOT_FIGURE_MAX; ++fN) {
+
+		if (pl->figure[fN].busy == 0)
+			continue;
+
+		dN = pl->figure[fN].data_N;
+		xN = pl->figure[fN].axis_X;
+		yN = pl->figure[fN].axis_Y;
+
+		if (		xN == aN || yN == aN
+				|| (pl->axis[xN].slave != 0 && pl->axis[xN].slave_N == aN)
+				|| (pl->axis[yN].slave != 0 && pl->axis[yN].slave_N == aN)) {
+
+			if (		plotDataSubtractPending(pl, dN, pl->figure[fN].column_X) != 0
+					|| plotDataSubtractPending(pl, dN, pl->figure[fN].column_Y) != 0)
+				return 1;
+		}
+	}
+
+	return 0;
+}
+
 void plotAxisScaleManual(plot_t *pl, int aN, double min, double max)
 {
 	if (aN < 0 || aN >= PLOT_AXES_MAX) {
@@ -2713,6 +4946,8 @@ void plotAxisScaleManual(plot_t *pl, int aN, double min, double max)
 	if (pl->axis[aN].slave != 0)
 		return ;
 
+	pl->axis[aN].defer_scale = 0;
+
 	pl->axis[aN].scale = 1. / (max - min);
 	pl->axis[aN].offset = - min / (max - min);
 }
@@ -2733,6 +4968,15 @@ void plotAxisScaleAuto(plot_t *pl, int aN)
 	if (pl->axis[aN].slave != 0)
 		return ;
 
+	if (plotAxisSubtractPending(pl, aN) != 0) {
+
+		/* Range of pending subtract is not complete so the axis is
+		 * scaled when the job is done.
+		 * */
+		pl->axis[aN].defer_scale = 1;
+		return ;
+	}
+
 	if (plotAxisRangeGet(pl, aN, &fmin, &fmax) != 0) {
 
 		if (fmin == fmax) {
@@ -2785,6 +5029,14 @@ void plotAxisScaleAutoCond(plot_t *pl, int aN, int bN)
 	if (pl->axis[aN].slave != 0)
 		return ;
 
+	if (		plotAxisSubtractPending(pl, aN) != 0
+			|| (bN >= 0 && plotAxisSubtractPending(pl, bN) != 0)) {
+
+		pl->axis[aN].defer_scale = 2;
+		pl->axis[aN].defer_N = bN;
+		return ;
+	}
+
 	if (plotAxisRangeCond(pl, aN, bN, &fmin, &fmax) != 0) {
 
 		if (fmin == fmax) {
@@ -2814,6 +5066,40 @@ void plotAxisScaleAutoCond(plot_t *pl, int aN, int bN)
 	}
 }
 
+int plotAxisScaleDeferred(plot_t *pl)
+{
+	int		aN, bN, job = 0;
+
+	for (aN = 0; aN < PLOT_AXES_MAX; ++aN) {
+
+		if (pl->axis[aN].defer_scale == 0)
+			continue;
+
+		bN = pl->axis[aN].defer_N;
+
+		if (		plotAxisSubtractPending(pl, aN) != 0
+				|| (pl->axis[aN].defer_scale == 2 && bN >= 0
+					&& plotAxisSubtractPending(pl, bN) != 0))
+			continue;
+
+		if (pl->axis[aN].defer_scale == 2) {
+
+			pl->axis[aN].defer_scale = 0;
+
+			plotAxisScaleAutoCond(pl, aN, bN);
+		}
+		else {
+			pl->axis[aN].defer_scale = 0;
+
+			plotAxisScaleAuto(pl, aN);
+		}
+
+		job = 1;
+	}
+
+	return job;
+}
+
 void plotAxisScaleLock(plot_t *pl, int knob)
 {
 	int		aN;
@@ -3448,6 +5734,7 @@ void plotAxisRemove(plot_t *pl, int aN)
 	pl->axis[aN].label[0] = 0;
 	pl->axis[aN].compact = 1;
 	pl->axis[aN].exponential = 0;
+	pl->axis[aN].defer_scale = 0;
 }
 
 void plotFigureAdd(plot_t *pl, int fN, int dN, int nX, int nY, int aX, int aY, const char *label)
@@ -3714,6 +6001,7 @@ plotSubtractGarbage(plot_t *pl, int dN)
 				if (plotCheckColumnLinked(pl, dN, cN) == 0) {
 
 					pl->data[dN].sub[sN].busy = SUBTRACT_FREE;
+					pl->data[dN].sub[sN].pending = 0;
 
 					N++;
 				}
@@ -3721,6 +6009,8 @@ plotSubtractGarbage(plot_t *pl, int dN)
 		}
 	}
 	while (N != 0);
+
+	plotDataSubtractFree(pl, dN);
 }
 
 void plotFigureRemove(plot_t *pl, int fN)
@@ -4053,6 +6343,18 @@ tuple_t plotGetSubtractTimeMedian(plot_t *pl, int dN, int cNX, int cNY,
 		return uN;
 	}
 
+	if (cNX < -1 || cNX >= pl->data[dN].column_N + PLOT_SUBTRACT) {
+
+		ERROR("Column number %i is out of range\n", cNX);
+		return uN;
+	}
+
+	if (cNY < -1 || cNY >= pl->data[dN].column_N + PLOT_SUBTRACT) {
+
+		ERROR("Column number %i is out of range\n", cNY);
+		return uN;
+	}
+
 	sNX = plotGetSubtractTimeMedianByMatch(pl, dN, cNX, length, unwrap);
 
 	if (sNX < 0) {
@@ -4106,6 +6408,12 @@ int plotGetSubtractScale(plot_t *pl, int dN, int cN, double scale, double offset
 		return -1;
 	}
 
+	if (cN < -1 || cN >= pl->data[dN].column_N + PLOT_SUBTRACT) {
+
+		ERROR("Column number %i is out of range\n", cN);
+		return -1;
+	}
+
 	sN = plotGetSubtractScaleByMatch(pl, dN, cN, scale, offset);
 
 	if (sN < 0) {
@@ -4126,18 +6434,42 @@ int plotGetSubtractScale(plot_t *pl, int dN, int cN, double scale, double offset
 		plotDataSubtractCompute(pl, dN, sN);
 	}
 
-	cN = sN + pl->data[dN].column_N;
-
-	return cN;
-}
+	cN = sN + pl->data[dN].column_N;
+
+	return cN;
+}
+
+int plotGetSubtractResample(plot_t *pl, int dN, int cNX, int in_dN, int in_cNX, int in_cNY)
+{
+	int		sN, cN;
+
+	if (dN < 0 || dN >= PLOT_DATASET_MAX) {
+
+		ERROR("Dataset number is out of range\n");
+		return -1;
+	}
+
+	if (cNX < -1 || cNX >= pl->data[dN].column_N + PLOT_SUBTRACT) {
+
+		ERROR("Column number %i is out of range\n", cNX);
+		return -1;
+	}
+
+	if (in_dN < 0 || in_dN >= PLOT_DATASET_MAX) {
+
+		ERROR("Dataset number is out of range\n");
+		return -1;
+	}
+
+	if (in_cNX < -1 || in_cNX >= pl->data[in_dN].column_N + PLOT_SUBTRACT) {
 
-int plotGetSubtractResample(plot_t *pl, int dN, int cNX, int in_dN, int in_cNX, int in_cNY)
-{
-	int		sN, cN;
+		ERROR("Column number %i is out of range\n", in_cNX);
+		return -1;
+	}
 
-	if (dN < 0 || dN >= PLOT_DATASET_MAX) {
+	if (in_cNY < -1 || in_cNY >= pl->data[in_dN].column_N + PLOT_SUBTRACT) {
 
-		ERROR("Dataset number is out of range\n");
+		ERROR("Column number %i is out of range\n", in_cNY);
 		return -1;
 	}
 
@@ -5026,6 +7358,8 @@ void plotFigureSubtractPolyfit(plot_t *pl, int fN_1, int N0, int N1)
 		offset_Y = offset_X * pl->axis[bN].scale + pl->axis[bN].offset;
 	}
 
+	plotDataSubtractFlush(pl);
+
 	plotDataPolyfit(pl, dN, pl->figure[fN_1].column_X, pl->figure[fN_1].column_Y,
 			scale_X, offset_X, scale_Y, offset_Y, N0, N1);
 
@@ -5215,6 +7549,7 @@ void plotFigureExportCSV(plot_t *pl, const char *file)
 
 		fprintf(fd_csv, "\n");
 
+		plotDataSubtractFlush(pl);
 		plotDataFileCSV(pl, list_dN, list_cN, len_N, fd_csv);
 
 		fclose(fd_csv);
@@ -5239,6 +7574,7 @@ void plotFigureClean(plot_t *pl)
 		pl->axis[N].label[0] = 0;
 		pl->axis[N].compact = 1;
 		pl->axis[N].exponential = 0;
+		pl->axis[N].defer_scale = 0;
 	}
 
 	pl->legend_X = 0;
@@ -5267,9 +7603,8 @@ void plotFigureClean(plot_t *pl)
 static void
 plotMarkLayout(plot_t *pl)
 {
-	const fval_t	*row;
 	double		shuffle, total, scale, offset, fval_X, fval_Y;
-	int		fN, vN, aN, bN, cX, cY, cZ, N, id_N, fMAX = 0;
+	int		fN, vN, aN, bN, dN, cX, cY, cZ, N, qN, id_N, fMAX = 0;
 
 	const int	ltdense[PLOT_FIGURE_MAX] = {
 
@@ -5327,16 +7662,16 @@ plotMarkLayout(plot_t *pl)
 
 				fval_X = (fval_X - offset) / scale;
 
-				row = plotDataSliceGet(pl, pl->figure[fN].data_N,
-							cZ, fval_X, &id_N);
+				dN = pl->figure[fN].data_N;
+				qN = plotDataSliceGet(pl, dN, cZ, fval_X, &id_N);
 
-				if (row != NULL) {
+				if (qN >= 0) {
 
 					cX = pl->figure[fN].column_X;
 					cY = pl->figure[fN].column_Y;
 
-					fval_X = (cX < 0) ? id_N : row[cX];
-					fval_Y = (cY < 0) ? id_N : row[cY];
+					fval_X = (cX < 0) ? id_N : plotDataFetch(pl, dN, cX, qN);
+					fval_Y = (cY < 0) ? id_N : plotDataFetch(pl, dN, cY, qN);
 
 					pl->figure[fN].mark_X[N] = fval_X;
 					pl->figure[fN].mark_Y[N] = fval_Y;
@@ -5518,9 +7853,8 @@ void plotSliceSwitch(plot_t *pl)
 
 void plotSliceTrack(plot_t *pl, int cur_X, int cur_Y)
 {
-	const fval_t	*row = NULL;
 	double		fval_X, fval_Y;
-	int		fN, aN, bN, dN, cX, cY, id_N;
+	int		fN, aN, bN, dN, cX, cY, qN = -1, id_N;
 	int		dN_s, aN_s, cX_s, job;
 
 	if (pl->slice_mode_N == 2)
@@ -5611,7 +7945,7 @@ void plotSliceTrack(plot_t *pl, int cur_X, int cur_Y)
 
 			if (dN_s != dN || aN_s != aN || cX_s != cX) {
 
-				row = plotDataSliceGet(pl, dN, cX,
+				qN = plotDataSliceGet(pl, dN, cX,
 						fval_X, &id_N);
 
 				dN_s = dN;
@@ -5619,13 +7953,13 @@ void plotSliceTrack(plot_t *pl, int cur_X, int cur_Y)
 				cX_s = cX;
 			}
 
-			if (row != NULL) {
+			if (qN >= 0) {
 
 				cX = pl->figure[fN].column_X;
 				cY = pl->figure[fN].column_Y;
 
-				fval_X = (cX < 0) ? id_N : row[cX];
-				fval_Y = (cY < 0) ? id_N : row[cY];
+				fval_X = (cX < 0) ? id_N : plotDataFetch(pl, dN, cX, qN);
+				fval_Y = (cY < 0) ? id_N : plotDataFetch(pl, dN, cY, qN);
 
 				pl->figure[fN].slice_busy = 1;
 				pl->figure[fN].slice_X = fval_X;
@@ -5978,6 +8312,74 @@ void plotSketchClean(plot_t *pl)
 		pl->draw[N].list_self = -1;
 
 	pl->draw_in_progress = 0;
+	pl->layer.valid = 0;
+}
+
+static void
+plotSketchMerge(plot_t *pl)
+{
+	int		N, hN, gN, fN, linked, last;
+
+	hN = pl->sketch_list_current;
+
+	while (hN >= 0) {
+
+		linked = pl->sketch[hN].linked;
+
+		gN = pl->sketch_list_todraw;
+		fN = -1;
+		last = -1;
+
+		while (gN >= 0) {
+
+			if (		pl->sketch[gN].figure_N == pl->sketch[hN].figure_N
+					&& pl->sketch[gN].drawing == pl->sketch[hN].drawing
+					&& pl->sketch[gN].width == pl->sketch[hN].width) {
+
+				fN = gN;
+			}
+
+			last = gN;
+			gN = pl->sketch[gN].linked;
+		}
+
+		if (		fN >= 0 && pl->sketch[fN].chunk != NULL
+				&& pl->sketch[fN].length + pl->sketch[hN].length
+				<= PLOT_SKETCH_CHUNK_SIZE) {
+
+			/* Pack the appended segments into the last chunk of
+			 * the same figure so the list does not grow with each
+			 * small append.
+			 * */
+			memcpy(pl->sketch[fN].chunk + pl->sketch[fN].length,
+					pl->sketch[hN].chunk,
+					sizeof(double) * pl->sketch[hN].length);
+
+			pl->sketch[fN].length += pl->sketch[hN].length;
+
+			pl->sketch[hN].linked = pl->sketch_list_garbage;
+			pl->sketch_list_garbage = hN;
+		}
+		else {
+			pl->sketch[hN].linked = -1;
+
+			if (last >= 0) {
+
+				pl->sketch[last].linked = hN;
+			}
+			else {
+				pl->sketch_list_todraw = hN;
+			}
+		}
+
+		hN = linked;
+	}
+
+	pl->sketch_list_current = -1;
+	pl->sketch_list_current_end = -1;
+
+	for (N = 0; N < PLOT_FIGURE_MAX; ++N)
+		pl->draw[N].list_self = -1;
 }
 
 static void
@@ -6020,11 +8422,13 @@ plotGetTickCached(plot_t *pl)
 static void
 plotDrawFigureTrial(plot_t *pl, int fN, int tTOP)
 {
-	const fval_t	*row;
+	const fval_t	*bx, *by;
 	double		scale_X, scale_Y, offset_X, offset_Y, im_MIN, im_MAX;
 	double		X, Y, last_X, last_Y, im_X, im_Y, last_im_X, last_im_Y;
-	int		dN, rN, xN, yN, xNR, yNR, aN, bN, id_N, id_N_top, kN, kN_cached;
-	int		job, skipped, line, rc, ncolor, fdrawing, fwidth;
+	double		min_Y, max_Y;
+	int		dN, qN, rN, xN, yN, xNR, yNR, aN, bN, id_N, id_N_top, id_N_X, id_N_Y;
+	int		kN, kN_cached, job, skipped, line, rc, ncolor, fdrawing, fwidth;
+	int		lN;
 
 	ncolor = (pl->figure[fN].hidden != 0) ? 9 : fN + 1;
 
@@ -6074,6 +8478,27 @@ plotDrawFigureTrial(plot_t *pl, int fN, int tTOP)
 	id_N_top = id_N + (1UL << pl->data[dN].chunk_SHIFT);
 	kN_cached = -1;
 
+	if (		plotDataSubtractPending(pl, dN, xN) != 0
+			|| plotDataSubtractPending(pl, dN, yN) != 0) {
+
+		/* We draw only the rows before the first chunk that is not
+		 * finished by background job or workers.
+		 * */
+		plotDataSubtractTop(pl, dN, xN, &id_N_X);
+		plotDataSubtractTop(pl, dN, yN, &id_N_Y);
+
+		id_N_X = (id_N_X < id_N_Y) ? id_N_X : id_N_Y;
+
+		if (id_N >= id_N_X) {
+
+			pl->draw[fN].sketch = SKETCH_FINISHED;
+			return ;
+		}
+
+		id_N_top = (id_N_top < id_N_X - 1)
+			? id_N_top : id_N_X - 1;
+	}
+
 	plotSketchDataChunkSetUp(pl, fN);
 
 	if (		fdrawing == FIGURE_DRAWING_LINE
@@ -6127,7 +8552,78 @@ plotDrawFigureTrial(plot_t *pl, int fN, int tTOP)
 				kN_cached = kN;
 			}
 
-			if (job != 0 || line != 0) {
+			if (		job != 0 && skipped == 0
+					&& (lN = plotDataLodGet(pl, dN, rN, xN, yN,
+							scale_X, &bx, &by)) != 0) {
+
+				/* The bucket fits into one pixel column so we draw
+				 * the line to its first point and the vertical span
+				 * from min to max. Thus spikes are not lost.
+				 * */
+				X = (xN < 0) ? id_N : bx[2];
+				Y = (yN < 0) ? id_N : by[2];
+
+				im_X = X * scale_X + offset_X;
+				im_Y = Y * scale_Y + offset_Y;
+
+				if (fp_isfinite(im_X) && fp_isfinite(im_Y)) {
+
+					if (line != 0) {
+
+						rc = drawLineTrial(pl->dw, &pl->viewport,
+								last_im_X, last_im_Y, im_X, im_Y,
+								ncolor, fwidth);
+
+						if (rc != 0) {
+
+							plotSketchDataAdd(pl, fN, last_X, last_Y);
+							plotSketchDataAdd(pl, fN, X, Y);
+						}
+					}
+				}
+
+				min_Y = (yN < 0) ? id_N : by[0];
+				max_Y = (yN < 0) ? id_N + lN - 1 : by[1];
+
+				if (fp_isfinite(im_X) && min_Y <= max_Y) {
+
+					im_MIN = min_Y * scale_Y + offset_Y;
+					im_MAX = max_Y * scale_Y + offset_Y;
+
+					rc = drawLineTrial(pl->dw, &pl->viewport,
+							im_X, im_MIN, im_X, im_MAX,
+							ncolor, fwidth);
+
+					if (rc != 0) {
+
+						plotSketchDataAdd(pl, fN, X, min_Y);
+						plotSketchDataAdd(pl, fN, X, max_Y);
+					}
+				}
+
+				X = (xN < 0) ? id_N + lN - 1 : bx[3];
+				Y = (yN < 0) ? id_N + lN - 1 : by[3];
+
+				im_X = X * scale_X + offset_X;
+				im_Y = Y * scale_Y + offset_Y;
+
+				if (fp_isfinite(im_X) && fp_isfinite(im_Y)) {
+
+					line = 1;
+
+					last_X = X;
+					last_Y = Y;
+
+					last_im_X = im_X;
+					last_im_Y = im_Y;
+				}
+				else {
+					line = 0;
+				}
+
+				plotDataSkip(pl, dN, &rN, &id_N, lN);
+			}
+			else if (job != 0 || line != 0) {
 
 				if (skipped != 0) {
 
@@ -6136,16 +8632,16 @@ plotDrawFigureTrial(plot_t *pl, int fN, int tTOP)
 					skipped = 0;
 				}
 
-				row = plotDataGet(pl, dN, &rN);
+				qN = plotDataGet(pl, dN, &rN);
 
-				if (row == NULL) {
+				if (qN < 0) {
 
 					pl->draw[fN].sketch = SKETCH_FINISHED;
 					break;
 				}
 
-				X = (xN < 0) ? id_N : row[xN];
-				Y = (yN < 0) ? id_N : row[yN];
+				X = (xN < 0) ? id_N : plotDataFetch(pl, dN, xN, qN);
+				Y = (yN < 0) ? id_N : plotDataFetch(pl, dN, yN, qN);
 
 				im_X = X * scale_X + offset_X;
 				im_Y = Y * scale_Y + offset_Y;
@@ -6244,18 +8740,57 @@ plotDrawFigureTrial(plot_t *pl, int fN, int tTOP)
 				kN_cached = kN;
 			}
 
-			if (job != 0) {
+			if (		job != 0
+					&& (lN = plotDataLodGet(pl, dN, rN, xN, yN,
+							scale_X, &bx, &by)) != 0) {
+
+				/* Draw the extremal points of the bucket.
+				 * */
+				X = (xN < 0) ? id_N : bx[2];
+
+				min_Y = (yN < 0) ? id_N : by[0];
+				max_Y = (yN < 0) ? id_N + lN - 1 : by[1];
+
+				im_X = X * scale_X + offset_X;
+
+				if (fp_isfinite(im_X) && min_Y <= max_Y) {
+
+					im_MIN = min_Y * scale_Y + offset_Y;
+					im_MAX = max_Y * scale_Y + offset_Y;
+
+					rc = drawDotTrial(pl->dw, &pl->viewport,
+							im_X, im_MIN, fwidth,
+							ncolor, 1);
+
+					if (rc != 0) {
+
+						plotSketchDataAdd(pl, fN, X, min_Y);
+					}
+
+					rc = drawDotTrial(pl->dw, &pl->viewport,
+							im_X, im_MAX, fwidth,
+							ncolor, 1);
+
+					if (rc != 0) {
 
-				row = plotDataGet(pl, dN, &rN);
+						plotSketchDataAdd(pl, fN, X, max_Y);
+					}
+				}
+
+				plotDataSkip(pl, dN, &rN, &id_N, lN);
+			}
+			else if (job != 0) {
 
-				if (row == NULL) {
+				qN = plotDataGet(pl, dN, &rN);
+
+				if (qN < 0) {
 
 					pl->draw[fN].sketch = SKETCH_FINISHED;
 					break;
 				}
 
-				X = (xN < 0) ? id_N : row[xN];
-				Y = (yN < 0) ? id_N : row[yN];
+				X = (xN < 0) ? id_N : plotDataFetch(pl, dN, xN, qN);
+				Y = (yN < 0) ? id_N : plotDataFetch(pl, dN, yN, qN);
 
 				im_X = X * scale_X + offset_X;
 				im_Y = Y * scale_Y + offset_Y;
@@ -6308,16 +8843,14 @@ int plotGetSketchLength(plot_t *pl)
 }
 
 static void
-plotDrawSketch(plot_t *pl, SDL_Surface *surface)
+plotDrawSketch(plot_t *pl, SDL_Surface *surface, int hN)
 {
 	double		scale_X, offset_X, scale_Y, offset_Y;
 	double		X, Y, last_X, last_Y, *chunk, *lend;
-	int		hN, fN, aN, bN;
+	int		fN, aN, bN;
 
 	int		fdrawing, fwidth, ncolor;
 
-	hN = pl->sketch_list_todraw;
-
 	drawDashReset(pl->dw);
 
 	SDL_LockSurface(surface);
@@ -7305,6 +9838,174 @@ void plotLayout(plot_t *pl)
 	}
 }
 
+static void
+plotLayerKey(plot_t *pl, plotLayerKey_t *key)
+{
+	double		scale, offset;
+	int		fN, dN, aN, bN;
+
+	memset(key, 0, sizeof(plotLayerKey_t));
+
+	key->cacheable = 1;
+	key->antialiasing = pl->dw->antialiasing;
+	key->pixmap_len = pl->dw->pixmap.len;
+	key->viewport = pl->viewport;
+	key->drawing_dash = pl->layout_drawing_dash;
+	key->drawing_space = pl->layout_drawing_space;
+
+	for (fN = 0; fN < PLOT_FIGURE_MAX; ++fN) {
+
+		if (pl->figure[fN].busy != 0) {
+
+			dN = pl->figure[fN].data_N;
+
+			key->figure[fN].busy = pl->figure[fN].busy;
+			key->figure[fN].hidden = pl->figure[fN].hidden;
+			key->figure[fN].drawing = pl->figure[fN].drawing;
+			key->figure[fN].width = pl->figure[fN].width;
+			key->figure[fN].data_N = dN;
+			key->figure[fN].column_X = pl->figure[fN].column_X;
+			key->figure[fN].column_Y = pl->figure[fN].column_Y;
+
+			aN = pl->figure[fN].axis_X;
+			scale = pl->axis[aN].scale;
+			offset = pl->axis[aN].offset;
+
+			if (pl->axis[aN].slave != 0) {
+
+				bN = pl->axis[aN].slave_N;
+				scale *= pl->axis[bN].scale;
+				offset = offset * pl->axis[bN].scale + pl->axis[bN].offset;
+			}
+
+			key->figure[fN].scale_X = scale;
+			key->figure[fN].offset_X = offset;
+
+			aN = pl->figure[fN].axis_Y;
+			scale = pl->axis[aN].scale;
+			offset = pl->axis[aN].offset;
+
+			if (pl->axis[aN].slave != 0) {
+
+				bN = pl->axis[aN].slave_N;
+				scale *= pl->axis[bN].scale;
+				offset = offset * pl->axis[bN].scale + pl->axis[bN].offset;
+			}
+
+			key->figure[fN].scale_Y = scale;
+			key->figure[fN].offset_Y = offset;
+
+			key->data[dN].gen = pl->data[dN].gen;
+			key->data[dN].head_N = pl->data[dN].head_N;
+			key->data[dN].id_N = pl->data[dN].id_N;
+			key->tail_N[dN] = pl->data[dN].tail_N;
+
+			if (		plotDataSubtractPending(pl, dN, pl->figure[fN].column_X) != 0
+					|| plotDataSubtractPending(pl, dN, pl->figure[fN].column_Y) != 0) {
+
+				/* Rows are being written by background job.
+				 * */
+				key->cacheable = 0;
+			}
+		}
+	}
+}
+
+static int
+plotLayerTest(plot_t *pl, SDL_Surface *surface)
+{
+	plotLayerKey_t		key;
+
+	if (		pl->layer.valid == 0
+			|| pl->draw_in_progress != 0
+			|| surface->userdata != NULL) {
+
+		/* We draw the sketch into SVG as well.
+		 * */
+		return LAYER_STALE;
+	}
+
+	plotLayerKey(pl, &key);
+
+	if (		key.cacheable == 0
+			|| memcmp(&key, &pl->layer.key, offsetof(plotLayerKey_t, tail_N)) != 0)
+		return LAYER_STALE;
+
+	if (memcmp(key.tail_N, pl->layer.key.tail_N, sizeof(key.tail_N)) != 0)
+		return LAYER_APPEND;
+
+	return LAYER_CACHED;
+}
+
+static int
+plotLayerAppend(plot_t *pl, SDL_Surface *surface)
+{
+	plotLayerKey_t		key;
+	int			fN, dN, rN, id_N, lN, tTOP, rc = 0;
+
+	plotLayerKey(pl, &key);
+
+	tTOP = SDL_GetTicks() + 20;
+
+	drawClearTrial(pl->dw);
+
+	for (fN = 0; fN < PLOT_FIGURE_MAX && rc == 0; ++fN) {
+
+		dN = pl->figure[fN].data_N;
+
+		if (		pl->figure[fN].busy != 0
+				&& key.tail_N[dN] != pl->layer.key.tail_N[dN]) {
+
+			/* We start from the last row of the layer so the line
+			 * is continued to the rows appended.
+			 * */
+			rN = pl->data[dN].head_N;
+			id_N = pl->data[dN].id_N;
+
+			lN = pl->layer.key.tail_N[dN] - rN;
+			lN += (lN < 0) ? pl->data[dN].length_N : 0;
+
+			plotDataSkip(pl, dN, &rN, &id_N, lN - 1);
+
+			pl->draw[fN].sketch = SKETCH_STARTED;
+			pl->draw[fN].rN = rN;
+			pl->draw[fN].id_N = id_N;
+
+			pl->draw[fN].skipped = 0;
+			pl->draw[fN].line = 0;
+
+			do {
+				if (SDL_GetTicks() > tTOP) {
+
+					/* Too many rows were appended so we
+					 * draw all of them in the usual way.
+					 * */
+					rc = -1;
+					break;
+				}
+
+				plotDrawFigureTrial(pl, fN, tTOP);
+			}
+			while (pl->draw[fN].sketch != SKETCH_FINISHED);
+		}
+	}
+
+	if (rc == 0) {
+
+		drawLayerRestore(pl->dw);
+
+		plotDrawSketch(pl, surface, pl->sketch_list_current);
+
+		drawLayerSave(pl->dw);
+
+		pl->layer.key = key;
+	}
+
+	plotSketchMerge(pl);
+
+	return rc;
+}
+
 static void
 plotDrawFigureTrialAll(plot_t *pl)
 {
@@ -7340,6 +10041,8 @@ plotDrawFigureTrialAll(plot_t *pl)
 			pl->draw[fN].line = 0;
 		}
 
+		plotLayerKey(pl, &pl->layer.pending);
+
 		pl->draw_in_progress = 1;
 	}
 
@@ -7403,6 +10106,8 @@ plotDrawAxisAll(plot_t *pl, SDL_Surface *surface)
 
 void plotDraw(plot_t *pl, SDL_Surface *surface)
 {
+	int		layer;
+
 	if (pl->slice_mode_N != 0) {
 
 		plotSliceLightDraw(pl, surface);
@@ -7411,25 +10116,59 @@ void plotDraw(plot_t *pl, SDL_Surface *surface)
 	drawPixmapAlloc(pl->dw, surface);
 
 	plotDrawPalette(pl);
-	plotDrawFigureTrialAll(pl);
-
-	drawClearCanvas(pl->dw);
 
-	plotDrawSketch(pl, surface);
+	layer = plotLayerTest(pl, surface);
 
-	if (pl->mark_on != 0) {
+	if (layer == LAYER_APPEND) {
 
-		plotMarkDraw(pl, surface);
+		layer = (plotLayerAppend(pl, surface) == 0) ? LAYER_CACHED : LAYER_STALE;
 	}
 
-	SDL_LockSurface(surface);
+	if (layer == LAYER_STALE) {
 
-	drawFlushCanvas(pl->dw, surface, &pl->viewport);
+		pl->layer.valid = 0;
 
-	SDL_UnlockSurface(surface);
+		plotDrawFigureTrialAll(pl);
+
+		drawClearCanvas(pl->dw);
+
+		plotDrawSketch(pl, surface, pl->sketch_list_todraw);
+
+		SDL_LockSurface(surface);
 
+		drawFlushCanvas(pl->dw, surface, &pl->viewport);
+
+		SDL_UnlockSurface(surface);
+
+		if (		pl->draw_in_progress == 0
+				&& pl->layer.pending.cacheable != 0) {
+
+			/* Trial is finished so the sketch we have drawn is up
+			 * to date with the pending key.
+			 * */
+			drawLayerSave(pl->dw);
+
+			pl->layer.key = pl->layer.pending;
+			pl->layer.valid = 1;
+		}
+	}
+	else {
+		SDL_LockSurface(surface);
+
+		drawLayerFlush(pl->dw, surface, &pl->viewport);
+
+		SDL_UnlockSurface(surface);
+	}
+
+	/* Overlays are drawn on top of the figure layer each time.
+	 * */
 	drawClearCanvas(pl->dw);
 
+	if (pl->mark_on != 0) {
+
+		plotMarkDraw(pl, surface);
+	}
+
 	plotDrawAxisAll(pl, surface);
 
 	if (pl->slice_on != 0) {
@@ -24,6 +24,7 @@
 
 #include "draw.h"
 #include "lse.h"
+#include "median.h"
 #include "scheme.h"
 
 #ifdef ERROR
@@ -42,11 +43,18 @@
 #define PLOT_CHUNK_MAX				2000
 #define PLOT_CHUNK_CACHE			4
 #define PLOT_RCACHE_SIZE			32
+#define PLOT_RANGE_THREAD_MAX			8
+#define PLOT_RANGE_QUEUE			PLOT_CHUNK_MAX
+#define PLOT_LOD_BASE				6
+#define PLOT_LOD_SHIFT				3
+#define PLOT_LOD_MAX				4
 #define PLOT_SLICE_SPAN				4
+#define PLOT_SUBTRACT_SLICE			20
+#define PLOT_SUBTRACT_FLIGHT			16
 #define PLOT_AXES_MAX				9
 #define PLOT_FIGURE_MAX 			8
 #define PLOT_DATA_BOX_MAX			8
-#define PLOT_MEDIAN_MAX 			91
+#define PLOT_MEDIAN_MAX 			16383
 #define PLOT_POLYFIT_MAX			7
 #define PLOT_SUBTRACT				20
 #define PLOT_GROUP_MAX				40
@@ -109,12 +117,24 @@ enum {
 	SKETCH_FINISHED
 };
 
+enum {
+	LAYER_STALE			= 0,
+	LAYER_APPEND,
+	LAYER_CACHED
+};
+
 enum {
 	DATA_BOX_FREE			= 0,
 	DATA_BOX_SLICE,
 	DATA_BOX_POLYFIT
 };
 
+enum {
+	COLUMN_DOUBLE			= 0,
+	COLUMN_FLOAT,
+	COLUMN_INT
+};
+
 typedef double			fval_t;
 
 typedef struct {
@@ -124,6 +144,90 @@ typedef struct {
 }
 tuple_t;
 
+/* Column chunks keep the rows of the same number as the chunks of any
+ * other column of the dataset. Integer column keeps NaN as INT_MIN.
+ * */
+typedef struct {
+
+	int		type;
+	int		chunk_bSIZE;
+
+	/* Chunk in memory is pointed by \raw. With LZ4 compression the
+	 * chunk is kept in \lz and taken into one of \cache nodes on
+	 * demand. List of chunks is allocated when column is in use.
+	 * */
+	struct {
+
+		void		*raw;
+		void		*lz;
+
+		int		length;
+		int		dirty;
+
+		fval_t		*lod;
+
+		int		dirty_min;
+		int		dirty_max;
+	}
+	*chunk;
+
+	struct {
+
+		void		*raw;
+		int		chunk_N;
+	}
+	cache[PLOT_CHUNK_CACHE];
+
+	int		cache_ID;
+}
+plotColumn_t;
+
+/* Everything that the rasterised figures depend on. Layer is reused when
+ * the key is the same and rasterised only for the rows appended after
+ * \tail_N when the rest of the key is the same.
+ * */
+typedef struct {
+
+	int		cacheable;
+	int		antialiasing;
+	int		pixmap_len;
+
+	clipBox_t	viewport;
+
+	int		drawing_dash;
+	int		drawing_space;
+
+	struct {
+
+		int		busy;
+		int		hidden;
+
+		int		drawing;
+		int		width;
+
+		int		data_N;
+		int		column_X;
+		int		column_Y;
+
+		double		scale_X;
+		double		offset_X;
+		double		scale_Y;
+		double		offset_Y;
+	}
+	figure[PLOT_FIGURE_MAX];
+
+	struct {
+
+		int		gen;
+		int		head_N;
+		int		id_N;
+	}
+	data[PLOT_DATASET_MAX];
+
+	int		tail_N[PLOT_DATASET_MAX];
+}
+plotLayerKey_t;
+
 typedef struct {
 
 	draw_t			*dw;
@@ -138,39 +242,84 @@ typedef struct {
 
 		int		chunk_SHIFT;
 		int		chunk_MASK;
-		int		chunk_bSIZE;
 
 		int		lz4_compress;
 
+		/* Columns are stored apart so the chunk of one column is
+		 * touched only when this column is read. There are \column_N
+		 * file columns followed by PLOT_SUBTRACT subtract columns.
+		 * */
+		plotColumn_t	*col;
+
+		int		*map;
+
+		/* Range summary of each chunk for all columns. The summary
+		 * is valid when \done is equal to \gen. Worker threads own
+		 * the chunk and \fmin and \fmax while \busy counts queued
+		 * scan or subtract rows. Column chunks to be taken by worker
+		 * are listed in \raw. Column that was not scanned is left
+		 * with NaN range.
+		 * */
 		struct {
 
-			fval_t		*raw;
+			fval_t		*fmin;
+			fval_t		*fmax;
 
-			int		chunk_N;
-			int		dirty;
-		}
-		cache[PLOT_CHUNK_CACHE];
+			void		**raw;
 
-		int		cache_ID;
+			int		gen;
 
+			SDL_atomic_t	done;
+			SDL_atomic_t	busy;
+		}
+		summary[PLOT_CHUNK_MAX];
+
+		/* Min/Max pyramid of each column chunk. Level 0 bucket covers
+		 * (1 << PLOT_LOD_BASE) rows and each next level is
+		 * (1 << PLOT_LOD_SHIFT) times coarser. Bucket keeps min, max,
+		 * first and last values. Pyramid is built on first draw and
+		 * then rescanned only over the dirty rows.
+		 * */
+		int		lod_N;
+		int		lod_offset[PLOT_LOD_MAX];
+
+		/* File mapping that backs the first \length_N rows. Chunks
+		 * are converted from the mapping on demand through the
+		 * chunk cache so the data is never read as a whole.
+		 * */
 		struct {
 
-			void		*raw;
-			int		length;
-		}
-		compress[PLOT_CHUNK_MAX];
+			const char	*raw;
 
-		fval_t		*raw[PLOT_CHUNK_MAX];
-		int		*map;
+			int		fsize;
+			int		length_N;
+		}
+		mapped;
 
 		int		head_N;
 		int		tail_N;
 		int		id_N;
 
+		/* Incremented on any change of the rows except appending to
+		 * the tail so the figure layer knows to be rasterised again.
+		 * */
+		int		gen;
+
 		struct {
 
 			int	busy;
 
+			/* Median filter is kept out of the union as it
+			 * is reused by any median subtract.
+			 * */
+			median_t	*md;
+
+			/* Subtract is being computed by background job.
+			 * Parallel subtract is computed by range workers.
+			 * */
+			int		pending;
+			int		parallel;
+
 			union {
 
 				struct {
@@ -183,16 +332,6 @@ typedef struct {
 					int	unwrap;
 					int	opdata;
 
-					struct {
-
-						double	fval;
-						double	fpay;
-					}
-					window[PLOT_MEDIAN_MAX];
-
-					int	keep;
-					int	tail;
-
 					double	prev[2];
 					double	offset;
 				}
@@ -252,6 +391,44 @@ typedef struct {
 
 		int		sub_N;
 		int		sub_paused;
+
+		/* Pending subtracts are computed chunk by chunk from the
+		 * head up to the tail. Rows before \sub_job_id_N are done.
+		 * */
+		int		sub_job_rN;
+		int		sub_job_id_N;
+
+		/* Parallel subtracts of the job. Workers read this list so
+		 * it is not changed while any chunk is in flight.
+		 * */
+		struct {
+
+			int	mode;
+			int	column;
+			int	column_1;
+			int	column_2;
+
+			double	scale;
+			double	offset;
+		}
+		sub_op[PLOT_SUBTRACT];
+
+		int		sub_op_N;
+
+		/* Chunks handed to workers in order of the rows. Rows before
+		 * the first chunk in flight are done.
+		 * */
+		struct {
+
+			int	chunk_N;
+			int	row_N;
+			int	id_N;
+			int	length_N;
+		}
+		sub_flight[PLOT_SUBTRACT_FLIGHT];
+
+		int		sub_flight_head;
+		int		sub_flight_tail;
 	}
 	data[PLOT_DATASET_MAX];
 
@@ -267,6 +444,11 @@ typedef struct {
 			int		computed;
 			int		finite;
 
+			/* Tail chunk range covers the rows before \scan_N
+			 * so the scan is resumed from there.
+			 * */
+			int		scan_N;
+
 			fval_t		fmin;
 			fval_t		fmax;
 		}
@@ -286,6 +468,12 @@ typedef struct {
 		int		lock_scale;
 		int		lock_tick;
 
+		/* Auto scale is deferred until the subtract job is done.
+		 * Conditional scale keeps the axis number in \defer_N.
+		 * */
+		int		defer_scale;
+		int		defer_N;
+
 		int		slave;
 		int		slave_N;
 
@@ -361,6 +549,43 @@ typedef struct {
 	int			rcache_wipe_data_N;
 	int			rcache_wipe_chunk_N;
 
+	struct {
+
+		SDL_Thread	*thread[PLOT_RANGE_THREAD_MAX];
+		int		thread_N;
+
+		SDL_mutex	*mutex;
+		SDL_cond	*cond;
+
+		/* Signalled when a chunk is released by the worker.
+		 * */
+		SDL_cond	*done;
+
+		struct {
+
+			int		data_N;
+			int		chunk_N;
+			int		gen;
+
+			const char	*map;
+
+			/* Rows of subtract job to compute instead of scan.
+			 * */
+			int		sub;
+			int		row_N;
+			int		id_N;
+
+			int		length_N;
+			int		fsize;
+		}
+		queue[PLOT_RANGE_QUEUE];
+
+		int		head;
+		int		tail;
+		int		stop;
+	}
+	range;
+
 	int			legend_hidden;
 	int			legend_X;
 	int			legend_Y;
@@ -420,6 +645,19 @@ typedef struct {
 	int			sketch_list_current;
 	int			sketch_list_current_end;
 
+	/* Figures are kept rasterised in the canvas layer of draw_t while
+	 * the \key is valid. The \pending key is taken when sketch trial
+	 * starts and becomes the \key when trial is finished.
+	 * */
+	struct {
+
+		int		valid;
+
+		plotLayerKey_t	key;
+		plotLayerKey_t	pending;
+	}
+	layer;
+
 	int			layout_font_ttf;
 	int			layout_font_pt;
 	int			layout_font_height;
@@ -479,6 +717,7 @@ unsigned long long plotDataMemoryUncompressed(plot_t *pl, int dN);
 unsigned long long plotDataMemoryCached(plot_t *pl, int dN);
 
 void plotDataAlloc(plot_t *pl, int dN, int cN, int lN);
+void plotDataColumnType(plot_t *pl, int dN, int cN, int type);
 void plotDataResize(plot_t *pl, int dN, int lN);
 int plotDataSpaceLeft(plot_t *pl, int dN);
 void plotDataGrowUp(plot_t *pl, int dN);
@@ -487,7 +726,11 @@ void plotDataSubtractResidual(plot_t *pl, int dN);
 void plotDataSubtractClean(plot_t *pl);
 void plotDataSubtractPaused(plot_t *pl);
 void plotDataSubtractAlternate(plot_t *pl);
+int plotDataSubtractUpdate(plot_t *pl);
+int plotDataSubtractProgress(plot_t *pl);
+void plotDataSubtractCancel(plot_t *pl);
 void plotDataInsert(plot_t *pl, int dN, const fval_t *row);
+int plotDataMap(plot_t *pl, int dN, const void *map, int fsize, int lN);
 void plotDataClean(plot_t *pl, int dN);
 
 void plotDataRangeCacheClean(plot_t *pl, int dN);
@@ -498,6 +741,7 @@ void plotAxisLabel(plot_t *pl, int aN, const char *label);
 void plotAxisScaleManual(plot_t *pl, int aN, double min, double max);
 void plotAxisScaleAuto(plot_t *pl, int aN);
 void plotAxisScaleAutoCond(plot_t *pl, int aN, int bN);
+int plotAxisScaleDeferred(plot_t *pl);
 void plotAxisScaleLock(plot_t *pl, int knob);
 void plotAxisScaleDefault(plot_t *pl);
 void plotAxisScaleZoom(plot_t *pl, int aN, int origin, double zoom);
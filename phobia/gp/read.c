@@ -32,9 +32,31 @@
 #include "draw.h"
 #include "edit.h"
 #include "lang.h"
+#include "lz4.h"
 #include "plot.h"
 #include "read.h"
 
+#if defined(__GNUC__) && defined(__SSE2__)
+#include <emmintrin.h>
+#define _READ_SIMD_SSE2
+#endif
+
+/* Significant digits that stod() keeps in the text mantissa.
+ * */
+#define READ_DIGIT_MAX		40
+
+void markupUpdate(markup_t *mk)
+{
+	const char	*s;
+
+	memset(mk->map, MARKUP_TOKEN, sizeof(mk->map));
+
+	for (s = mk->space; *s != 0; ++s) { mk->map[(unsigned char) *s] = MARKUP_SPACE; }
+	for (s = mk->lend; *s != 0; ++s) { mk->map[(unsigned char) *s] = MARKUP_SPACE; }
+
+	mk->map[0] = MARKUP_END;
+}
+
 char *stoi(const markup_t *mk, int *x, char *s)
 {
 	int		n, d, i;
@@ -54,8 +76,7 @@ char *stoi(const markup_t *mk, int *x, char *s)
 
 	if (d == 0 || d > 9) { return NULL; }
 
-	if (*s == 0 || strchr(mk->space, *s) != NULL
-			|| strchr(mk->lend, *s) != NULL) {
+	if (mk->map[(unsigned char) *s] != MARKUP_TOKEN) {
 
 		*x = i;
 	}
@@ -86,8 +107,7 @@ char *htoi(const markup_t *mk, int *x, char *s)
 
 	if (d == 0 || d > 8) { return NULL; }
 
-	if (*s == 0 || strchr(mk->space, *s) != NULL
-			|| strchr(mk->lend, *s) != NULL) {
+	if (mk->map[(unsigned char) *s] != MARKUP_TOKEN) {
 
 		*x = h;
 	}
@@ -114,8 +134,7 @@ char *otoi(const markup_t *mk, int *x, char *s)
 
 	if (d == 0 || d > 11) { return NULL; }
 
-	if (*s == 0 || strchr(mk->space, *s) != NULL
-			|| strchr(mk->lend, *s) != NULL) {
+	if (mk->map[(unsigned char) *s] != MARKUP_TOKEN) {
 
 		*x = h;
 	}
@@ -126,7 +145,17 @@ char *otoi(const markup_t *mk, int *x, char *s)
 
 char *stod(const markup_t *mk, double *x, char *s)
 {
-	int		n, d, v, e;
+	static const double	lpow[] = {
+
+		1E+0, 1E+1, 1E+2, 1E+3, 1E+4, 1E+5, 1E+6, 1E+7, 1E+8, 1E+9,
+		1E+10, 1E+11, 1E+12, 1E+13, 1E+14, 1E+15, 1E+16, 1E+17,
+		1E+18, 1E+19, 1E+20, 1E+21, 1E+22
+	};
+
+	char			tbuf[READ_DIGIT_MAX + 16];
+	unsigned long long	m;
+
+	int		n, d, k, v, e;
 	double		f;
 
 	if (*s == '-') { n = - 1; s++; }
@@ -134,13 +163,26 @@ char *stod(const markup_t *mk, double *x, char *s)
 	else { n = 1; }
 
 	d = 0;
+	k = 0;
 	v = 0;
-	f = 0.;
+	m = 0;
 
+	/* Significant digits are collected into the integer mantissa and
+	 * also as text in case the mantissa is too long to be exact.
+	 * */
 	while (*s >= '0' && *s <= '9') {
 
-		f = 10. * f + (*s++ - '0') * n;
-		d += 1;
+		if (k < READ_DIGIT_MAX) {
+
+			if (k != 0 || *s != '0') {
+
+				m = (k < 19) ? 10 * m + (*s - '0') : m;
+				tbuf[k++] = *s;
+			}
+		}
+		else { v += 1; }
+
+		s++; d += 1;
 	}
 
 	if (*s == mk->delim) {
@@ -149,8 +191,18 @@ char *stod(const markup_t *mk, double *x, char *s)
 
 		while (*s >= '0' && *s <= '9') {
 
-			f = 10. * f + (*s++ - '0') * n;
-			d += 1; v -= 1;
+			if (k < READ_DIGIT_MAX) {
+
+				if (k != 0 || *s != '0') {
+
+					m = (k < 19) ? 10 * m + (*s - '0') : m;
+					tbuf[k++] = *s;
+				}
+
+				v -= 1;
+			}
+
+			s++; d += 1;
 		}
 	}
 
@@ -170,13 +222,29 @@ char *stod(const markup_t *mk, double *x, char *s)
 		else { return NULL; }
 	}
 
-	if (*s == 0 || strchr(mk->space, *s) != NULL
-			|| strchr(mk->lend, *s) != NULL) {
+	if (mk->map[(unsigned char) *s] != MARKUP_TOKEN) {
+
+		if (k == 0) {
+
+			f = 0.;
+		}
+		else if (k <= 19 && m <= (1ULL << 53) && v >= - 22 && v <= 22) {
+
+			/* Mantissa and power of ten are both exact so we have
+			 * the only rounding that gives the nearest double.
+			 * */
+			f = (v < 0) ? (double) m / lpow[- v] : (double) m * lpow[v];
+		}
+		else {
+			/* Long mantissa or large exponent is rare so we pass
+			 * the digits without any decimal point to strtod().
+			 * */
+			sprintf(tbuf + k, "e%i", v);
 
-		while (v < 0) { f /= 10.; v += 1; }
-		while (v > 0) { f *= 10.; v -= 1; }
+			f = strtod(tbuf, NULL);
+		}
 
-		*x = f;
+		*x = (n < 0) ? - f : f;
 	}
 	else { return NULL; }
 
@@ -210,6 +278,9 @@ read_t *readAlloc(draw_t *dw, plot_t *pl)
 	strcpy(rd->mk_text.space, rd->mk_config.space);
 	strcpy(rd->mk_text.lend, rd->mk_config.lend);
 
+	markupUpdate(&rd->mk_config);
+	markupUpdate(&rd->mk_text);
+
 #ifdef _WINDOWS
 	rd->legacy_label = 1;
 #endif /* _WINDOWS */
@@ -788,101 +859,147 @@ readTimeGetBuf(char *s, int len, FILE *fd, int timeout)
 	}
 }
 
+static char *
+readTEXTSkipSpace(const markup_t *mk, char *s, const char *end)
+{
+#ifdef _READ_SIMD_SSE2
+	__m128i		ls, lm;
+	const char	*sp;
+	int		mask;
+#endif /* _READ_SIMD_SSE2 */
+
+	/* Single separator between the columns is the most usual case.
+	 * */
+	if (mk->map[(unsigned char) s[0]] != MARKUP_SPACE) { return s; }
+	if (mk->map[(unsigned char) s[1]] != MARKUP_SPACE) { return s + 1; }
+
+#ifdef _READ_SIMD_SSE2
+	/* Long run of separators in aligned columns is skipped by compare of
+	 * 16 characters against each of the space characters at once.
+	 * */
+	while (s + 16 <= end) {
+
+		ls = _mm_loadu_si128((const __m128i *) s);
+		lm = _mm_setzero_si128();
+
+		for (sp = mk->space; *sp != 0; ++sp) {
+
+			lm = _mm_or_si128(lm, _mm_cmpeq_epi8(ls, _mm_set1_epi8(*sp)));
+		}
+
+		mask = _mm_movemask_epi8(lm) ^ 0xFFFF;
+
+		if (mask != 0) {
+
+			s += __builtin_ctz(mask);
+			break;
+		}
+
+		s += 16;
+	}
+#endif /* _READ_SIMD_SSE2 */
+
+	while (mk->map[(unsigned char) *s] == MARKUP_SPACE) { s++; }
+
+	return s;
+}
+
 static int
 readTEXTGetRow(read_t *rd, int dN)
 {
+	const markup_t	*mk = &rd->mk_text;
+
 	fval_t 		*row = rd->data[dN].row;
 	int		*hint = rd->data[dN].hint;
 	char 		*r, *s = rd->data[dN].buf;
+	const char	*end = rd->data[dN].buf + sizeof(rd->data[0].buf);
 
-	int		hex, m, N;
+	int		hex, N;
 	double		val;
 
-	m = 0;
 	N = 0;
 
-	while (*s != 0) {
-
-		if (		strchr(rd->mk_text.space, *s) != NULL
-				|| strchr(rd->mk_text.lend, *s) != NULL) {
-
-			m = 0;
-		}
-		else {
-			if (m == 0) {
-
-				m = 1;
+	do {
+		s = readTEXTSkipSpace(mk, s, end);
 
-				if (hint[N] == DATA_HINT_FLOAT) {
+		if (*s == 0)
+			break;
 
-					r = stod(&rd->mk_text, &val, s);
+		if (hint[N] == DATA_HINT_FLOAT) {
 
-					if (r != NULL) {
+			r = stod(mk, &val, s);
 
-						*row++ = (fval_t) val;
-					}
-					else {
-						*row++ = (fval_t) FP_NAN;
-					}
-				}
-				else if (hint[N] == DATA_HINT_HEX) {
+			if (r != NULL) {
 
-					r = htoi(&rd->mk_text, &hex, s);
+				*row++ = (fval_t) val;
+			}
+			else {
+				*row++ = (fval_t) FP_NAN;
+			}
+		}
+		else if (hint[N] == DATA_HINT_HEX) {
 
-					if (r != NULL) {
+			r = htoi(mk, &hex, s);
 
-						*row++ = (fval_t) hex;
-					}
-					else {
-						*row++ = (fval_t) FP_NAN;
-					}
-				}
-				else if (hint[N] == DATA_HINT_OCT) {
+			if (r != NULL) {
 
-					r = otoi(&rd->mk_text, &hex, s);
+				*row++ = (fval_t) hex;
+			}
+			else {
+				*row++ = (fval_t) FP_NAN;
+			}
+		}
+		else if (hint[N] == DATA_HINT_OCT) {
 
-					if (r != NULL) {
+			r = otoi(mk, &hex, s);
 
-						*row++ = (fval_t) hex;
-					}
-					else {
-						*row++ = (fval_t) FP_NAN;
-					}
-				}
-				else {
-					r = stod(&rd->mk_text, &val, s);
+			if (r != NULL) {
 
-					if (r != NULL) {
+				*row++ = (fval_t) hex;
+			}
+			else {
+				*row++ = (fval_t) FP_NAN;
+			}
+		}
+		else {
+			r = stod(mk, &val, s);
 
-						*row++ = (fval_t) val;
-					}
-					else {
-						r = htoi(&rd->mk_text, &hex, s);
+			if (r != NULL) {
 
-						if (r != NULL) {
+				*row++ = (fval_t) val;
+			}
+			else {
+				r = htoi(mk, &hex, s);
 
-							if (hint[N] == DATA_HINT_NONE) {
+				if (r != NULL) {
 
-								hint[N] = DATA_HINT_HEX;
-							}
+					if (hint[N] == DATA_HINT_NONE) {
 
-							*row++ = (fval_t) hex;
-						}
-						else {
-							*row++ = (fval_t) FP_NAN;
-						}
+						hint[N] = DATA_HINT_HEX;
 					}
-				}
 
-				N++;
-
-				if (N >= READ_COLUMN_MAX)
-					break;
+					*row++ = (fval_t) hex;
+				}
+				else {
+					*row++ = (fval_t) FP_NAN;
+				}
 			}
 		}
 
-		s++;
+		/* Parsed token ends at the separator already. Otherwise we
+		 * scan the rest of the token by character class.
+		 * */
+		if (r != NULL) { s = r; }
+		else {
+			while (mk->map[(unsigned char) *s] == MARKUP_TOKEN) { s++; }
+		}
+
+		N++;
+
+		if (N >= READ_COLUMN_MAX)
+			break;
 	}
+	while (1);
 
 	return N;
 }
@@ -909,8 +1026,7 @@ readTEXTGetLabel(read_t *rd, int dN)
 
 	while (*s != 0) {
 
-		if (		strchr(rd->mk_text.space, *s) != NULL
-				|| strchr(rd->mk_text.lend, *s) != NULL) {
+		if (rd->mk_text.map[(unsigned char) *s] == MARKUP_SPACE) {
 
 			if (m != 0) {
 
@@ -1058,16 +1174,129 @@ readClose(read_t *rd, int dN)
 	rd->data[dN].fd = NULL;
 	rd->data[dN].afd = NULL;
 
+	if (rd->data[dN].lz4.raw != NULL) {
+
+		free(rd->data[dN].lz4.raw);
+		free(rd->data[dN].lz4.lz);
+
+		rd->data[dN].lz4.raw = NULL;
+		rd->data[dN].lz4.lz = NULL;
+	}
+
 	rd->files_N -= 1;
 }
 
+static int
+readLZ4Header(read_t *rd, int dN, FILE *fd, int cN)
+{
+	char		magic[8];
+	unsigned int	hdr[4], map[2];
+	int		N;
+
+	/* See bench/tlz.h for the container layout.
+	 * */
+	if (		fread(magic, sizeof(magic), 1, fd) != 1
+			|| fread(hdr, sizeof(hdr), 1, fd) != 1) {
+
+		ERROR("No LZ4 header in file \"%s\"\n", rd->data[dN].file);
+		return -1;
+	}
+
+	if (memcmp(magic, "TLMLZ4\r\n", 8) != 0 || hdr[0] != 1) {
+
+		ERROR("Unknown LZ4 container in file \"%s\"\n", rd->data[dN].file);
+		return -1;
+	}
+
+	if (		hdr[1] != cN
+			|| hdr[2] < 1 || hdr[2] > cN
+			|| hdr[3] < 1 || LZ4_compressBound(hdr[3]) > rd->preload / 2) {
+
+		ERROR("Invalid LZ4 header (%u %u %u) in file \"%s\"\n",
+				hdr[1], hdr[2], hdr[3], rd->data[dN].file);
+		return -1;
+	}
+
+	rd->data[dN].lz4.map_N = hdr[2];
+	rd->data[dN].lz4.block_size = hdr[3];
+
+	for (N = 0; N < rd->data[dN].lz4.map_N; ++N) {
+
+		if (fread(map, sizeof(map), 1, fd) != 1) {
+
+			ERROR("No LZ4 column map in file \"%s\"\n", rd->data[dN].file);
+			return -1;
+		}
+
+		if (map[0] >= cN || map[1] < 1) {
+
+			ERROR("Invalid LZ4 column map in file \"%s\"\n", rd->data[dN].file);
+			return -1;
+		}
+
+		rd->data[dN].lz4.map[N] = map[0];
+		rd->data[dN].lz4.decimate[N] = map[1];
+	}
+
+	rd->data[dN].lz4.raw = malloc(rd->data[dN].lz4.block_size);
+	rd->data[dN].lz4.lz = malloc(LZ4_compressBound(rd->data[dN].lz4.block_size));
+
+	if (rd->data[dN].lz4.raw == NULL || rd->data[dN].lz4.lz == NULL) {
+
+		ERROR("No memory allocated for LZ4 block\n");
+
+		free(rd->data[dN].lz4.raw);
+		free(rd->data[dN].lz4.lz);
+
+		rd->data[dN].lz4.raw = NULL;
+		rd->data[dN].lz4.lz = NULL;
+
+		return -1;
+	}
+
+	rd->data[dN].lz4.raw_N = 0;
+	rd->data[dN].lz4.raw_pos = 0;
+	rd->data[dN].lz4.lz_N = 0;
+	rd->data[dN].lz4.row_N = 0;
+
+	/* Columns out of the map are zero.
+	 * */
+	for (N = 0; N < cN; ++N)
+		rd->data[dN].row[N] = (fval_t) 0.;
+
+	return 0;
+}
+
+static int
+readSeek(FILE *fd, unsigned long long offset)
+{
+#ifdef _WINDOWS
+	return _fseeki64(fd, (__int64) offset, SEEK_SET);
+#else /* _WINDOWS */
+	return fseeko(fd, (off_t) offset, SEEK_SET);
+#endif /* _WINDOWS */
+}
+
+static void
+readUnmap(read_t *rd, int dN, void *map, unsigned long long length)
+{
+	if (rd->data[dN].map.raw != NULL) {
+
+		file_unmap(rd->data[dN].map.raw, rd->data[dN].map.length);
+	}
+
+	rd->data[dN].map.raw = map;
+	rd->data[dN].map.length = length;
+}
+
 void readOpenUnified(read_t *rd, int dN, int cN, int lN, const char *file, int fmt)
 {
 	fval_t		rbuf[READ_COLUMN_MAX * 3];
-	int		N, rbuf_N;
+	int		N, rbuf_N, fsize = 0;
 
 	FILE			*fd;
-	unsigned long long	bF = 0U;
+	unsigned long long	bF = 0U, bM = 0U;
+	void			*map = NULL;
 
 	if (rd->data[dN].fd != NULL) {
 
@@ -1130,14 +1359,34 @@ void readOpenUnified(read_t *rd, int dN, int cN, int lN, const char *file, int f
 		}
 		else if (fmt == FORMAT_BINARY_FLOAT) {
 
+			fsize = (lN < 1) ? sizeof(float) : 0;
+
 			lN = (lN < 1) ? bF / (cN * sizeof(float)) : lN;
 			rd->data[dN].line_N = 1;
 		}
 		else if (fmt == FORMAT_BINARY_DOUBLE) {
 
+			fsize = (lN < 1) ? sizeof(double) : 0;
+
 			lN = (lN < 1) ? bF / (cN * sizeof(double)) : lN;
 			rd->data[dN].line_N = 1;
 		}
+		else if (fmt == FORMAT_BINARY_LZ4) {
+
+			strcpy(rd->data[dN].file, file);
+
+			if (readLZ4Header(rd, dN, fd, cN) != 0) {
+
+				fclose(fd);
+				return ;
+			}
+
+			/* Compressed file size says nothing about the
+			 * length so we use incremental allocation.
+			 * */
+			lN = (lN < 1) ? 1000 : lN;
+			rd->data[dN].line_N = 1;
+		}
 
 #ifdef _LEGACY
 		else if (fmt == FORMAT_BINARY_LEGACY_V1) {
@@ -1156,8 +1405,49 @@ void readOpenUnified(read_t *rd, int dN, int cN, int lN, const char *file, int f
 		}
 #endif /* _LEGACY */
 
+		if (fsize != 0 && lN > 0 && rd->pl->lz4_compress != 0) {
+
+			/* Whole binary file is mapped into memory and chunks are
+			 * converted on demand. So the file is opened at once
+			 * whatever its size.
+			 * */
+			map = file_map(file, &bM);
+		}
+
 		plotDataAlloc(rd->pl, dN, cN, lN + 1);
 
+		if (		fmt == FORMAT_BINARY_FLOAT
+				|| fmt == FORMAT_BINARY_LZ4) {
+
+			/* File has float values so the columns are kept in
+			 * float too with half of memory.
+			 * */
+			for (N = 0; N < cN; ++N)
+				plotDataColumnType(rd->pl, dN, N, COLUMN_FLOAT);
+		}
+
+		readUnmap(rd, dN, NULL, 0U);
+
+		if (map != NULL) {
+
+			/* Rows appended after this moment are read from
+			 * the stream as usual.
+			 * */
+			bF = (unsigned long long) lN * cN * fsize;
+
+			if (		bM >= bF && readSeek(fd, bF) == 0
+					&& plotDataMap(rd->pl, dN, map, fsize, lN) == 0) {
+
+				rd->data[dN].line_N += lN;
+
+				readUnmap(rd, dN, map, bM);
+			}
+			else {
+				readSeek(fd, 0U);
+				file_unmap(map, bM);
+			}
+		}
+
 		if (		fmt == FORMAT_PLAIN_STDIN
 				|| fmt == FORMAT_PLAIN_TEXT) {
 
@@ -1188,6 +1478,8 @@ void readOpenStub(read_t *rd, int dN, int cN, int lN, const char *file, int fmt)
 
 	plotDataAlloc(rd->pl, dN, cN, lN + 1);
 
+	readUnmap(rd, dN, NULL, 0U);
+
 	rd->data[dN].format = fmt;
 	rd->data[dN].column_N = cN;
 
@@ -1196,6 +1488,51 @@ void readOpenStub(read_t *rd, int dN, int cN, int lN, const char *file, int fmt)
 	rd->bind_N = dN;
 }
 
+void readOpenDirect(read_t *rd, int dN, int cN, const char *label)
+{
+	int		N;
+
+	if (rd->data[dN].fd != NULL) {
+
+		readClose(rd, dN);
+	}
+
+	/* Rows are given by the host so we only take the labels from the
+	 * same line as in text file.
+	 * */
+	sprintf(rd->data[dN].buf, "%.*s", (int) sizeof(rd->data[0].buf) - 1, label);
+
+	N = readTEXTGetLabel(rd, dN);
+
+	for (; N < cN; ++N) {
+
+		rd->data[dN].label[N][0] = 0;
+	}
+
+	readOpenStub(rd, dN, cN, 0, "", FORMAT_NONE);
+
+	rd->data[dN].line_N = 0;
+}
+
+void readInsertRow(read_t *rd, int dN, const double *row)
+{
+	int		N;
+
+	for (N = 0; N < rd->data[dN].column_N; ++N) {
+
+		rd->data[dN].row[N] = (fval_t) row[N];
+	}
+
+	plotDataInsert(rd->pl, dN, rd->data[dN].row);
+
+	rd->data[dN].line_N++;
+
+	if (plotDataSpaceLeft(rd->pl, dN) < 10) {
+
+		plotDataGrowUp(rd->pl, dN);
+	}
+}
+
 void readToggleHint(read_t *rd, int dN, int cN)
 {
 	if (rd->data[dN].format == FORMAT_NONE) {
@@ -1303,6 +1640,106 @@ readDOUBLE(read_t *rd, int dN)
 	return 0;
 }
 
+static int
+readLZ4(read_t *rd, int dN)
+{
+	unsigned int	chunk[2];
+	float		fval;
+	int		r, N, lzLEN, cN = rd->pl->data[dN].column_N;
+
+	if (rd->data[dN].lz4.raw_pos >= rd->data[dN].lz4.raw_N) {
+
+		if (rd->data[dN].lz4.lz_N == 0) {
+
+			r = async_read(rd->data[dN].afd, (void *) chunk, sizeof(chunk));
+
+			if (r == ASYNC_END_OF_FILE) {
+
+				readClose(rd, dN);
+				return 0;
+			}
+			else if (r != ASYNC_OK) {
+
+				return 0;
+			}
+
+			if (		chunk[0] > rd->data[dN].lz4.block_size
+					|| chunk[1] < 1 || chunk[1] > LZ4_compressBound(
+						rd->data[dN].lz4.block_size)) {
+
+				ERROR("Invalid LZ4 chunk (%u %u) in file \"%s\"\n",
+						chunk[0], chunk[1], rd->data[dN].file);
+
+				readClose(rd, dN);
+				return 0;
+			}
+
+			rd->data[dN].lz4.raw_N = chunk[0];
+			rd->data[dN].lz4.lz_N = chunk[1];
+		}
+
+		r = async_read(rd->data[dN].afd, rd->data[dN].lz4.lz,
+				rd->data[dN].lz4.lz_N);
+
+		if (r == ASYNC_END_OF_FILE) {
+
+			readClose(rd, dN);
+			return 0;
+		}
+		else if (r != ASYNC_OK) {
+
+			return 0;
+		}
+
+		lzLEN = LZ4_decompress_safe(rd->data[dN].lz4.lz, rd->data[dN].lz4.raw,
+				rd->data[dN].lz4.lz_N, rd->data[dN].lz4.block_size);
+
+		if (lzLEN != rd->data[dN].lz4.raw_N) {
+
+			ERROR("LZ4 decompression failed in file \"%s\"\n",
+					rd->data[dN].file);
+
+			readClose(rd, dN);
+			return 0;
+		}
+
+		rd->data[dN].lz4.raw_pos = 0;
+		rd->data[dN].lz4.lz_N = 0;
+	}
+
+	for (N = 0; N < rd->data[dN].lz4.map_N; ++N) {
+
+		if (rd->data[dN].lz4.row_N % rd->data[dN].lz4.decimate[N] != 0) {
+
+			/* Hold the last value of decimated column.
+			 * */
+			continue;
+		}
+
+		if (rd->data[dN].lz4.raw_pos + (int) sizeof(float) > rd->data[dN].lz4.raw_N) {
+
+			ERROR("LZ4 chunk is truncated in file \"%s\"\n", rd->data[dN].file);
+
+			readClose(rd, dN);
+			return 0;
+		}
+
+		memcpy(&fval, rd->data[dN].lz4.raw + rd->data[dN].lz4.raw_pos, sizeof(float));
+		rd->data[dN].lz4.raw_pos += sizeof(float);
+
+		if (rd->data[dN].lz4.map[N] < cN) {
+
+			rd->data[dN].row[rd->data[dN].lz4.map[N]] = (fval_t) fval;
+		}
+	}
+
+	rd->data[dN].lz4.row_N++;
+
+	plotDataInsert(rd->pl, dN, rd->data[dN].row);
+
+	return 1;
+}
+
 #ifdef _LEGACY
 static int
 readLEGACY(read_t *rd, int dN)
@@ -1391,6 +1828,16 @@ int readUpdate(read_t *rd)
 						break;
 					}
 				}
+				else if (rd->data[dN].format == FORMAT_BINARY_LZ4) {
+
+					if (readLZ4(rd, dN) != 0) {
+
+						ulN += 1;
+					}
+					else {
+						break;
+					}
+				}
 
 #ifdef _LEGACY
 				else if (rd->data[dN].format == FORMAT_BINARY_LEGACY_V1
@@ -1962,6 +2409,48 @@ configParseFSM(read_t *rd, parse_t *pa)
 				}
 				while (0);
 			}
+			else if (strcmp(tbuf, "tiled") == 0) {
+
+				failed = 1;
+
+				do {
+					r = configToken(rd, pa);
+
+					if (r == 0 && stoi(&rd->mk_config, &argi[0], tbuf) != NULL) ;
+					else break;
+
+					if (argi[0] >= 0 && argi[0] <= 1) {
+
+						failed = 0;
+						rd->dw->tiled = argi[0];
+					}
+					else {
+						sprintf(msg_tbuf, "invalid tiled %i", argi[0]);
+					}
+				}
+				while (0);
+			}
+			else if (strcmp(tbuf, "threads") == 0) {
+
+				failed = 1;
+
+				do {
+					r = configToken(rd, pa);
+
+					if (r == 0 && stoi(&rd->mk_config, &argi[0], tbuf) != NULL) ;
+					else break;
+
+					if (argi[0] >= 0 && argi[0] <= DRAW_TILE_THREAD_MAX + 1) {
+
+						failed = 0;
+						rd->dw->threads = argi[0];
+					}
+					else {
+						sprintf(msg_tbuf, "invalid threads %i", argi[0]);
+					}
+				}
+				while (0);
+			}
 			else if (strcmp(tbuf, "thickness") == 0) {
 
 				failed = 1;
@@ -2222,6 +2711,7 @@ configParseFSM(read_t *rd, parse_t *pa)
 						failed = 0;
 						strcpy(rd->mk_text.space, rd->mk_config.space);
 						strcat(rd->mk_text.space, tbuf);
+						markupUpdate(&rd->mk_text);
 					}
 				}
 				while (0);
@@ -2300,6 +2790,10 @@ configParseFSM(read_t *rd, parse_t *pa)
 
 							argi[2] = FORMAT_BINARY_DOUBLE;
 						}
+						else if (strcmp(tbuf, "lz4") == 0) {
+
+							argi[2] = FORMAT_BINARY_LZ4;
+						}
 						else {
 							sprintf(msg_tbuf, "invalid file format \"%.80s\"", tbuf);
 							break;
@@ -2330,7 +2824,8 @@ configParseFSM(read_t *rd, parse_t *pa)
 						break;
 					}
 					else if (	argi[2] == FORMAT_BINARY_FLOAT
-							|| argi[2] == FORMAT_BINARY_DOUBLE) {
+							|| argi[2] == FORMAT_BINARY_DOUBLE
+							|| argi[2] == FORMAT_BINARY_LZ4) {
 
 						r = configToken(rd, pa);
 
@@ -2365,7 +2860,8 @@ configParseFSM(read_t *rd, parse_t *pa)
 						if (rd->data[dN_remap].fd == NULL) {
 
 							if (		argi[2] == FORMAT_BINARY_FLOAT
-									|| argi[2] == FORMAT_BINARY_DOUBLE) {
+									|| argi[2] == FORMAT_BINARY_DOUBLE
+									|| argi[2] == FORMAT_BINARY_LZ4) {
 
 								readOpenStub(rd, dN_remap, argi[3],
 										argi[1], lbuf, argi[2]);
@@ -2462,6 +2958,57 @@ configParseFSM(read_t *rd, parse_t *pa)
 				}
 				while (0);
 			}
+			else if (strcmp(tbuf, "coltype") == 0) {
+
+				failed = 1;
+
+				do {
+					r = configToken(rd, pa);
+
+					if (r == 0) {
+
+						if (strcmp(tbuf, "double") == 0) {
+
+							argi[0] = COLUMN_DOUBLE;
+						}
+						else if (strcmp(tbuf, "float") == 0) {
+
+							argi[0] = COLUMN_FLOAT;
+						}
+						else if (strcmp(tbuf, "int") == 0) {
+
+							argi[0] = COLUMN_INT;
+						}
+						else {
+							sprintf(msg_tbuf, "invalid column type \"%.80s\"", tbuf);
+							break;
+						}
+					}
+					else break;
+
+					r = configToken(rd, pa);
+
+					if (r == 0 && stoi(&rd->mk_config, &argi[1], tbuf) != NULL) ;
+					else break;
+
+					if (rd->bind_N < 0) {
+
+						sprintf(msg_tbuf, "no dataset selected");
+						break;
+					}
+
+					if (argi[1] >= 0 && argi[1] < rd->pl->data[rd->bind_N].column_N) {
+
+						failed = 0;
+
+						plotDataColumnType(rd->pl, rd->bind_N, argi[1], argi[0]);
+					}
+					else {
+						sprintf(msg_tbuf, "column number %i is out of range", argi[1]);
+					}
+				}
+				while (0);
+			}
 			else if (strcmp(tbuf, "deflabel") == 0) {
 
 				failed = 1;
@@ -3452,12 +3999,14 @@ void readDatasetClean(read_t *rd, int dN)
 		readClose(rd, dN);
 	}
 
-	memset(&rd->data[dN], 0, sizeof(rd->data[0]));
-
 	plotFigureGarbage(rd->pl, dN);
 
 	plotDataRangeCacheClean(rd->pl, dN);
 	plotDataClean(rd->pl, dN);
+
+	readUnmap(rd, dN, NULL, 0U);
+
+	memset(&rd->data[dN], 0, sizeof(rd->data[0]));
 }
 
 int readGetTimeColumn(read_t *rd, int dN)
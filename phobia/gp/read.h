@@ -46,6 +46,7 @@ enum {
 	FORMAT_PLAIN_TEXT,
 	FORMAT_BINARY_FLOAT,
 	FORMAT_BINARY_DOUBLE,
+	FORMAT_BINARY_LZ4,
 
 #ifdef _LEGACY
 	FORMAT_BINARY_LEGACY_V1,
@@ -53,6 +54,12 @@ enum {
 #endif /* _LEGACY */
 };
 
+enum {
+	MARKUP_TOKEN			= 0,
+	MARKUP_SPACE,
+	MARKUP_END
+};
+
 enum {
 	DATA_HINT_NONE			= 0,
 	DATA_HINT_FLOAT,
@@ -65,6 +72,11 @@ typedef struct {
 	char		delim;
 	char		space[READ_TOKEN_MAX];
 	char		lend[READ_TOKEN_MAX];
+
+	/* Class of each character that is built from \space and \lend
+	 * by markupUpdate() so we do not search the strings.
+	 * */
+	unsigned char	map[256];
 }
 markup_t;
 
@@ -181,6 +193,31 @@ typedef struct {
 		char		label[READ_COLUMN_MAX][READ_TOKEN_MAX];
 
 		int		hint[READ_COLUMN_MAX];
+
+		struct {
+
+			int		map_N;
+			int		map[READ_COLUMN_MAX];
+			int		decimate[READ_COLUMN_MAX];
+
+			char		*raw;
+			char		*lz;
+
+			int		block_size;
+			int		raw_N;
+			int		raw_pos;
+			int		lz_N;
+
+			long long	row_N;
+		}
+		lz4;
+
+		struct {
+
+			void			*raw;
+			unsigned long long	length;
+		}
+		map;
 	}
 	data[PLOT_DATASET_MAX];
 
@@ -194,6 +231,8 @@ typedef struct {
 }
 read_t;
 
+void markupUpdate(markup_t *mk);
+
 char *stoi(const markup_t *mk, int *x, char *s);
 char *htoi(const markup_t *mk, int *x, char *s);
 char *otoi(const markup_t *mk, int *x, char *s);
@@ -202,6 +241,9 @@ char *stod(const markup_t *mk, double *x, char *s);
 read_t *readAlloc(draw_t *dw, plot_t *pl);
 void readClean(read_t *rd);
 void readOpenUnified(read_t *rd, int dN, int cN, int lN, const char *file, int fmt);
+void readOpenStub(read_t *rd, int dN, int cN, int lN, const char *file, int fmt);
+void readOpenDirect(read_t *rd, int dN, int cN, const char *label);
+void readInsertRow(read_t *rd, int dN, const double *row);
 void readToggleHint(read_t *rd, int dN, int cN);
 int readUpdate(read_t *rd);
 
@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
@@ -14,6 +15,15 @@
 #define LINK_SPACE			" \t"
 #define LINK_EXTRA			"])"
 
+#define LINK_BATCH_MAX			72
+#define LINK_QUEUED_MAX			80
+
+#define LINK_TLM_INPUT_MAX		10
+#define LINK_TLM_FRAME_MAX		160
+#define LINK_TLM_ROW_MAX		4096
+
+#define LINK_HASH_MAX			2048
+
 enum {
 	LINK_MODE_IDLE			= 0,
 	LINK_MODE_HWINFO,
@@ -36,12 +46,40 @@ struct link_priv {
 	FILE			*fd_log;
 	FILE			*fd_grab;
 
+	struct {
+
+		int		layout_N;
+		int		precision;
+		double		dT;
+
+		char		fmt[LINK_TLM_INPUT_MAX][2];
+
+		int		clock;
+
+		/* Decoded rows wait here until the host takes them.
+		 * */
+		double		row[LINK_TLM_ROW_MAX][LINK_TLM_INPUT_MAX + 1];
+
+		int		row_rp;
+		int		row_wp;
+	}
+	tlm;
+
 	char			hw_revision[LINK_NAME_MAX];
 	char			hw_build[LINK_NAME_MAX];
 	char			hw_crc32[LINK_NAME_MAX];
 
 	char			mb[81920];
 	char			*mbflow;
+
+	/* Index of register names. The hash table keeps (reg_ID + 1) with
+	 * linear probing and sorted table is used to look up the prefix.
+	 * */
+	short			reg_hash[LINK_HASH_MAX];
+	int			reg_hash_dirty;
+
+	short			reg_sort[LINK_REGS_MAX];
+	int			reg_sort_N;
 };
 
 const char *lk_stoi(int *x, const char *s)
@@ -290,6 +328,132 @@ link_reg_postproc(struct link_pmc *lp, struct link_reg *reg)
 	}
 }
 
+static unsigned int
+link_reg_hash(const char *sym)
+{
+	unsigned int		h = 2166136261U;
+
+	/* FNV-1a hash.
+	 * */
+	while (*sym != 0) {
+
+		h = (h ^ (unsigned char) *sym++) * 16777619U;
+	}
+
+	return h & (LINK_HASH_MAX - 1U);
+}
+
+static void
+link_reg_hash_insert(struct link_pmc *lp, int reg_ID)
+{
+	struct link_priv	*priv = lp->priv;
+	unsigned int		n;
+
+	n = link_reg_hash(lp->reg[reg_ID].sym);
+
+	while (priv->reg_hash[n] != 0) {
+
+		if (priv->reg_hash[n] == reg_ID + 1)
+			return ;
+
+		n = (n + 1U) & (LINK_HASH_MAX - 1U);
+	}
+
+	priv->reg_hash[n] = reg_ID + 1;
+}
+
+static void
+link_reg_hash_rebuild(struct link_pmc *lp)
+{
+	struct link_priv	*priv = lp->priv;
+	int			reg_ID;
+
+	memset(priv->reg_hash, 0, sizeof(priv->reg_hash));
+
+	for (reg_ID = 0; reg_ID < lp->reg_MAX_N; ++reg_ID) {
+
+		if (lp->reg[reg_ID].sym[0] != 0) {
+
+			link_reg_hash_insert(lp, reg_ID);
+		}
+	}
+
+	priv->reg_hash_dirty = 0;
+}
+
+static int
+link_reg_sort_bound(struct link_pmc *lp, const char *sym)
+{
+	struct link_priv	*priv = lp->priv;
+	int			lo, hi, mid;
+
+	lo = 0;
+	hi = priv->reg_sort_N;
+
+	while (lo < hi) {
+
+		mid = (lo + hi) / 2;
+
+		if (strcmp(lp->reg[priv->reg_sort[mid]].sym, sym) < 0) {
+
+			lo = mid + 1;
+		}
+		else {
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+static void
+link_reg_index(struct link_pmc *lp, int reg_ID, const char *sym)
+{
+	struct link_priv	*priv = lp->priv;
+	struct link_reg		*reg = lp->reg + reg_ID;
+	char			sbuf[LINK_NAME_MAX];
+	int			n;
+
+	sprintf(sbuf, "%.77s", sym);
+
+	if (strcmp(reg->sym, sbuf) == 0)
+		return ;
+
+	if (reg->sym[0] != 0) {
+
+		/* Register is renamed so we drop it from index.
+		 * */
+		n = link_reg_sort_bound(lp, reg->sym);
+
+		while (n < priv->reg_sort_N && priv->reg_sort[n] != reg_ID) { n++; }
+
+		if (n < priv->reg_sort_N) {
+
+			memmove(priv->reg_sort + n, priv->reg_sort + n + 1,
+					(priv->reg_sort_N - n - 1) * sizeof(short));
+
+			priv->reg_sort_N -= 1;
+		}
+
+		priv->reg_hash_dirty = 1;
+	}
+
+	strcpy(reg->sym, sbuf);
+
+	if (reg->sym[0] != 0) {
+
+		n = link_reg_sort_bound(lp, reg->sym);
+
+		memmove(priv->reg_sort + n + 1, priv->reg_sort + n,
+				(priv->reg_sort_N - n) * sizeof(short));
+
+		priv->reg_sort[n] = reg_ID;
+		priv->reg_sort_N += 1;
+
+		link_reg_hash_insert(lp, reg_ID);
+	}
+}
+
 static void
 link_fetch_reg_format(struct link_pmc *lp)
 {
@@ -339,7 +503,7 @@ link_fetch_reg_format(struct link_pmc *lp)
 
 			reg->mode = reg_mode;
 
-			sprintf(reg->sym, "%.77s", sym);
+			link_reg_index(lp, reg_ID, sym);
 			sprintf(reg->val, "%.77s", lk_token(&sp));
 			sprintf(reg->um,  "%.77s", lk_token(&sp));
 
@@ -392,6 +556,20 @@ link_fetch_hwinfo(struct link_pmc *lp)
 		sprintf(lp->hwinfo, "%.16s / %.16s / %.36s", priv->hw_revision,
 				priv->hw_build, priv->hw_crc32);
 	}
+	else if (strcmp(tok, "Feature") == 0) {
+
+		while (*sp != 0) {
+
+			tok = lk_token(&sp);
+
+			if (		*tok != 0 && strlen(lp->feature) + strlen(tok)
+					< sizeof(lp->feature) - 2) {
+
+				strcat(lp->feature, " ");
+				strcat(lp->feature, tok);
+			}
+		}
+	}
 }
 
 static void
@@ -417,6 +595,272 @@ link_fetch_clock(struct link_pmc *lp)
 	}
 }
 
+static uint32_t
+link_crc32b(const uint8_t *s, int n)
+{
+	uint32_t		crc, buf;
+
+	static const uint32_t	mask[16] = {
+
+		0x00000000U, 0x1DB71064U, 0x3B6E20C8U, 0x26D930ACU,
+		0x76DC4190U, 0x6B6B51F4U, 0x4DB26158U, 0x5005713CU,
+		0xEDB88320U, 0xF00F9344U, 0xD6D6A3E8U, 0xCB61B38CU,
+		0x9B64C2B0U, 0x86D3D2D4U, 0xA00AE278U, 0xBDBDF21CU
+	};
+
+	crc = 0xFFFFFFFFU;
+
+	while (n >= 4) {
+
+		buf = (uint32_t) s[0] | (uint32_t) s[1] << 8
+			| (uint32_t) s[2] << 16 | (uint32_t) s[3] << 24;
+
+		s += 4;
+		n += - 4;
+
+		crc = crc ^ buf;
+
+		crc = (crc >> 4) ^ mask[crc & 0x0FU];
+		crc = (crc >> 4) ^ mask[crc & 0x0FU];
+		crc = (crc >> 4) ^ mask[crc & 0x0FU];
+		crc = (crc >> 4) ^ mask[crc & 0x0FU];
+		crc = (crc >> 4) ^ mask[crc & 0x0FU];
+		crc = (crc >> 4) ^ mask[crc & 0x0FU];
+		crc = (crc >> 4) ^ mask[crc & 0x0FU];
+		crc = (crc >> 4) ^ mask[crc & 0x0FU];
+	}
+
+	return crc ^ 0xFFFFFFFFU;
+}
+
+static int
+link_base64_decode(uint8_t *data, const char *s, int n)
+{
+	uint32_t		x = 0U;
+	int			c, len = 0, bits = 0;
+
+	while (*s != 0 && *s != '=') {
+
+		c = *s++;
+
+		if (c >= 'A' && c <= 'Z') { c = c - 'A'; }
+		else if (c >= 'a' && c <= 'z') { c = c - 'a' + 26; }
+		else if (c >= '0' && c <= '9') { c = c - '0' + 52; }
+		else if (c == '+') { c = 62; }
+		else if (c == '/') { c = 63; }
+		else return -1;
+
+		x = (x << 6) | (uint32_t) c;
+		bits += 6;
+
+		if (bits >= 8) {
+
+			bits += - 8;
+
+			if (len >= n)
+				return -1;
+
+			data[len++] = (uint8_t) (x >> bits);
+		}
+	}
+
+	return len;
+}
+
+static void
+link_fetch_tlm_header(struct link_pmc *lp)
+{
+	struct link_priv	*priv = lp->priv;
+	char			*sp = priv->lbuf + 3;
+	const char		*tok;
+	double			freq;
+	int			N, length, rate;
+
+	priv->tlm.layout_N = 0;
+
+	if (lk_stoi(&N, lk_token(&sp)) == NULL)
+		return ;
+
+	if (N < 1 || N > LINK_TLM_INPUT_MAX)
+		return ;
+
+	if (lk_stoi(&length, lk_token(&sp)) == NULL)
+		return ;
+
+	if (lk_stoi(&priv->tlm.precision, lk_token(&sp)) == NULL)
+		return ;
+
+	if (lk_stoi(&rate, lk_token(&sp)) == NULL)
+		return ;
+
+	if (lk_stod(&freq, lk_token(&sp)) == NULL)
+		return ;
+
+	for (priv->tlm.layout_N = 0; priv->tlm.layout_N < N; ++priv->tlm.layout_N) {
+
+		tok = lk_token(&sp);
+
+		if (strlen(tok) != 2)
+			break;
+
+		priv->tlm.fmt[priv->tlm.layout_N][0] = tok[0];
+		priv->tlm.fmt[priv->tlm.layout_N][1] = tok[1];
+	}
+
+	if (priv->tlm.layout_N != N) {
+
+		priv->tlm.layout_N = 0;
+		return ;
+	}
+
+	priv->tlm.dT = (freq > 0.) ? (double) rate / freq : 1.;
+	priv->tlm.clock = 0;
+}
+
+static void
+link_fetch_tlm_frame(struct link_pmc *lp)
+{
+	struct link_priv	*priv = lp->priv;
+	uint8_t			frame[LINK_TLM_FRAME_MAX];
+	const uint8_t		*code, *data;
+	uint32_t		crc, x, lprev[LINK_TLM_INPUT_MAX];
+	double			*row, rbuf[LINK_TLM_INPUT_MAX + 1];
+	int			len, clock, rows, delta, wp, N, n, k;
+
+	union {
+
+		float		f;
+		int32_t		i;
+	}
+	rval;
+
+	if (priv->tlm.layout_N == 0)
+		return ;
+
+	len = link_base64_decode(frame, priv->lbuf + 1, sizeof(frame));
+
+	if (len < 8 || (len & 3) != 0) {
+
+		return ;
+	}
+
+	len += - 4;
+
+	crc = (uint32_t) frame[len] | (uint32_t) frame[len + 1] << 8
+		| (uint32_t) frame[len + 2] << 16 | (uint32_t) frame[len + 3] << 24;
+
+	if (link_crc32b(frame, len) != crc) {
+
+		return ;
+	}
+
+	clock = (int) frame[0] | (int) frame[1] << 8;
+	rows = frame[2];
+	delta = frame[3];
+
+	/* Frame has only low 16 bits of the line number so we extend it from
+	 * the expected one. Stream may run for a long time.
+	 * */
+	clock = (clock - priv->tlm.clock) & 0xFFFF;
+
+	/* We count the lines lost in corrupted frames or dropped by PMC
+	 * because of slow link.
+	 * */
+	lp->grab_lost += clock;
+
+	priv->tlm.clock += clock;
+
+	memset(lprev, 0, sizeof(lprev));
+
+	data = frame + 4;
+
+	while (rows > 0) {
+
+		code = data;
+		data += (priv->tlm.layout_N + 3) / 4;
+
+		if (data > frame + len)
+			break;
+
+		wp = (priv->tlm.row_wp + 1) % LINK_TLM_ROW_MAX;
+
+		if (lp->grab_rows != 0 && wp != priv->tlm.row_rp) {
+
+			row = priv->tlm.row[priv->tlm.row_wp];
+		}
+		else {
+			/* Row is lost for the host if nobody takes them.
+			 * */
+			row = rbuf;
+
+			lp->grab_lost += (lp->grab_rows != 0) ? 1 : 0;
+		}
+
+		row[0] = (double) priv->tlm.clock * priv->tlm.dT;
+
+		fprintf(priv->fd_grab, "%.*f;", priv->tlm.precision, row[0]);
+
+		for (N = 0; N < priv->tlm.layout_N; ++N) {
+
+			n = (code[N / 4] >> ((N & 3) * 2)) & 3;
+			n = (n == 3) ? 4 : n;
+
+			x = 0U;
+
+			for (k = 0; k < n && data < frame + len; ++k) {
+
+				x |= (uint32_t) *data++ << (k * 8);
+			}
+
+			x = (delta != 0) ? x ^ lprev[N] : x;
+
+			lprev[N] = x;
+
+			memcpy(&rval, &x, sizeof(x));
+
+			k = priv->tlm.fmt[N][0] - '0';
+
+			switch (priv->tlm.fmt[N][1]) {
+
+				case 'i':
+				case 'x':
+					row[N + 1] = (double) rval.i;
+					fprintf(priv->fd_grab, "%i;", (int) rval.i);
+					break;
+
+				case 'e':
+					row[N + 1] = (double) rval.f;
+					fprintf(priv->fd_grab, "%.*e;", k, (double) rval.f);
+					break;
+
+				case 'g':
+					row[N + 1] = (double) rval.f;
+					fprintf(priv->fd_grab, "%.*g;", k, (double) rval.f);
+					break;
+
+				default:
+					row[N + 1] = (double) rval.f;
+					fprintf(priv->fd_grab, "%.*f;", k, (double) rval.f);
+					break;
+			}
+		}
+
+		fprintf(priv->fd_grab, "\n");
+
+		if (row != rbuf) {
+
+			priv->tlm.row_wp = wp;
+		}
+
+		priv->tlm.clock += 1;
+
+		lp->grab_N++;
+		rows--;
+	}
+
+	fflush(priv->fd_grab);
+}
+
 static void
 link_fetch_epcan_map(struct link_pmc *lp)
 {
@@ -610,10 +1054,17 @@ void link_remote(struct link_pmc *lp)
 
 	lp->grab_N = 0;
 
+	lp->feature[0] = 0;
+
 	memset(lp->reg, 0, sizeof(lp->reg));
 
 	lp->reg_MAX_N = 0;
 
+	memset(priv->reg_hash, 0, sizeof(priv->reg_hash));
+
+	priv->reg_hash_dirty = 0;
+	priv->reg_sort_N = 0;
+
 	sprintf(priv->lbuf, LINK_EOL LINK_EOL);
 	serial_fputs(priv->fd, priv->lbuf);
 
@@ -651,6 +1102,8 @@ int link_fetch(struct link_pmc *lp, int clock)
 		{ "pm_probe",		LINK_MODE_UNABLE_WARNING },
 		{ "pm_adjust",		LINK_MODE_UNABLE_WARNING },
 		{ "tlm_flush_sync",	LINK_MODE_DATA_GRAB },
+		{ "tlm_flush_bin",	LINK_MODE_DATA_GRAB },
+		{ "tlm_stream_sync",	LINK_MODE_DATA_GRAB },
 		{ "tlm_live_sync",	LINK_MODE_DATA_GRAB },
 		{ "net_survey",		LINK_MODE_EPCAN_MAP },
 		{ "net_assign",		LINK_MODE_UNABLE_WARNING },
@@ -730,6 +1183,34 @@ int link_fetch(struct link_pmc *lp, int clock)
 				if (priv->fd_grab == NULL)
 					break;
 
+				if (strstr(priv->lbuf, "$H ") == priv->lbuf) {
+
+					link_fetch_tlm_header(lp);
+					break;
+				}
+				else if (strstr(priv->lbuf, "$O ") == priv->lbuf) {
+
+					/* PMC tells how many lines it has dropped, they
+					 * are also seen by the line gap.
+					 * */
+					lk_stoi(&lp->grab_overflow, priv->lbuf + 3);
+					break;
+				}
+				else if (priv->lbuf[0] == '$') {
+
+					link_fetch_tlm_frame(lp);
+					break;
+				}
+
+				if (		priv->tlm.layout_N == 0
+						&& lp->grab_label[0] == 0) {
+
+					/* Label line comes before the header.
+					 * */
+					sprintf(lp->grab_label, "%.*s", (int) sizeof(lp->grab_label) - 1,
+							priv->lbuf);
+				}
+
 				fprintf(priv->fd_grab, "%s\n", priv->lbuf);
 				fflush(priv->fd_grab);
 
@@ -780,11 +1261,43 @@ int link_fetch(struct link_pmc *lp, int clock)
 	return N;
 }
 
+void link_wait(struct link_pmc *lp, int timeout)
+{
+	struct link_priv	*priv = lp->priv;
+
+	if (		lp->linked == 0
+			|| priv->link_mode == LINK_MODE_DATA_GRAB) {
+
+		/* We do not need to wake up on each chunk of data grab.
+		 * */
+		SDL_Delay(timeout);
+	}
+	else {
+		serial_wait(priv->fd, timeout);
+	}
+}
+
+static void
+link_push_range(char *lbuf, int min, int max)
+{
+	lbuf += strlen(lbuf);
+
+	if (min != max) {
+
+		sprintf(lbuf, " %i-%i", min, max);
+	}
+	else {
+		sprintf(lbuf, " %i", min);
+	}
+}
+
 void link_push(struct link_pmc *lp)
 {
 	struct link_priv	*priv = lp->priv;
 	struct link_reg		*reg;
-	int			reg_ID, dofetch;
+	char			sbuf[LINK_MESSAGE_MAX];
+	int			reg_ID, dofetch, queued_N, min, max, set_N;
+	int			batch_list, batch_set;
 
 	if (lp->linked == 0)
 		return ;
@@ -795,9 +1308,36 @@ void link_push(struct link_pmc *lp)
 	if (lp->locked > lp->clock)
 		return ;
 
+	/* Older firmware has no batch commands so we fall back to single
+	 * register per line.
+	 * */
+	batch_list = link_feature(lp, "reg_list");
+	batch_set = link_feature(lp, "reg_set");
+
+	/* We keep several requests in flight. The replies are matched by
+	 * register ID so we only limit the number of queued registers.
+	 * */
+	queued_N = 0;
+
+	for (reg_ID = 0; reg_ID < lp->reg_MAX_N; ++reg_ID) {
+
+		queued_N += (lp->reg[reg_ID].queued != 0) ? 1 : 0;
+	}
+
+	sprintf(priv->lbuf, "reg_list");
+	sprintf(sbuf, "reg_set");
+
+	min = -1;
+	max = -1;
+
+	set_N = 0;
+
 	reg_ID = priv->reg_push_ID;
 
 	do {
+		if (queued_N >= LINK_QUEUED_MAX)
+			break;
+
 		reg = lp->reg + reg_ID;
 
 		if (reg->queued == 0) {
@@ -827,18 +1367,44 @@ void link_push(struct link_pmc *lp)
 
 			if (reg->modified > reg->fetched) {
 
-				sprintf(priv->lbuf, "reg %i %.77s" LINK_EOL,
-						reg_ID, reg->val);
+				if (batch_set != 0) {
 
-				if (serial_fputs(priv->fd, priv->lbuf) == SERIAL_OK) {
+					if (		set_N != 0 && strlen(sbuf) + strlen(reg->val)
+							> LINK_BATCH_MAX - 8)
+						break;
+
+					sprintf(sbuf + strlen(sbuf), " %i %.77s", reg_ID, reg->val);
 
 					reg->queued = lp->clock;
-					lp->locked = lp->clock + lp->quantum;
+					queued_N++;
+					set_N++;
 				}
+				else {
+					if (min >= 0) {
 
-				break;
+						/* Send the batch first */
+						break;
+					}
+
+					sprintf(priv->lbuf, "reg %i %.77s" LINK_EOL,
+							reg_ID, reg->val);
+
+					if (serial_fputs(priv->fd, priv->lbuf) == SERIAL_OK) {
+
+						reg->queued = lp->clock;
+						lp->locked = lp->clock + lp->quantum;
+					}
+
+					break;
+				}
 			}
-			else if (dofetch != 0) {
+			else if (dofetch != 0 && batch_list == 0) {
+
+				if (set_N != 0) {
+
+					/* Send the writes first */
+					break;
+				}
 
 				sprintf(priv->lbuf, "reg %i" LINK_EOL, reg_ID);
 
@@ -850,6 +1416,28 @@ void link_push(struct link_pmc *lp)
 
 				break;
 			}
+			else if (dofetch != 0) {
+
+				if (min >= 0 && reg_ID == max + 1) {
+
+					max = reg_ID;
+				}
+				else {
+					if (strlen(priv->lbuf) > LINK_BATCH_MAX - 24)
+						break;
+
+					if (min >= 0) {
+
+						link_push_range(priv->lbuf, min, max);
+					}
+
+					min = reg_ID;
+					max = reg_ID;
+				}
+
+				reg->queued = lp->clock;
+				queued_N++;
+			}
 		}
 		else {
 			if (reg->queued + 1000 < lp->clock)
@@ -867,6 +1455,28 @@ void link_push(struct link_pmc *lp)
 	while (1);
 
 	priv->reg_push_ID = reg_ID;
+
+	if (set_N != 0) {
+
+		strcat(sbuf, LINK_EOL);
+
+		if (serial_fputs(priv->fd, sbuf) == SERIAL_OK) {
+
+			lp->locked = lp->clock + lp->quantum;
+		}
+	}
+
+	if (min >= 0) {
+
+		link_push_range(priv->lbuf, min, max);
+
+		strcat(priv->lbuf, LINK_EOL);
+
+		if (serial_fputs(priv->fd, priv->lbuf) == SERIAL_OK) {
+
+			lp->locked = lp->clock + lp->quantum;
+		}
+	}
 }
 
 int link_command(struct link_pmc *lp, const char *command)
@@ -894,19 +1504,32 @@ int link_command(struct link_pmc *lp, const char *command)
 
 struct link_reg *link_reg_lookup(struct link_pmc *lp, const char *sym)
 {
+	struct link_priv		*priv = lp->priv;
 	struct link_reg			*reg = NULL;
+	unsigned int			n;
 	int				reg_ID;
 
-	for (reg_ID = 0; reg_ID < lp->reg_MAX_N; ++reg_ID) {
+	if (lp->reg_MAX_N == 0)
+		return NULL;
 
-		if (lp->reg[reg_ID].sym[0] != 0) {
+	if (priv->reg_hash_dirty != 0) {
 
-			if (strcmp(lp->reg[reg_ID].sym, sym) == 0) {
+		link_reg_hash_rebuild(lp);
+	}
 
-				reg = &lp->reg[reg_ID];
-				break;
-			}
+	n = link_reg_hash(sym);
+
+	while (priv->reg_hash[n] != 0) {
+
+		reg_ID = priv->reg_hash[n] - 1;
+
+		if (strcmp(lp->reg[reg_ID].sym, sym) == 0) {
+
+			reg = &lp->reg[reg_ID];
+			break;
 		}
+
+		n = (n + 1U) & (LINK_HASH_MAX - 1U);
 	}
 
 	return reg;
@@ -914,27 +1537,45 @@ struct link_reg *link_reg_lookup(struct link_pmc *lp, const char *sym)
 
 int link_reg_lookup_range(struct link_pmc *lp, const char *sym, int *min, int *max)
 {
-	int				n, rc, reg_ID;
+	struct link_priv		*priv = lp->priv;
+	int				n, rc, reg_ID, sort_ID;
+
+	if (lp->reg_MAX_N == 0)
+		return 0;
 
 	n = strlen(sym);
 	rc = 0;
 
-	for (reg_ID = 0; reg_ID < lp->reg_MAX_N; ++reg_ID) {
+	/* All names with the prefix are adjacent in sorted index so we take
+	 * the lowest ID among them.
+	 * */
+	for (sort_ID = link_reg_sort_bound(lp, sym); sort_ID < priv->reg_sort_N; ++sort_ID) {
 
-		if (lp->reg[reg_ID].sym[0] != 0) {
+		reg_ID = priv->reg_sort[sort_ID];
 
-			if (strncmp(lp->reg[reg_ID].sym, sym, n) == 0) {
+		if (strncmp(lp->reg[reg_ID].sym, sym, n) != 0)
+			break;
 
-				if (rc == 0) {
+		if (rc == 0 || reg_ID < *min) {
 
-					*min = reg_ID;
-					rc = 1;
-				}
+			*min = reg_ID;
+			rc = 1;
+		}
+	}
 
-				*max = reg_ID;
-			}
-			else if (rc != 0)
+	if (rc == 0)
+		return 0;
+
+	*max = *min;
+
+	for (reg_ID = *min + 1; reg_ID < lp->reg_MAX_N; ++reg_ID) {
+
+		if (lp->reg[reg_ID].sym[0] != 0) {
+
+			if (strncmp(lp->reg[reg_ID].sym, sym, n) != 0)
 				break;
+
+			*max = reg_ID;
 		}
 	}
 
@@ -1073,7 +1714,15 @@ int link_grab_file_open(struct link_pmc *lp, const char *file)
 
 			priv->fd_grab = fd;
 
+			priv->tlm.layout_N = 0;
+			priv->tlm.row_rp = 0;
+			priv->tlm.row_wp = 0;
+
 			lp->grab_N = 1;
+			lp->grab_lost = 0;
+			lp->grab_overflow = 0;
+			lp->grab_rows = 0;
+			lp->grab_label[0] = 0;
 
 			rc = 1;
 		}
@@ -1103,3 +1752,39 @@ void link_grab_file_close(struct link_pmc *lp)
 	}
 }
 
+const double *link_grab_row(struct link_pmc *lp, int *cN)
+{
+	struct link_priv	*priv = lp->priv;
+	const double		*row;
+
+	if (lp->linked == 0)
+		return NULL;
+
+	if (priv->tlm.row_rp == priv->tlm.row_wp)
+		return NULL;
+
+	row = priv->tlm.row[priv->tlm.row_rp];
+
+	priv->tlm.row_rp = (priv->tlm.row_rp + 1) % LINK_TLM_ROW_MAX;
+
+	*cN = priv->tlm.layout_N + 1;
+
+	return row;
+}
+
+int link_feature(struct link_pmc *lp, const char *sym)
+{
+	const char		*s = lp->feature;
+	int			len = strlen(sym);
+
+	while ((s = strstr(s, sym)) != NULL) {
+
+		if (		s[-1] == ' '
+				&& (s[len] == ' ' || s[len] == 0))
+			return 1;
+
+		s += len;
+	}
+
+	return 0;
+}
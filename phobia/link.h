@@ -71,6 +71,7 @@ struct link_pmc {
 	int			keep;
 
 	char			hwinfo[LINK_NAME_MAX];
+	char			feature[LINK_MESSAGE_MAX];
 	char			network[LINK_NAME_MAX];
 
 	struct {
@@ -91,6 +92,11 @@ struct link_pmc {
 
 	int			line_N;
 	int			grab_N;
+	int			grab_lost;
+	int			grab_overflow;
+	int			grab_rows;
+
+	char			grab_label[LINK_MESSAGE_MAX];
 
 	struct link_reg		reg[LINK_REGS_MAX];
 
@@ -107,6 +113,7 @@ void link_remote(struct link_pmc *lp);
 
 int link_fetch(struct link_pmc *lp, int clock);
 void link_push(struct link_pmc *lp);
+void link_wait(struct link_pmc *lp, int timeout);
 int link_command(struct link_pmc *lp, const char *command);
 
 struct link_reg *link_reg_lookup(struct link_pmc *lp, const char *sym);
@@ -117,6 +124,9 @@ void link_reg_clean_all_always(struct link_pmc *lp);
 int link_log_file_open(struct link_pmc *lp, const char *file);
 int link_grab_file_open(struct link_pmc *lp, const char *file);
 void link_grab_file_close(struct link_pmc *lp);
+const double *link_grab_row(struct link_pmc *lp, int *cN);
+
+int link_feature(struct link_pmc *lp, const char *sym);
 
 #endif /* _H_LINK_ */
 
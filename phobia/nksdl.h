@@ -40,6 +40,15 @@ struct nk_sdl {
 	int				updated;
 	int				idled;
 
+	/* Frame time statistics published once per second (us).
+	 * */
+	Uint64				frame_sum;
+	Uint64				frame_max;
+	int				frame_N;
+	int				frame_clock;
+	int				frame_avg;
+	int				frame_peak;
+
 	SDL_Window			*window;
 	SDL_Surface			*fb;
 	SDL_Surface			*surface;
@@ -888,6 +888,42 @@ pub_open_GP(struct public *pub, const char *file)
 	pub->gp_ID = gp_OpenWindow(pub->gp);
 }
 
+static void
+pub_take_GP(struct public *pub)
+{
+	struct link_pmc			*lp = pub->lp;
+	const double			*row;
+	int				cN;
+
+	while ((row = link_grab_row(lp, &cN)) != NULL) {
+
+		if (pub->telemetry.wait_GP == 2) {
+
+			pub->telemetry.wait_GP = 0;
+
+			if (pub->gp != NULL) {
+
+				gp_Clean(pub->gp);
+			}
+
+			/* Decoded rows go straight into the dataset so GP
+			 * does not parse the text we have just written.
+			 * */
+			pub->gp = gp_Alloc();
+
+			gp_OpenDataset(pub->gp, 0, cN, lp->grab_label);
+			gp_TakeConfig(pub->gp, "mkpages 0\n");
+
+			pub->gp_ID = gp_OpenWindow(pub->gp);
+		}
+
+		if (pub->gp != NULL) {
+
+			gp_TakeRow(pub->gp, 0, row);
+		}
+	}
+}
+
 static void
 pub_popup_telemetry_grab(struct public *pub, int popup)
 {
@@ -971,7 +1007,16 @@ pub_popup_telemetry_grab(struct public *pub, int popup)
 
 				if (link_grab_file_open(lp, pub->telemetry.file_snap) != 0) {
 
-					if (link_command(lp, "tlm_flush_sync") != 0) {
+					if (link_feature(lp, "tlm_flush_bin") != 0) {
+
+						if (link_command(lp, "tlm_flush_bin") != 0) {
+
+							lp->grab_rows = 1;
+
+							pub->telemetry.wait_GP = 2;
+						}
+					}
+					else if (link_command(lp, "tlm_flush_sync") != 0) {
 
 						pub->telemetry.wait_GP = 1;
 					}
@@ -1010,7 +1055,16 @@ pub_popup_telemetry_grab(struct public *pub, int popup)
 
 			if (link_grab_file_open(lp, pub->telemetry.file_snap) != 0) {
 
-				if (link_command(lp, "tlm_live_sync") != 0) {
+				if (link_feature(lp, "tlm_stream_sync") != 0) {
+
+					if (link_command(lp, "tlm_stream_sync") != 0) {
+
+						lp->grab_rows = 1;
+
+						pub->telemetry.wait_GP = 2;
+					}
+				}
+				else if (link_command(lp, "tlm_live_sync") != 0) {
 
 					pub->telemetry.wait_GP = 1;
 				}
@@ -1039,7 +1093,19 @@ pub_popup_telemetry_grab(struct public *pub, int popup)
 
 		nk_spacer(ctx);
 
-		sprintf(pub->lbuf, "# %i", lp->grab_N);
+		if (lp->grab_overflow != 0) {
+
+			sprintf(pub->lbuf, "# %i / %i lost / %i overflow", lp->grab_N,
+					lp->grab_lost, lp->grab_overflow);
+		}
+		else if (lp->grab_lost != 0) {
+
+			sprintf(pub->lbuf, "# %i / %i lost", lp->grab_N, lp->grab_lost);
+		}
+		else {
+			sprintf(pub->lbuf, "# %i", lp->grab_N);
+		}
+
 		nk_label(ctx, pub->lbuf, NK_TEXT_LEFT);
 
 		nk_spacer(ctx);
@@ -1179,7 +1245,7 @@ pub_popup_telemetry_grab(struct public *pub, int popup)
 
 		nk_spacer(ctx);
 
-		if (		pub->telemetry.wait_GP != 0
+		if (		pub->telemetry.wait_GP == 1
 				&& lp->grab_N >= 5) {
 
 			pub->telemetry.wait_GP = 0;
@@ -2489,6 +2555,13 @@ page_serial(struct public *pub)
 
 	nk_spacer(ctx);
 
+	nk_label(ctx, "Frame time", NK_TEXT_LEFT);
+
+	sprintf(pub->lbuf, "%i us avg / %i us max", nk->frame_avg, nk->frame_peak);
+	nk_label(ctx, pub->lbuf, NK_TEXT_LEFT);
+
+	nk_spacer(ctx);
+
 	nk_layout_row_dynamic(ctx, 0, 1);
 	nk_spacer(ctx);
 
@@ -5594,6 +5667,8 @@ int main(int argc, char **argv)
 			nk->active = 1;
 		}
 
+		pub_take_GP(pub);
+
 		if (nk->active != 0) {
 
 			nk->idled = 0;
@@ -5608,6 +5683,8 @@ int main(int argc, char **argv)
 			struct nk_rect		bounds = nk_rect(0, 0, nk->surface->w,
 									nk->surface->h);
 
+			Uint64			frame = SDL_GetPerformanceCounter();
+
 			if (lp->hwinfo[0] != 0) {
 
 				struct nk_color		header;
@@ -5652,6 +5729,26 @@ int main(int argc, char **argv)
 			SDL_BlitSurface(nk->surface, NULL, nk->fb, NULL);
 			SDL_UpdateWindowSurface(nk->window);
 
+			frame = SDL_GetPerformanceCounter() - frame;
+
+			nk->frame_sum += frame;
+			nk->frame_max = (frame > nk->frame_max) ? frame : nk->frame_max;
+			nk->frame_N += 1;
+
+			if (nk->frame_clock + 1000 < nk->clock) {
+
+				Uint64		freq = SDL_GetPerformanceFrequency();
+
+				nk->frame_avg = (int) (nk->frame_sum * 1000000U
+						/ (freq * nk->frame_N));
+				nk->frame_peak = (int) (nk->frame_max * 1000000U / freq);
+
+				nk->frame_sum = 0;
+				nk->frame_max = 0;
+				nk->frame_N = 0;
+				nk->frame_clock = nk->clock;
+			}
+
 			nk->updated = nk->clock;
 			nk->active = 0;
 		}
@@ -5663,7 +5760,7 @@ int main(int argc, char **argv)
 
 			if (gp_Draw(pub->gp) == 0) {
 
-				SDL_Delay(10);
+				link_wait(lp, 10);
 			}
 		}
 		else {
@@ -5681,7 +5778,7 @@ int main(int argc, char **argv)
 				pub->gp = NULL;
 			}
 
-			SDL_Delay(10);
+			link_wait(lp, 10);
 		}
 	}
 
@@ -12,6 +12,7 @@
 #include <sys/stat.h>
 #include <dirent.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <termios.h>
 #include <unistd.h>
 #endif /* _WINDOWS */
@@ -24,6 +25,10 @@ struct serial_fd {
 	HANDLE		hFile;
 #else
 	int		port;
+
+	/* We write into this pipe to break the blocking wait of RX thread.
+	 * */
+	int		wake[2];
 #endif /* _WINDOWS */
 
 	struct async_priv	*rxq;
@@ -45,11 +50,19 @@ struct async_priv {
 	char		*ophunk;
 	int		chunk;
 
+	/* The ring is lock-free with a single producer and single consumer.
+	 * We only take the mutex to sleep on the condition until the other
+	 * side moves the pointer.
+	 * */
+	SDL_mutex	*mutex;
+	SDL_cond	*cond;
+
+	SDL_atomic_t	waiting;
 	SDL_atomic_t	terminate;
 };
 
 static struct async_priv *
-async_open(int length)
+async_open(int length, int chunk)
 {
 	struct async_priv	*ap;
 
@@ -58,63 +71,102 @@ async_open(int length)
 	ap->length = length;
 	ap->stream = (char *) malloc(ap->length);
 
-	ap->chunk = 80;
+	ap->chunk = chunk;
 	ap->ophunk = (char *) malloc(ap->chunk);
 
+	ap->mutex = SDL_CreateMutex();
+	ap->cond = SDL_CreateCond();
+
 	return ap;
 }
 
 static void
 async_close(struct async_priv *ap)
 {
+	SDL_DestroyCond(ap->cond);
+	SDL_DestroyMutex(ap->mutex);
+
 	free(ap->stream);
 	free(ap->ophunk);
 	free(ap);
 }
 
+static void
+async_notify(struct async_priv *ap)
+{
+	SDL_LockMutex(ap->mutex);
+	SDL_CondBroadcast(ap->cond);
+	SDL_UnlockMutex(ap->mutex);
+}
+
+/* Wait until the write pointer moves away from \pos.
+ * */
+static void
+async_wait(struct async_priv *ap, int pos, int timeout)
+{
+	SDL_LockMutex(ap->mutex);
+
+	if (		SDL_AtomicGet(&ap->wp) == pos
+			&& SDL_AtomicGet(&ap->terminate) == 0) {
+
+		SDL_CondWaitTimeout(ap->cond, ap->mutex, timeout);
+	}
+
+	SDL_UnlockMutex(ap->mutex);
+}
+
 static int
-async_getc(struct async_priv *ap)
+async_read(struct async_priv *ap, char *s, int n)
 {
-	int		rp, wp, cq;
+	int		rp, wp, nr, nq;
 
 	rp = SDL_AtomicGet(&ap->rp);
 	wp = SDL_AtomicGet(&ap->wp);
 
-	if (rp != wp) {
+	nr = wp - rp;
+	nr += (nr < 0) ? ap->length : 0;
 
-		cq = (int) ap->stream[rp];
-		rp = (rp < ap->length - 1) ? rp + 1 : 0;
+	n = (n < nr) ? n : nr;
 
-		SDL_AtomicSet(&ap->rp, rp);
+	nq = ap->length - rp;
+	nq = (n < nq) ? n : nq;
 
-		return cq;
-	}
-	else {
-		return SERIAL_ASYNC_WAIT;
-	}
+	memcpy(s, ap->stream + rp, nq);
+	memcpy(s + nq, ap->stream, n - nq);
+
+	rp += n;
+	rp -= (rp >= ap->length) ? ap->length : 0;
+
+	SDL_AtomicSet(&ap->rp, rp);
+
+	return n;
 }
 
 static int
-async_putc(struct async_priv *ap, int cq)
+async_write(struct async_priv *ap, const char *s, int n)
 {
-	int		rp, wp, wpi;
+	int		rp, wp, nr, nq;
 
 	rp = SDL_AtomicGet(&ap->rp);
 	wp = SDL_AtomicGet(&ap->wp);
 
-	wpi = (wp < ap->length - 1) ? wp + 1 : 0;
+	nr = rp - wp - 1;
+	nr += (nr < 0) ? ap->length : 0;
 
-	if (wpi != rp) {
+	n = (n < nr) ? n : nr;
 
-		ap->stream[wp] = (char) cq;
+	nq = ap->length - wp;
+	nq = (n < nq) ? n : nq;
 
-		SDL_AtomicSet(&ap->wp, wpi);
+	memcpy(ap->stream + wp, s, nq);
+	memcpy(ap->stream, s + nq, n - nq);
 
-		return SERIAL_OK;
-	}
-	else {
-		return SERIAL_ASYNC_WAIT;
-	}
+	wp += n;
+	wp -= (wp >= ap->length) ? ap->length : 0;
+
+	SDL_AtomicSet(&ap->wp, wp);
+
+	return n;
 }
 
 static int
@@ -162,6 +214,13 @@ async_fgets(struct async_priv *ap, char *sbuf, int n)
 
 			SDL_AtomicSet(&ap->rp, rp);
 
+			if (SDL_AtomicGet(&ap->waiting) != 0) {
+
+				/* Producer is waiting for free space.
+				 * */
+				async_notify(ap);
+			}
+
 			return SERIAL_OK;
 		}
 		else {
@@ -391,6 +450,13 @@ serial_port_open(const char *devname, int baudrate, const char *mode)
 	return fd;
 }
 
+static void
+serial_port_wait(struct serial_fd *fd)
+{
+	/* We rely on ReadFile() timeout to wait for incoming data.
+	 * */
+}
+
 static int
 serial_port_read(struct serial_fd *fd, char *s, int n)
 {
@@ -594,9 +660,32 @@ serial_port_open(const char *devname, int baudrate, const char *mode)
 
 	fd->port = port;
 
+	if (pipe(fd->wake) != 0) {
+
+		fd->wake[0] = -1;
+		fd->wake[1] = -1;
+	}
+
 	return fd;
 }
 
+static void
+serial_port_wait(struct serial_fd *fd)
+{
+	struct pollfd		pfd[2];
+
+	pfd[0].fd = fd->port;
+	pfd[0].events = POLLIN;
+
+	pfd[1].fd = fd->wake[0];
+	pfd[1].events = POLLIN;
+
+	/* The wait is bounded so the thread still sees the termination if
+	 * the wake pipe was not created or writing into it has failed.
+	 * */
+	poll(pfd, (fd->wake[0] >= 0) ? 2 : 1, (fd->wake[0] >= 0) ? 1000 : 100);
+}
+
 static int
 serial_port_read(struct serial_fd *fd, char *s, int n)
 {
@@ -613,12 +702,24 @@ serial_port_read(struct serial_fd *fd, char *s, int n)
 static int
 serial_port_write(struct serial_fd *fd, const char *s, int n)
 {
-	int		rc, total = 0;
+	struct pollfd		pfd;
+	int			rc, total = 0;
 
 	while (total < n) {
 
 		rc = write(fd->port, s + total, n - total);
 
+		if (rc < 0 && (errno == EAGAIN || errno == EINTR)) {
+
+			/* Wait for the port to drain its output queue.
+			 * */
+			pfd.fd = fd->port;
+			pfd.events = POLLOUT;
+
+			if (poll(&pfd, 1, 1000) > 0)
+				continue;
+		}
+
 		if (rc < 1) {
 
 			return SERIAL_ERROR_UNKNOWN;
@@ -635,35 +736,52 @@ static int
 async_thread_rx(struct serial_fd *fd)
 {
 	struct async_priv	*ap = fd->rxq;
-	int			cq, rc, n, i;
+	int			n, i;
 
 	do {
+		serial_port_wait(fd);
+
+		if (SDL_AtomicGet(&ap->terminate) != 0)
+			break;
+
 		n = serial_port_read(fd, ap->ophunk, ap->chunk);
 
-		for (i = 0; i < n; ++i) {
+		if (n < 1) {
+
+			/* Port is closed on the other side or timed out.
+			 * */
+			SDL_Delay(10);
+			continue;
+		}
 
-			cq = (int) ap->ophunk[i];
+		i = async_write(ap, ap->ophunk, n);
 
-			do {
-				rc = async_putc(ap, cq);
+		async_notify(ap);
 
-				if (rc == SERIAL_OK)
-					break;
+		while (i < n) {
 
-				SDL_Delay(10);
+			/* Sleep until consumer frees some space.
+			 * */
+			SDL_LockMutex(ap->mutex);
+			SDL_AtomicSet(&ap->waiting, 1);
+
+			if (		async_space_available(ap) < 2
+					&& SDL_AtomicGet(&ap->terminate) == 0) {
+
+				SDL_CondWaitTimeout(ap->cond, ap->mutex, 100);
 			}
-			while (1);
-		}
 
-		SDL_Delay(1);
+			SDL_AtomicSet(&ap->waiting, 0);
+			SDL_UnlockMutex(ap->mutex);
 
-		if (SDL_AtomicGet(&ap->terminate) != 0)
-			break;
+			if (SDL_AtomicGet(&ap->terminate) != 0)
+				break;
+
+			i += async_write(ap, ap->ophunk + i, n - i);
+		}
 	}
 	while (1);
 
-	async_close(ap);
-
 	return 0;
 }
 
@@ -671,28 +789,12 @@ static int
 async_thread_tx(struct serial_fd *fd)
 {
 	struct async_priv	*ap = fd->txq;
-	int			cq, rc, n, terminate = 0;
+	int			rc, n, terminate;
 
 	do {
-		n = 0;
-
-		if (SDL_AtomicGet(&ap->terminate) != 0) {
-
-			terminate = 1;
-		}
-
-		do {
-			cq = async_getc(ap);
-
-			if (cq == SERIAL_ASYNC_WAIT)
-				break;
-
-			ap->ophunk[n++] = (char) cq;
+		terminate = SDL_AtomicGet(&ap->terminate);
 
-			if (n >= ap->chunk)
-				break;
-		}
-		while (1);
+		n = async_read(ap, ap->ophunk, ap->chunk);
 
 		if (n > 0) {
 
@@ -704,16 +806,14 @@ async_thread_tx(struct serial_fd *fd)
 			}
 		}
 		else {
-			SDL_Delay(10);
-
 			if (terminate != 0)
 				break;
+
+			async_wait(ap, SDL_AtomicGet(&ap->rp), 100);
 		}
 	}
 	while (1);
 
-	async_close(ap);
-
 	return 0;
 }
 
@@ -725,8 +825,8 @@ struct serial_fd *serial_open(const char *devname, int baudrate, const char *mod
 
 	if (fd != NULL) {
 
-		fd->rxq = async_open(4000);
-		fd->txq = async_open(200);
+		fd->rxq = async_open(16384, 1024);
+		fd->txq = async_open(200, 80);
 
 		fd->thread_rxq = SDL_CreateThread((int (*) (void *)) &async_thread_rx,
 				"async_thread_rx", fd);
@@ -742,14 +842,22 @@ static int
 serial_thread_garbage(struct serial_fd *fd)
 {
 	SDL_WaitThread(fd->thread_txq, NULL);
+	SDL_WaitThread(fd->thread_rxq, NULL);
+
+	async_close(fd->rxq);
+	async_close(fd->txq);
 
 #ifdef _WINDOWS
 	CloseHandle(fd->hFile);
 #else
 	close(fd->port);
-#endif /* _WINDOWS */
 
-	SDL_WaitThread(fd->thread_rxq, NULL);
+	if (fd->wake[0] >= 0) {
+
+		close(fd->wake[0]);
+		close(fd->wake[1]);
+	}
+#endif /* _WINDOWS */
 
 	free(fd);
 
@@ -763,6 +871,21 @@ void serial_close(struct serial_fd *fd)
 	SDL_AtomicSet(&fd->rxq->terminate, 1);
 	SDL_AtomicSet(&fd->txq->terminate, 1);
 
+	async_notify(fd->rxq);
+	async_notify(fd->txq);
+
+#ifndef _WINDOWS
+	if (fd->wake[1] >= 0) {
+
+		if (write(fd->wake[1], "", 1) != 1) {
+
+			/* RX thread leaves the bounded wait by timeout and
+			 * sees the termination flag then.
+			 * */
+		}
+	}
+#endif /* _WINDOWS */
+
 	thread = SDL_CreateThread((int (*) (void *)) &serial_thread_garbage,
 			"serial_thread_garbage", fd);
 
@@ -771,22 +894,20 @@ void serial_close(struct serial_fd *fd)
 
 int serial_fputs(struct serial_fd *fd, const char *s)
 {
-	int		av, rc;
+	int		av, n;
 
 	av = async_space_available(fd->txq);
+	n = strlen(s);
 
-	if (strlen(s) < av) {
+	if (n < av) {
 
-		while (*s != 0) {
+		if (async_write(fd->txq, s, n) != n) {
 
-			rc = async_putc(fd->txq, *s++);
-
-			if (rc != SERIAL_OK) {
-
-				return SERIAL_ERROR_UNKNOWN;
-			}
+			return SERIAL_ERROR_UNKNOWN;
 		}
 
+		async_notify(fd->txq);
+
 		return SERIAL_OK;
 	}
 	else {
@@ -799,3 +920,12 @@ int serial_fgets(struct serial_fd *fd, char *s, int n)
 	return async_fgets(fd->rxq, s, n);
 }
 
+int serial_wait(struct serial_fd *fd, int timeout)
+{
+	struct async_priv	*ap = fd->rxq;
+
+	async_wait(ap, ap->cached, timeout);
+
+	return (SDL_AtomicGet(&ap->wp) != ap->cached)
+		? SERIAL_OK : SERIAL_ASYNC_WAIT;
+}
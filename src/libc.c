@@ -72,10 +72,10 @@ void *memcpy(void *restrict d, const void *restrict s, size_t n)
 
 int strcmp(const char *s, const char *p)
 {
-	char		c;
+	int		c;
 
 	do {
-		c = *s - *p;
+		c = (int) (uint8_t) *s - (int) (uint8_t) *p;
 
 		if (c || *s == 0)
 			break;
@@ -838,7 +838,7 @@ uint32_t crc32b(const void *s, size_t n)
 	while (n >= 4U) {
 
 		buf = *ls++;
-		n += - 4U;
+		n -= 4U;
 
 		crc = crc ^ buf;
 
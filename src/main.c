@@ -1143,6 +1143,10 @@ SH_DEF(ap_version)
 	rc = (crc32b((const void *) fw.ld_begin, flash_sizeof) == flash_crc32) ? 1 : 0;
 
 	printf("CRC32 %8x (%s)" EOL, flash_crc32, (rc != 0) ? "OK" : "does NOT match");
+
+	/* Host looks here for commands that older firmware does not have.
+	 * */
+	printf("Feature tlm_flush_bin tlm_stream_sync reg_list reg_set" EOL);
 }
 
 SH_DEF(ap_clock)
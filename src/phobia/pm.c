@@ -1384,7 +1384,7 @@ pm_estimate(pmc_t *pm)
 			pm->flux_TYPE = PM_FLUX_ORTEGA;
 		}
 
-		pm_flux_ortega(pm);
+		PM_PROFILE(FLUX_ORTEGA, pm_flux_ortega(pm));
 		pm_flux_zone(pm);
 	}
 	else if (pm->config_LU_ESTIMATE == PM_FLUX_KALMAN) {
@@ -1426,7 +1426,7 @@ pm_estimate(pmc_t *pm)
 			pm->flux_TYPE = PM_FLUX_KALMAN;
 		}
 
-		pm_flux_kalman(pm);
+		PM_PROFILE(FLUX_KALMAN, pm_flux_kalman(pm));
 		pm_flux_zone(pm);
 	}
 	else {
@@ -2050,7 +2050,7 @@ pm_lu_FSM(pmc_t *pm)
 	else if (pm->lu_MODE == PM_LU_SENSOR_HALL) {
 
 		pm_estimate(pm);
-		pm_sensor_hall(pm);
+		PM_PROFILE(SENSOR_HALL, pm_sensor_hall(pm));
 
 		lu_F[0] = pm->hall_F[0];
 		lu_F[1] = pm->hall_F[1];
@@ -2065,7 +2065,7 @@ pm_lu_FSM(pmc_t *pm)
 	else if (pm->lu_MODE == PM_LU_SENSOR_EABI) {
 
 		pm_estimate(pm);
-		pm_sensor_eabi(pm);
+		PM_PROFILE(SENSOR_EABI, pm_sensor_eabi(pm));
 
 		lu_F[0] = pm->eabi_F[0];
 		lu_F[1] = pm->eabi_F[1];
@@ -2160,7 +2160,7 @@ pm_lu_FSM(pmc_t *pm)
 
 		if (lu_EABI != PM_ENABLED) {
 
-			pm_sensor_eabi(pm);
+			PM_PROFILE(SENSOR_EABI, pm_sensor_eabi(pm));
 
 			lu_EABI = PM_ENABLED;
 		}
@@ -3100,7 +3100,7 @@ pm_loop_current(pmc_t *pm)
 
 		/* HF waveform synthesis.
 		 * */
-		pm_hfi_wave(pm);
+		PM_PROFILE(HFI_WAVE, pm_hfi_wave(pm));
 
 		uHF = pm->hfi_sine * pm->quick_HFwS * pm->const_im_L1;
 
@@ -3114,7 +3114,7 @@ pm_loop_current(pmc_t *pm)
 	uX = pm->lu_F[0] * uD - pm->lu_F[1] * uQ;
 	uY = pm->lu_F[1] * uD + pm->lu_F[0] * uQ;
 
-	pm_voltage(pm, uX, uY);
+	PM_PROFILE(VOLTAGE, pm_voltage(pm, uX, uY));
 }
 
 static void
@@ -3397,26 +3397,26 @@ void pm_feedback(pmc_t *pm, pmfb_t *fb)
 
 		/* The observer FSM.
 		 * */
-		pm_lu_FSM(pm);
+		PM_PROFILE(LU_FSM, pm_lu_FSM(pm));
 
 		if (pm->lu_MODE == PM_LU_DETACHED) {
 
-			pm_voltage(pm, pm->vsi_X, pm->vsi_Y);
+			PM_PROFILE(VOLTAGE, pm_voltage(pm, pm->vsi_X, pm->vsi_Y));
 		}
 		else {
 			if (pm->config_LU_DRIVE == PM_DRIVE_SPEED) {
 
-				pm_loop_speed(pm);
+				PM_PROFILE(LOOP_SPEED, pm_loop_speed(pm));
 			}
 			else if (pm->config_LU_DRIVE == PM_DRIVE_LOCATION) {
 
 				pm_loop_location(pm);
-				pm_loop_speed(pm);
+				PM_PROFILE(LOOP_SPEED, pm_loop_speed(pm));
 			}
 
 			/* Current loop is always enabled.
 			 * */
-			pm_loop_current(pm);
+			PM_PROFILE(LOOP_CURRENT, pm_loop_current(pm));
 
 			if (pm->kalman_POSTPONED == PM_ENABLED) {
 
@@ -3424,11 +3424,11 @@ void pm_feedback(pmc_t *pm, pmfb_t *fb)
 				 * values are output to the PWM. This allows
 				 * efficient use of CPU.
 				 * */
-				pm_kalman_forecast(pm);
+				PM_PROFILE(KALMAN_FORECAST, pm_kalman_forecast(pm));
 
 				if (likely(pm->vsi_IF == 0)) {
 
-					pm_kalman_update(pm, pm->flux_X);
+					PM_PROFILE(KALMAN_UPDATE, pm_kalman_update(pm, pm->flux_X));
 				}
 
 				pm->kalman_POSTPONED = PM_DISABLED;
@@ -3458,6 +3458,6 @@ void pm_feedback(pmc_t *pm, pmfb_t *fb)
 
 	/* The FSM is used to execute assistive routines.
 	 * */
-	pm_FSM(pm);
+	PM_PROFILE(FSM, pm_FSM(pm));
 }
 
@@ -14,6 +14,13 @@
 #define PM_MAX_F		1000000000000.f
 #define PM_SFI(s)		#s
 
+#ifndef PM_PROFILE
+/* Cost profiling hook of the subfunction call. It is defined by the bench
+ * to measure the execution cost. On the target it is just a call.
+ * */
+#define PM_PROFILE(id, call)	call
+#endif /* PM_PROFILE */
+
 enum {
 	PM_Z_NONE				= 0,
 	PM_Z_A,
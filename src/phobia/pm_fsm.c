@@ -981,9 +981,9 @@ pm_fsm_state_adjust_current(pmc_t *pm)
 				break;
 			}
 
-			if      (pm->fsm_subi == 0) { pm_voltage(pm, uA, 0.f); }
-			else if (pm->fsm_subi == 1) { pm_voltage(pm, uA, 0.f); }
-			else if (pm->fsm_subi == 2) { pm_voltage(pm, 0.f, uA); }
+			if      (pm->fsm_subi == 0) { PM_PROFILE(VOLTAGE, pm_voltage(pm, uA, 0.f)); }
+			else if (pm->fsm_subi == 1) { PM_PROFILE(VOLTAGE, pm_voltage(pm, uA, 0.f)); }
+			else if (pm->fsm_subi == 2) { PM_PROFILE(VOLTAGE, pm_voltage(pm, 0.f, uA)); }
 
 			pm->tm_value++;
 
@@ -1060,7 +1060,7 @@ pm_fsm_state_adjust_current(pmc_t *pm)
 			break;
 
 		case 6:
-			pm_voltage(pm, 0.f, 0.f);
+			PM_PROFILE(VOLTAGE, pm_voltage(pm, 0.f, 0.f));
 
 			pm->tm_value++;
 
@@ -1265,7 +1265,7 @@ pm_fsm_probe_loop_current(pmc_t *pm, float track_HF)
 		uQ += uHF * pm->hfi_wave[1];
 	}
 
-	pm_voltage(pm, uD, uQ);
+	PM_PROFILE(VOLTAGE, pm_voltage(pm, uD, uQ));
 }
 
 static void
@@ -1371,7 +1371,7 @@ pm_fsm_state_probe_const_resistance(pmc_t *pm)
 			break;
 
 		case 5:
-			pm_voltage(pm, 0.f, 0.f);
+			PM_PROFILE(VOLTAGE, pm_voltage(pm, 0.f, 0.f));
 
 			pm->tm_value++;
 
@@ -1500,7 +1500,7 @@ pm_fsm_state_probe_const_inductance(pmc_t *pm)
 			break;
 
 		case 3:
-			pm_voltage(pm, 0.f, 0.f);
+			PM_PROFILE(VOLTAGE, pm_voltage(pm, 0.f, 0.f));
 
 			pm->tm_value++;
 
@@ -2154,17 +2154,42 @@ void reg_format(const reg_t *reg)
 	}
 }
 
+/* Register IDs sorted by symbol. This is generated by mkconfig.
+ * */
+static const uint16_t	regsort[] = {
+
+#include "regsort.h"
+};
+
+#define REGSORT_MAX				(sizeof(regsort) / sizeof(uint16_t))
+
 const reg_t *reg_search(const char *sym)
 {
 	const reg_t		*reg, *found = NULL;
+	int			lo, hi, mid, rc;
 
-	for (reg = regfile; reg->sym != NULL; ++reg) {
+	lo = 0;
+	hi = REGSORT_MAX - 1;
+
+	while (lo <= hi) {
 
-		if (strcmp(reg->sym, sym) == 0) {
+		mid = (lo + hi) / 2;
+		reg = regfile + regsort[mid];
+
+		rc = strcmp(reg->sym, sym);
+
+		if (rc == 0) {
 
 			found = reg;
 			break;
 		}
+		else if (rc < 0) {
+
+			lo = mid + 1;
+		}
+		else {
+			hi = mid - 1;
+		}
 	}
 
 	return found;
@@ -2181,14 +2206,7 @@ const reg_t *reg_search_fuzzy(const char *sym)
 			found = regfile + n;
 	}
 	else {
-		for (reg = regfile; reg->sym != NULL; ++reg) {
-
-			if (strcmp(reg->sym, sym) == 0) {
-
-				found = reg;
-				break;
-			}
-		}
+		found = reg_search(sym);
 
 		if (found == NULL) {
 
@@ -2273,46 +2291,95 @@ void reg_TOUCH_I(int reg_ID)
 	reg_SET_I(reg_ID, reg_GET_I(reg_ID));
 }
 
-SH_DEF(reg)
+static void
+reg_setval_parse(const reg_t *reg, const char *s)
 {
 	rval_t			rval;
-	const reg_t		*reg, *lreg;
+	const reg_t		*lreg;
 
-	reg = reg_search_fuzzy(s);
+	if (		   reg->fmt[2] == 'i'
+			|| reg->fmt[2] == 'x') {
 
-	if (reg != NULL) {
+		if (reg->mode & REG_LINKED) {
 
-		s = sh_next_arg(s);
+			lreg = reg_search_fuzzy(s);
 
-		if (		   reg->fmt[2] == 'i'
-				|| reg->fmt[2] == 'x') {
+			if (lreg != NULL) {
 
-			if (reg->mode & REG_LINKED) {
+				rval.i = (int) (lreg - regfile);
+				reg_setval(reg, &rval);
+			}
+		}
+		else if (stoi(&rval.i, s) != NULL) {
 
-				lreg = reg_search_fuzzy(s);
+			reg_setval(reg, &rval);
+		}
+		else if (htoi(&rval.i, s) != NULL) {
 
-				if (lreg != NULL) {
+			reg_setval(reg, &rval);
+		}
+	}
+	else {
+		if (stof(&rval.f, s) != NULL) {
 
-					rval.i = (int) (lreg - regfile);
-					reg_setval(reg, &rval);
-				}
-			}
-			else if (stoi(&rval.i, s) != NULL) {
+			reg_setval(reg, &rval);
+		}
+	}
+}
 
-				reg_setval(reg, &rval);
-			}
-			else if (htoi(&rval.i, s) != NULL) {
+static const char *
+reg_stoi_range(int *min, int *max, const char *s)
+{
+	int		n, d;
 
-				reg_setval(reg, &rval);
-			}
-		}
-		else {
-			if (stof(&rval.f, s) != NULL) {
+	n = 0;
+	d = 0;
 
-				reg_setval(reg, &rval);
-			}
+	while (*s >= '0' && *s <= '9') {
+
+		n = 10 * n + (*s++ - '0');
+		d += 1;
+	}
+
+	if (d == 0 || d > 5) { return NULL; }
+
+	*min = n;
+	*max = n;
+
+	if (*s == '-') {
+
+		s++;
+
+		n = 0;
+		d = 0;
+
+		while (*s >= '0' && *s <= '9') {
+
+			n = 10 * n + (*s++ - '0');
+			d += 1;
 		}
 
+		if (d == 0 || d > 5) { return NULL; }
+
+		*max = n;
+	}
+
+	if (*s != 0 && *s != ' ') { return NULL; }
+
+	return s;
+}
+
+SH_DEF(reg)
+{
+	const reg_t		*reg;
+
+	reg = reg_search_fuzzy(s);
+
+	if (reg != NULL) {
+
+		s = sh_next_arg(s);
+
+		reg_setval_parse(reg, s);
 		reg_format(reg);
 	}
 	else {
@@ -2326,6 +2393,38 @@ SH_DEF(reg)
 	}
 }
 
+SH_DEF(reg_list)
+{
+	int			reg_ID, min, max;
+
+	while (reg_stoi_range(&min, &max, s) != NULL) {
+
+		max = (max < (int) REGFILE_MAX - 1) ? max : (int) REGFILE_MAX - 1;
+
+		for (reg_ID = min; reg_ID <= max; ++reg_ID) {
+
+			reg_format(regfile + reg_ID);
+		}
+
+		s = sh_next_arg(s);
+	}
+}
+
+SH_DEF(reg_set)
+{
+	const reg_t		*reg;
+
+	while ((reg = reg_search_fuzzy(s)) != NULL) {
+
+		s = sh_next_arg(s);
+
+		reg_setval_parse(reg, s);
+		reg_format(reg);
+
+		s = sh_next_arg(s);
+	}
+}
+
 SH_DEF(config_reg)
 {
 	rval_t			rval;
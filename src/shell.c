@@ -85,17 +85,21 @@ static void
 sh_exact_match_call(priv_sh_t *sh)
 {
 	const sh_cmd_t		*cmd;
-	const char		*id;
+	int			lo, hi, mid, rc;
 
-	cmd = cmLIST;
+	/* The command list is sorted by mkconfig.
+	 * */
+	lo = 0;
+	hi = cmLIST_END - cmLIST;
 
-	do {
-		id = cmd->sym;
+	while (lo <= hi) {
 
-		if (id == NULL)
-			break;
+		mid = (lo + hi) / 2;
+		cmd = cmLIST + mid;
 
-		if (strcmp(sh->cline, id) == 0) {
+		rc = strcmp(sh->cline, cmd->sym);
+
+		if (rc == 0) {
 
 			/* Call the function.
 			 * */
@@ -103,10 +107,14 @@ sh_exact_match_call(priv_sh_t *sh)
 
 			break;
 		}
+		else if (rc < 0) {
 
-		++cmd;
+			hi = mid - 1;
+		}
+		else {
+			lo = mid + 1;
+		}
 	}
-	while (1);
 }
 
 static void
@@ -26,6 +26,43 @@ void tlm_reg_default(tlm_t *tlm)
 	tlm->reg_ID[9] = ID_HAL_CNT_DIAG2_PC;
 }
 
+static void
+tlm_reg_stream(tlm_t *tlm)
+{
+	int			line_end;
+
+	line_end = tlm->block_N * (tlm->block_fill + 1) - 1;
+
+	if (likely(tlm->line < line_end)) {
+
+		tlm->line += 1;
+	}
+	else {
+		if (tlm->line == tlm->block_N * 2) {
+
+			/* The line was written into scratch so it is lost.
+			 * */
+			tlm->overflow += 1;
+		}
+
+		if (tlm->block_ready < 0) {
+
+			tlm->block_ready = tlm->block_fill;
+			tlm->block_fill ^= 1;
+
+			tlm->block_clock[tlm->block_fill] = tlm->clock;
+
+			tlm->line = tlm->block_N * tlm->block_fill;
+		}
+		else {
+			/* Both blocks are busy so we write into scratch line
+			 * until the shipping is done.
+			 * */
+			tlm->line = tlm->block_N * 2;
+		}
+	}
+}
+
 void tlm_reg_grab(tlm_t *tlm)
 {
 	int			N;
@@ -50,6 +87,12 @@ void tlm_reg_grab(tlm_t *tlm)
 		tlm->clock += 1;
 		tlm->skip = 0;
 
+		if (tlm->mode == TLM_MODE_STREAM) {
+
+			tlm_reg_stream(tlm);
+			return ;
+		}
+
 		tlm->line = (tlm->line < (tlm->length_MAX - 1)) ? tlm->line + 1 : 0;
 
 		if (tlm->mode == TLM_MODE_GRAB) {
@@ -95,6 +138,19 @@ void tlm_startup(tlm_t *tlm, int rate, int mode)
 
 	tlm->rate = rate;
 
+	if (mode == TLM_MODE_STREAM) {
+
+		/* We keep one scratch line after the blocks.
+		 * */
+		tlm->block_N = (tlm->length_MAX - 1) / 2;
+		tlm->block_fill = 0;
+		tlm->block_clock[0] = 0;
+		tlm->block_ready = -1;
+
+		tlm->overflow = 0;
+		tlm->line = 0;
+	}
+
 	hal_memory_fence();
 
 	tlm->mode = mode;
@@ -225,6 +281,279 @@ SH_DEF(tlm_flush_sync)
 	while (line != tlm.line);
 }
 
+static void
+tlm_base64_puts(const uint8_t *data, int len)
+{
+	const char		*b64 = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+					"abcdefghijklmnopqrstuvwxyz0123456789+/";
+	uint32_t		x;
+	int			N;
+
+	for (N = 0; N < len; N += 3) {
+
+		x = (uint32_t) data[N] << 16;
+		x |= (N + 1 < len) ? (uint32_t) data[N + 1] << 8 : 0U;
+		x |= (N + 2 < len) ? (uint32_t) data[N + 2] : 0U;
+
+		putc(b64[(x >> 18) & 0x3FU]);
+		putc(b64[(x >> 12) & 0x3FU]);
+		putc((N + 1 < len) ? b64[(x >> 6) & 0x3FU] : '=');
+		putc((N + 2 < len) ? b64[x & 0x3FU] : '=');
+	}
+}
+
+static void
+tlm_frame_flush(uint32_t *frame, int len)
+{
+	uint8_t			*bframe = (uint8_t *) frame;
+	uint32_t		crc;
+
+	while ((len & 3) != 0) {
+
+		bframe[len++] = 0;
+	}
+
+	/* We append CRC32 of the frame in little-endian.
+	 * */
+	crc = crc32b(frame, len);
+
+	bframe[len++] = (uint8_t) (crc);
+	bframe[len++] = (uint8_t) (crc >> 8);
+	bframe[len++] = (uint8_t) (crc >> 16);
+	bframe[len++] = (uint8_t) (crc >> 24);
+
+	putc('$');
+
+	tlm_base64_puts(bframe, len);
+
+	puts(EOL);
+}
+
+static int
+tlm_frame_line(tlm_t *tlm, uint8_t *bframe, int line, uint32_t *lprev, int delta)
+{
+	const rval_t		*rdata = tlm->rdata + tlm->layout_N * line;
+	uint8_t			*code = bframe;
+	uint32_t		x;
+	int			N, len;
+
+	len = (tlm->layout_N + 3) / 4;
+
+	for (N = 0; N < len; ++N) {
+
+		code[N] = 0;
+	}
+
+	for (N = 0; N < tlm->layout_N; ++N) {
+
+		const reg_t	*reg = tlm->layout_reg[N];
+		rval_t		rval = rdata[N];
+
+		if (reg->proc != NULL) {
+
+			reg_t		lreg = { .link = &rval };
+
+			reg->proc(&lreg, &rval, NULL);
+		}
+
+		/* We take XOR with previous value of the same column. So the
+		 * leading bytes that are not changed become zero.
+		 * */
+		x = (delta != 0) ? (uint32_t) rval.i ^ lprev[N] : (uint32_t) rval.i;
+
+		lprev[N] = (uint32_t) rval.i;
+
+		if (x == 0U) {
+
+			/* Nothing to send */
+		}
+		else if (x < 0x100U) {
+
+			code[N / 4] |= 1U << ((N & 3) * 2);
+
+			bframe[len++] = (uint8_t) (x);
+		}
+		else if (x < 0x10000U) {
+
+			code[N / 4] |= 2U << ((N & 3) * 2);
+
+			bframe[len++] = (uint8_t) (x);
+			bframe[len++] = (uint8_t) (x >> 8);
+		}
+		else {
+			code[N / 4] |= 3U << ((N & 3) * 2);
+
+			bframe[len++] = (uint8_t) (x);
+			bframe[len++] = (uint8_t) (x >> 8);
+			bframe[len++] = (uint8_t) (x >> 16);
+			bframe[len++] = (uint8_t) (x >> 24);
+		}
+	}
+
+	return len;
+}
+
+static void
+tlm_frame_header(tlm_t *tlm, int length)
+{
+	float			dT;
+	int			N, precision;
+
+	dT = (float) tlm->rate / hal.PWM_frequency;
+
+	precision = (int) (2.9f - m_log10f(dT));
+	precision = (precision < 2) ? 2
+		  : (precision > 7) ? 7 : precision;
+
+	tlm_reg_label(tlm);
+
+	/* Header line gives the host all it needs to decode the frames.
+	 * */
+	printf("$H %i %i %i %i %1f", tlm->layout_N, length,
+			precision, tlm->rate, &hal.PWM_frequency);
+
+	for (N = 0; N < tlm->layout_N; ++N) {
+
+		const reg_t	*reg = tlm->layout_reg[N];
+
+		printf(" %c%c", reg->fmt[1], reg->fmt[2]);
+	}
+
+	puts(EOL);
+}
+
+static int
+tlm_frame_block(tlm_t *tlm, int line, int clock, int length, int delta)
+{
+	uint32_t		frame[TLM_FRAME_MAX / 4];
+	uint8_t			*bframe = (uint8_t *) frame;
+	uint32_t		lprev[TLM_INPUT_MAX];
+	int			N, len, rows, wcase;
+
+	/* Worst case size of one encoded line.
+	 * */
+	wcase = (tlm->layout_N + 3) / 4 + tlm->layout_N * 4;
+
+	len = 0;
+	rows = 0;
+
+	while (length > 0) {
+
+		if (len + wcase > TLM_FRAME_MAX - 8) {
+
+			bframe[2] = (uint8_t) rows;
+
+			tlm_frame_flush(frame, len);
+
+			len = 0;
+
+			if (		   poll() != 0
+					&& getc() != K_LF)
+				return 0;
+		}
+
+		if (len == 0) {
+
+			/* Each frame starts with raw values so that a corrupted
+			 * frame does not spoil the rest.
+			 * */
+			for (N = 0; N < tlm->layout_N; ++N) {
+
+				lprev[N] = 0U;
+			}
+
+			bframe[0] = (uint8_t) (clock);
+			bframe[1] = (uint8_t) (clock >> 8);
+			bframe[2] = 0;
+			bframe[3] = (uint8_t) delta;
+
+			len = 4;
+			rows = 0;
+		}
+
+		len += tlm_frame_line(tlm, bframe + len, line, lprev, delta);
+
+		rows += 1;
+
+		line = (line < (tlm->length_MAX - 1)) ? line + 1 : 0;
+
+		clock += 1;
+		length -= 1;
+	}
+
+	if (len != 0) {
+
+		bframe[2] = (uint8_t) rows;
+
+		tlm_frame_flush(frame, len);
+	}
+
+	return 1;
+}
+
+SH_DEF(tlm_flush_bin)
+{
+	int			delta = 1;
+
+	if (tlm.mode != TLM_MODE_DISABLED)
+		return ;
+
+	stoi(&delta, s);
+
+	tlm_frame_header(&tlm, tlm.length_MAX);
+	tlm_frame_block(&tlm, tlm.line, 0, tlm.length_MAX, delta);
+}
+
+SH_DEF(tlm_stream_sync)
+{
+	int			rate, ready, overflow = 0;
+
+	if (tlm.mode != TLM_MODE_DISABLED)
+		return ;
+
+	rate = tlm.rate_grab;
+
+	stoi(&rate, s);
+
+	tlm_startup(&tlm, rate, TLM_MODE_STREAM);
+	tlm_frame_header(&tlm, 0);
+
+	do {
+		vTaskDelay((TickType_t) 1);
+
+		ready = tlm.block_ready;
+
+		if (ready >= 0) {
+
+			hal_memory_fence();
+
+			if (tlm_frame_block(&tlm, tlm.block_N * ready,
+					tlm.block_clock[ready], tlm.block_N, 1) == 0)
+				break;
+
+			hal_memory_fence();
+
+			tlm.block_ready = -1;
+		}
+
+		if (tlm.overflow != overflow) {
+
+			overflow = tlm.overflow;
+
+			/* Tell the host how many lines are lost.
+			 * */
+			printf("$O %i" EOL, overflow);
+		}
+
+		if (		   poll() != 0
+				&& getc() != K_LF)
+			break;
+	}
+	while (1);
+
+	tlm_halt(&tlm);
+}
+
 SH_DEF(tlm_live_sync)
 {
 	float			time, dT;
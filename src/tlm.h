@@ -8,11 +8,17 @@
 #define TLM_DATA_MAX		20000
 #define TLM_INPUT_MAX		10
 
+/* Maximal size of binary frame. It is chosen so that base64 encoded frame
+ * fits into the host line buffer.
+ * */
+#define TLM_FRAME_MAX		152
+
 enum {
 	TLM_MODE_DISABLED	= 0,
 	TLM_MODE_GRAB,
 	TLM_MODE_WATCH,
-	TLM_MODE_LIVE
+	TLM_MODE_LIVE,
+	TLM_MODE_STREAM
 };
 
 typedef struct {
@@ -34,6 +40,17 @@ typedef struct {
 	int		rate;
 	int		line;
 
+	/* In stream mode memory is divided into two blocks. IRQ fills one
+	 * block while the other is being shipped.
+	 * */
+	int		block_N;
+	int		block_fill;
+	int		block_clock[2];
+
+	volatile int	block_ready;
+
+	int		overflow;
+
 	rval_t		rdata[TLM_DATA_MAX];	/* memory to keep telemetry data */
 }
 tlm_t;